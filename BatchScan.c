@@ -0,0 +1,529 @@
+/* C-program file that contains the
+   code for the batch mode of rpe64.
+
+   This functionality of rpe64 takes any number of files, directories and file lists
+   (a file list, or '-' for the standard input, holds one path per line),
+   walks the directories recursively, and reports on every file found
+   using a pool of worker threads within a single process.
+
+   Every worker thread has its own queue of files. The directory walk deals the files
+   out to the queues in turn, and a worker whose queue runs dry steals files from the
+   back of the other queues, so that one huge file doesn't hold up the files queued behind it.
+   The reports are written in the order in which the files were found (deterministic order),
+   or as soon as each of them is ready if the '-u' option is used (streaming order).
+ */
+
+#define _DEFAULT_SOURCE     // for the d_type field of directory entries and sysconf(_SC_NPROCESSORS_ONLN)
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "rpe64Header.h"
+
+#define BATCH_WINDOW_PER_WORKER 1024    // Files per worker that may be queued or waiting to be written before the walk pauses
+#define BATCH_STDOUT_BUFFER (1 << 20)   // Size of the standard output buffer in batch mode
+
+// A file that is waiting to be reported on, and its position in the order in which the files were found
+typedef struct ScanTask
+{
+    char *path;
+    size_t index;
+} ScanTask;
+
+// Queue of files owned by one worker thread, stored as a ring buffer
+typedef struct TaskDeque
+{
+    pthread_mutex_t lock;
+    ScanTask *items;
+    size_t head;                // Position of the oldest file
+    size_t count;
+    size_t cap;
+} TaskDeque;
+
+// Finished report that is waiting for the reports of the files found before it to be written
+typedef struct ScanReport
+{
+    char *text;
+    size_t len;
+    int ready;
+} ScanReport;
+
+typedef struct BatchState
+{
+    const RpeOptions *opts;
+    int workers;
+    TaskDeque *queues;
+    size_t nextQueue;           // Queue that the next file found by the walk is dealt to
+    size_t window;              // Maximum number of files that are queued or waiting to be written
+
+    pthread_mutex_t lock;       // Protects all the fields below
+    pthread_cond_t work;        // Signalled when a file is queued, or when the walk is over
+    pthread_cond_t room;        // Signalled when a report is written
+    long queued;                // Number of files in all the queues
+    size_t submitted;           // Number of files found by the walk so far
+    size_t written;             // Number of reports written so far
+    int walkDone;
+    int failed;                 // Set if any file couldn't be decoded
+    ScanReport *reports;        // Reorder buffer of the deterministic order, indexed by file index % window
+    ColumnWriter *columns;      // Columnar file that the reports are rows of, with '-f columnar'
+} BatchState;
+
+typedef struct BatchWorker
+{
+    BatchState *state;
+    int id;
+    pthread_t thread;
+} BatchWorker;
+
+// Adds a file to the back of a queue, growing it if it's full
+static int DequePush(TaskDeque *q, ScanTask task)
+{
+    pthread_mutex_lock(&q->lock);
+
+    if (q->count == q->cap)
+    {
+        size_t cap = q->cap ? q->cap * 2 : 64, i;
+        ScanTask *items = malloc(cap * sizeof(ScanTask));
+
+        if (items == NULL)
+        {
+            pthread_mutex_unlock(&q->lock);
+            return 1;
+        }
+        for (i = 0; i < q->count; i++)
+            items[i] = q->items[(q->head + i) % q->cap];
+
+        free(q->items);
+        q->items = items;
+        q->head = 0;
+        q->cap = cap;
+    }
+
+    q->items[(q->head + q->count) % q->cap] = task;
+    q->count++;
+
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+}
+
+/* Takes a file from a queue, either the oldest one (for the owner of the queue)
+ * or the newest one (for a worker stealing from the queue)
+ * It returns 0 if a file was taken, otherwise it returns 1
+ */
+static int DequeTake(TaskDeque *q, ScanTask *task, int steal)
+{
+    int rc = 1;
+
+    pthread_mutex_lock(&q->lock);
+    if (q->count)
+    {
+        if (steal)
+            *task = q->items[(q->head + q->count - 1) % q->cap];
+        else
+        {
+            *task = q->items[q->head];
+            q->head = (q->head + 1) % q->cap;
+        }
+        q->count--;
+        rc = 0;
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    return rc;
+}
+
+/* Takes the next file for the given worker, from its own queue if possible,
+ * otherwise by stealing from the other queues
+ * It returns 0 if a file was taken, otherwise it returns 1
+ */
+static int BatchTake(BatchState *st, int id, ScanTask *task)
+{
+    int i;
+
+    if (DequeTake(&st->queues[id], task, 0) == 0)
+        goto taken;
+
+    for (i = 1; i < st->workers; i++)
+        if (DequeTake(&st->queues[(id + i) % st->workers], task, 1) == 0)
+            goto taken;
+
+    return 1;
+
+taken:
+    pthread_mutex_lock(&st->lock);
+    st->queued--;
+    pthread_mutex_unlock(&st->lock);
+    return 0;
+}
+
+// Writes a finished report out, or adds it to the columnar file
+static void BatchWrite(BatchState *st, const char *text, size_t len)
+{
+    if (st->columns != NULL)
+        ColumnAdd(st->columns, text, len);
+    else
+        fwrite(text, 1, len, stdout);
+}
+
+/* Hands the finished report of a file over for writing
+ * In deterministic order, the report is parked in the reorder buffer, and every report
+ * that is next in order is then written out. In streaming order, it's written out at once.
+ */
+static void BatchEmit(BatchState *st, size_t index, OutBuf *report)
+{
+    pthread_mutex_lock(&st->lock);
+
+    if (st->opts->unordered)
+    {
+        BatchWrite(st, report->data, report->len);
+        st->written++;
+    }
+    else
+    {
+        ScanReport *slot = &st->reports[index % st->window];
+
+        // The buffer of the report changes hands, and the worker starts a new one for its next file
+        slot->text = report->data;
+        slot->len = report->len;
+        slot->ready = 1;
+        OutInit(report);
+
+        for (slot = &st->reports[st->written % st->window]; slot->ready; slot = &st->reports[st->written % st->window])
+        {
+            BatchWrite(st, slot->text, slot->len);
+            free(slot->text);
+            slot->text = NULL;
+            slot->ready = 0;
+            st->written++;
+        }
+    }
+
+    pthread_cond_broadcast(&st->room);
+    pthread_mutex_unlock(&st->lock);
+}
+
+// Main loop of a worker thread, which reports on files until the walk is over and all the queues are empty
+static void* BatchWorkerMain(void *arg)
+{
+    BatchWorker *self = arg;
+    BatchState *st = self->state;
+    OutBuf report;
+    ScanTask task;
+
+    OutInit(&report);
+
+    for (;;)
+    {
+        if (BatchTake(st, self->id, &task) == 0)
+        {
+            OutReset(&report);
+            if (st->opts->format == RPE_FORMAT_TEXT)
+                OutPrintf(&report, "\n==> %s <==\n", task.path);
+
+            if (ReportFile(&report, task.path, st->opts))
+            {
+                pthread_mutex_lock(&st->lock);
+                st->failed = 1;
+                pthread_mutex_unlock(&st->lock);
+            }
+
+            free(task.path);
+            BatchEmit(st, task.index, &report);
+            continue;
+        }
+
+        pthread_mutex_lock(&st->lock);
+        while (st->queued <= 0 && !st->walkDone)
+            pthread_cond_wait(&st->work, &st->lock);
+        int done = st->queued <= 0 && st->walkDone;
+        pthread_mutex_unlock(&st->lock);
+
+        if (done)
+            break;
+    }
+
+    OutFree(&report);
+    return NULL;
+}
+
+// Deals a file found by the walk out to the next queue, after waiting for room in the window
+static void BatchSubmit(BatchState *st, const char *path)
+{
+    ScanTask task;
+
+    task.path = strdup(path);
+    if (task.path == NULL)
+        return;
+
+    pthread_mutex_lock(&st->lock);
+    while (st->submitted - st->written >= st->window)
+        pthread_cond_wait(&st->room, &st->lock);
+    task.index = st->submitted++;
+    pthread_mutex_unlock(&st->lock);
+
+    if (DequePush(&st->queues[st->nextQueue], task))
+    {
+        // The file can't be queued, so it's reported on right here to keep the order intact
+        OutBuf report;
+
+        OutInit(&report);
+        if (st->opts->format == RPE_FORMAT_TEXT)
+            OutPrintf(&report, "\n==> %s <==\n", task.path);
+        ReportFile(&report, task.path, st->opts);
+        free(task.path);
+        BatchEmit(st, task.index, &report);
+        OutFree(&report);
+        return;
+    }
+    st->nextQueue = (st->nextQueue + 1) % st->workers;
+
+    pthread_mutex_lock(&st->lock);
+    st->queued++;
+    pthread_cond_signal(&st->work);
+    pthread_mutex_unlock(&st->lock);
+}
+
+// Entry of a directory, with the type given by readdir() if the filesystem provides it
+typedef struct WalkEntry
+{
+    char *name;
+    unsigned char type;
+} WalkEntry;
+
+static int WalkEntryCompare(const void *a, const void *b)
+{
+    return strcmp(((const WalkEntry *)a)->name, ((const WalkEntry *)b)->name);
+}
+
+static void BatchWalk(BatchState *st, const char *path);
+
+/* Walks a directory recursively and submits every regular file within it
+ * The entries of each directory are sorted by name, so that the order in which the files are found
+ * doesn't depend on the filesystem. Symbolic links to directories aren't followed, to avoid cycles.
+ */
+static void BatchWalkDir(BatchState *st, const char *dir)
+{
+    DIR *d = opendir(dir);
+    WalkEntry *entries = NULL;
+    size_t count = 0, cap = 0, i;
+    struct dirent *de;
+
+    if (d == NULL)
+    {
+        fprintf(stderr, "rpe64: can't open directory '%s'\n", dir);
+        return;
+    }
+
+    while ((de = readdir(d)) != NULL)
+    {
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
+            continue;
+
+        if (count == cap)
+        {
+            WalkEntry *grown = realloc(entries, (cap ? cap * 2 : 32) * sizeof(WalkEntry));
+
+            if (grown == NULL)
+                break;
+            entries = grown;
+            cap = cap ? cap * 2 : 32;
+        }
+
+        entries[count].name = strdup(de->d_name);
+        if (entries[count].name == NULL)
+            break;
+#ifdef _DIRENT_HAVE_D_TYPE
+        entries[count].type = de->d_type;
+#else
+        entries[count].type = DT_UNKNOWN;
+#endif
+        count++;
+    }
+    closedir(d);
+
+    qsort(entries, count, sizeof(WalkEntry), WalkEntryCompare);
+
+    size_t dirLen = strlen(dir);
+    for (i = 0; i < count; i++)
+    {
+        size_t len = dirLen + strlen(entries[i].name) + 2;
+        char *path = malloc(len);
+        struct stat sb;
+
+        if (path != NULL)
+        {
+            snprintf(path, len, "%s%s%s", dir, (dirLen && dir[dirLen - 1] == '/') ? "" : "/", entries[i].name);
+
+            if (entries[i].type == DT_DIR)
+                BatchWalkDir(st, path);
+            else if (entries[i].type == DT_REG)
+                BatchSubmit(st, path);
+            else if (entries[i].type == DT_LNK || entries[i].type == DT_UNKNOWN)
+            {
+                // The type has to be looked up. Links are only followed to regular files.
+                if (lstat(path, &sb) == 0 && S_ISDIR(sb.st_mode))
+                    BatchWalkDir(st, path);
+                else if (stat(path, &sb) == 0 && S_ISREG(sb.st_mode))
+                    BatchSubmit(st, path);
+            }
+            free(path);
+        }
+        free(entries[i].name);
+    }
+    free(entries);
+}
+
+// Reads newline-separated paths from a file list and walks each of them
+static void BatchWalkList(BatchState *st, FILE *list)
+{
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+
+    while ((len = getline(&line, &cap, list)) != -1)
+    {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+            line[--len] = '\0';
+        if (len > 0)
+            BatchWalk(st, line);
+    }
+    free(line);
+}
+
+/* Submits a file, walks a directory, or walks the paths within a file list given as '-'
+ * Paths that don't exist are submitted too, so that their error is reported in order
+ */
+static void BatchWalk(BatchState *st, const char *path)
+{
+    struct stat sb;
+
+    if (!strcmp(path, "-"))
+        BatchWalkList(st, stdin);
+    else if (stat(path, &sb) == 0 && S_ISDIR(sb.st_mode))
+        BatchWalkDir(st, path);
+    else
+        BatchSubmit(st, path);
+}
+
+/* This is the function that runs the batch mode over the given input paths, and the file list if one is given.
+ * It returns 0 if the headers of every file could be decoded, otherwise it returns 1.
+ */
+int BatchScan(char *inputs[], int count, const RpeOptions *opts)
+{
+    BatchState st;
+    BatchWorker *workers;
+    int i, started = 0;
+
+    memset(&st, 0, sizeof(st));
+    st.opts = opts;
+    st.workers = opts->threads > 0 ? opts->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (st.workers < 1)
+        st.workers = 1;
+    st.window = (size_t)st.workers * BATCH_WINDOW_PER_WORKER;
+
+    st.queues = calloc(st.workers, sizeof(TaskDeque));
+    st.reports = calloc(st.window, sizeof(ScanReport));
+    workers = calloc(st.workers, sizeof(BatchWorker));
+    if (st.queues == NULL || st.reports == NULL || workers == NULL)
+    {
+        fprintf(stderr, "rpe64: out of memory\n");
+        free(st.queues);
+        free(st.reports);
+        free(workers);
+        return 1;
+    }
+
+    setvbuf(stdout, NULL, _IOFBF, BATCH_STDOUT_BUFFER);
+    if (opts->format == RPE_FORMAT_CSV)
+    {
+        OutBuf header;
+
+        OutInit(&header);
+        CsvHeader(&header, opts);
+        OutFlush(&header, stdout);
+        OutFree(&header);
+    }
+    else if (opts->format == RPE_FORMAT_COLUMNAR && (st.columns = ColumnOpen(stdout)) == NULL)
+    {
+        fprintf(stderr, "rpe64: out of memory\n");
+        free(st.queues);
+        free(st.reports);
+        free(workers);
+        return 1;
+    }
+    pthread_mutex_init(&st.lock, NULL);
+    pthread_cond_init(&st.work, NULL);
+    pthread_cond_init(&st.room, NULL);
+
+    for (i = 0; i < st.workers; i++)
+        pthread_mutex_init(&st.queues[i].lock, NULL);
+
+    for (i = 0; i < st.workers; i++)
+    {
+        workers[i].state = &st;
+        workers[i].id = i;
+        if (pthread_create(&workers[i].thread, NULL, BatchWorkerMain, &workers[i]) != 0)
+            break;
+        started++;
+    }
+
+    if (started == 0)
+    {
+        fprintf(stderr, "rpe64: can't start worker threads\n");
+        st.failed = 1;
+    }
+    else
+    {
+        // The walk runs on the main thread, while the workers report on the files found so far
+        if (opts->listFile != NULL)
+        {
+            FILE *list = strcmp(opts->listFile, "-") ? fopen(opts->listFile, "r") : stdin;
+
+            if (list == NULL)
+            {
+                fprintf(stderr, "rpe64: can't open file list '%s'\n", opts->listFile);
+                st.failed = 1;
+            }
+            else
+            {
+                BatchWalkList(&st, list);
+                if (list != stdin)
+                    fclose(list);
+            }
+        }
+        for (i = 0; i < count; i++)
+            BatchWalk(&st, inputs[i]);
+    }
+
+    pthread_mutex_lock(&st.lock);
+    st.walkDone = 1;
+    pthread_cond_broadcast(&st.work);
+    pthread_mutex_unlock(&st.lock);
+
+    for (i = 0; i < started; i++)
+        pthread_join(workers[i].thread, NULL);
+
+    if (st.columns != NULL && ColumnClose(st.columns))
+    {
+        fprintf(stderr, "rpe64: can't write the columnar file\n");
+        st.failed = 1;
+    }
+    fflush(stdout);
+
+    for (i = 0; i < st.workers; i++)
+    {
+        pthread_mutex_destroy(&st.queues[i].lock);
+        free(st.queues[i].items);
+    }
+    pthread_cond_destroy(&st.room);
+    pthread_cond_destroy(&st.work);
+    pthread_mutex_destroy(&st.lock);
+    free(st.queues);
+    free(st.reports);
+    free(workers);
+
+    return st.failed;
+}
@@ -0,0 +1,417 @@
+/* C-program file that contains the
+   code for the synthetic image file generator of the rpe64 benchmark.
+
+   This functionality writes PE32 and PE32+ image files that vary in the number of sections,
+   of imported DLLs and functions, of exports and of resources, and in the size of their code
+   and of their overlay, so that every stage of rpe64 can be timed on a corpus that is the same
+   from one run to the next. Every file is derived from a seed by a small pseudo-random generator,
+   so the same seed always gives the same corpus, on any machine.
+
+   The files are well-formed enough for rpe64 and for other PE tools to decode, but they don't run:
+   the code section is filled with bytes of roughly the entropy of machine code, not instructions.
+ */
+
+/* Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "rpe64Header.h"
+
+#define BENCH_LFANEW 0x80               // File offset of the PE signature
+#define BENCH_FILE_ALIGN 0x200
+#define BENCH_SECTION_ALIGN 0x1000
+#define BENCH_MAX_SECTIONS 16
+
+#define ALIGN_UP(x, a) (((x) + (a) - 1) & ~(uint32_t)((a) - 1))
+
+// Names of the DLLs that synthetic files import from, the first ones of which most files share
+static const char *const BenchDlls[] =
+{
+    "KERNEL32.dll", "USER32.dll", "ADVAPI32.dll", "ntdll.dll", "msvcrt.dll", "GDI32.dll",
+    "SHELL32.dll", "ole32.dll", "WS2_32.dll", "OLEAUT32.dll", "COMCTL32.dll", "WININET.dll"
+};
+
+#define BENCH_DLL_NAMES (sizeof(BenchDlls) / sizeof(BenchDlls[0]))
+
+// Returns the next number of the xorshift32 generator of the given state, which must not be 0
+static uint32_t BenchRandom(uint32_t *state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void PutLe16(unsigned char *p, uint16_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void PutLe32(unsigned char *p, uint32_t v)
+{
+    PutLe16(p, (uint16_t)v);
+    PutLe16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void PutLe64(unsigned char *p, uint64_t v)
+{
+    PutLe32(p, (uint32_t)v);
+    PutLe32(p + 4, (uint32_t)(v >> 32));
+}
+
+// Appends the given number of zero bytes to the buffer, and returns the offset of the first of them
+static size_t PutZeros(OutBuf *buf, size_t count)
+{
+    size_t at = buf->len;
+
+    if (OutReserve(buf, count) == 0)
+    {
+        memset(buf->data + at, 0, count);
+        buf->len += count;
+    }
+    return at;
+}
+
+// Appends a NUL-terminated string to the buffer, and returns its offset
+static size_t PutString(OutBuf *buf, const char *str)
+{
+    size_t at = buf->len;
+
+    OutWrite(buf, str, strlen(str) + 1);
+    return at;
+}
+
+/* This function picks the shape of the synthetic file of the given index within the corpus of the given seed
+ * Most files are small, as in real corpora, with a few files of several megabytes
+ */
+void BenchRandomShape(BenchShape *shape, uint32_t seed, uint32_t index)
+{
+    uint32_t state = (seed ^ (index * 0x9E3779B9u)) | 1;
+    int i;
+
+    for (i = 0; i < 4; i++)
+        BenchRandom(&state);
+
+    memset(shape, 0, sizeof(*shape));
+    shape->seed = BenchRandom(&state) | 1;
+    shape->pe32plus = BenchRandom(&state) & 1;
+    shape->dlls = BenchRandom(&state) % 16;
+    shape->funcsPerDll = 1 + BenchRandom(&state) % 64;
+    shape->exports = BenchRandom(&state) % 3 == 0 ? 1 + BenchRandom(&state) % 2048 : 0;
+    shape->resources = BenchRandom(&state) % 2 ? 1 + BenchRandom(&state) % 32 : 0;
+    shape->extraSections = BenchRandom(&state) % 7;
+    shape->codeSize = (4096u << (BenchRandom(&state) % 11)) + BenchRandom(&state) % 4096;
+    shape->overlaySize = BenchRandom(&state) % 4 == 0 ? BenchRandom(&state) % (1u << 20) : 0;
+}
+
+/* Builds the contents of the .rdata section at the given RVA: the Import Table followed by the Export Table
+ * The exported functions are given RVAs within the code section
+ */
+static void BuildRdata(OutBuf *rdata, const BenchShape *shape, uint32_t rva, uint32_t codeRva, PeDataDir dir[])
+{
+    uint32_t thunk = shape->pe32plus ? 8 : 4, d, f;
+    size_t desc = 0, exp;
+
+    if (shape->dlls)
+    {
+        desc = PutZeros(rdata, (shape->dlls + 1) * 20);
+        dir[PE_DIR_IMPORT].VirtualAddress = rva + (uint32_t)desc;
+        dir[PE_DIR_IMPORT].Size = (shape->dlls + 1) * 20;
+    }
+
+    for (d = 0; d < shape->dlls; d++)
+    {
+        size_t ilt = PutZeros(rdata, (shape->funcsPerDll + 1) * thunk);
+        size_t iat = PutZeros(rdata, (shape->funcsPerDll + 1) * thunk);
+        size_t name;
+        char dllName[32];
+
+        for (f = 0; f < shape->funcsPerDll; f++)
+        {
+            uint64_t value;
+
+            // Every seventh function is imported by ordinal
+            if (f % 7 == 6)
+                value = (shape->pe32plus ? 1ULL << 63 : 1ULL << 31) | (f + 1);
+            else
+            {
+                char funcName[48];
+                size_t hint;
+
+                if (rdata->len & 1)
+                    PutZeros(rdata, 1);
+                hint = PutZeros(rdata, 2);
+                snprintf(funcName, sizeof(funcName), "BenchImport%uFunction%u", d, f);
+                PutString(rdata, funcName);
+                PutLe16((unsigned char*)rdata->data + hint, (uint16_t)f);
+                value = rva + (uint32_t)hint;
+            }
+
+            if (shape->pe32plus)
+            {
+                PutLe64((unsigned char*)rdata->data + ilt + f * 8, value);
+                PutLe64((unsigned char*)rdata->data + iat + f * 8, value);
+            }
+            else
+            {
+                PutLe32((unsigned char*)rdata->data + ilt + f * 4, (uint32_t)value);
+                PutLe32((unsigned char*)rdata->data + iat + f * 4, (uint32_t)value);
+            }
+        }
+
+        if (d < BENCH_DLL_NAMES)
+            name = PutString(rdata, BenchDlls[d]);
+        else
+        {
+            snprintf(dllName, sizeof(dllName), "bench%u.dll", d);
+            name = PutString(rdata, dllName);
+        }
+
+        PutLe32((unsigned char*)rdata->data + desc + d * 20, rva + (uint32_t)ilt);
+        PutLe32((unsigned char*)rdata->data + desc + d * 20 + 12, rva + (uint32_t)name);
+        PutLe32((unsigned char*)rdata->data + desc + d * 20 + 16, rva + (uint32_t)iat);
+    }
+
+    if (shape->exports == 0)
+        return;
+
+    // Export Directory Table, Export Address Table, Export Name Pointer Table, Export Ordinal Table and the names
+    PutZeros(rdata, (4 - rdata->len % 4) % 4);
+    exp = PutZeros(rdata, 40 + shape->exports * 10);
+    PutLe32((unsigned char*)rdata->data + exp + 12, rva + (uint32_t)PutString(rdata, "bench.dll"));
+    PutLe32((unsigned char*)rdata->data + exp + 16, 1);
+    PutLe32((unsigned char*)rdata->data + exp + 20, shape->exports);
+    PutLe32((unsigned char*)rdata->data + exp + 24, shape->exports);
+    PutLe32((unsigned char*)rdata->data + exp + 28, rva + (uint32_t)exp + 40);
+    PutLe32((unsigned char*)rdata->data + exp + 32, rva + (uint32_t)exp + 40 + shape->exports * 4);
+    PutLe32((unsigned char*)rdata->data + exp + 36, rva + (uint32_t)exp + 40 + shape->exports * 8);
+
+    for (f = 0; f < shape->exports; f++)
+    {
+        char expName[32];
+        size_t name;
+
+        // The names are numbered with leading zeros, so that they're sorted as the loader expects
+        snprintf(expName, sizeof(expName), "BenchExport%05u", f);
+        name = PutString(rdata, expName);
+
+        PutLe32((unsigned char*)rdata->data + exp + 40 + f * 4, codeRva + (f * 16) % shape->codeSize);
+        PutLe32((unsigned char*)rdata->data + exp + 40 + shape->exports * 4 + f * 4, rva + (uint32_t)name);
+        PutLe16((unsigned char*)rdata->data + exp + 40 + shape->exports * 8 + f * 2, (uint16_t)f);
+    }
+
+    dir[PE_DIR_EXPORT].VirtualAddress = rva + (uint32_t)exp;
+    dir[PE_DIR_EXPORT].Size = (uint32_t)(rdata->len - exp);
+}
+
+/* Builds the contents of the .rsrc section at the given RVA: a Resource Directory of RT_RCDATA resources,
+ * each with one name level entry and one language level entry
+ */
+static void BuildRsrc(OutBuf *rsrc, const BenchShape *shape, uint32_t rva, uint32_t *state)
+{
+    uint32_t count = shape->resources, r;
+    size_t types = 24, names = types + 16 + 8 * count, entries = names + 24 * count;
+    unsigned char *p;
+
+    PutZeros(rsrc, entries + 16 * count);
+    p = (unsigned char*)rsrc->data;
+
+    // Root directory with one type, RT_RCDATA, and the type directory with the given number of IDs
+    PutLe16(p + 14, 1);
+    PutLe32(p + 16, 10);
+    PutLe32(p + 20, 0x80000000u | (uint32_t)types);
+    PutLe16(p + types + 14, (uint16_t)count);
+
+    for (r = 0; r < count; r++)
+    {
+        size_t name = names + 24 * r, entry = entries + 16 * r, data;
+        uint32_t size = 64 + BenchRandom(state) % 4096, i;
+
+        data = PutZeros(rsrc, ALIGN_UP(size, 4));
+        p = (unsigned char*)rsrc->data;
+        for (i = 0; i < size; i++)
+            p[data + i] = (unsigned char)BenchRandom(state);
+
+        PutLe32(p + types + 16 + 8 * r, r + 1);
+        PutLe32(p + types + 20 + 8 * r, 0x80000000u | (uint32_t)name);
+        PutLe16(p + name + 14, 1);
+        PutLe32(p + name + 16, 0x409);
+        PutLe32(p + name + 20, (uint32_t)entry);
+        PutLe32(p + entry, rva + (uint32_t)data);
+        PutLe32(p + entry + 4, size);
+    }
+}
+
+/* This function writes the synthetic image file of the given shape to the given path
+ * It returns the size of the file, or 0 if it couldn't be written
+ */
+uint64_t BenchWritePe(const char *path, const BenchShape *shape)
+{
+    OutBuf body[BENCH_MAX_SECTIONS];
+    PeDataDir dir[PE_NUM_DATA_DIRECTORIES];
+    static const char *const names[] = { ".text", ".rdata", ".rsrc" };
+    uint32_t state = shape->seed, rva = BENCH_SECTION_ALIGN, raw, headers, optSize, i;
+    uint32_t characteristics[BENCH_MAX_SECTIONS], sizeOfImage;
+    uint16_t count = 0, s;
+    unsigned char *file = NULL, *nt, *opt, *sec;
+    uint64_t size = 0;
+    FILE *fp;
+
+    memset(dir, 0, sizeof(dir));
+    optSize = shape->pe32plus ? 240 : 224;
+
+    // .text: bytes with about 6 bits of entropy per byte, like machine code
+    OutInit(&body[count]);
+    PutZeros(&body[count], shape->codeSize);
+    for (i = 0; i < shape->codeSize; i++)
+        body[count].data[i] = (char)(BenchRandom(&state) & 0x3F);
+    characteristics[count++] = 0x60000020;
+
+    // .rdata: imports and exports, which refer to each other by RVA, so the RVA of the section is needed first
+    OutInit(&body[count]);
+    BuildRdata(&body[count], shape, rva + ALIGN_UP(shape->codeSize, BENCH_SECTION_ALIGN), rva, dir);
+    if (body[count].len == 0)
+        PutZeros(&body[count], 16);
+    characteristics[count++] = 0x40000040;
+
+    for (s = 0; s < count; s++)
+        rva += ALIGN_UP((uint32_t)body[s].len, BENCH_SECTION_ALIGN);
+
+    if (shape->resources)
+    {
+        OutInit(&body[count]);
+        BuildRsrc(&body[count], shape, rva, &state);
+        dir[PE_DIR_RESOURCE].VirtualAddress = rva;
+        dir[PE_DIR_RESOURCE].Size = (uint32_t)body[count].len;
+        rva += ALIGN_UP((uint32_t)body[count].len, BENCH_SECTION_ALIGN);
+        characteristics[count++] = 0x40000040;
+    }
+
+    // Data sections that are mostly zeros, as initialised data is
+    for (i = 0; i < shape->extraSections && count < BENCH_MAX_SECTIONS; i++)
+    {
+        uint32_t len = 512 + BenchRandom(&state) % 65536, j;
+
+        OutInit(&body[count]);
+        PutZeros(&body[count], len);
+        for (j = 0; j < len; j += 1 + BenchRandom(&state) % 64)
+            body[count].data[j] = (char)BenchRandom(&state);
+        rva += ALIGN_UP(len, BENCH_SECTION_ALIGN);
+        characteristics[count++] = 0xC0000040;
+    }
+    sizeOfImage = rva;
+
+    headers = ALIGN_UP(BENCH_LFANEW + PE_NT_FIXED_SIZE + optSize + count * PE_SECTION_HEADER_SIZE, BENCH_FILE_ALIGN);
+    size = headers;
+    for (s = 0; s < count; s++)
+        size += ALIGN_UP((uint32_t)body[s].len, BENCH_FILE_ALIGN);
+    size += shape->overlaySize;
+
+    file = calloc(1, size);
+    if (file == NULL)
+    {
+        size = 0;
+        goto done;
+    }
+
+    // DOS Header, PE signature and Image File Header
+    file[0] = 'M';
+    file[1] = 'Z';
+    PutLe32(file + 60, BENCH_LFANEW);
+    nt = file + BENCH_LFANEW;
+    memcpy(nt, "PE\0\0", 4);
+    PutLe16(nt + 4, shape->pe32plus ? 0x8664 : 0x14C);
+    PutLe16(nt + 6, count);
+    PutLe32(nt + 8, 0x5F000000u + (shape->seed & 0xFFFFFF));
+    PutLe16(nt + 20, (uint16_t)optSize);
+    PutLe16(nt + 22, shape->exports ? 0x2022 : 0x0022);
+
+    // Image Optional Header, whose fields from ImageBase on are wider in PE32+ images
+    opt = nt + PE_NT_FIXED_SIZE;
+    PutLe16(opt, shape->pe32plus ? PE32PLUS_MAGIC : PE32_MAGIC);
+    opt[2] = 14;
+    PutLe32(opt + 4, ALIGN_UP(shape->codeSize, BENCH_FILE_ALIGN));
+    PutLe32(opt + 16, BENCH_SECTION_ALIGN);
+    PutLe32(opt + 20, BENCH_SECTION_ALIGN);
+    if (shape->pe32plus)
+        PutLe64(opt + 24, 0x140000000ULL);
+    else
+        PutLe32(opt + 28, 0x400000);
+    PutLe32(opt + 32, BENCH_SECTION_ALIGN);
+    PutLe32(opt + 36, BENCH_FILE_ALIGN);
+    PutLe16(opt + 40, 6);
+    PutLe16(opt + 48, 6);
+    PutLe32(opt + 56, sizeOfImage);
+    PutLe32(opt + 60, headers);
+    PutLe16(opt + 68, 3);
+    PutLe16(opt + 70, 0x8160);
+    if (shape->pe32plus)
+    {
+        PutLe64(opt + 72, 0x100000);
+        PutLe64(opt + 80, 0x1000);
+        PutLe64(opt + 88, 0x100000);
+        PutLe64(opt + 96, 0x1000);
+        PutLe32(opt + 108, PE_NUM_DATA_DIRECTORIES);
+    }
+    else
+    {
+        PutLe32(opt + 72, 0x100000);
+        PutLe32(opt + 76, 0x1000);
+        PutLe32(opt + 80, 0x100000);
+        PutLe32(opt + 84, 0x1000);
+        PutLe32(opt + 92, PE_NUM_DATA_DIRECTORIES);
+    }
+    for (i = 0; i < PE_NUM_DATA_DIRECTORIES; i++)
+    {
+        PutLe32(opt + optSize - 128 + 8 * i, dir[i].VirtualAddress);
+        PutLe32(opt + optSize - 124 + 8 * i, dir[i].Size);
+    }
+
+    // Section Table and the raw data of the sections, followed by the overlay
+    sec = opt + optSize;
+    rva = BENCH_SECTION_ALIGN;
+    raw = headers;
+    for (s = 0; s < count; s++)
+    {
+        uint32_t len = (uint32_t)body[s].len;
+        unsigned char *hdr = sec + s * PE_SECTION_HEADER_SIZE;
+
+        if (s < 3 && (s < 2 || shape->resources))
+            memcpy(hdr, names[s], strlen(names[s]));
+        else
+            snprintf((char*)hdr, 8, ".data%u", (unsigned)s);
+        PutLe32(hdr + 8, len);
+        PutLe32(hdr + 12, rva);
+        PutLe32(hdr + 16, ALIGN_UP(len, BENCH_FILE_ALIGN));
+        PutLe32(hdr + 20, raw);
+        PutLe32(hdr + 36, characteristics[s]);
+        memcpy(file + raw, body[s].data, len);
+
+        if (s == 0)
+        {
+            PutLe32(opt + 16, rva);
+            PutLe32(opt + 20, rva);
+        }
+        rva += ALIGN_UP(len, BENCH_SECTION_ALIGN);
+        raw += ALIGN_UP(len, BENCH_FILE_ALIGN);
+    }
+    for (i = 0; i < shape->overlaySize; i++)
+        file[raw + i] = (unsigned char)BenchRandom(&state);
+
+    fp = fopen(path, "wb");
+    if (fp == NULL || fwrite(file, 1, size, fp) != size)
+        size = 0;
+    if (fp != NULL && fclose(fp) != 0)
+        size = 0;
+
+done:
+    for (s = 0; s < count; s++)
+        OutFree(&body[s]);
+    free(file);
+    return size;
+}
@@ -0,0 +1,865 @@
+/* C-program file that contains the
+   code for the 'rpe64 query' subcommand.
+
+   This functionality of rpe64 answers aggregate questions about the files of a columnar file (see ColumnStore.c),
+   e.g. how many PE32+ images lack DYNAMIC_BASE, grouped by linker version:
+
+       rpe64 query -g optional.MajorLinkerVersion,optional.MinorLinkerVersion scan.col \
+                   optional.Magic=0x20b 'optional.DllCharacteristics&0x40=0'
+
+   The file is memory-mapped, and only the columns named by the filters, the grouping and the selection are read.
+   Every filter of a numeric column is turned into a range test of the masked value, lo <= (value & mask) <= hi,
+   which is computed as a single unsigned comparison of (value & mask) - lo against hi - lo. With AVX2, it's
+   computed for 8 values of up to 32 bits, or 4 values of 64 bits, per instruction, into a bitmap of the rows of
+   the row group, and the bitmaps of the filters are combined with AND. The choice of the AVX2 kernel is made once,
+   at run time. Row groups whose smallest and largest values show that a filter can't match are skipped without
+   reading the column, and filters of string columns are tested once per distinct string of the dictionary.
+ */
+
+/* Filters are given as '<column>[&<mask>]<operator><value>', where the operator is one of =, !=, <, <=, >, >= for
+   numeric columns, and =, !=, ~ (contains), !~ (doesn't contain), which all ignore case, for string columns.
+   A filter of a list column, like 'dlls', matches the rows in which any of the strings match, and '!=' or '!~'
+   the rows in which none does.
+ */
+
+#define _POSIX_C_SOURCE 200809L    // for getopt()
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include "rpe64Header.h"
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(QUERY_NO_SIMD)
+#define QUERY_HAVE_SIMD 1
+#include <immintrin.h>
+#endif
+
+#define QUERY_MAX_COLUMNS 64            // Largest number of columns that can be grouped by or selected
+#define QUERY_INITIAL_GROUPS 1024       // Initial size of the hash table of the groups, a power of 2
+#define QUERY_WORDS (COLUMN_GROUP_ROWS / 64)    // Number of 64-bit words of the bitmap of the rows of a row group
+
+// Kinds of filters
+#define FILTER_RANGE 0          // lo <= (value & mask) <= hi, for numeric columns
+#define FILTER_EQUAL 1          // Equal strings, for string and list columns
+#define FILTER_CONTAINS 2       // Strings that contain the text, for string and list columns
+
+typedef struct QueryFilter
+{
+    uint32_t column;
+    int kind;                   // One of the FILTER_ values
+    int negate;                 // 1 if the rows that don't pass the test are the ones that match
+    uint64_t mask, lo, hi;      // Range of FILTER_RANGE filters, empty if lo > hi
+    const char *text;           // Text of FILTER_EQUAL and FILTER_CONTAINS filters
+} QueryFilter;
+
+// Column chunk of a row group, once checked by QueryChunkOpen()
+typedef struct QueryChunk
+{
+    const ColumnChunk *info;
+    int type, width;
+    const unsigned char *values;    // Numbers, or 32-bit dictionary indexes
+    const uint32_t *starts;         // First item of each row of a list column, and the end of the last one
+    const uint32_t *dict;           // Offsets of the strings of the dictionary, and the end of the last one
+    const char *strings;
+    uint32_t dictCount;
+} QueryChunk;
+
+// Count of one combination of values of the grouping columns
+typedef struct QueryGroup
+{
+    char *key;                  // The values, as CSV fields
+    uint64_t count;
+} QueryGroup;
+
+typedef struct Query
+{
+    const unsigned char *data;      // The memory-mapped columnar file
+    uint64_t size;
+    const ColumnDesc *columns;
+    uint32_t columnCount;
+    QueryFilter *filters;
+    int filterCount;
+    uint32_t groupBy[QUERY_MAX_COLUMNS], select[QUERY_MAX_COLUMNS];
+    int groupCount, selectCount;
+    uint64_t limit;                 // Largest number of selected rows to write, 0 for all of them
+    uint64_t rows, matches;
+    QueryGroup *groups;             // Hash table of the groups
+    uint64_t groupSlots, groupsUsed;
+    OutBuf out, key, list;
+} Query;
+
+static void QueryUsage(void)
+{
+    fprintf(stderr, "usage: rpe64 query [-g <columns>] [-s <columns>] [-n <rows>] [-l] <columnar file> [<filter>...]\n"
+                    "  filters: '<column>[&<mask>]<op><value>', with =, !=, <, <=, >, >= for numbers, and =, !=, ~, !~ for strings\n"
+                    "  -g: count the matching files per combination of values of the given comma-separated columns\n"
+                    "  -s: write the given columns of the matching files, as CSV, up to -n rows\n"
+                    "  -l: list the columns of the file\n"
+                    "  Without -g or -s, the matching files are counted.\n");
+}
+
+/* Range kernels, which set the bit of each row from the given one on whose value passes lo <= (value & mask) <= lo + span
+ * The bits have to be clear beforehand. They return the row they stopped at, which the portable kernel carries on from.
+ */
+#define RANGE_LOOP(type) \
+    for (; i < rows; i++) \
+        if ((uint64_t)((((const type*)values)[i] & mask) - lo) <= span) \
+            bits[i >> 6] |= 1ULL << (i & 63)
+
+static void RangePortable(const unsigned char *values, int width, uint32_t i, uint32_t rows, uint64_t mask, uint64_t lo, uint64_t span, uint64_t *bits)
+{
+    switch (width)
+    {
+        case 1:
+            RANGE_LOOP(uint8_t);
+            break;
+        case 2:
+            RANGE_LOOP(uint16_t);
+            break;
+        case 4:
+            RANGE_LOOP(uint32_t);
+            break;
+        default:
+            RANGE_LOOP(uint64_t);
+            break;
+    }
+}
+
+#ifdef QUERY_HAVE_SIMD
+
+/* AVX2 kernel. Values of 1, 2 and 4 bytes are zero-extended into eight 32-bit lanes, and 64-bit values are taken four at a time.
+ * The unsigned comparison is a signed one of the values with their sign bits flipped.
+ */
+__attribute__((target("avx2")))
+static uint32_t RangeAvx2(const unsigned char *values, int width, uint32_t rows, uint64_t mask, uint64_t lo, uint64_t span, uint64_t *bits)
+{
+    uint32_t i = 0;
+
+    if (width == 8)
+    {
+        const __m256i m = _mm256_set1_epi64x((long long)mask), l = _mm256_set1_epi64x((long long)lo);
+        const __m256i sign = _mm256_set1_epi64x(INT64_MIN), s = _mm256_set1_epi64x((long long)(span ^ (1ULL << 63)));
+
+        for (; i + 4 <= rows; i += 4)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(values + (size_t)i * 8));
+            __m256i t = _mm256_xor_si256(_mm256_sub_epi64(_mm256_and_si256(v, m), l), sign);
+            unsigned k = ~(unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(t, s))) & 0xF;
+
+            bits[i >> 6] |= (uint64_t)k << (i & 63);
+        }
+        return i;
+    }
+
+    const __m256i m = _mm256_set1_epi32((int)(uint32_t)mask), l = _mm256_set1_epi32((int)(uint32_t)lo);
+    const __m256i sign = _mm256_set1_epi32(INT32_MIN), s = _mm256_set1_epi32((int)((uint32_t)span ^ 0x80000000u));
+
+#define RANGE_AVX2_STEP(load) \
+    for (; i + 8 <= rows; i += 8) \
+    { \
+        __m256i v = load; \
+        __m256i t = _mm256_xor_si256(_mm256_sub_epi32(_mm256_and_si256(v, m), l), sign); \
+        unsigned k = ~(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(t, s))) & 0xFF; \
+        bits[i >> 6] |= (uint64_t)k << (i & 63); \
+    }
+
+    if (width == 4)
+        RANGE_AVX2_STEP(_mm256_loadu_si256((const __m256i*)(values + (size_t)i * 4)))
+    else if (width == 2)
+        RANGE_AVX2_STEP(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(values + (size_t)i * 2))))
+    else
+        RANGE_AVX2_STEP(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(values + i))))
+    return i;
+}
+
+static int QueryUseAvx2;
+
+#endif
+
+// Sets the bit of each row of the chunk whose value is within the range of the filter
+static void QueryRange(const QueryChunk *chunk, uint32_t rows, const QueryFilter *f, uint64_t *bits)
+{
+    uint32_t i = 0;
+
+#ifdef QUERY_HAVE_SIMD
+    if (QueryUseAvx2)
+        i = RangeAvx2(chunk->values, chunk->width, rows, f->mask, f->lo, f->hi - f->lo, bits);
+#endif
+    RangePortable(chunk->values, chunk->width, i, rows, f->mask, f->lo, f->hi - f->lo, bits);
+}
+
+// Returns the index of the column of the given name, or UINT32_MAX if the file has none
+static uint32_t QueryColumn(const Query *q, const char *name, size_t len)
+{
+    uint32_t c;
+
+    for (c = 0; c < q->columnCount; c++)
+        if (strlen(q->columns[c].name) == len && !strncmp(q->columns[c].name, name, len))
+            return c;
+    return UINT32_MAX;
+}
+
+// Parses a comma-separated list of columns, it returns 1 after printing the reason if one isn't in the file
+static int QueryColumnList(const Query *q, const char *list, uint32_t *columns, int *count)
+{
+    const char *p = list;
+
+    *count = 0;
+    while (*p)
+    {
+        size_t len = strcspn(p, ",");
+        uint32_t c = QueryColumn(q, p, len);
+
+        if (c == UINT32_MAX || *count == QUERY_MAX_COLUMNS)
+        {
+            fprintf(stderr, "rpe64 query: unknown column '%.*s', see 'rpe64 query -l <file>'\n", (int)len, p);
+            return 1;
+        }
+        columns[(*count)++] = c;
+        p += len;
+        if (*p == ',')
+            p++;
+    }
+    return 0;
+}
+
+/* Parses a filter, '<column>[&<mask>]<op><value>', into the given structure
+ * It returns 0 on success, otherwise it returns 1 after printing the reason.
+ */
+static int QueryParseFilter(const Query *q, const char *arg, QueryFilter *f)
+{
+    size_t len = strcspn(arg, "&!<>=~");
+    const char *p = arg + len, *op;
+    char *end;
+    uint64_t value, top;
+
+    memset(f, 0, sizeof(*f));
+    f->column = QueryColumn(q, arg, len);
+    if (f->column == UINT32_MAX)
+    {
+        fprintf(stderr, "rpe64 query: unknown column '%.*s', see 'rpe64 query -l <file>'\n", (int)len, arg);
+        return 1;
+    }
+
+    const ColumnDesc *col = &q->columns[f->column];
+
+    top = col->width >= 8 ? UINT64_MAX : (1ULL << (8 * col->width)) - 1;
+    f->mask = top;
+    if (*p == '&')
+    {
+        if (col->type != COLUMN_NUMBER)
+        {
+            fprintf(stderr, "rpe64 query: '%s': only numeric columns can be masked\n", arg);
+            return 1;
+        }
+        f->mask = strtoull(p + 1, &end, 0) & top;
+        if (end == p + 1)
+        {
+            fprintf(stderr, "rpe64 query: '%s': the mask isn't a number\n", arg);
+            return 1;
+        }
+        p = end;
+    }
+
+    op = p;
+    if (!strncmp(p, "!=", 2) || !strncmp(p, "<=", 2) || !strncmp(p, ">=", 2) || !strncmp(p, "!~", 2))
+        p += 2;
+    else if (*p == '=' || *p == '<' || *p == '>' || *p == '~')
+        p += 1;
+    else
+    {
+        fprintf(stderr, "rpe64 query: '%s' has no operator\n", arg);
+        return 1;
+    }
+    f->negate = *op == '!';
+
+    if (col->type != COLUMN_NUMBER)
+    {
+        if (*op == '<' || *op == '>')
+        {
+            fprintf(stderr, "rpe64 query: '%s': string columns can only be compared with =, !=, ~ and !~\n", arg);
+            return 1;
+        }
+        f->kind = op[f->negate] == '~' ? FILTER_CONTAINS : FILTER_EQUAL;
+        f->text = p;
+        return 0;
+    }
+
+    if (op[f->negate] == '~')
+    {
+        fprintf(stderr, "rpe64 query: '%s': numeric columns can't be compared with ~\n", arg);
+        return 1;
+    }
+    value = strtoull(p, &end, 0);
+    if (end == p || *end != '\0')
+    {
+        fprintf(stderr, "rpe64 query: '%s': the value isn't a number\n", arg);
+        return 1;
+    }
+
+    // Every comparison is a range of the masked value, which is empty if lo > hi
+    f->kind = FILTER_RANGE;
+    f->lo = 0;
+    f->hi = f->mask;
+    if (*op == '=' || *op == '!')
+        f->lo = f->hi = value;
+    else if (*op == '<')
+    {
+        if (op[1] == '=')
+            f->hi = value < f->mask ? value : f->mask;
+        else if (value == 0)
+            f->lo = 1, f->hi = 0;
+        else
+            f->hi = value - 1 < f->mask ? value - 1 : f->mask;
+    }
+    else
+    {
+        if (op[1] == '=')
+            f->lo = value;
+        else if (value >= f->mask)
+            f->lo = 1, f->hi = 0;
+        else
+            f->lo = value + 1;
+    }
+    if (f->lo > f->mask)
+        f->lo = 1, f->hi = 0;
+    return 0;
+}
+
+/* Checks that the chunk of the given column lies within its row group and that its arrays and dictionary are consistent,
+ * and fills in where they are. It returns 1 if it's malformed.
+ */
+static int QueryChunkOpen(const Query *q, const unsigned char *group, const ColumnGroupHeader *hdr, uint32_t column, QueryChunk *chunk)
+{
+    const ColumnChunk *info = (const ColumnChunk*)(group + sizeof(*hdr)) + column;
+    const unsigned char *p;
+    uint64_t need, left;
+    uint32_t i;
+
+    memset(chunk, 0, sizeof(*chunk));
+    chunk->info = info;
+    chunk->type = q->columns[column].type;
+    chunk->width = q->columns[column].width;
+    if (info->offset % COLUMN_ALIGN || info->offset > hdr->size || info->size > hdr->size - info->offset)
+        return 1;
+
+    p = group + info->offset;
+    left = info->size;
+    if (chunk->type == COLUMN_NUMBER)
+    {
+        chunk->values = p;
+        return (uint64_t)hdr->rows * chunk->width != left;
+    }
+
+    if (chunk->type == COLUMN_LIST)
+    {
+        need = ((uint64_t)hdr->rows + 1) * 4;
+        if (left < need)
+            return 1;
+        chunk->starts = (const uint32_t*)p;
+        if (chunk->starts[0] != 0 || chunk->starts[hdr->rows] != info->items)
+            return 1;
+        for (i = 0; i < hdr->rows; i++)
+            if (chunk->starts[i] > chunk->starts[i + 1])
+                return 1;
+        p += need;
+        left -= need;
+        need = (uint64_t)info->items * 4;
+    }
+    else
+        need = (uint64_t)hdr->rows * 4;
+
+    if (left < need)
+        return 1;
+    chunk->values = p;
+    p += need;
+    left -= need;
+
+    need = ((uint64_t)info->dictCount + 1) * 4;
+    if (left < need)
+        return 1;
+    chunk->dict = (const uint32_t*)p;
+    chunk->strings = (const char*)p + need;
+    chunk->dictCount = info->dictCount;
+    left -= need;
+
+    // Every string has to end with a NUL within the strings, so that it can be used as it is
+    if (chunk->dict[info->dictCount] != left || (left && chunk->strings[left - 1] != '\0'))
+        return 1;
+    for (i = 0; i < info->dictCount; i++)
+        if (chunk->dict[i] >= chunk->dict[i + 1])
+            return 1;
+    return 0;
+}
+
+// Tells if the text is in the string, ignoring case like the names of DLLs and sections are compared by Windows
+static int QueryContains(const char *s, const char *text)
+{
+    size_t len = strlen(text);
+
+    for (; *s; s++)
+        if (!strncasecmp(s, text, len))
+            return 1;
+    return len == 0;
+}
+
+// Returns the string of the given dictionary index, or an empty string if the index is out of range
+static const char* QueryString(const QueryChunk *chunk, uint32_t index)
+{
+    return index < chunk->dictCount ? chunk->strings + chunk->dict[index] : "";
+}
+
+// Tests a string filter against every string of the dictionary, then sets the bits of the rows with a string that passes
+static int QueryStrings(const QueryChunk *chunk, uint32_t rows, const QueryFilter *f, uint64_t *bits)
+{
+    const uint32_t *ids = (const uint32_t*)chunk->values;
+    unsigned char *pass = malloc(chunk->dictCount ? chunk->dictCount : 1);
+    uint32_t i, j;
+
+    if (pass == NULL)
+        return 1;
+    for (i = 0; i < chunk->dictCount; i++)
+    {
+        const char *s = QueryString(chunk, i);
+
+        pass[i] = f->kind == FILTER_EQUAL ? !strcasecmp(s, f->text) : QueryContains(s, f->text);
+    }
+
+    for (i = 0; i < rows; i++)
+    {
+        int hit = 0;
+
+        if (chunk->type == COLUMN_STRING)
+            hit = ids[i] < chunk->dictCount && pass[ids[i]];
+        else
+            for (j = chunk->starts[i]; j < chunk->starts[i + 1] && !hit; j++)
+                hit = ids[j] < chunk->dictCount && pass[ids[j]];
+        if (hit)
+            bits[i >> 6] |= 1ULL << (i & 63);
+    }
+    free(pass);
+    return 0;
+}
+
+/* Works out which rows of a row group the filter matches, into the given bitmap, which is cleared first
+ * It returns -1 if the chunk is malformed, 0 if no row matches, and 1 otherwise
+ */
+static int QueryFilterGroup(const Query *q, const unsigned char *group, const ColumnGroupHeader *hdr, const QueryFilter *f, uint64_t *bits)
+{
+    uint32_t words = (hdr->rows + 63) / 64, i;
+    QueryChunk chunk;
+    int all = 0, none = 0;
+
+    if (QueryChunkOpen(q, group, hdr, f->column, &chunk))
+        return -1;
+
+    // The smallest and largest values of the chunk can settle the filter for the whole row group
+    if (f->kind == FILTER_RANGE)
+    {
+        uint64_t top = chunk.width >= 8 ? UINT64_MAX : (1ULL << (8 * chunk.width)) - 1;
+
+        if (f->lo > f->hi)
+            none = 1;
+        else if (f->mask == top && (chunk.info->max < f->lo || chunk.info->min > f->hi))
+            none = 1;
+        else if (f->mask == top && chunk.info->min >= f->lo && chunk.info->max <= f->hi)
+            all = 1;
+    }
+    if (f->negate)
+    {
+        int swap = all;
+
+        all = none;
+        none = swap;
+    }
+    if (none)
+        return 0;
+
+    memset(bits, 0, words * sizeof(uint64_t));
+    if (all)
+        memset(bits, 0xFF, words * sizeof(uint64_t));
+    else if (f->kind == FILTER_RANGE && f->lo <= f->hi)
+        QueryRange(&chunk, hdr->rows, f, bits);
+    else if (f->kind != FILTER_RANGE && QueryStrings(&chunk, hdr->rows, f, bits))
+        return -1;
+
+    if (f->negate && !all)
+        for (i = 0; i < words; i++)
+            bits[i] = ~bits[i];
+    if (hdr->rows % 64)
+        bits[words - 1] &= (1ULL << (hdr->rows % 64)) - 1;
+    return 1;
+}
+
+// Appends the value of a column of a row as a CSV field, with the strings of a list column separated by ';'
+static void QueryValue(Query *q, OutBuf *out, const QueryChunk *chunk, uint32_t row)
+{
+    const uint32_t *ids = (const uint32_t*)chunk->values;
+    uint32_t j;
+
+    switch (chunk->type)
+    {
+        case COLUMN_NUMBER:
+            switch (chunk->width)
+            {
+                case 1:
+                    OutU64(out, chunk->values[row]);
+                    break;
+                case 2:
+                    OutU64(out, ((const uint16_t*)chunk->values)[row]);
+                    break;
+                case 4:
+                    OutU64(out, ((const uint32_t*)chunk->values)[row]);
+                    break;
+                default:
+                    OutU64(out, ((const uint64_t*)chunk->values)[row]);
+                    break;
+            }
+            break;
+        case COLUMN_STRING:
+            OutCsvString(out, QueryString(chunk, ids[row]));
+            break;
+        default:
+            OutReset(&q->list);
+            for (j = chunk->starts[row]; j < chunk->starts[row + 1]; j++)
+            {
+                if (j != chunk->starts[row])
+                    OutChar(&q->list, ';');
+                OutPuts(&q->list, QueryString(chunk, ids[j]));
+            }
+            OutChar(&q->list, '\0');
+            OutCsvString(out, q->list.data != NULL ? q->list.data : "");
+            break;
+    }
+}
+
+// Adds a row to the count of its group, whose key is the CSV fields of the values of the grouping columns
+static int QueryCount(Query *q, const char *key, size_t len)
+{
+    uint64_t mask, i, hash = StrHash(key, len);
+
+    if ((q->groupsUsed + 1) * 2 > q->groupSlots)
+    {
+        uint64_t count = q->groupSlots ? q->groupSlots * 2 : QUERY_INITIAL_GROUPS, j;
+        QueryGroup *groups = calloc(count, sizeof(QueryGroup));
+
+        if (groups == NULL)
+            return 1;
+        for (j = 0; j < q->groupSlots; j++)
+            if (q->groups[j].key != NULL)
+            {
+                for (i = StrHash(q->groups[j].key, strlen(q->groups[j].key)) & (count - 1); groups[i].key != NULL; i = (i + 1) & (count - 1))
+                    ;
+                groups[i] = q->groups[j];
+            }
+        free(q->groups);
+        q->groups = groups;
+        q->groupSlots = count;
+    }
+
+    mask = q->groupSlots - 1;
+    for (i = hash & mask; q->groups[i].key != NULL; i = (i + 1) & mask)
+        if (!strncmp(q->groups[i].key, key, len) && q->groups[i].key[len] == '\0')
+        {
+            q->groups[i].count++;
+            return 0;
+        }
+
+    q->groups[i].key = malloc(len + 1);
+    if (q->groups[i].key == NULL)
+        return 1;
+    memcpy(q->groups[i].key, key, len);
+    q->groups[i].key[len] = '\0';
+    q->groups[i].count = 1;
+    q->groupsUsed++;
+    return 0;
+}
+
+/* Runs the query on one row group, it returns 1 if it's malformed
+ * The rows that pass every filter are counted, added to their groups, or written out
+ */
+static int QueryGroupRows(Query *q, const unsigned char *group, const ColumnGroupHeader *hdr)
+{
+    static uint64_t match[QUERY_WORDS], bits[QUERY_WORDS];
+    QueryChunk groupChunks[QUERY_MAX_COLUMNS], selectChunks[QUERY_MAX_COLUMNS];
+    uint32_t words = (hdr->rows + 63) / 64, w;
+    int i, rc;
+
+    q->rows += hdr->rows;
+    memset(match, 0xFF, words * sizeof(uint64_t));
+    if (hdr->rows % 64)
+        match[words - 1] = (1ULL << (hdr->rows % 64)) - 1;
+
+    for (i = 0; i < q->filterCount; i++)
+    {
+        rc = QueryFilterGroup(q, group, hdr, &q->filters[i], bits);
+        if (rc < 0)
+            return 1;
+        if (rc == 0)
+            return 0;       // No row of the group can match
+        for (w = 0; w < words; w++)
+            match[w] &= bits[w];
+    }
+
+    for (i = 0; i < q->groupCount; i++)
+        if (QueryChunkOpen(q, group, hdr, q->groupBy[i], &groupChunks[i]))
+            return 1;
+    for (i = 0; i < q->selectCount; i++)
+        if (QueryChunkOpen(q, group, hdr, q->select[i], &selectChunks[i]))
+            return 1;
+
+    for (w = 0; w < words; w++)
+    {
+        uint64_t word = match[w];
+
+        if (q->groupCount == 0 && q->selectCount == 0)
+        {
+            q->matches += (uint64_t)__builtin_popcountll(word);
+            continue;
+        }
+
+        for (; word; word &= word - 1)
+        {
+            uint32_t row = w * 64 + (uint32_t)__builtin_ctzll(word);
+
+            q->matches++;
+            if (q->groupCount)
+            {
+                OutReset(&q->key);
+                for (i = 0; i < q->groupCount; i++)
+                {
+                    if (i)
+                        OutChar(&q->key, ',');
+                    QueryValue(q, &q->key, &groupChunks[i], row);
+                }
+                if (QueryCount(q, q->key.data != NULL ? q->key.data : "", q->key.len))
+                    return 1;
+            }
+            else if (q->limit == 0 || q->matches <= q->limit)
+            {
+                for (i = 0; i < q->selectCount; i++)
+                {
+                    if (i)
+                        OutChar(&q->out, ',');
+                    QueryValue(q, &q->out, &selectChunks[i], row);
+                }
+                OutChar(&q->out, '\n');
+                if (q->out.len >= 1 << 20)
+                {
+                    OutFlush(&q->out, stdout);
+                    OutReset(&q->out);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static int QueryGroupCompare(const void *a, const void *b)
+{
+    const QueryGroup *x = a, *y = b;
+
+    if (x->count != y->count)
+        return x->count < y->count ? 1 : -1;
+    return strcmp(x->key, y->key);
+}
+
+// Writes the counts of the groups, the largest first
+static void QueryWriteGroups(Query *q)
+{
+    uint64_t i, n = 0;
+    int c;
+
+    for (i = 0; i < q->groupSlots; i++)
+        if (q->groups[i].key != NULL)
+            q->groups[n++] = q->groups[i];
+    qsort(q->groups, n, sizeof(QueryGroup), QueryGroupCompare);
+
+    OutPuts(&q->out, "count");
+    for (c = 0; c < q->groupCount; c++)
+    {
+        OutChar(&q->out, ',');
+        OutPuts(&q->out, q->columns[q->groupBy[c]].name);
+    }
+    OutChar(&q->out, '\n');
+    for (i = 0; i < n; i++)
+    {
+        OutU64(&q->out, q->groups[i].count);
+        OutChar(&q->out, ',');
+        OutPuts(&q->out, q->groups[i].key);
+        OutChar(&q->out, '\n');
+        free(q->groups[i].key);
+    }
+    q->groupSlots = n;
+}
+
+// Checks the header of the columnar file and its columns, it returns the offset of the first row group, or 0 if it's malformed
+static uint64_t QueryOpenFile(Query *q)
+{
+    ColumnFileHeader hdr;
+    uint64_t size;
+    uint32_t c;
+
+    if (q->size < sizeof(hdr))
+        return 0;
+    memcpy(&hdr, q->data, sizeof(hdr));
+    if (memcmp(hdr.magic, COLUMN_MAGIC, sizeof(hdr.magic)) || hdr.version != COLUMN_VERSION || hdr.columnCount == 0
+        || hdr.columnCount > (q->size - sizeof(hdr)) / sizeof(ColumnDesc))
+        return 0;
+
+    q->columns = (const ColumnDesc*)(q->data + sizeof(hdr));
+    q->columnCount = hdr.columnCount;
+    for (c = 0; c < hdr.columnCount; c++)
+    {
+        const ColumnDesc *col = &q->columns[c];
+
+        if (memchr(col->name, '\0', sizeof(col->name)) == NULL || col->type > COLUMN_LIST
+            || (col->type == COLUMN_NUMBER && col->width != 1 && col->width != 2 && col->width != 4 && col->width != 8))
+            return 0;
+    }
+
+    size = sizeof(hdr) + (uint64_t)hdr.columnCount * sizeof(ColumnDesc);
+    size += (COLUMN_ALIGN - size % COLUMN_ALIGN) % COLUMN_ALIGN;
+    return size <= q->size ? size : 0;
+}
+
+/* This function runs the 'rpe64 query' subcommand, with the arguments that follow 'query'
+ * It returns 0 on success, otherwise it returns 1 after printing the reason.
+ */
+int QueryMain(int argc, char *argv[])
+{
+    const char *groupList = NULL, *selectList = NULL;
+    int ch, i, list = 0, rc = 0;
+    uint64_t offset;
+    PeImage img;
+    Query q;
+
+    memset(&q, 0, sizeof(q));
+    optind = 1;
+    while ((ch = getopt(argc, argv, "g:s:n:l")) != -1)
+        switch (ch)
+        {
+            case 'g':
+                groupList = optarg;
+                break;
+            case 's':
+                selectList = optarg;
+                break;
+            case 'n':
+                q.limit = strtoull(optarg, NULL, 10);
+                break;
+            case 'l':
+                list = 1;
+                break;
+            default:
+                QueryUsage();
+                return 1;
+        }
+    argc -= optind;
+    argv += optind;
+    if (argc < 1 || (groupList != NULL && selectList != NULL))
+    {
+        QueryUsage();
+        return 1;
+    }
+
+    if (PeImageOpen(&img, argv[0]))
+    {
+        fprintf(stderr, "rpe64 query: can't open '%s'\n", argv[0]);
+        return 1;
+    }
+    q.data = img.data;
+    q.size = img.size;
+    offset = QueryOpenFile(&q);
+    if (offset == 0)
+    {
+        fprintf(stderr, "rpe64 query: '%s' isn't a columnar file of rpe64 ('-f columnar')\n", argv[0]);
+        PeImageClose(&img);
+        return 1;
+    }
+
+    if (list)
+    {
+        static const char *const types[] = {"number", "string", "list"};
+        uint32_t c;
+
+        for (c = 0; c < q.columnCount; c++)
+            if (q.columns[c].type == COLUMN_NUMBER)
+                OutPrintf(&q.out, "%s,%s%d\n", q.columns[c].name, types[0], 8 * q.columns[c].width);
+            else
+                OutPrintf(&q.out, "%s,%s\n", q.columns[c].name, types[q.columns[c].type]);
+        OutFlush(&q.out, stdout);
+        OutFree(&q.out);
+        PeImageClose(&img);
+        return 0;
+    }
+
+    q.filterCount = argc - 1;
+    q.filters = calloc(q.filterCount ? q.filterCount : 1, sizeof(QueryFilter));
+    if (q.filters == NULL)
+        rc = 1;
+    for (i = 0; i < q.filterCount && !rc; i++)
+        rc = QueryParseFilter(&q, argv[i + 1], &q.filters[i]);
+    if (!rc && groupList != NULL)
+        rc = QueryColumnList(&q, groupList, q.groupBy, &q.groupCount);
+    if (!rc && selectList != NULL)
+        rc = QueryColumnList(&q, selectList, q.select, &q.selectCount);
+
+#ifdef QUERY_HAVE_SIMD
+    __builtin_cpu_init();
+    QueryUseAvx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    if (!rc && q.selectCount)
+    {
+        for (i = 0; i < q.selectCount; i++)
+        {
+            if (i)
+                OutChar(&q.out, ',');
+            OutPuts(&q.out, q.columns[q.select[i]].name);
+        }
+        OutChar(&q.out, '\n');
+    }
+
+    // The row groups follow each other up to the end of the file
+    while (!rc && offset < q.size)
+    {
+        ColumnGroupHeader hdr;
+
+        if (q.size - offset < sizeof(hdr))
+            rc = 1;
+        else
+        {
+            memcpy(&hdr, q.data + offset, sizeof(hdr));
+            if (hdr.magic != COLUMN_GROUP_MAGIC || hdr.rows > COLUMN_GROUP_ROWS || hdr.size % COLUMN_ALIGN
+                || hdr.size > q.size - offset || hdr.size < sizeof(hdr) + (uint64_t)q.columnCount * sizeof(ColumnChunk)
+                || QueryGroupRows(&q, q.data + offset, &hdr))
+                rc = 1;
+        }
+        if (rc)
+            fprintf(stderr, "rpe64 query: '%s' has a malformed row group at offset %llu\n", argv[0], (unsigned long long)offset);
+        else
+            offset += hdr.size;
+    }
+
+    if (!rc)
+    {
+        if (q.groupCount)
+            QueryWriteGroups(&q);
+        else if (!q.selectCount)
+            OutPrintf(&q.out, "count\n%llu\n", (unsigned long long)q.matches);
+        OutFlush(&q.out, stdout);
+    }
+    else
+        for (offset = 0; offset < q.groupSlots; offset++)
+            free(q.groups[offset].key);
+
+    free(q.groups);
+    free(q.filters);
+    OutFree(&q.out);
+    OutFree(&q.key);
+    OutFree(&q.list);
+    PeImageClose(&img);
+    return rc;
+}
@@ -0,0 +1,485 @@
+/* C-program file that contains the
+   code for the columnar output format of rpe64 ('-f columnar').
+
+   This functionality of rpe64 writes the header fields of many files into one binary file that is laid out
+   by column rather than by file, for aggregate queries over millions of files with 'rpe64 query' (see ColumnQuery.c),
+   without the size of JSON or the cost of parsing it again. Every numeric field of the Image File Header and of
+   the Image Optional Header becomes a column of fixed-width values, named and sized after its entry in the field
+   descriptor tables (see PeFields.c), next to the file name, status and error, the size of the file, and the
+   names of its sections, of the DLLs it imports and of the signature rules it matched ('-S'), which are dictionary-encoded.
+
+   The rows are grouped by COLUMN_GROUP_ROWS into row groups. Each row group holds one chunk per column, with the
+   smallest and largest value of its column, so that queries can skip the row groups that can't match, and its own
+   dictionaries, so that it can be written as soon as it's full. The file can be memory-mapped and its columns
+   scanned in place, see rpe64Header.h for its layout.
+
+   The report of a file (ColumnRecord()) is an intermediate row, which the batch mode puts in order like any other
+   report and which the result cache can keep, and ColumnAdd() adds it to the row group being built.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "rpe64Header.h"
+
+#define COLUMN_MAX 64                   // Largest number of columns of the schema
+#define COLUMN_DICT_INITIAL_SLOTS 256   // Initial size of the hash table of a dictionary, a power of 2
+
+// Where the value of each column comes from
+#define SOURCE_FILE 0
+#define SOURCE_STATUS 1
+#define SOURCE_ERROR 2
+#define SOURCE_ERROR_IN 3
+#define SOURCE_SIZE 4
+#define SOURCE_COFF 5
+#define SOURCE_OPTIONAL 6
+#define SOURCE_SECTIONS 7
+#define SOURCE_DLLS 8
+#define SOURCE_SIGNATURES 9
+
+// Column of the schema
+typedef struct ColumnSpec
+{
+    ColumnDesc desc;
+    int source;                 // One of the SOURCE_ values
+    const PeField *field;       // Field descriptor of SOURCE_COFF and SOURCE_OPTIONAL columns
+} ColumnSpec;
+
+static ColumnSpec Columns[COLUMN_MAX];
+static uint32_t ColumnCount;
+static pthread_once_t ColumnOnce = PTHREAD_ONCE_INIT;
+
+static void ColumnDefine(const char *prefix, const char *name, int type, int width, int source, const PeField *field)
+{
+    ColumnSpec *col = &Columns[ColumnCount++];
+
+    snprintf(col->desc.name, sizeof(col->desc.name), "%s%s", prefix, name);
+    col->desc.type = (uint8_t)type;
+    col->desc.width = (uint8_t)width;
+    col->source = source;
+    col->field = field;
+}
+
+static void ColumnDefineFields(const char *prefix, const PeFieldTable *table, int source)
+{
+    uint16_t i;
+
+    for (i = 0; i < table->count; i++)
+        if (table->fields[i].show != PE_SHOW_NAME)
+            ColumnDefine(prefix, table->fields[i].name, COLUMN_NUMBER, table->fields[i].size, source, &table->fields[i]);
+}
+
+// Builds the schema once, from the descriptor tables of the headers, with the same column names as the CSV format
+static void ColumnSchema(void)
+{
+    ColumnDefine("", "file", COLUMN_STRING, 0, SOURCE_FILE, NULL);
+    ColumnDefine("", "status", COLUMN_STRING, 0, SOURCE_STATUS, NULL);
+    ColumnDefine("", "error", COLUMN_STRING, 0, SOURCE_ERROR, NULL);
+    ColumnDefine("", "error_in", COLUMN_STRING, 0, SOURCE_ERROR_IN, NULL);
+    ColumnDefine("", "size", COLUMN_NUMBER, 8, SOURCE_SIZE, NULL);
+    ColumnDefineFields("coff.", &PeCoffLayout, SOURCE_COFF);
+    ColumnDefineFields("optional.", &PeOptionalLayout, SOURCE_OPTIONAL);
+    ColumnDefine("", "sections", COLUMN_LIST, 0, SOURCE_SECTIONS, NULL);
+    ColumnDefine("", "dlls", COLUMN_LIST, 0, SOURCE_DLLS, NULL);
+    ColumnDefine("", "signatures", COLUMN_LIST, 0, SOURCE_SIGNATURES, NULL);
+}
+
+static void RowString(OutBuf *out, const char *str)
+{
+    uint32_t len = (uint32_t)strlen(str);
+
+    OutWrite(out, &len, sizeof(len));
+    OutWrite(out, str, len);
+}
+
+/* This function appends the row of the given file to the output buffer, for ColumnAdd() to add to a columnar file
+ * The row holds the value of every column in the order of the schema: numbers as 64-bit values, strings as
+ * their 32-bit length and bytes, and lists as their 32-bit number of strings followed by the strings.
+ * The header fields of files whose headers couldn't be decoded are 0.
+ */
+void ColumnRecord(OutBuf *out, const PeFile *pe)
+{
+    const char *stage;
+    int error = PeFileError(pe, &stage);
+    uint32_t c, i, count;
+
+    pthread_once(&ColumnOnce, ColumnSchema);
+    for (c = 0; c < ColumnCount; c++)
+    {
+        const ColumnSpec *col = &Columns[c];
+        uint64_t value = 0;
+
+        switch (col->source)
+        {
+            case SOURCE_FILE:
+                RowString(out, pe->path);
+                continue;
+            case SOURCE_STATUS:
+                RowString(out, PeStatusName(pe->status));
+                continue;
+            case SOURCE_ERROR:
+                RowString(out, PeErrorName(error));
+                continue;
+            case SOURCE_ERROR_IN:
+                RowString(out, stage != NULL ? stage : "");
+                continue;
+            case SOURCE_SECTIONS:
+                count = PE_HEADERS_VALID(pe) ? pe->sectionCount : 0;
+                OutWrite(out, &count, sizeof(count));
+                for (i = 0; i < count; i++)
+                    RowString(out, pe->sections[i].Name);
+                continue;
+            case SOURCE_DLLS:
+                count = pe->importDllCount;
+                OutWrite(out, &count, sizeof(count));
+                for (i = 0; i < count; i++)
+                    RowString(out, pe->importDlls[i].name);
+                continue;
+            case SOURCE_SIGNATURES:
+                count = pe->sigRuleCount;
+                OutWrite(out, &count, sizeof(count));
+                for (i = 0; i < count; i++)
+                    RowString(out, pe->sigRules[i]);
+                continue;
+            case SOURCE_SIZE:
+                value = pe->image.size;
+                break;
+            case SOURCE_COFF:
+                value = PE_HEADERS_VALID(pe) ? PeFieldValue(&pe->coff, col->field) : 0;
+                break;
+            case SOURCE_OPTIONAL:
+                value = PE_HEADERS_VALID(pe) ? PeFieldValue(&pe->opt, col->field) : 0;
+                break;
+        }
+        OutWrite(out, &value, sizeof(value));
+    }
+}
+
+// Dictionary of a string or list column within the row group being built
+typedef struct ColumnDict
+{
+    OutBuf offsets;             // 32-bit offset of each string within bytes
+    OutBuf bytes;               // NUL-terminated strings
+    uint32_t count;
+    uint32_t *slots;            // Hash table of the indexes of the strings plus 1, 0 if the slot is empty
+    uint32_t slotCount;         // A power of 2
+} ColumnDict;
+
+// Column of the row group being built
+typedef struct ColumnBuild
+{
+    OutBuf values;              // Numbers of the width of the column, or 32-bit dictionary indexes
+    OutBuf starts;              // 32-bit offset of the first item of each row of a list column
+    ColumnDict dict;
+    uint64_t min, max;
+    uint32_t items;
+} ColumnBuild;
+
+struct ColumnWriter
+{
+    FILE *fp;
+    ColumnBuild *builds;
+    uint32_t rows;              // Number of rows of the row group being built
+    int failed;                 // Set if the file couldn't be written
+};
+
+static void ColumnDictFree(ColumnDict *dict)
+{
+    OutFree(&dict->offsets);
+    OutFree(&dict->bytes);
+    free(dict->slots);
+    memset(dict, 0, sizeof(*dict));
+}
+
+static const char* ColumnDictString(const ColumnDict *dict, uint32_t index)
+{
+    return dict->bytes.data + ((const uint32_t*)dict->offsets.data)[index];
+}
+
+/* Returns the index of the given string within the dictionary, adding it if it isn't there yet
+ * It returns UINT32_MAX if there's no memory for it
+ */
+static uint32_t ColumnDictAdd(ColumnDict *dict, const char *str, uint32_t len)
+{
+    uint32_t mask, i, offset;
+    uint64_t hash = StrHash(str, len);
+
+    if ((dict->count + 1) * 2 > dict->slotCount)
+    {
+        uint32_t count = dict->slotCount ? dict->slotCount * 2 : COLUMN_DICT_INITIAL_SLOTS, j;
+        uint32_t *slots = calloc(count, sizeof(uint32_t));
+
+        if (slots == NULL)
+            return UINT32_MAX;
+        for (j = 0; j < dict->count; j++)
+        {
+            const char *s = ColumnDictString(dict, j);
+
+            for (i = StrHash(s, strlen(s)) & (count - 1); slots[i]; i = (i + 1) & (count - 1))
+                ;
+            slots[i] = j + 1;
+        }
+        free(dict->slots);
+        dict->slots = slots;
+        dict->slotCount = count;
+    }
+
+    mask = dict->slotCount - 1;
+    for (i = hash & mask; dict->slots[i]; i = (i + 1) & mask)
+    {
+        const char *s = ColumnDictString(dict, dict->slots[i] - 1);
+
+        if (!strncmp(s, str, len) && s[len] == '\0')
+            return dict->slots[i] - 1;
+    }
+
+    offset = (uint32_t)dict->bytes.len;
+    OutWrite(&dict->offsets, &offset, sizeof(offset));
+    OutWrite(&dict->bytes, str, len);
+    OutChar(&dict->bytes, '\0');
+    dict->slots[i] = ++dict->count;
+    return dict->count - 1;
+}
+
+/* This function starts a columnar file on the given stream, by writing its header and its columns
+ * It returns NULL if there's no memory for the writer
+ */
+ColumnWriter* ColumnOpen(FILE *fp)
+{
+    ColumnWriter *w = calloc(1, sizeof(*w));
+    ColumnFileHeader hdr;
+    static const char pad[COLUMN_ALIGN];
+    uint32_t c;
+    size_t size;
+
+    pthread_once(&ColumnOnce, ColumnSchema);
+    if (w == NULL || (w->builds = calloc(ColumnCount, sizeof(ColumnBuild))) == NULL)
+    {
+        free(w);
+        return NULL;
+    }
+    w->fp = fp;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, COLUMN_MAGIC, sizeof(hdr.magic));
+    hdr.version = COLUMN_VERSION;
+    hdr.columnCount = ColumnCount;
+    fwrite(&hdr, sizeof(hdr), 1, fp);
+    for (c = 0; c < ColumnCount; c++)
+        fwrite(&Columns[c].desc, sizeof(ColumnDesc), 1, fp);
+    size = sizeof(hdr) + ColumnCount * sizeof(ColumnDesc);
+    fwrite(pad, 1, (COLUMN_ALIGN - size % COLUMN_ALIGN) % COLUMN_ALIGN, fp);
+    return w;
+}
+
+/* Writes the row group built so far, and starts the next one
+ * The chunks follow the directory of the row group in the order of the columns, each padded to COLUMN_ALIGN bytes
+ */
+static void ColumnFlush(ColumnWriter *w)
+{
+    static const char pad[COLUMN_ALIGN];
+    ColumnGroupHeader group;
+    ColumnChunk chunks[COLUMN_MAX];
+    uint64_t offset;
+    uint32_t c, end;
+
+    if (w->rows == 0)
+        return;
+
+    offset = sizeof(group) + ColumnCount * sizeof(ColumnChunk);
+    offset += (COLUMN_ALIGN - offset % COLUMN_ALIGN) % COLUMN_ALIGN;
+    for (c = 0; c < ColumnCount; c++)
+    {
+        ColumnBuild *b = &w->builds[c];
+        ColumnChunk *chunk = &chunks[c];
+
+        // The offset of the end of the last list, and of the end of the strings, close the offset arrays
+        if (Columns[c].desc.type == COLUMN_LIST)
+            OutWrite(&b->starts, &b->items, sizeof(b->items));
+        if (Columns[c].desc.type != COLUMN_NUMBER)
+        {
+            end = (uint32_t)b->dict.bytes.len;
+            OutWrite(&b->dict.offsets, &end, sizeof(end));
+        }
+
+        memset(chunk, 0, sizeof(*chunk));
+        chunk->offset = offset;
+        chunk->size = b->starts.len + b->values.len + b->dict.offsets.len + b->dict.bytes.len;
+        chunk->min = b->min;
+        chunk->max = b->max;
+        chunk->dictCount = b->dict.count;
+        chunk->items = b->items;
+        offset += chunk->size + (COLUMN_ALIGN - chunk->size % COLUMN_ALIGN) % COLUMN_ALIGN;
+    }
+
+    group.magic = COLUMN_GROUP_MAGIC;
+    group.rows = w->rows;
+    group.size = offset;
+    fwrite(&group, sizeof(group), 1, w->fp);
+    fwrite(chunks, sizeof(ColumnChunk), ColumnCount, w->fp);
+    fwrite(pad, 1, chunks[0].offset - sizeof(group) - ColumnCount * sizeof(ColumnChunk), w->fp);
+
+    for (c = 0; c < ColumnCount; c++)
+    {
+        ColumnBuild *b = &w->builds[c];
+
+        fwrite(b->starts.data, 1, b->starts.len, w->fp);
+        fwrite(b->values.data, 1, b->values.len, w->fp);
+        fwrite(b->dict.offsets.data, 1, b->dict.offsets.len, w->fp);
+        fwrite(b->dict.bytes.data, 1, b->dict.bytes.len, w->fp);
+        fwrite(pad, 1, (COLUMN_ALIGN - chunks[c].size % COLUMN_ALIGN) % COLUMN_ALIGN, w->fp);
+
+        OutFree(&b->starts);
+        OutFree(&b->values);
+        ColumnDictFree(&b->dict);
+        b->min = b->max = 0;
+        b->items = 0;
+    }
+    if (ferror(w->fp))
+        w->failed = 1;
+    w->rows = 0;
+}
+
+// Appends a number of the given width in bytes to the values of a column
+static void ColumnWriteNumber(OutBuf *values, uint64_t value, int width)
+{
+    uint8_t v8 = (uint8_t)value;
+    uint16_t v16 = (uint16_t)value;
+    uint32_t v32 = (uint32_t)value;
+
+    switch (width)
+    {
+        case 1:
+            OutWrite(values, &v8, 1);
+            break;
+        case 2:
+            OutWrite(values, &v16, 2);
+            break;
+        case 4:
+            OutWrite(values, &v32, 4);
+            break;
+        default:
+            OutWrite(values, &value, 8);
+            break;
+    }
+}
+
+// Reads a 32-bit length or count from a row, it returns 1 if the row is too short for it
+static int RowU32(const char **p, const char *end, uint32_t *value)
+{
+    if (end - *p < 4)
+        return 1;
+    memcpy(value, *p, 4);
+    *p += 4;
+    return 0;
+}
+
+// Adds a string of a row to the dictionary of the given column, and writes its index, it returns 1 if the row is malformed
+static int RowDictString(ColumnBuild *b, const char **p, const char *end)
+{
+    uint32_t len, index;
+
+    if (RowU32(p, end, &len) || (size_t)(end - *p) < len)
+        return 1;
+    index = ColumnDictAdd(&b->dict, *p, len);
+    *p += len;
+    if (index == UINT32_MAX)
+        return 1;
+    OutWrite(&b->values, &index, sizeof(index));
+    return 0;
+}
+
+/* This function adds the given row, made by ColumnRecord(), to the columnar file, and writes the row group once it's full
+ * A row that is cut short is left out
+ */
+void ColumnAdd(ColumnWriter *w, const char *row, size_t len)
+{
+    const char *p = row, *end = row + len;
+    size_t saved[COLUMN_MAX][3];
+    uint32_t c, i, count;
+
+    // The lengths of the buffers are saved, so that a malformed row can be taken back out of the row group
+    for (c = 0; c < ColumnCount; c++)
+    {
+        saved[c][0] = w->builds[c].values.len;
+        saved[c][1] = w->builds[c].starts.len;
+        saved[c][2] = w->builds[c].items;
+    }
+
+    for (c = 0; c < ColumnCount; c++)
+    {
+        ColumnBuild *b = &w->builds[c];
+        uint64_t value;
+
+        switch (Columns[c].desc.type)
+        {
+            case COLUMN_NUMBER:
+                if (end - p < 8)
+                    goto malformed;
+                memcpy(&value, p, 8);
+                p += 8;
+                if (w->rows == 0 || value < b->min)
+                    b->min = value;
+                if (w->rows == 0 || value > b->max)
+                    b->max = value;
+                ColumnWriteNumber(&b->values, value, Columns[c].desc.width);
+                break;
+            case COLUMN_STRING:
+                if (RowDictString(b, &p, end))
+                    goto malformed;
+                break;
+            case COLUMN_LIST:
+                if (RowU32(&p, end, &count))
+                    goto malformed;
+                OutWrite(&b->starts, &b->items, sizeof(b->items));
+                for (i = 0; i < count; i++)
+                    if (RowDictString(b, &p, end))
+                        goto malformed;
+                b->items += count;
+                if (w->rows == 0 || count < b->min)
+                    b->min = count;
+                if (w->rows == 0 || count > b->max)
+                    b->max = count;
+                break;
+        }
+    }
+
+    if (++w->rows == COLUMN_GROUP_ROWS)
+        ColumnFlush(w);
+    return;
+
+malformed:
+    // The strings added to the dictionaries stay there, unused, and the min and max may be wider than needed
+    for (c = 0; c < ColumnCount; c++)
+    {
+        ColumnBuild *b = &w->builds[c];
+
+        b->values.len = saved[c][0];
+        b->starts.len = saved[c][1];
+        b->items = (uint32_t)saved[c][2];
+    }
+}
+
+/* This function writes the last row group of the columnar file, and frees the writer
+ * It returns 0 if the whole file could be written, otherwise it returns 1.
+ */
+int ColumnClose(ColumnWriter *w)
+{
+    int failed;
+    uint32_t c;
+
+    if (w == NULL)
+        return 1;
+
+    ColumnFlush(w);
+    failed = w->failed || fflush(w->fp) != 0;
+    for (c = 0; c < ColumnCount; c++)
+    {
+        OutFree(&w->builds[c].starts);
+        OutFree(&w->builds[c].values);
+        ColumnDictFree(&w->builds[c].dict);
+    }
+    free(w->builds);
+    free(w);
+    return failed;
+}
@@ -0,0 +1,509 @@
+/* C-program file that contains the
+   code for the function to decode and show
+   the Attribute Certificate Table of the image file, based on the Microsoft Documentation
+
+   This functionality of rpe64 follows the Certificate Table entry of the data directories, whose
+   address is a file offset rather than an RVA, and walks the WIN_CERTIFICATE structures it holds.
+   The Authenticode signatures among them are PKCS #7 SignedData structures, which are decoded offline
+   by a small bounds-checked DER reader: the signed digest of the image, from the SpcIndirectDataContent,
+   is compared with the Authenticode digest computed by the hashing pass (see ExecutableHashes.c),
+   and the subject and issuer of the signer's certificate are reported.
+   The certificate chain isn't validated, and there are no revocation checks, so a matching digest only means
+   that the image hasn't changed since it was signed by whoever holds the signer's certificate.
+ */
+
+/* Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#the-attribute-certificate-table-image-only
+   Windows Authenticode Portable Executable Signature Format, RFC 2315 (PKCS #7) and RFC 5280 (X.509)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "rpe64Header.h"
+
+#define CERT_HEADER_SIZE 8              // Size of the dwLength, wRevision and wCertificateType fields
+#define CERT_MAX_ENTRIES 16             // Maximum number of WIN_CERTIFICATE structures decoded per file
+#define CERT_MAX_CHAIN 64               // Maximum number of certificates of a SignedData searched for the signer
+#define CERT_MAX_NAME 512               // Maximum length of a distinguished name, in bytes
+
+// DER tags used by the signatures
+#define DER_INTEGER 0x02
+#define DER_OCTET_STRING 0x04
+#define DER_OID 0x06
+#define DER_SEQUENCE 0x30
+#define DER_SET 0x31
+#define DER_CONTEXT_0 0xA0
+#define DER_CONTEXT_1 0xA1
+
+// Encoded object identifiers
+static const unsigned char OidSignedData[] = {0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x02};    // 1.2.840.113549.1.7.2
+static const unsigned char OidSha1[] = {0x2B, 0x0E, 0x03, 0x02, 0x1A};                                  // 1.3.14.3.2.26
+static const unsigned char OidSha256[] = {0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01};        // 2.16.840.1.101.3.4.2.1
+static const unsigned char OidEmail[] = {0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x09, 0x01};         // 1.2.840.113549.1.9.1
+
+// Short names of the attributes of distinguished names, indexed by the last arc of their 2.5.4 identifier
+static const char *const NameAttributes[] = {
+    NULL, NULL, NULL, "CN", "SN", "serialNumber", "C", "L", "ST", "street", "O", "OU", "title"
+};
+
+// Item of a DER encoding, whose contents are within the buffer it was read from
+typedef struct DerItem
+{
+    unsigned tag;
+    const unsigned char *data;  // First byte of the contents
+    size_t len;                 // Number of bytes of the contents
+    const unsigned char *end;   // First byte after the item
+} DerItem;
+
+/* Reads the DER item at the start of the given range
+ * It returns 0 on success, or 1 if the item doesn't fit within the range or isn't in DER
+ */
+static int DerRead(const unsigned char *p, const unsigned char *end, DerItem *item)
+{
+    size_t avail = (size_t)(end - p), len, head = 2, i;
+
+    if (p >= end || avail < 2 || (p[0] & 0x1F) == 0x1F)
+        return 1;
+
+    item->tag = p[0];
+    len = p[1];
+    if (len & 0x80)
+    {
+        size_t count = len & 0x7F;
+
+        // Indefinite lengths are BER, and lengths of more than 4 bytes can't fit in a certificate table
+        if (count == 0 || count > 4 || avail < 2 + count)
+            return 1;
+        for (len = 0, i = 0; i < count; i++)
+            len = len << 8 | p[2 + i];
+        head += count;
+    }
+    if (len > avail - head)
+        return 1;
+
+    item->data = p + head;
+    item->len = len;
+    item->end = p + head + len;
+    return 0;
+}
+
+// Reads the DER item at the given position, which has to have the given tag, and moves the position past it
+static int DerNext(const unsigned char **p, const unsigned char *end, unsigned tag, DerItem *item)
+{
+    if (DerRead(*p, end, item) || item->tag != tag)
+        return 1;
+    *p = item->end;
+    return 0;
+}
+
+// Returns 1 if the given item is the given encoded object identifier
+static int DerIsOid(const DerItem *item, const unsigned char *oid, size_t len)
+{
+    return item->tag == DER_OID && item->len == len && memcmp(item->data, oid, len) == 0;
+}
+
+// Appends the given byte to the buffer of the given size, if there's room for it and the terminating NUL
+static void NameChar(char *buf, size_t size, size_t *n, char c)
+{
+    if (*n + 1 < size)
+        buf[(*n)++] = c;
+}
+
+// Appends the given code point to the buffer in UTF-8
+static void NameCodePoint(char *buf, size_t size, size_t *n, uint32_t c)
+{
+    if (c < 0x20 || c == 0x7F)
+        NameChar(buf, size, n, '?');
+    else if (c < 0x80)
+        NameChar(buf, size, n, (char)c);
+    else if (c < 0x800 && *n + 2 < size)
+    {
+        NameChar(buf, size, n, (char)(0xC0 | c >> 6));
+        NameChar(buf, size, n, (char)(0x80 | (c & 0x3F)));
+    }
+    else if (c >= 0x800 && *n + 3 < size)
+    {
+        NameChar(buf, size, n, (char)(0xE0 | c >> 12));
+        NameChar(buf, size, n, (char)(0x80 | (c >> 6 & 0x3F)));
+        NameChar(buf, size, n, (char)(0x80 | (c & 0x3F)));
+    }
+}
+
+// Appends the given object identifier in dotted form
+static void NameOid(char *buf, size_t size, size_t *n, const DerItem *oid)
+{
+    char arc[24];
+    const char *c;
+    uint64_t value = 0;
+    size_t i;
+    int first = 1;
+
+    for (i = 0; i < oid->len; i++)
+    {
+        value = value << 7 | (oid->data[i] & 0x7F);
+        if (oid->data[i] & 0x80)
+            continue;
+
+        if (first)
+            snprintf(arc, sizeof(arc), "%u.%llu", value < 80 ? (unsigned)(value / 40) : 2, (unsigned long long)(value < 80 ? value % 40 : value - 80));
+        else
+            snprintf(arc, sizeof(arc), ".%llu", (unsigned long long)value);
+        for (c = arc; *c; c++)
+            NameChar(buf, size, n, *c);
+        value = 0;
+        first = 0;
+    }
+}
+
+/* Appends the given X.501 Name as a distinguished name, e.g. "CN=Example, O=Example Corp, C=US",
+ * with its attributes in the order they're encoded in
+ * BMPString values are converted from UTF-16BE, and the other string types are taken as Latin-1 if they aren't ASCII
+ */
+static const char* DerName(const DerItem *name)
+{
+    char buf[CERT_MAX_NAME];
+    const unsigned char *p = name->data, *end = name->data + name->len;
+    size_t n = 0;
+    DerItem rdn, atv;
+
+    while (DerNext(&p, end, DER_SET, &rdn) == 0)
+    {
+        const unsigned char *q = rdn.data;
+        int firstInRdn = 1;
+
+        while (DerNext(&q, rdn.end, DER_SEQUENCE, &atv) == 0)
+        {
+            const unsigned char *r = atv.data;
+            DerItem type, value;
+            const char *label = NULL;
+            size_t i;
+
+            if (DerNext(&r, atv.end, DER_OID, &type) || DerRead(r, atv.end, &value))
+                break;
+
+            if (n)
+                NameChar(buf, sizeof(buf), &n, firstInRdn ? ',' : '+');
+            if (n && firstInRdn)
+                NameChar(buf, sizeof(buf), &n, ' ');
+            firstInRdn = 0;
+
+            if (type.len == 3 && type.data[0] == 0x55 && type.data[1] == 0x04 &&
+                type.data[2] < sizeof(NameAttributes) / sizeof(NameAttributes[0]))
+                label = NameAttributes[type.data[2]];
+            else if (DerIsOid(&type, OidEmail, sizeof(OidEmail)))
+                label = "E";
+            if (label != NULL)
+                for (; *label; label++)
+                    NameChar(buf, sizeof(buf), &n, *label);
+            else
+                NameOid(buf, sizeof(buf), &n, &type);
+            NameChar(buf, sizeof(buf), &n, '=');
+
+            if (value.tag == 0x1E)      // BMPString
+                for (i = 0; i + 1 < value.len; i += 2)
+                    NameCodePoint(buf, sizeof(buf), &n, (uint32_t)value.data[i] << 8 | value.data[i + 1]);
+            else if (value.tag == 0x1C) // UniversalString
+                for (i = 0; i + 3 < value.len; i += 4)
+                    NameCodePoint(buf, sizeof(buf), &n, value.data[i + 2] ? 0xFFFD : (uint32_t)value.data[i + 3] | (uint32_t)value.data[i + 2] << 8);
+            else if (value.tag == 0x0C) // UTF8String, copied as it is apart from control characters
+                for (i = 0; i < value.len; i++)
+                    NameChar(buf, sizeof(buf), &n, value.data[i] < 0x20 || value.data[i] == 0x7F ? '?' : (char)value.data[i]);
+            else
+                for (i = 0; i < value.len; i++)
+                    NameCodePoint(buf, sizeof(buf), &n, value.data[i]);
+        }
+    }
+
+    buf[n] = '\0';
+    return StrIntern(buf, n);
+}
+
+/* Finds the certificate of the given issuer and serial number among the certificates of a SignedData,
+ * and returns its subject in the given item
+ * It returns 0 if it's found, otherwise it returns 1
+ */
+static int FindSigner(const DerItem *certs, const DerItem *issuer, const DerItem *serial, DerItem *subject)
+{
+    const unsigned char *p = certs->data, *end = certs->data + certs->len;
+    DerItem cert, tbs, item, certSerial, certIssuer;
+    int count = 0;
+
+    while (count++ < CERT_MAX_CHAIN && DerRead(p, end, &cert) == 0)
+    {
+        const unsigned char *q;
+
+        p = cert.end;
+        if (cert.tag != DER_SEQUENCE)
+            continue;
+
+        // TBSCertificate: an optional [0] version, serialNumber, signature, issuer, validity and subject
+        q = cert.data;
+        if (DerNext(&q, cert.end, DER_SEQUENCE, &tbs))
+            continue;
+        q = tbs.data;
+        if (DerRead(q, tbs.end, &item) == 0 && item.tag == DER_CONTEXT_0)
+            q = item.end;
+        if (DerNext(&q, tbs.end, DER_INTEGER, &certSerial) || DerNext(&q, tbs.end, DER_SEQUENCE, &item) ||
+            DerNext(&q, tbs.end, DER_SEQUENCE, &certIssuer) || DerNext(&q, tbs.end, DER_SEQUENCE, &item) ||
+            DerNext(&q, tbs.end, DER_SEQUENCE, subject))
+            continue;
+
+        if (certSerial.len == serial->len && memcmp(certSerial.data, serial->data, serial->len) == 0 &&
+            certIssuer.len == issuer->len && memcmp(certIssuer.data, issuer->data, issuer->len) == 0)
+            return 0;
+    }
+    return 1;
+}
+
+/* Decodes the PKCS #7 SignedData of an Authenticode signature into the given entry:
+ * the algorithm and value of the signed digest of the image, and the subject and issuer of the first signer
+ * Anything that can't be decoded is left unset
+ */
+static void DecodeSignedData(PeCertificate *cert, const unsigned char *data, size_t len)
+{
+    const unsigned char *p = data, *end = data + len, *q;
+    DerItem contentInfo, item, signedData, content, indirect, digestInfo, alg, digest, certs, signers, signer, issuer, serial, subject;
+    int haveCerts = 0;
+
+    // ContentInfo: contentType signedData, and the SignedData as [0] EXPLICIT content
+    if (DerNext(&p, end, DER_SEQUENCE, &contentInfo))
+        return;
+    p = contentInfo.data;
+    if (DerNext(&p, contentInfo.end, DER_OID, &item) || !DerIsOid(&item, OidSignedData, sizeof(OidSignedData)) ||
+        DerNext(&p, contentInfo.end, DER_CONTEXT_0, &item))
+        return;
+    p = item.data;
+    if (DerNext(&p, item.end, DER_SEQUENCE, &signedData))
+        return;
+
+    // SignedData: version, digestAlgorithms, contentInfo, an optional [0] certificates and [1] crls, and signerInfos
+    p = signedData.data;
+    if (DerNext(&p, signedData.end, DER_INTEGER, &item) || DerNext(&p, signedData.end, DER_SET, &item) ||
+        DerNext(&p, signedData.end, DER_SEQUENCE, &content))
+        return;
+
+    /* The content is the SpcIndirectDataContent, whose messageDigest is a DigestInfo of the image
+     * It's normally [0] EXPLICIT, but CMS signers wrap it in an OCTET STRING as well
+     */
+    q = content.data;
+    if (DerNext(&q, content.end, DER_OID, &item) == 0 && DerNext(&q, content.end, DER_CONTEXT_0, &item) == 0)
+    {
+        q = item.data;
+        if (DerRead(q, item.end, &indirect) == 0 && indirect.tag == DER_OCTET_STRING)
+            q = indirect.data;
+        if (DerNext(&q, item.end, DER_SEQUENCE, &indirect) == 0)
+        {
+            q = indirect.data;
+            if (DerNext(&q, indirect.end, DER_SEQUENCE, &item) == 0 && DerNext(&q, indirect.end, DER_SEQUENCE, &digestInfo) == 0)
+            {
+                q = digestInfo.data;
+                if (DerNext(&q, digestInfo.end, DER_SEQUENCE, &alg) == 0 && DerNext(&q, digestInfo.end, DER_OCTET_STRING, &digest) == 0)
+                {
+                    q = alg.data;
+                    if (DerNext(&q, alg.end, DER_OID, &item) == 0)
+                    {
+                        if (DerIsOid(&item, OidSha1, sizeof(OidSha1)))
+                            cert->digestAlg = PE_DIGEST_SHA1;
+                        else if (DerIsOid(&item, OidSha256, sizeof(OidSha256)))
+                            cert->digestAlg = PE_DIGEST_SHA256;
+                        if (cert->digestAlg != PE_DIGEST_NONE && digest.len == PeDigestSize(cert->digestAlg))
+                            memcpy(cert->digest, digest.data, digest.len);
+                        else
+                            cert->digestAlg = PE_DIGEST_NONE;
+                    }
+                }
+            }
+        }
+    }
+
+    if (DerRead(p, signedData.end, &certs) == 0 && certs.tag == DER_CONTEXT_0)
+    {
+        haveCerts = 1;
+        p = certs.end;
+    }
+    if (DerRead(p, signedData.end, &item) == 0 && item.tag == DER_CONTEXT_1)
+        p = item.end;
+    if (DerNext(&p, signedData.end, DER_SET, &signers))
+        return;
+
+    // SignerInfo: version, issuerAndSerialNumber, ...
+    q = signers.data;
+    if (DerNext(&q, signers.end, DER_SEQUENCE, &signer))
+        return;
+    q = signer.data;
+    if (DerNext(&q, signer.end, DER_INTEGER, &item) || DerNext(&q, signer.end, DER_SEQUENCE, &item))
+        return;
+    q = item.data;
+    if (DerNext(&q, item.end, DER_SEQUENCE, &issuer) || DerNext(&q, item.end, DER_INTEGER, &serial))
+        return;
+
+    cert->issuer = DerName(&issuer);
+    if (haveCerts && FindSigner(&certs, &issuer, &serial, &subject) == 0)
+        cert->subject = DerName(&subject);
+}
+
+// Returns the name of the given PE_DIGEST_ value
+const char* PeDigestName(int alg)
+{
+    return alg == PE_DIGEST_SHA1 ? "SHA-1" : alg == PE_DIGEST_SHA256 ? "SHA-256" : "unknown";
+}
+
+// Returns the size in bytes of the digests of the given PE_DIGEST_ value
+size_t PeDigestSize(int alg)
+{
+    return alg == PE_DIGEST_SHA1 ? 20 : alg == PE_DIGEST_SHA256 ? 32 : 0;
+}
+
+/* This function decodes the WIN_CERTIFICATE structures of the Attribute Certificate Table into the model,
+ * which are 8-byte aligned and follow each other up to the size given by the data directory
+ * Structures that run past the end of the file or past CERT_MAX_ENTRIES are left out,
+ * and the certificatesError field of the model is set
+ * It returns 0 on success, or 1 if the headers of the file couldn't be decoded
+ */
+int PeFileCertificates(PeFile *pe)
+{
+    uint32_t offset = pe->dir[PE_DIR_CERTIFICATE].VirtualAddress;
+    PeCursor table;
+
+    if (!PE_HEADERS_VALID(pe))
+        return 1;
+    if (pe->parsed & PE_PARSED_CERTIFICATES)
+        return 0;
+    pe->parsed |= PE_PARSED_CERTIFICATES;
+
+    if (offset == 0 || pe->dir[PE_DIR_CERTIFICATE].Size == 0)
+        return 0;
+    PeSetError(&pe->certificatesError, PeCursorAtOffset(&table, &pe->image, offset, pe->dir[PE_DIR_CERTIFICATE].Size));
+
+    while (CursorLeft(&table) >= CERT_HEADER_SIZE)
+    {
+        uint32_t start = table.pos;
+        uint32_t length = CursorU32(&table);
+        uint16_t revision = CursorU16(&table);
+        uint16_t type = CursorU16(&table);
+        const unsigned char *content;
+        PeCertificate *cert;
+        uint64_t next;
+
+        if (length < CERT_HEADER_SIZE)
+        {
+            PeSetError(&pe->certificatesError, PE_ERROR_MALFORMED);
+            break;
+        }
+        content = CursorBytes(&table, length - CERT_HEADER_SIZE);
+        if (content == NULL)
+        {
+            PeSetError(&pe->certificatesError, PE_ERROR_TRUNCATED);
+            break;
+        }
+        if (pe->certificateCount == CERT_MAX_ENTRIES)
+        {
+            PeSetError(&pe->certificatesError, PE_ERROR_LIMIT);
+            break;
+        }
+        if (pe->certificates == NULL)
+        {
+            pe->certificates = calloc(CERT_MAX_ENTRIES, sizeof(PeCertificate));
+            if (pe->certificates == NULL)
+            {
+                PeSetError(&pe->certificatesError, PE_ERROR_NO_MEMORY);
+                break;
+            }
+        }
+
+        cert = &pe->certificates[pe->certificateCount++];
+        cert->offset = offset + start;
+        cert->length = length;
+        cert->revision = revision;
+        cert->type = type;
+        if (cert->type == WIN_CERT_TYPE_PKCS_SIGNED_DATA)
+            DecodeSignedData(cert, content, length - CERT_HEADER_SIZE);
+
+        // Each structure is padded to a multiple of 8 bytes, which may run past the end of the table after the last one
+        next = start + (((uint64_t)length + 7) & ~(uint64_t)7);
+        if (next >= table.size)
+            break;
+        CursorSeek(&table, (uint32_t)next);
+    }
+
+    return 0;
+}
+
+// Returns the name of the given wCertificateType
+static const char* CertificateType(uint16_t type)
+{
+    switch (type)
+    {
+        case WIN_CERT_TYPE_X509:
+            return "X509";
+        case WIN_CERT_TYPE_PKCS_SIGNED_DATA:
+            return "PKCS_SIGNED_DATA";
+        case WIN_CERT_TYPE_TS_STACK_SIGNED:
+            return "TS_STACK_SIGNED";
+        default:
+            return "unknown";
+    }
+}
+
+/* The following function is used to show the Authenticode digest of the image file and its certificate table
+ * It takes the parsed model of the executable, on which PeFileAuthenticode() has been run, as a pointer argument
+ * It returns nothing and simply appends strings to the given output buffer
+ */
+void ExecutableCertificates(OutBuf *out, const PeFile *exes)
+{
+    uint32_t i;
+
+    if (!PE_HEADERS_VALID(exes))
+    {
+        OutPrintf (out, "\nThe given executable doesn't have complete PE File Header information.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "\nCertificate Table: --\n\n");
+    if (exes->parsed & PE_PARSED_AUTHENTICODE)
+    {
+        OutPrintf (out, "Authenticode %s: ", PeDigestName(exes->authenticodeAlg));
+        OutHex(out, exes->authenticode, PeDigestSize(exes->authenticodeAlg));
+        OutChar(out, '\n');
+    }
+
+    if (exes->certificateCount == 0 && !exes->certificatesError)
+    {
+        OutPrintf (out, "The given executable isn't signed.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "Number of Certificates: %u\n", exes->certificateCount);
+    if (exes->certificatesError == PE_ERROR_UNMAPPED)
+        OutPrintf (out, "Warning: the certificate table doesn't point into the file\n");
+    else if (exes->certificatesError == PE_ERROR_LIMIT)
+        OutPrintf (out, "Warning: the certificate table has more than %d certificates, only the first ones are shown\n", CERT_MAX_ENTRIES);
+    else if (exes->certificatesError)
+        OutPrintf (out, "Warning: the certificate table is cut off or malformed, only the certificates before the cut are shown\n");
+
+    for (i = 0; i < exes->certificateCount; i++)
+    {
+        const PeCertificate *cert = &exes->certificates[i];
+
+        OutPrintf (out, "\nCertificate %u --\n", i + 1);
+        OutPrintf (out, "Offset: 0x%X\nLength: %u\nRevision: 0x%04X\nType: %s\n", cert->offset, cert->length, cert->revision, CertificateType(cert->type));
+        if (cert->type != WIN_CERT_TYPE_PKCS_SIGNED_DATA)
+            continue;
+
+        if (cert->digestAlg != PE_DIGEST_NONE)
+        {
+            OutPrintf (out, "Signed Digest: %s ", PeDigestName(cert->digestAlg));
+            OutHex(out, cert->digest, PeDigestSize(cert->digestAlg));
+            if (cert->digestAlg == exes->authenticodeAlg && (exes->parsed & PE_PARSED_AUTHENTICODE))
+                OutPuts(out, memcmp(cert->digest, exes->authenticode, PeDigestSize(cert->digestAlg)) == 0 ?
+                        " (matches the image)\n" : " (doesn't match the image)\n");
+            else
+                OutChar(out, '\n');
+        }
+        else
+            OutPrintf (out, "Signed Digest: none or unsupported\n");
+        OutPrintf (out, "Signer Subject: %s\n", cert->subject != NULL ? cert->subject : "unknown");
+        OutPrintf (out, "Signer Issuer: %s\n", cert->issuer != NULL ? cert->issuer : "unknown");
+    }
+
+    OutPrintf (out, "\n");
+}
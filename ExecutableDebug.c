@@ -0,0 +1,358 @@
+/* C-program file that contains the
+   code for the function to decode and show
+   the Debug Directory of the image file, based on the Microsoft Documentation
+
+   This functionality of rpe64 follows the Debug Data Table of the data directories, and decodes
+   its IMAGE_DEBUG_DIRECTORY entries, together with the debug data of the types that identify the build:
+   the CodeView record, whose PDB GUID (or time stamp) and age are the key that symbol servers index the PDB on,
+   the POGO entry, which lists the COFF groups the linker put into the sections, and the REPRO entry
+   of images linked with /Brepro, whose time stamps are hashes of the build rather than times.
+   The debug data is found through its file offset, so that debug data that isn't loaded into memory is read too.
+ */
+
+/* Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#the-debug-section
+   https://github.com/dotnet/runtime/blob/main/docs/design/specs/PE-COFF.md (CodeView and deterministic debug entries)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rpe64Header.h"
+
+#define DEBUG_DIRECTORY_SIZE 28         // Size of an IMAGE_DEBUG_DIRECTORY structure
+#define DEBUG_MAX_ENTRIES 64            // Maximum number of debug entries decoded per file
+#define POGO_MAX_ENTRIES 4096           // Maximum number of section contributions decoded from a POGO entry
+#define PDB_MAX_PATH 1024               // Maximum length of the path of a PDB
+#define CV_SIGNATURE_RSDS 0x53445352    // 'RSDS'
+#define CV_SIGNATURE_NB10 0x3031424E    // 'NB10'
+#define CV_RSDS_HEADER_SIZE 24          // Signature, GUID and age, before the path
+#define CV_NB10_HEADER_SIZE 16          // Signature, offset, time stamp and age, before the path
+
+// Names of the debug types, indexed by type
+static const char *const DebugTypes[] = {
+    "UNKNOWN", "COFF", "CODEVIEW", "FPO", "MISC", "EXCEPTION", "FIXUP", "OMAP_TO_SRC", "OMAP_FROM_SRC",
+    "BORLAND", "RESERVED10", "CLSID", "VC_FEATURE", "POGO", "ILTCG", "MPX", "REPRO", "EMBEDDED_PDB",
+    NULL, "PDBCHECKSUM", "EX_DLLCHARACTERISTICS"
+};
+
+// Returns the name of the given debug type
+const char* PeDebugTypeName(uint32_t type)
+{
+    if (type < sizeof(DebugTypes) / sizeof(DebugTypes[0]) && DebugTypes[type] != NULL)
+        return DebugTypes[type];
+    return "UNKNOWN";
+}
+
+/* Points the given cursor at the debug data of the given entry, found through its file offset,
+ * or through its RVA if it has no file offset
+ * It returns PE_ERROR_NONE if all the data lies within the file, otherwise one of the other PE_ERROR_ values
+ */
+static int DebugData(const PeFile *pe, const PeDebugEntry *entry, PeCursor *data)
+{
+    if (entry->pointerToRawData)
+        return PeCursorAtOffset(data, &pe->image, entry->pointerToRawData, entry->sizeOfData);
+    if (entry->addressOfRawData)
+        return PeCursorAtRva(data, pe, entry->addressOfRawData, entry->sizeOfData);
+    return PeCursorAtOffset(data, &pe->image, pe->image.size, 0);
+}
+
+// Interns the NUL-terminated string at the cursor, which is cut at the end of the data if it isn't terminated
+static const char* DebugString(PeCursor *data, size_t max)
+{
+    const unsigned char *str = data->data + data->pos, *end;
+    size_t avail = CursorLeft(data);
+
+    if (avail > max)
+        avail = max;
+    end = memchr(str, 0, avail);
+    return StrIntern((const char*)str, end != NULL ? (size_t)(end - str) : avail);
+}
+
+// Decodes an RSDS or NB10 CodeView record into the model, returning 1 if it's cut off or of another format
+static int DecodeCodeView(PeFile *pe, PeCursor *data)
+{
+    PeCodeView *cv = &pe->codeView;
+    uint32_t signature = CursorU32(data);
+    const unsigned char *guid;
+
+    if (signature == CV_SIGNATURE_RSDS && CursorLeft(data) >= CV_RSDS_HEADER_SIZE - 4)
+    {
+        guid = CursorBytes(data, 16);
+        memcpy(cv->guid, guid, 16);
+        cv->age = CursorU32(data);
+    }
+    else if (signature == CV_SIGNATURE_NB10 && CursorLeft(data) >= CV_NB10_HEADER_SIZE - 4)
+    {
+        CursorU32(data);        // Offset of the debug information within the PDB, which is always 0
+        cv->stamp = CursorU32(data);
+        cv->age = CursorU32(data);
+    }
+    else
+        return 1;
+
+    cv->pdbPath = DebugString(data, PDB_MAX_PATH);
+    cv->signature = signature;
+    return 0;
+}
+
+/* Decodes the section contributions of a POGO entry into the model
+ * Each contribution is an RVA, a size and a NUL-terminated name, padded to a multiple of 4 bytes
+ */
+static void DecodePogo(PeFile *pe, PeCursor *data)
+{
+    uint32_t capacity = 0;
+
+    pe->hasPogo = 1;
+    pe->pogoSignature = CursorU32(data);
+    while (CursorLeft(data) >= 9)
+    {
+        uint32_t rva = CursorU32(data), size = CursorU32(data), padded;
+        const unsigned char *name = data->data + data->pos;
+        const unsigned char *end = memchr(name, 0, CursorLeft(data));
+        PePogoEntry *entry;
+
+        if (end == NULL)
+        {
+            PeSetError(&pe->debugError, PE_ERROR_MALFORMED);
+            break;
+        }
+        if (pe->pogoCount == POGO_MAX_ENTRIES)
+        {
+            PeSetError(&pe->debugError, PE_ERROR_LIMIT);
+            break;
+        }
+        if (pe->pogoCount == capacity)
+        {
+            uint32_t count = capacity ? capacity * 2 : 32;
+            PePogoEntry *grown = realloc(pe->pogoEntries, count * sizeof(PePogoEntry));
+
+            if (grown == NULL)
+            {
+                PeSetError(&pe->debugError, PE_ERROR_NO_MEMORY);
+                break;
+            }
+            pe->pogoEntries = grown;
+            capacity = count;
+        }
+
+        entry = &pe->pogoEntries[pe->pogoCount++];
+        entry->rva = rva;
+        entry->size = size;
+        entry->name = StrIntern((const char*)name, (size_t)(end - name));
+
+        // The padding of the last name may run past the end of the data
+        padded = (uint32_t)(end - name + 1 + 3) / 4 * 4;
+        if (padded >= CursorLeft(data))
+            break;
+        CursorBytes(data, padded);
+    }
+}
+
+/* This function decodes the entries of the Debug Directory into the model, with the CodeView record,
+ * the section contributions of the POGO entry and the hash of the REPRO entry, if there are any
+ * Only the first entry of each of those types is decoded
+ * It returns 0 on success, or 1 if the headers of the file couldn't be decoded
+ */
+int PeFileDebug(PeFile *pe)
+{
+    uint32_t rva = pe->dir[PE_DIR_DEBUG].VirtualAddress, count, i;
+    PeCursor table;
+
+    if (!PE_HEADERS_VALID(pe))
+        return 1;
+    if (pe->parsed & PE_PARSED_DEBUG)
+        return 0;
+    pe->parsed |= PE_PARSED_DEBUG;
+
+    if (rva == 0 || pe->dir[PE_DIR_DEBUG].Size == 0)
+        return 0;
+    PeSetError(&pe->debugError, PeCursorAtRva(&table, pe, rva, pe->dir[PE_DIR_DEBUG].Size));
+
+    count = table.size / DEBUG_DIRECTORY_SIZE;
+    if (count > DEBUG_MAX_ENTRIES)
+    {
+        count = DEBUG_MAX_ENTRIES;
+        PeSetError(&pe->debugError, PE_ERROR_LIMIT);
+    }
+    if (count == 0)
+        return 0;
+
+    pe->debugEntries = malloc(count * sizeof(PeDebugEntry));
+    if (pe->debugEntries == NULL)
+    {
+        PeSetError(&pe->debugError, PE_ERROR_NO_MEMORY);
+        return 0;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        PeDebugEntry *entry = &pe->debugEntries[i];
+        PeCursor data;
+        int rc;
+
+        entry->characteristics = CursorU32(&table);
+        entry->timeDateStamp = CursorU32(&table);
+        entry->majorVersion = CursorU16(&table);
+        entry->minorVersion = CursorU16(&table);
+        entry->type = CursorU32(&table);
+        entry->sizeOfData = CursorU32(&table);
+        entry->addressOfRawData = CursorU32(&table);
+        entry->pointerToRawData = CursorU32(&table);
+        pe->debugCount++;
+
+        rc = entry->sizeOfData ? DebugData(pe, entry, &data) : PE_ERROR_UNMAPPED;
+        if (rc != PE_ERROR_NONE)
+        {
+            if (entry->sizeOfData && (entry->type == IMAGE_DEBUG_TYPE_CODEVIEW || entry->type == IMAGE_DEBUG_TYPE_POGO))
+                PeSetError(&pe->debugError, rc);
+            else if (entry->type == IMAGE_DEBUG_TYPE_REPRO)
+                pe->hasRepro = 1;
+            continue;
+        }
+
+        if (entry->type == IMAGE_DEBUG_TYPE_CODEVIEW && pe->codeView.signature == 0)
+            DecodeCodeView(pe, &data);
+        else if (entry->type == IMAGE_DEBUG_TYPE_POGO && !pe->hasPogo && entry->sizeOfData >= 4)
+            DecodePogo(pe, &data);
+        else if (entry->type == IMAGE_DEBUG_TYPE_REPRO && !pe->hasRepro)
+        {
+            // The data, if any, is the size of the hash followed by the hash
+            pe->hasRepro = 1;
+            if (entry->sizeOfData >= 4)
+            {
+                uint32_t size = CursorU32(&data);
+
+                if (size > CursorLeft(&data))
+                    PeSetError(&pe->debugError, PE_ERROR_MALFORMED);
+                else if (size > PE_REPRO_HASH_MAX)
+                    PeSetError(&pe->debugError, PE_ERROR_LIMIT);
+                else
+                {
+                    memcpy(pe->reproHash, CursorBytes(&data, size), size);
+                    pe->reproHashSize = size;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+// Writes the GUID of the PDB in its registry format, e.g. "{3844DBB9-2017-4967-BE7A-A4A2C20430FA}", or an empty string if there's none
+void PeCodeViewGuid(const PeCodeView *cv, char buf[39])
+{
+    const unsigned char *g = cv->guid;
+
+    if (cv->signature != CV_SIGNATURE_RSDS)
+    {
+        buf[0] = '\0';
+        return;
+    }
+    snprintf(buf, 39, "{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}", ReadLe32(g), ReadLe16(g + 4), ReadLe16(g + 6),
+             g[8], g[9], g[10], g[11], g[12], g[13], g[14], g[15]);
+}
+
+/* Writes the key that symbol servers store the PDB under, i.e. the directory between the name of the PDB and the PDB itself:
+ * the GUID without punctuation followed by the age in hexadecimal, or the time stamp and the age in hexadecimal for NB10 records
+ * It writes an empty string if there's no CodeView record
+ */
+void PeCodeViewKey(const PeCodeView *cv, char buf[41])
+{
+    const unsigned char *g = cv->guid;
+
+    if (cv->signature == CV_SIGNATURE_RSDS)
+        snprintf(buf, 41, "%08X%04X%04X%02X%02X%02X%02X%02X%02X%02X%02X%X", ReadLe32(g), ReadLe16(g + 4), ReadLe16(g + 6),
+                 g[8], g[9], g[10], g[11], g[12], g[13], g[14], g[15], cv->age);
+    else if (cv->signature == CV_SIGNATURE_NB10)
+        snprintf(buf, 41, "%X%X", cv->stamp, cv->age);
+    else
+        buf[0] = '\0';
+}
+
+/* The following function is used to show the entries of the Debug Directory, the PDB of the image file
+ * with its symbol server key, the REPRO hash and the COFF groups of the POGO entry
+ * It takes the parsed model of the executable, on which PeFileDebug() has been run, as a pointer argument
+ * It returns nothing and simply appends strings to the given output buffer
+ */
+void ExecutableDebug(OutBuf *out, const PeFile *exes)
+{
+    const PeCodeView *cv = &exes->codeView;
+    char guid[39], key[41];
+    uint32_t i;
+
+    if (!PE_HEADERS_VALID(exes))
+    {
+        OutPrintf (out, "\nThe given executable doesn't have complete PE File Header information.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "\nDebug Directory: --\n\n");
+    if (exes->dir[PE_DIR_DEBUG].VirtualAddress == 0 || exes->dir[PE_DIR_DEBUG].Size == 0)
+    {
+        OutPrintf (out, "The given executable doesn't have a Debug Directory.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "Number of Entries: %u\n", exes->debugCount);
+    if (exes->debugError == PE_ERROR_LIMIT)
+        OutPrintf (out, "Warning: the Debug Directory or its data have more entries than are decoded, only the first ones are shown\n");
+    else if (exes->debugError)
+        OutPrintf (out, "Warning: the Debug Directory or its data are %s, only the data before them is shown\n",
+                   exes->debugError == PE_ERROR_UNMAPPED ? "outside the file" : "cut off or malformed");
+
+    OutPrintf (out, "\nType                   Time Stamp  Version  Size      RVA         File Offset\n");
+    for (i = 0; i < exes->debugCount; i++)
+    {
+        const PeDebugEntry *entry = &exes->debugEntries[i];
+
+        OutPrintf (out, "%-21s  0x%08X  %u.%-5u  %-8u  0x%08X  0x%08X\n", PeDebugTypeName(entry->type), entry->timeDateStamp,
+                   entry->majorVersion, entry->minorVersion, entry->sizeOfData, entry->addressOfRawData, entry->pointerToRawData);
+    }
+
+    if (cv->signature)
+    {
+        PeCodeViewGuid(cv, guid);
+        PeCodeViewKey(cv, key);
+        OutPrintf (out, "\nCodeView Record: %s\n", cv->signature == CV_SIGNATURE_RSDS ? "RSDS (PDB 7.0)" : "NB10 (PDB 2.0)");
+        if (cv->signature == CV_SIGNATURE_RSDS)
+            OutPrintf (out, "PDB GUID: %s\n", guid);
+        else
+            OutPrintf (out, "PDB Signature: 0x%08X\n", cv->stamp);
+        OutPrintf (out, "PDB Age: %u\n", cv->age);
+        OutPrintf (out, "PDB Path: %s\n", cv->pdbPath);
+        OutPrintf (out, "Symbol Server Key: %s\n", key);
+    }
+
+    if (exes->hasRepro)
+    {
+        OutPrintf (out, "\nReproducible Build: the time stamps of the image are hashes of its contents\n");
+        if (exes->reproHashSize)
+        {
+            OutPrintf (out, "Build Hash: ");
+            OutHex(out, exes->reproHash, exes->reproHashSize);
+            OutChar(out, '\n');
+        }
+    }
+
+    if (exes->hasPogo)
+    {
+        char signature[5];      // 'LTCG', 'PGU' or 'PGI', from the high byte down, without the NUL padding
+        int n = 0;
+
+        for (i = 4; i-- > 0; )
+        {
+            char c = (char)(exes->pogoSignature >> (8 * i));
+
+            if (c >= 0x20 && c < 0x7F)
+                signature[n++] = c;
+        }
+        signature[n] = '\0';
+
+        OutPrintf (out, "\nPOGO (%s): %u COFF groups\n", n ? signature : "no signature", exes->pogoCount);
+        OutPrintf (out, "RVA         Size      Name\n");
+        for (i = 0; i < exes->pogoCount; i++)
+            OutPrintf (out, "0x%08X  %-8u  %s\n", exes->pogoEntries[i].rva, exes->pogoEntries[i].size, exes->pogoEntries[i].name);
+    }
+
+    OutPrintf (out, "\n");
+}
@@ -0,0 +1,265 @@
+/* C-program file that contains the
+   code for the entropy stage of rpe64, which helps to detect packed and encrypted image files.
+
+   This functionality of rpe64 computes the Shannon entropy, in bits per byte, of the whole file,
+   of the raw data of each section, and of the overlay, i.e. the data appended after the end of
+   the last section. Packed or encrypted data has an entropy close to 8.
+
+   The file is cut at every section boundary into disjoint pieces, and each piece is histogrammed
+   only once. The histograms of the file, of each section and of the overlay are then summed from
+   the histograms of their pieces, so no byte of the file is read twice.
+ */
+
+/* Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#section-table-section-headers
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rpe64Header.h"
+
+#define HISTOGRAM_BLOCK_SIZE (1u << 30)     // Bytes counted before the 32-bit sub-histograms are merged
+#define ENTROPY_MAX_PIECES 64               // Sections spanning more pieces than this are histogrammed on their own
+
+/* This function adds the number of times each byte value occurs in the given bytes to the given counts
+ * Incrementing a single histogram stalls on every run of equal bytes, as each increment has to wait
+ * for the store of the previous one. The bytes are therefore spread over 4 sub-histograms, and read
+ * as two 8-byte words at a time, whose bytes are shifted out one by one, so that there is one load
+ * for every 8 bytes rather than one per byte. The increments themselves stay scalar.
+ * The sub-histograms are merged at the end of every block, before their 32-bit counts could overflow.
+ */
+void ByteHistogram(const unsigned char *data, size_t len, uint64_t counts[256])
+{
+    uint32_t sub[4][256];
+
+    while (len)
+    {
+        size_t n = len < HISTOGRAM_BLOCK_SIZE ? len : HISTOGRAM_BLOCK_SIZE;
+        size_t i = 0;
+        int b;
+
+        memset(sub, 0, sizeof(sub));
+
+        for (; i + 16 <= n; i += 16)
+        {
+            uint64_t x, y;
+
+            memcpy(&x, data + i, 8);
+            memcpy(&y, data + i + 8, 8);
+
+            sub[0][x & 0xFF]++;
+            sub[1][(x >> 8) & 0xFF]++;
+            sub[2][(x >> 16) & 0xFF]++;
+            sub[3][(x >> 24) & 0xFF]++;
+            sub[0][(x >> 32) & 0xFF]++;
+            sub[1][(x >> 40) & 0xFF]++;
+            sub[2][(x >> 48) & 0xFF]++;
+            sub[3][x >> 56]++;
+
+            sub[0][y & 0xFF]++;
+            sub[1][(y >> 8) & 0xFF]++;
+            sub[2][(y >> 16) & 0xFF]++;
+            sub[3][(y >> 24) & 0xFF]++;
+            sub[0][(y >> 32) & 0xFF]++;
+            sub[1][(y >> 40) & 0xFF]++;
+            sub[2][(y >> 48) & 0xFF]++;
+            sub[3][y >> 56]++;
+        }
+        for (; i < n; i++)
+            sub[0][data[i]]++;
+
+        for (b = 0; b < 256; b++)
+            counts[b] += (uint64_t)sub[0][b] + sub[1][b] + sub[2][b] + sub[3][b];
+
+        data += n;
+        len -= n;
+    }
+}
+
+// Returns the Shannon entropy of the given byte histogram in bits per byte, which is 0 for no bytes
+double HistogramEntropy(const uint64_t counts[256])
+{
+    uint64_t total = 0;
+    double entropy = 0;
+    int b;
+
+    for (b = 0; b < 256; b++)
+        total += counts[b];
+    if (total == 0)
+        return 0;
+
+    for (b = 0; b < 256; b++)
+        if (counts[b])
+        {
+            double p = (double)counts[b] / (double)total;
+            entropy -= p * log2(p);
+        }
+    return entropy;
+}
+
+static int OffsetCompare(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Finds the index of the piece that starts at the given offset, among the sorted piece boundaries
+ * Every start and end of a section is one of the boundaries
+ */
+static size_t FindPiece(const uint64_t *cuts, size_t count, uint64_t offset)
+{
+    size_t lo = 0, hi = count;
+
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (cuts[mid] < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Sums the histograms of the pieces from the given first piece up to the piece that starts at the given end
+static void SumPieces(uint64_t (*hist)[256], const uint64_t *cuts, size_t first, uint64_t end, uint64_t counts[256])
+{
+    size_t p;
+    int b;
+
+    for (p = first; cuts[p] < end; p++)
+        for (b = 0; b < 256; b++)
+            counts[b] += hist[p][b];
+}
+
+/* This function computes the entropy of the whole file, of the raw data of each section and of the overlay into the model
+ * The overlay starts after the end of the headers and of the raw data of every section, and is empty
+ * if the headers of the file couldn't be decoded
+ * It returns 0 on success, or 1 if the file couldn't be opened or there's no memory for the histograms
+ */
+int PeFileEntropy(PeFile *pe)
+{
+    uint64_t size = pe->image.size, *cuts, (*hist)[256], counts[256];
+    uint16_t count = 0, i;
+    size_t ncuts = 0, p, first;
+    int rc = 1;
+
+    if (pe->status == PE_STATUS_OPEN_FAILED)
+        return 1;
+    if (pe->parsed & PE_PARSED_ENTROPY)
+        return 0;
+    pe->parsed |= PE_PARSED_ENTROPY;
+
+    if (PE_HEADERS_VALID(pe))
+    {
+        count = pe->sectionCount;
+        pe->entropy.overlayOffset = pe->opt.SizeOfHeaders < size ? pe->opt.SizeOfHeaders : size;
+    }
+    else
+        pe->entropy.overlayOffset = size;
+
+    // Boundaries of the pieces: the start and end of the file, of every section and of the overlay
+    cuts = malloc((2 * (size_t)count + 3) * sizeof(uint64_t));
+    hist = malloc((2 * (size_t)count + 3) * sizeof(*hist));
+    pe->sectionEntropy = count ? malloc(count * sizeof(double)) : NULL;
+    if (cuts == NULL || hist == NULL || (count && pe->sectionEntropy == NULL))
+        goto done;
+
+    cuts[ncuts++] = 0;
+    cuts[ncuts++] = size;
+    for (i = 0; i < count; i++)
+    {
+        const PeSection *sec = &pe->sections[i];
+        uint64_t start = sec->PointerToRawData < size ? sec->PointerToRawData : size;
+        uint64_t end = (uint64_t)sec->PointerToRawData + sec->SizeOfRawData;
+
+        if (end > size)
+            end = size;
+        if (sec->SizeOfRawData && end > pe->entropy.overlayOffset)
+            pe->entropy.overlayOffset = end;
+        cuts[ncuts++] = start;
+        cuts[ncuts++] = end;
+    }
+    cuts[ncuts++] = pe->entropy.overlayOffset;
+
+    qsort(cuts, ncuts, sizeof(uint64_t), OffsetCompare);
+    for (p = 1, first = 1; p < ncuts; p++)
+        if (cuts[p] != cuts[first - 1])
+            cuts[first++] = cuts[p];
+    ncuts = first;
+
+    // The histogram of each piece, from one boundary up to the next
+    for (p = 0; p + 1 < ncuts; p++)
+    {
+        memset(hist[p], 0, sizeof(hist[p]));
+        ByteHistogram(pe->image.data + cuts[p], (size_t)(cuts[p + 1] - cuts[p]), hist[p]);
+    }
+
+    memset(counts, 0, sizeof(counts));
+    SumPieces(hist, cuts, 0, size, counts);
+    pe->entropy.file = HistogramEntropy(counts);
+
+    pe->entropy.overlaySize = size - pe->entropy.overlayOffset;
+    memset(counts, 0, sizeof(counts));
+    SumPieces(hist, cuts, FindPiece(cuts, ncuts, pe->entropy.overlayOffset), size, counts);
+    pe->entropy.overlay = HistogramEntropy(counts);
+
+    for (i = 0; i < count; i++)
+    {
+        const PeSection *sec = &pe->sections[i];
+        uint64_t start = sec->PointerToRawData < size ? sec->PointerToRawData : size;
+        uint64_t end = (uint64_t)sec->PointerToRawData + sec->SizeOfRawData;
+
+        if (end > size)
+            end = size;
+        first = FindPiece(cuts, ncuts, start);
+        memset(counts, 0, sizeof(counts));
+
+        // Sections that overlap many others are cheaper to histogram again than to sum up
+        if (FindPiece(cuts, ncuts, end) - first > ENTROPY_MAX_PIECES)
+            ByteHistogram(pe->image.data + start, (size_t)(end - start), counts);
+        else
+            SumPieces(hist, cuts, first, end, counts);
+        pe->sectionEntropy[i] = HistogramEntropy(counts);
+    }
+    rc = 0;
+
+done:
+    if (rc)
+    {
+        free(pe->sectionEntropy);
+        pe->sectionEntropy = NULL;
+    }
+    free(cuts);
+    free(hist);
+    return rc;
+}
+
+/* The following function is used to show the entropy of the image file, of its overlay and of its sections
+ * It takes the parsed model of the executable, on which PeFileEntropy() has been run, as a pointer argument
+ * It returns nothing and simply appends strings to the given output buffer
+ */
+void ExecutableEntropy(OutBuf *out, const PeFile *exes)
+{
+    uint16_t i;
+
+    if (exes->status == PE_STATUS_OPEN_FAILED)
+    {
+        OutPrintf (out, "\nThe given file couldn't be opened.\n\n");
+        return;
+    }
+
+    // Entropy is measured in bits per byte, from 0 for constant data up to 8 for random data
+    OutPrintf (out, "\nEntropy: --\n\n");
+    OutPrintf (out, "File: %.4f\n", exes->entropy.file);
+    OutPrintf (out, "Overlay: %.4f (%llu bytes at 0x%llX)\n", exes->entropy.overlay,
+               (unsigned long long)exes->entropy.overlaySize, (unsigned long long)exes->entropy.overlayOffset);
+
+    if (exes->sectionEntropy != NULL)
+        for (i = 0; i < exes->sectionCount; i++)
+            OutPrintf (out, "Section %-8s  %.4f\n", exes->sections[i].Name, exes->sectionEntropy[i]);
+
+    OutPrintf (out, "\n");
+}
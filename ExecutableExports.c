@@ -0,0 +1,268 @@
+/* C-program file that contains the
+   code for the function to decode and show
+   the functions that the image file exports, based on the Microsoft Documentation
+
+   This functionality of rpe64 follows the Export Table of the data directories, and reads the
+   Export Directory Table, the Export Address Table, the Export Name Pointer Table and the
+   Export Ordinal Table. Exports whose address lies within the export section are forwarders,
+   whose address is that of a 'DLL.Function' or 'DLL.#Ordinal' string naming the real export.
+
+   A hash table of the export names is built while decoding, so that PeFindExportByName()
+   finds an export in constant time, while PeFindExportByOrdinal() indexes the Export Address Table directly.
+   System DLLs export thousands of names, and dependency resolution looks them up over and over.
+ */
+
+/* Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#the-edata-section-image-only
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "rpe64Header.h"
+
+#define EXPORT_DIRECTORY_SIZE 40        // Size of the Export Directory Table
+#define EXPORT_MAX_ENTRIES 65536        // Maximum number of Export Address Table entries and of names decoded per file
+#define EXPORT_MAX_NAME 1024            // Maximum length of an export name or forwarder string
+
+/* Points the given cursor at a table of the given number of entries of the given width at the given RVA
+ * If the table is cut off by the end of its section or of the file, the number of entries is reduced
+ * to those that are present and the exportsError field of the model is set
+ */
+static void ExportTable(PeFile *pe, PeCursor *table, uint32_t rva, uint32_t *count, uint32_t width)
+{
+    memset(table, 0, sizeof(*table));
+    if (*count == 0)
+        return;
+
+    PeSetError(&pe->exportsError, PeCursorAtRva(table, pe, rva, *count * width));
+    if (*count > table->size / width)
+        *count = table->size / width;
+}
+
+// Reads and interns the NUL-terminated string at the given RVA, returning NULL if it can't be read
+static const char* ExportString(PeFile *pe, uint32_t rva)
+{
+    size_t len;
+    const char *str = PeFileRvaString(pe, rva, EXPORT_MAX_NAME, &len);
+
+    if (str == NULL)
+    {
+        PeSetError(&pe->exportsError, PeFileRvaView(pe, rva, 1) ? PE_ERROR_TRUNCATED : PE_ERROR_UNMAPPED);
+        return NULL;
+    }
+    return StrIntern(str, len);
+}
+
+/* Builds the hash table of the export names from the Export Name Pointer Table and the Export Ordinal Table
+ * Each name has an entry of the ordinal table at the same index, which is the unbiased index of its export
+ * The first name of an export also becomes the name of the export itself
+ */
+static void BuildExportNames(PeFile *pe, PeCursor *names, PeCursor *ordinals, uint32_t count)
+{
+    uint32_t slots = 16, mask, i;
+
+    // The table is kept at most half full
+    while (slots < count * 2)
+        slots *= 2;
+
+    pe->exportSlots = calloc(slots, sizeof(PeExportSlot));
+    if (pe->exportSlots == NULL)
+    {
+        PeSetError(&pe->exportsError, PE_ERROR_NO_MEMORY);
+        return;
+    }
+    pe->exportSlotCount = slots;
+    mask = slots - 1;
+
+    for (i = 0; i < count; i++)
+    {
+        uint16_t index = CursorU16(ordinals);
+        uint32_t nameRva = CursorU32(names);
+        const char *name;
+        uint32_t hash, at;
+
+        if (index >= pe->exportCount)
+            continue;
+        name = ExportString(pe, nameRva);
+        if (name == NULL)
+            continue;
+
+        if (pe->exports[index].name == NULL)
+            pe->exports[index].name = name;
+
+        hash = (uint32_t)StrHash(name, strlen(name));
+        for (at = hash & mask; pe->exportSlots[at].name != NULL; at = (at + 1) & mask)
+            ;
+        pe->exportSlots[at].name = name;
+        pe->exportSlots[at].hash = hash;
+        pe->exportSlots[at].index = index;
+        pe->exportNameCount++;
+    }
+}
+
+/* This function decodes the Export Table of the image file into the model, and builds the hash table of its names
+ * Tables that are cut off are decoded up to the point where they're cut off,
+ * and the exportsError field of the model is set
+ * It returns 0 on success, or 1 if the headers of the file couldn't be decoded
+ */
+int PeFileExports(PeFile *pe)
+{
+    uint32_t dirRva = pe->dir[PE_DIR_EXPORT].VirtualAddress;
+    uint32_t dirSize = pe->dir[PE_DIR_EXPORT].Size;
+    uint32_t nameRva, eatRva, namesRva, ordinalsRva;
+    uint32_t eatCount, nameCount, ordinalCount, i;
+    PeCursor dir, eat, names, ordinals;
+    int rc;
+
+    if (!PE_HEADERS_VALID(pe))
+        return 1;
+    if (pe->parsed & PE_PARSED_EXPORTS)
+        return 0;
+    pe->parsed |= PE_PARSED_EXPORTS;
+
+    if (dirRva == 0)
+        return 0;
+
+    rc = PeCursorAtRva(&dir, pe, dirRva, EXPORT_DIRECTORY_SIZE);
+    if (rc != PE_ERROR_NONE)
+    {
+        pe->exportsError = rc;
+        return 0;
+    }
+
+    CursorBytes(&dir, 12);      // Export Flags, Time/Date Stamp and the version
+    nameRva = CursorU32(&dir);
+    pe->exportOrdinalBase = CursorU32(&dir);
+    eatCount = CursorU32(&dir);
+    nameCount = CursorU32(&dir);
+    eatRva = CursorU32(&dir);
+    namesRva = CursorU32(&dir);
+    ordinalsRva = CursorU32(&dir);
+    pe->exportDllName = ExportString(pe, nameRva);
+
+    if (eatCount > EXPORT_MAX_ENTRIES)
+    {
+        eatCount = EXPORT_MAX_ENTRIES;
+        PeSetError(&pe->exportsError, PE_ERROR_LIMIT);
+    }
+    if (nameCount > EXPORT_MAX_ENTRIES)
+    {
+        nameCount = EXPORT_MAX_ENTRIES;
+        PeSetError(&pe->exportsError, PE_ERROR_LIMIT);
+    }
+
+    // Export Address Table, whose entries are either export RVAs or forwarder string RVAs
+    ExportTable(pe, &eat, eatRva, &eatCount, 4);
+    if (eatCount)
+    {
+        pe->exports = calloc(eatCount, sizeof(PeExport));
+        if (pe->exports == NULL)
+        {
+            PeSetError(&pe->exportsError, PE_ERROR_NO_MEMORY);
+            return 0;
+        }
+        pe->exportCount = eatCount;
+    }
+
+    for (i = 0; i < pe->exportCount; i++)
+    {
+        PeExport *exp = &pe->exports[i];
+
+        exp->ordinal = pe->exportOrdinalBase + i;
+        exp->rva = CursorU32(&eat);
+
+        // An address within the export section is that of a forwarder string
+        if (exp->rva >= dirRva && exp->rva - dirRva < dirSize)
+            exp->forwarder = ExportString(pe, exp->rva);
+    }
+
+    // Export Name Pointer Table and Export Ordinal Table, which have the same number of entries
+    ordinalCount = nameCount;
+    ExportTable(pe, &names, namesRva, &nameCount, 4);
+    ExportTable(pe, &ordinals, ordinalsRva, &ordinalCount, 2);
+    if (ordinalCount < nameCount)
+        nameCount = ordinalCount;
+    if (nameCount && pe->exportCount)
+        BuildExportNames(pe, &names, &ordinals, nameCount);
+
+    return 0;
+}
+
+/* This function finds the export of the given name in constant time through the hash table of the export names
+ * It returns NULL if the image file has no export of that name, or if PeFileExports() hasn't been run
+ */
+const PeExport* PeFindExportByName(const PeFile *pe, const char *name)
+{
+    uint32_t hash, mask, at;
+
+    if (pe->exportSlotCount == 0)
+        return NULL;
+
+    hash = (uint32_t)StrHash(name, strlen(name));
+    mask = pe->exportSlotCount - 1;
+    for (at = hash & mask; pe->exportSlots[at].name != NULL; at = (at + 1) & mask)
+    {
+        const PeExportSlot *slot = &pe->exportSlots[at];
+
+        if (slot->hash == hash && (slot->name == name || strcmp(slot->name, name) == 0))
+            return &pe->exports[slot->index];
+    }
+    return NULL;
+}
+
+/* This function finds the export of the given ordinal, which is biased by the ordinal base as in import thunks
+ * It returns NULL if the ordinal is outside the Export Address Table, or isn't used
+ */
+const PeExport* PeFindExportByOrdinal(const PeFile *pe, uint32_t ordinal)
+{
+    uint32_t index = ordinal - pe->exportOrdinalBase;
+
+    if (ordinal < pe->exportOrdinalBase || index >= pe->exportCount || pe->exports[index].rva == 0)
+        return NULL;
+    return &pe->exports[index];
+}
+
+/* The following function is used to show the functions exported by the image file
+ * It takes the parsed model of the executable, on which PeFileExports() has been run, as a pointer argument
+ * It returns nothing and simply appends strings to the given output buffer
+ */
+void ExecutableExports(OutBuf *out, const PeFile *exes)
+{
+    uint32_t i;
+
+    if (!PE_HEADERS_VALID(exes))
+    {
+        OutPrintf (out, "\nThe given executable doesn't have complete PE File Header information.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "\nExport Table: --\n\n");
+    if (exes->dir[PE_DIR_EXPORT].VirtualAddress == 0)
+    {
+        OutPrintf (out, "The given executable doesn't export any functions.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "DLL Name: %s\n", exes->exportDllName ? exes->exportDllName : "");
+    OutPrintf (out, "Ordinal Base: %u\n", exes->exportOrdinalBase);
+    OutPrintf (out, "Number of Functions: %u\n", exes->exportCount);
+    OutPrintf (out, "Number of Names: %u\n", exes->exportNameCount);
+    if (exes->exportsError)
+        OutPrintf (out, "Warning: the export tables are %s, only the exports before the problem are shown\n", PeErrorText(exes->exportsError));
+
+    // Unused entries of the Export Address Table are left out
+    OutPrintf (out, "\nOrdinal  RVA         Name\n");
+    for (i = 0; i < exes->exportCount; i++)
+    {
+        const PeExport *exp = &exes->exports[i];
+
+        if (exp->rva == 0)
+            continue;
+
+        OutPrintf (out, "%-7u  0x%08X  %s", exp->ordinal, exp->rva, exp->name ? exp->name : "[by ordinal only]");
+        if (exp->forwarder != NULL)
+            OutPrintf (out, " -> %s", exp->forwarder);
+        OutPrintf (out, "\n");
+    }
+
+    OutPrintf (out, "\n");
+}
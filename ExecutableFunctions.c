@@ -0,0 +1,211 @@
+/* C-program file that contains the
+   code for the function to decode and show
+   the functions listed by the Exception Table of x64 image files, based on the Microsoft Documentation
+
+   This functionality of rpe64 follows the Exception Table of the data directories, which in x64 images
+   is an array of RUNTIME_FUNCTION structures (the .pdata section), giving the start, the end and the
+   unwind information of every function that isn't a leaf function. It's a cheap index of function boundaries,
+   that doesn't need any disassembly.
+
+   The entries are kept sorted by address, so that PeFindFunction() finds the function that contains
+   a given RVA with a binary search, as the loader does when it unwinds the stack. The entries are also checked:
+   the loader needs them sorted and disjoint, within the executable sections, and the share of the code
+   they cover is reported.
+ */
+
+/* Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#the-pdata-section
+   https://docs.microsoft.com/en-us/cpp/build/exception-handling-x64
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "rpe64Header.h"
+
+#define RUNTIME_FUNCTION_SIZE 12        // Size of the BeginAddress, EndAddress and UnwindInfoAddress fields
+#define MACHINE_AMD64 0x8664            // IMAGE_FILE_MACHINE_AMD64
+#define SCN_MEM_EXECUTE 0x20000000      // IMAGE_SCN_MEM_EXECUTE
+
+static int FunctionCompare(const void *a, const void *b)
+{
+    const PeFunction *x = a, *y = b;
+
+    if (x->begin != y->begin)
+        return x->begin < y->begin ? -1 : 1;
+    return (x->end > y->end) - (x->end < y->end);
+}
+
+// Returns 1 if the given range of RVAs lies within a single executable section
+static int InExecutableSection(const PeFile *pe, uint32_t begin, uint32_t end)
+{
+    int section = PeSectionOfRva(pe, begin);
+
+    return section >= 0 && (pe->sections[section].Characteristics & SCN_MEM_EXECUTE) && PeSectionOfRva(pe, end - 1) == section;
+}
+
+// Returns the number of bytes of the executable sections, as loaded into memory
+uint64_t PeExecutableBytes(const PeFile *pe)
+{
+    uint64_t total = 0;
+    uint16_t i;
+
+    for (i = 0; i < pe->sectionCount; i++)
+        if (pe->sections[i].Characteristics & SCN_MEM_EXECUTE)
+            total += pe->sections[i].VirtualSize ? pe->sections[i].VirtualSize : pe->sections[i].SizeOfRawData;
+    return total;
+}
+
+/* This function decodes the RUNTIME_FUNCTION entries of the Exception Table of x64 images into the model,
+ * sorts them by address if they aren't already, and checks them
+ * The Exception Table of other machine types has other formats, and is left out
+ * It returns 0 on success, or 1 if the headers of the file couldn't be decoded
+ */
+int PeFileFunctions(PeFile *pe)
+{
+    uint32_t rva = pe->dir[PE_DIR_EXCEPTION].VirtualAddress, count, i;
+    uint32_t maxEnd = 0;
+    PeCursor table;
+
+    if (!PE_HEADERS_VALID(pe))
+        return 1;
+    if (pe->parsed & PE_PARSED_FUNCTIONS)
+        return 0;
+    pe->parsed |= PE_PARSED_FUNCTIONS;
+
+    if (pe->coff.Machine != MACHINE_AMD64 || rva == 0)
+        return 0;
+    PeSetError(&pe->functionsError, PeCursorAtRva(&table, pe, rva, pe->dir[PE_DIR_EXCEPTION].Size));
+
+    count = table.size / RUNTIME_FUNCTION_SIZE;
+    if (count == 0)
+        return 0;
+
+    pe->functions = malloc(count * sizeof(PeFunction));
+    if (pe->functions == NULL)
+    {
+        PeSetError(&pe->functionsError, PE_ERROR_NO_MEMORY);
+        return 0;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        PeFunction *func = &pe->functions[i];
+
+        func->begin = CursorU32(&table);
+        func->end = CursorU32(&table);
+        func->unwind = CursorU32(&table);
+        if (i && func->begin < pe->functions[i - 1].begin)
+            pe->functionsUnsorted++;
+    }
+    pe->functionCount = count;
+
+    if (pe->functionsUnsorted)
+        qsort(pe->functions, count, sizeof(PeFunction), FunctionCompare);
+
+    // The code covered by the entries is their union, so overlapping entries aren't counted twice
+    for (i = 0; i < count; i++)
+    {
+        const PeFunction *func = &pe->functions[i];
+
+        if (func->end <= func->begin || !InExecutableSection(pe, func->begin, func->end))
+        {
+            pe->functionsInvalid++;
+            continue;
+        }
+        if (func->begin < maxEnd)
+            pe->functionOverlaps++;
+
+        if (func->begin >= maxEnd)
+            pe->functionBytes += func->end - func->begin;
+        else if (func->end > maxEnd)
+            pe->functionBytes += func->end - maxEnd;
+        if (func->end > maxEnd)
+            maxEnd = func->end;
+    }
+
+    return 0;
+}
+
+/* Finds the function that contains the given RVA with a binary search of the sorted entries of the Exception Table
+ * It returns NULL if no entry contains it, e.g. in leaf functions, which have no entry
+ */
+const PeFunction* PeFindFunction(const PeFile *pe, uint32_t rva)
+{
+    size_t lo = 0, hi = pe->functionCount;
+
+    // Finds the last entry that starts at or before the RVA
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (pe->functions[mid].begin <= rva)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo == 0 || rva >= pe->functions[lo - 1].end)
+        return NULL;
+    return &pe->functions[lo - 1];
+}
+
+/* The following function is used to show the functions of the Exception Table, with the checks of its entries
+ * It takes the parsed model of the executable, on which PeFileFunctions() has been run, as a pointer argument
+ * It returns nothing and simply appends strings to the given output buffer
+ */
+void ExecutableFunctions(OutBuf *out, const PeFile *exes)
+{
+    const PeFunction *entry;
+    uint64_t code;
+    uint32_t i;
+
+    if (!PE_HEADERS_VALID(exes))
+    {
+        OutPrintf (out, "\nThe given executable doesn't have complete PE File Header information.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "\nException Table: --\n\n");
+    if (exes->coff.Machine != MACHINE_AMD64)
+    {
+        OutPrintf (out, "Only the Exception Table of x64 executables is decoded.\n\n");
+        return;
+    }
+    if (exes->dir[PE_DIR_EXCEPTION].VirtualAddress == 0)
+    {
+        OutPrintf (out, "The given executable doesn't have an Exception Table.\n\n");
+        return;
+    }
+
+    code = PeExecutableBytes(exes);
+    OutPrintf (out, "Number of Functions: %u\n", exes->functionCount);
+    OutPrintf (out, "Code Covered: %llu of %llu bytes of the executable sections (%.1f%%)\n", (unsigned long long)exes->functionBytes,
+               (unsigned long long)code, code ? 100.0 * (double)exes->functionBytes / (double)code : 0.0);
+    if (exes->functionsError == PE_ERROR_UNMAPPED)
+        OutPrintf (out, "Warning: the Exception Table doesn't point into the file\n");
+    else if (exes->functionsError == PE_ERROR_NO_MEMORY)
+        OutPrintf (out, "Warning: there was no memory for the entries of the Exception Table\n");
+    else if (exes->functionsError)
+        OutPrintf (out, "Warning: the Exception Table is cut off by the end of its section or of the file\n");
+    if (exes->functionsUnsorted)
+        OutPrintf (out, "Warning: %u entries aren't sorted by address, so the loader can't find them when unwinding\n", exes->functionsUnsorted);
+    if (exes->functionOverlaps)
+        OutPrintf (out, "Warning: %u entries overlap the entry before them\n", exes->functionOverlaps);
+    if (exes->functionsInvalid)
+        OutPrintf (out, "Warning: %u entries are empty or lie outside the executable sections\n", exes->functionsInvalid);
+
+    entry = PeFindFunction(exes, exes->opt.AddressOfEntryPoint);
+    if (entry != NULL)
+        OutPrintf (out, "Entry Point: 0x%08X, in the function at 0x%08X-0x%08X\n", exes->opt.AddressOfEntryPoint, entry->begin, entry->end);
+    else
+        OutPrintf (out, "Entry Point: 0x%08X, not within any function of the table\n", exes->opt.AddressOfEntryPoint);
+
+    OutPrintf (out, "\nBegin       End         Size      Unwind Info\n");
+    for (i = 0; i < exes->functionCount; i++)
+    {
+        const PeFunction *func = &exes->functions[i];
+
+        OutPrintf (out, "0x%08X  0x%08X  %-8u  0x%08X\n", func->begin, func->end, func->end > func->begin ? func->end - func->begin : 0, func->unwind);
+    }
+
+    OutPrintf (out, "\n");
+}
@@ -0,0 +1,337 @@
+/* C-program file that contains the
+   code for the optional hashing stage of rpe64.
+
+   This functionality of rpe64 computes the MD5, SHA-1 and SHA-256 digests of the whole file,
+   and the SHA-256 digest of the raw data of each section, in a single streaming pass over the
+   mapped file: each chunk of the file is fed to every digest, and to every section that overlaps it,
+   while it's still in the cache. It also computes the imphash of the file from its decoded Import Table.
+   A separate sha256sum pass over the same files is then no longer needed.
+
+   The Authenticode digest of the image, which leaves out the CheckSum field, the Certificate Table entry
+   and the certificates themselves, is computed in the same pass when the certificate table is decoded too,
+   so that checking the signatures doesn't need another read of the file. The PE checksum is summed from
+   the same chunks too (see PeChecksum.c).
+ */
+
+#define _DEFAULT_SOURCE     // for strcasecmp()
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "rpe64Header.h"
+
+#define HASH_CHUNK_SIZE (64 * 1024)     // Number of bytes fed to every digest at a time
+
+/* Computes the imphash of the file, which is the MD5 of the comma-separated list of its imports,
+ * each written as 'dll.function' in lowercase, where the 'dll', 'ocx' and 'sys' extensions are dropped
+ * from the DLL names and functions imported by ordinal are written as 'ord<ordinal>'
+ * Only the Import Table is used, not the Delay-load Import Table, as in the original definition of the imphash.
+ * Unlike some tools, the ordinals of ws2_32.dll, wsock32.dll and oleaut32.dll aren't translated to names.
+ */
+static void ComputeImphash(PeFile *pe)
+{
+    OutBuf list;
+    Md5Ctx md5;
+    uint32_t i, j;
+    size_t k;
+
+    OutInit(&list);
+
+    for (i = 0; i < pe->importDllCount; i++)
+    {
+        const PeImportDll *dll = &pe->importDlls[i];
+        const char *dot = strrchr(dll->name, '.');
+        size_t nameLen = strlen(dll->name);
+
+        if (dll->delayLoad)
+            continue;
+        if (dot != NULL && (!strcasecmp(dot, ".dll") || !strcasecmp(dot, ".ocx") || !strcasecmp(dot, ".sys")))
+            nameLen = (size_t)(dot - dll->name);
+
+        for (j = dll->first; j < dll->first + dll->count; j++)
+        {
+            const PeImportFunc *func = &pe->importFuncs[j];
+
+            if (list.len)
+                OutChar(&list, ',');
+            OutWrite(&list, dll->name, nameLen);
+            OutChar(&list, '.');
+            if (func->name != NULL)
+                OutPuts(&list, func->name);
+            else
+                OutPrintf(&list, "ord%u", func->ordinal);
+        }
+    }
+
+    if (list.len)
+    {
+        for (k = 0; k < list.len; k++)
+            if (list.data[k] >= 'A' && list.data[k] <= 'Z')
+                list.data[k] += 'a' - 'A';
+
+        Md5Init(&md5);
+        Md5Update(&md5, list.data, list.len);
+        Md5Final(&md5, pe->hashes.imphash);
+        pe->hashes.hasImphash = 1;
+    }
+
+    OutFree(&list);
+}
+
+#define HASH_FILE 1             // The digests of the whole file and of each section, and the PE checksum
+#define HASH_AUTHENTICODE 2     // The Authenticode digest
+
+// Range of the file that's left out of the Authenticode digest
+typedef struct HashSkip
+{
+    uint64_t start, end;
+} HashSkip;
+
+/* Stores the ranges that the Authenticode digest leaves out, sorted by offset: the CheckSum field
+ * of the Image Optional Header, the Certificate Table entry of the data directories, and the
+ * Attribute Certificate Table itself, whose "RVA" is a file offset
+ * It returns the number of ranges
+ */
+static int AuthenticodeSkips(const PeFile *pe, HashSkip skips[3])
+{
+    uint64_t opt = (uint64_t)pe->dos.e_lfanew + PE_NT_FIXED_SIZE;
+    const PeDataDir *cert = &pe->dir[PE_DIR_CERTIFICATE];
+    int n = 0, i, j;
+
+    skips[n].start = opt + 64;
+    skips[n].end = opt + 68;
+    n++;
+    if (pe->opt.NumberOfRvaAndSizes > PE_DIR_CERTIFICATE)
+    {
+        skips[n].start = opt + (pe->opt.Magic == PE32PLUS_MAGIC ? 112 : 96) + 8 * PE_DIR_CERTIFICATE;
+        skips[n].end = skips[n].start + 8;
+        n++;
+    }
+    if (cert->VirtualAddress && cert->Size)
+    {
+        skips[n].start = cert->VirtualAddress;
+        skips[n].end = (uint64_t)cert->VirtualAddress + cert->Size;
+        n++;
+    }
+
+    for (i = 1; i < n; i++)
+        for (j = i; j > 0 && skips[j].start < skips[j - 1].start; j--)
+        {
+            HashSkip t = skips[j];
+
+            skips[j] = skips[j - 1];
+            skips[j - 1] = t;
+        }
+    return n;
+}
+
+// Feeds the part of the chunk at the given offset that's outside the given ranges to the Authenticode digest
+static void AuthenticodeUpdate(const PeFile *pe, int alg, void *ctx, uint64_t offset, size_t len, const HashSkip *skips, int count)
+{
+    uint64_t at = offset, end = offset + len;
+    int i;
+
+    for (i = 0; i <= count && at < end; i++)
+    {
+        uint64_t stop = i < count && skips[i].start < end ? skips[i].start : end;
+
+        if (at < stop)
+        {
+            if (alg == PE_DIGEST_SHA1)
+                Sha1Update(ctx, pe->image.data + at, (size_t)(stop - at));
+            else
+                Sha256Update(ctx, pe->image.data + at, (size_t)(stop - at));
+        }
+        if (i < count && skips[i].end > at)
+            at = skips[i].end;
+    }
+}
+
+/* Runs the streaming pass over the mapped file, computing the digests selected by the given HASH_ values
+ * Each chunk of the file is fed to every digest, and to every section that overlaps it, while it's still in the cache
+ */
+static void HashPass(PeFile *pe, int what)
+{
+    Md5Ctx md5;
+    Sha1Ctx sha1, authSha1;
+    Sha256Ctx sha256, authSha256, *sections = NULL;
+    HashSkip skips[3];
+    uint16_t count = 0, i;
+    int skipCount = 0, alg = PE_DIGEST_SHA256, checksum = 0;
+    uint64_t words = 0;
+    size_t offset;
+
+    if ((what & HASH_FILE) && PE_HEADERS_VALID(pe) && pe->sectionCount)
+    {
+        sections = malloc(pe->sectionCount * sizeof(Sha256Ctx));
+        pe->sectionSha256 = malloc(pe->sectionCount * sizeof(*pe->sectionSha256));
+        if (sections != NULL && pe->sectionSha256 != NULL)
+            count = pe->sectionCount;
+        for (i = 0; i < count; i++)
+            Sha256Init(&sections[i]);
+    }
+
+    // The Authenticode digest uses the algorithm of the first signature that has a supported one
+    if (what & HASH_AUTHENTICODE)
+    {
+        for (i = 0; i < pe->certificateCount; i++)
+            if (pe->certificates[i].digestAlg != PE_DIGEST_NONE)
+            {
+                alg = pe->certificates[i].digestAlg;
+                break;
+            }
+        skipCount = AuthenticodeSkips(pe, skips);
+        Sha1Init(&authSha1);
+        Sha256Init(&authSha256);
+    }
+
+    // The PE checksum is summed from the same chunks, which all start at even offsets
+    if ((what & HASH_FILE) && PE_HEADERS_VALID(pe) && !(pe->parsed & PE_PARSED_CHECKSUM))
+        checksum = 1;
+
+    if (what & HASH_FILE)
+    {
+        Md5Init(&md5);
+        Sha1Init(&sha1);
+        Sha256Init(&sha256);
+    }
+
+    for (offset = 0; offset < pe->image.size; offset += HASH_CHUNK_SIZE)
+    {
+        const unsigned char *chunk = pe->image.data + offset;
+        size_t len = pe->image.size - offset < HASH_CHUNK_SIZE ? pe->image.size - offset : HASH_CHUNK_SIZE;
+
+        if (what & HASH_FILE)
+        {
+            Md5Update(&md5, chunk, len);
+            Sha1Update(&sha1, chunk, len);
+            Sha256Update(&sha256, chunk, len);
+        }
+        if (checksum)
+            words += PeChecksumAdd(chunk, len);
+        if (what & HASH_AUTHENTICODE)
+            AuthenticodeUpdate(pe, alg, alg == PE_DIGEST_SHA1 ? (void*)&authSha1 : (void*)&authSha256, offset, len, skips, skipCount);
+
+        // The part of the raw data of each section that lies within this chunk
+        for (i = 0; i < count; i++)
+        {
+            uint64_t start = pe->sections[i].PointerToRawData;
+            uint64_t end = start + pe->sections[i].SizeOfRawData;
+
+            if (start < offset)
+                start = offset;
+            if (end > offset + len)
+                end = offset + len;
+            if (start < end)
+                Sha256Update(&sections[i], pe->image.data + start, (size_t)(end - start));
+        }
+    }
+
+    if (what & HASH_FILE)
+    {
+        Md5Final(&md5, pe->hashes.md5);
+        Sha1Final(&sha1, pe->hashes.sha1);
+        Sha256Final(&sha256, pe->hashes.sha256);
+        for (i = 0; i < count; i++)
+            Sha256Final(&sections[i], pe->sectionSha256[i]);
+        free(sections);
+        if (count == 0)
+        {
+            free(pe->sectionSha256);
+            pe->sectionSha256 = NULL;
+        }
+    }
+    if (checksum)
+        PeChecksumFinish(pe, words);
+
+    if (what & HASH_AUTHENTICODE)
+    {
+        pe->authenticodeAlg = alg;
+        if (alg == PE_DIGEST_SHA1)
+            Sha1Final(&authSha1, pe->authenticode);
+        else
+            Sha256Final(&authSha256, pe->authenticode);
+        pe->parsed |= PE_PARSED_AUTHENTICODE;
+    }
+}
+
+/* This function computes the digests of the whole file and of each section, the imphash and the PE checksum, into the model
+ * If the certificate table has already been decoded, the Authenticode digest is computed in the same pass
+ * The section digests, the imphash, the checksum and the Authenticode digest need the headers of the file, and are left out if they couldn't be decoded
+ * It returns 0 on success, or 1 if the file couldn't be opened
+ */
+int PeFileHashes(PeFile *pe)
+{
+    int what = HASH_FILE;
+
+    if (pe->status == PE_STATUS_OPEN_FAILED)
+        return 1;
+    if (pe->parsed & PE_PARSED_HASHES)
+        return 0;
+    pe->parsed |= PE_PARSED_HASHES;
+
+    if ((pe->parsed & PE_PARSED_CERTIFICATES) && !(pe->parsed & PE_PARSED_AUTHENTICODE))
+        what |= HASH_AUTHENTICODE;
+    HashPass(pe, what);
+
+    if (PE_HEADERS_VALID(pe) && PeFileImports(pe) == 0)
+        ComputeImphash(pe);
+
+    return 0;
+}
+
+/* This function decodes the certificate table of the image file, and computes its Authenticode digest into the model,
+ * unless PeFileHashes() already did so in its pass over the file
+ * It returns 0 on success, or 1 if the headers of the file couldn't be decoded
+ */
+int PeFileAuthenticode(PeFile *pe)
+{
+    if (PeFileCertificates(pe))
+        return 1;
+    if (!(pe->parsed & PE_PARSED_AUTHENTICODE))
+        HashPass(pe, HASH_AUTHENTICODE);
+    return 0;
+}
+
+/* The following function is used to show the digests of the image file and of its sections
+ * It takes the parsed model of the executable, on which PeFileHashes() has been run, as a pointer argument
+ * It returns nothing and simply appends strings to the given output buffer
+ */
+void ExecutableHashes(OutBuf *out, const PeFile *exes)
+{
+    uint16_t i;
+
+    if (exes->status == PE_STATUS_OPEN_FAILED)
+    {
+        OutPrintf (out, "\nThe given file couldn't be opened.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "\nHashes: --\n\n");
+
+    OutPuts(out, "MD5: ");
+    OutHex(out, exes->hashes.md5, sizeof(exes->hashes.md5));
+    OutPuts(out, "\nSHA-1: ");
+    OutHex(out, exes->hashes.sha1, sizeof(exes->hashes.sha1));
+    OutPuts(out, "\nSHA-256: ");
+    OutHex(out, exes->hashes.sha256, sizeof(exes->hashes.sha256));
+    OutPuts(out, "\nImphash: ");
+    if (exes->hashes.hasImphash)
+        OutHex(out, exes->hashes.imphash, sizeof(exes->hashes.imphash));
+    else
+        OutPuts(out, "none");
+    OutPuts(out, "\n");
+
+    if (exes->sectionSha256 != NULL)
+    {
+        OutPrintf (out, "\nSHA-256 of the raw data of each section:\n");
+        for (i = 0; i < exes->sectionCount; i++)
+        {
+            OutPrintf (out, "%-8s  ", exes->sections[i].Name);
+            OutHex(out, exes->sectionSha256[i], 32);
+            OutChar(out, '\n');
+        }
+    }
+
+    OutPrintf (out, "\n");
+}
@@ -0,0 +1,326 @@
+/* C-program file that contains the
+   code for the function to decode and show
+   the functions that the image file imports from DLLs, based on the Microsoft Documentation
+
+   This functionality of rpe64 follows the Import Table and the Delay-load Import Table
+   of the data directories, and walks every import descriptor, its Import Lookup Table (or
+   Delay Import Name Table) and the Hint/Name Table entries it points to, for both PE32 and PE32+ images.
+   The names of the DLLs and the functions are interned in the shared string pool,
+   so a batch scan over many files keeps only one copy of each name.
+ */
+
+/* Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#the-idata-section
+                            https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#delay-load-import-tables-image-only
+ */
+
+#include <stdlib.h>
+#include "rpe64Header.h"
+
+#define IMPORT_DESCRIPTOR_SIZE 20       // Size of each entry of the Import Directory Table
+#define DELAY_DESCRIPTOR_SIZE 32        // Size of each entry of the Delay-load Directory Table
+#define IMPORT_MAX_DLLS 4096            // Maximum number of DLLs decoded per file
+#define IMPORT_MAX_FUNCS 65536          // Maximum number of functions decoded per file
+#define IMPORT_MAX_NAME 1024            // Maximum length of a DLL or function name
+
+// Growable arrays that the imports of a file are collected into, before being moved into the model
+typedef struct ImportBuilder
+{
+    PeFile *pe;
+    uint32_t dllCap;
+    uint32_t funcCap;
+} ImportBuilder;
+
+// Appends an empty DLL entry with the given name, returning NULL if there's no room for it
+static PeImportDll* AddImportDll(ImportBuilder *b, uint32_t nameRva, uint32_t timeDateStamp, int delayLoad)
+{
+    PeFile *pe = b->pe;
+    const char *name;
+    size_t len;
+    PeImportDll *dll;
+
+    if (pe->importDllCount == IMPORT_MAX_DLLS)
+        return NULL;
+
+    if (pe->importDllCount == b->dllCap)
+    {
+        uint32_t cap = b->dllCap ? b->dllCap * 2 : 16;
+        PeImportDll *dlls = realloc(pe->importDlls, cap * sizeof(PeImportDll));
+
+        if (dlls == NULL)
+            return NULL;
+        pe->importDlls = dlls;
+        b->dllCap = cap;
+    }
+
+    // DLLs whose name can't be read are still listed, with an empty name
+    name = PeFileRvaString(pe, nameRva, IMPORT_MAX_NAME, &len);
+    if (name == NULL)
+    {
+        name = "";
+        len = 0;
+        PeSetError(&pe->importsError, PeFileRvaView(pe, nameRva, 1) ? PE_ERROR_TRUNCATED : PE_ERROR_UNMAPPED);
+    }
+
+    name = StrIntern(name, len);
+    if (name == NULL)
+        return NULL;
+
+    dll = &pe->importDlls[pe->importDllCount++];
+    dll->name = name;
+    dll->timeDateStamp = timeDateStamp;
+    dll->delayLoad = delayLoad;
+    dll->first = pe->importFuncCount;
+    dll->count = 0;
+    return dll;
+}
+
+// Appends a function to the given DLL entry, which must be the last one, returning 1 if there's no room for it
+static int AddImportFunc(ImportBuilder *b, PeImportDll *dll, const char *name, uint16_t ordinal, uint32_t iatRva)
+{
+    PeFile *pe = b->pe;
+    PeImportFunc *func;
+
+    if (pe->importFuncCount == IMPORT_MAX_FUNCS)
+        return 1;
+
+    if (pe->importFuncCount == b->funcCap)
+    {
+        uint32_t cap = b->funcCap ? b->funcCap * 2 : 256;
+        PeImportFunc *funcs = realloc(pe->importFuncs, cap * sizeof(PeImportFunc));
+
+        if (funcs == NULL)
+            return 1;
+        pe->importFuncs = funcs;
+        b->funcCap = cap;
+    }
+
+    func = &pe->importFuncs[pe->importFuncCount++];
+    func->name = name;
+    func->ordinal = ordinal;
+    func->iatRva = iatRva;
+    dll->count++;
+    return 0;
+}
+
+/* Walks the lookup table of thunks that starts at the given RVA, adding a function to the DLL for each thunk
+ * Each thunk is 4 bytes wide in PE32 images and 8 bytes wide in PE32+ images, and the table ends with a zero thunk
+ * The top bit of a thunk is set if the function is imported by ordinal, otherwise the low 31 bits are the RVA
+ * of a Hint/Name Table entry, which holds a 2-byte hint followed by the NUL-terminated name of the function
+ */
+static void WalkThunks(ImportBuilder *b, PeImportDll *dll, uint32_t lookupRva, uint32_t iatRva)
+{
+    PeFile *pe = b->pe;
+    int wide = pe->opt.Magic == PE32PLUS_MAGIC;
+    uint32_t width = wide ? 8 : 4, i;
+    PeCursor thunks;
+
+    // The whole table is viewed at once, as it can't cross the end of the section that holds its start
+    if (PeCursorAtRva(&thunks, pe, lookupRva, UINT32_MAX) == PE_ERROR_UNMAPPED)
+    {
+        PeSetError(&pe->importsError, PE_ERROR_UNMAPPED);
+        return;
+    }
+
+    for (i = 0; ; i++)
+    {
+        uint64_t value = CursorAddr(&thunks, wide);
+        uint32_t low;
+        int byOrdinal;
+
+        if (thunks.error != PE_ERROR_NONE)
+        {
+            PeSetError(&pe->importsError, thunks.error);
+            return;
+        }
+        if (value == 0)
+            return;
+
+        low = (uint32_t)value;
+        byOrdinal = (value >> (width * 8 - 1)) != 0;
+
+        if (byOrdinal)
+        {
+            if (AddImportFunc(b, dll, NULL, (uint16_t)low, iatRva + i * width))
+                break;
+        }
+        else
+        {
+            const unsigned char *hint = PeFileRvaView(pe, low & 0x7FFFFFFF, 2);
+            const char *name;
+            size_t len;
+
+            name = hint ? PeFileRvaString(pe, (low & 0x7FFFFFFF) + 2, IMPORT_MAX_NAME, &len) : NULL;
+            if (name == NULL)
+            {
+                PeSetError(&pe->importsError, hint ? PE_ERROR_TRUNCATED : PE_ERROR_UNMAPPED);
+                return;
+            }
+
+            name = StrIntern(name, len);
+            if (name == NULL || AddImportFunc(b, dll, name, ReadLe16(hint), iatRva + i * width))
+                break;
+        }
+    }
+
+    // The limits of the decoder were reached, or there was no memory for the function
+    PeSetError(&pe->importsError, pe->importFuncCount == IMPORT_MAX_FUNCS ? PE_ERROR_LIMIT : PE_ERROR_NO_MEMORY);
+}
+
+/* Walks the Import Directory Table, which is an array of 20-byte descriptors ending with a zero descriptor:
+ * Import Lookup Table RVA, time/date stamp, forwarder chain, name RVA and Import Address Table RVA
+ */
+static void WalkImportTable(ImportBuilder *b)
+{
+    PeFile *pe = b->pe;
+    uint32_t rva = pe->dir[PE_DIR_IMPORT].VirtualAddress;
+    PeCursor table;
+
+    // The descriptors are viewed at once, as they can't cross the end of the section that holds the first one
+    if (PeCursorAtRva(&table, pe, rva, UINT32_MAX) == PE_ERROR_UNMAPPED)
+    {
+        PeSetError(&pe->importsError, PE_ERROR_UNMAPPED);
+        return;
+    }
+
+    for (;;)
+    {
+        const unsigned char *desc = CursorBytes(&table, IMPORT_DESCRIPTOR_SIZE);
+        uint32_t lookup, nameRva, iat;
+        PeImportDll *dll;
+
+        if (desc == NULL)
+        {
+            PeSetError(&pe->importsError, PE_ERROR_TRUNCATED);
+            return;
+        }
+
+        lookup = ReadLe32(desc);
+        nameRva = ReadLe32(desc + 12);
+        iat = ReadLe32(desc + 16);
+        if (lookup == 0 && nameRva == 0 && iat == 0)
+            return;
+
+        dll = AddImportDll(b, nameRva, ReadLe32(desc + 4), 0);
+        if (dll == NULL)
+        {
+            PeSetError(&pe->importsError, pe->importDllCount == IMPORT_MAX_DLLS ? PE_ERROR_LIMIT : PE_ERROR_NO_MEMORY);
+            return;
+        }
+
+        // Some linkers leave out the Import Lookup Table, in which case the unbound IAT holds the same thunks
+        WalkThunks(b, dll, lookup ? lookup : iat, iat);
+    }
+}
+
+/* Walks the Delay-load Directory Table, which is an array of 32-byte descriptors ending with a zero descriptor:
+ * attributes, name RVA, module handle RVA, Delay Import Address Table RVA, Delay Import Name Table RVA,
+ * bound and unload table RVAs, and time/date stamp
+ * Images built by old linkers have the attributes set to 0, and hold virtual addresses instead of RVAs
+ */
+static void WalkDelayImportTable(ImportBuilder *b)
+{
+    PeFile *pe = b->pe;
+    uint32_t rva = pe->dir[PE_DIR_DELAY_IMPORT].VirtualAddress;
+    PeCursor table;
+
+    // The descriptors are viewed at once, as they can't cross the end of the section that holds the first one
+    if (PeCursorAtRva(&table, pe, rva, UINT32_MAX) == PE_ERROR_UNMAPPED)
+    {
+        PeSetError(&pe->importsError, PE_ERROR_UNMAPPED);
+        return;
+    }
+
+    for (;;)
+    {
+        const unsigned char *desc = CursorBytes(&table, DELAY_DESCRIPTOR_SIZE);
+        uint32_t bias, nameRva, iat, names;
+        PeImportDll *dll;
+
+        if (desc == NULL)
+        {
+            PeSetError(&pe->importsError, PE_ERROR_TRUNCATED);
+            return;
+        }
+
+        nameRva = ReadLe32(desc + 4);
+        iat = ReadLe32(desc + 12);
+        names = ReadLe32(desc + 16);
+        if (nameRva == 0)
+            return;
+
+        bias = (ReadLe32(desc) & 1) ? 0 : (uint32_t)pe->opt.ImageBase;
+        dll = AddImportDll(b, nameRva - bias, ReadLe32(desc + 28), 1);
+        if (dll == NULL)
+        {
+            PeSetError(&pe->importsError, pe->importDllCount == IMPORT_MAX_DLLS ? PE_ERROR_LIMIT : PE_ERROR_NO_MEMORY);
+            return;
+        }
+
+        WalkThunks(b, dll, names - bias, iat - bias);
+    }
+}
+
+/* This function decodes the Import Table and the Delay-load Import Table of the image file into the model
+ * Directories that are cut off are decoded up to the point where they're cut off,
+ * and the importsError field of the model is set
+ * It returns 0 on success, or 1 if the headers of the file couldn't be decoded
+ */
+int PeFileImports(PeFile *pe)
+{
+    ImportBuilder b = {pe, 0, 0};
+
+    if (!PE_HEADERS_VALID(pe))
+        return 1;
+    if (pe->parsed & PE_PARSED_IMPORTS)
+        return 0;
+
+    if (pe->dir[PE_DIR_IMPORT].VirtualAddress)
+        WalkImportTable(&b);
+    if (pe->dir[PE_DIR_DELAY_IMPORT].VirtualAddress)
+        WalkDelayImportTable(&b);
+
+    pe->parsed |= PE_PARSED_IMPORTS;
+    return 0;
+}
+
+/* The following function is used to show the DLLs and functions imported by the image file
+ * It takes the parsed model of the executable, on which PeFileImports() has been run, as a pointer argument
+ * It returns nothing and simply appends strings to the given output buffer
+ */
+void ExecutableImports(OutBuf *out, const PeFile *exes)
+{
+    uint32_t i, j;
+
+    if (!PE_HEADERS_VALID(exes))
+    {
+        OutPrintf (out, "\nThe given executable doesn't have complete PE File Header information.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "\nImport Table: --\n\n");
+    OutPrintf (out, "Number of DLLs: %u\n", exes->importDllCount);
+    OutPrintf (out, "Number of Functions: %u\n", exes->importFuncCount);
+    if (exes->importsError)
+        OutPrintf (out, "Warning: the import tables are %s, only the imports before the problem are shown\n", PeErrorText(exes->importsError));
+
+    for (i = 0; i < exes->importDllCount; i++)
+    {
+        const PeImportDll *dll = &exes->importDlls[i];
+
+        OutPrintf (out, "\n%s (%u functions%s%s)\n", dll->name, dll->count,
+                   dll->delayLoad ? ", delay-load" : "", dll->timeDateStamp && !dll->delayLoad ? ", bound" : "");
+
+        // Functions imported by name are shown with their hint, which is the likely index into the export name table of the DLL
+        for (j = dll->first; j < dll->first + dll->count; j++)
+        {
+            const PeImportFunc *func = &exes->importFuncs[j];
+
+            if (func->name != NULL)
+                OutPrintf (out, "    0x%08X  Hint %-5u  %s\n", func->iatRva, func->ordinal, func->name);
+            else
+                OutPrintf (out, "    0x%08X  Ordinal %u\n", func->iatRva, func->ordinal);
+        }
+    }
+
+    OutPrintf (out, "\n");
+}
@@ -0,0 +1,198 @@
+/* C-program file that contains the
+   code for the function to decode and show
+   the Load Configuration Structure of the image file, based on the Microsoft Documentation
+
+   This functionality of rpe64 follows the Load Configuration Table of the data directories, and decodes
+   the IMAGE_LOAD_CONFIG_DIRECTORY structure through the field descriptor table PeLoadConfigLayout (see PeFields.c),
+   for both PE32 and PE32+ images. The structure has grown with each version of Windows, and its Size field
+   says which version it is, so only the fields within that size are decoded and shown.
+
+   The fields tell which exploit mitigations the image was built with: the /GS security cookie,
+   SafeSEH, Control Flow Guard and its extensions (XFG, EH continuation for CET), and the hybrid CHPE metadata,
+   which are summarized so that the mitigations of many files can be audited from the records.
+ */
+
+/* Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#the-load-configuration-structure-image-only
+   https://docs.microsoft.com/en-us/windows/win32/secbp/control-flow-guard
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "rpe64Header.h"
+
+#define MACHINE_I386 0x14C                  // IMAGE_FILE_MACHINE_I386, the only machine type that SafeSEH applies to
+#define DLL_NO_SEH 0x0400                   // IMAGE_DLLCHARACTERISTICS_NO_SEH
+#define DLL_GUARD_CF 0x4000                 // IMAGE_DLLCHARACTERISTICS_GUARD_CF
+
+// Mitigations found by LoadConfigMitigations(), one bit each
+#define LC_MITIGATION_GS 0x01               // The /GS stack cookie is used
+#define LC_MITIGATION_SAFESEH 0x02          // x86 image with a table of the valid exception handlers
+#define LC_MITIGATION_CFG 0x04              // Control Flow Guard, instrumented and enabled in the DLL Characteristics
+#define LC_MITIGATION_XFG 0x08              // eXtended Flow Guard
+#define LC_MITIGATION_EHCONT 0x10           // Table of valid exception continuations, for CET shadow stacks
+#define LC_MITIGATION_CHPE 0x20             // Hybrid ARM64 metadata (CHPE or ARM64EC)
+
+// Short names of the mitigations, in bit order, as used by the structured output formats
+const char *const LoadConfigMitigationNames[PE_MITIGATION_COUNT] = {
+    "gs", "safeseh", "cfg", "xfg", "eh_continuation", "chpe"
+};
+
+// Descriptions of the mitigations, in bit order, for the text output
+static const char *const LoadConfigMitigationText[PE_MITIGATION_COUNT] = {
+    "/GS Security Cookie", "SafeSEH", "Control Flow Guard (CFG)", "eXtended Flow Guard (XFG)",
+    "EH Continuation Metadata (CET)", "Hybrid ARM64 (CHPE) Metadata"
+};
+
+/* This function decodes the Load Configuration Structure into the model, up to the smaller of its Size field
+ * and the size of the latest known version of the structure; the fields beyond it are left as 0
+ * If the structure is cut off, the fields before the cut are decoded and the loadConfigError field of the model is set
+ * It returns 0 on success, or 1 if the headers of the file couldn't be decoded
+ */
+int PeFileLoadConfig(PeFile *pe)
+{
+    uint32_t rva = pe->dir[PE_DIR_LOAD_CONFIG].VirtualAddress, size;
+    int layout = pe->opt.Magic == PE32PLUS_MAGIC ? PE_LAYOUT_PE32PLUS : PE_LAYOUT_PE32;
+    uint32_t latest = layout == PE_LAYOUT_PE32PLUS ? PE_LOAD_CONFIG_SIZE64 : PE_LOAD_CONFIG_SIZE32;
+    unsigned char raw[PE_LOAD_CONFIG_SIZE64];
+    PeCursor lc;
+
+    if (!PE_HEADERS_VALID(pe))
+        return 1;
+    if (pe->parsed & PE_PARSED_LOAD_CONFIG)
+        return 0;
+    pe->parsed |= PE_PARSED_LOAD_CONFIG;
+
+    if (rva == 0)
+        return 0;
+    if (PeCursorAtRva(&lc, pe, rva, latest) == PE_ERROR_UNMAPPED)
+    {
+        pe->loadConfigError = PE_ERROR_UNMAPPED;
+        return 0;
+    }
+
+    // Old linkers left the Size field as 0, in which case the size of the data directory entry is used
+    size = CursorU32(&lc);
+    if (lc.error != PE_ERROR_NONE)
+    {
+        pe->loadConfigError = lc.error;
+        return 0;
+    }
+    if (size == 0)
+        size = pe->dir[PE_DIR_LOAD_CONFIG].Size;
+    if (size > latest)
+        size = latest;
+    if (size > lc.size)
+    {
+        size = lc.size;
+        pe->loadConfigError = PE_ERROR_TRUNCATED;
+    }
+
+    memset(raw, 0, sizeof(raw));
+    CursorSeek(&lc, 0);
+    memcpy(raw, CursorBytes(&lc, size), size);
+    PeDecodeFields(&pe->loadConfig, raw, &PeLoadConfigLayout, layout);
+    pe->loadConfigSize = size;
+    pe->hasLoadConfig = 1;
+    return 0;
+}
+
+/* Returns the fields of PeLoadConfigLayout that lie within the decoded part of the Load Configuration Structure of the given file,
+ * i.e. the fields of its version of the structure, as a table for ShowFields()
+ */
+PeFieldTable PeLoadConfigFields(const PeFile *pe)
+{
+    int layout = pe->opt.Magic == PE32PLUS_MAGIC ? PE_LAYOUT_PE32PLUS : PE_LAYOUT_PE32;
+    PeFieldTable table = {PeLoadConfigLayout.fields, 0};
+
+    while (table.count < PeLoadConfigLayout.count &&
+           (uint32_t)table.fields[table.count].offset[layout] + table.fields[table.count].width[layout] <= pe->loadConfigSize)
+        table.count++;
+    return table;
+}
+
+/* The following function finds the exploit mitigations that the Load Configuration Structure of the given file enables
+ * It returns a combination of the LC_MITIGATION_ bits, which is 0 if the file has no Load Configuration Structure
+ */
+unsigned LoadConfigMitigations(const PeFile *pe)
+{
+    const PeLoadConfig *lc = &pe->loadConfig;
+    unsigned mitigations = 0;
+
+    if (!pe->hasLoadConfig)
+        return 0;
+
+    if (lc->SecurityCookie && !(lc->GuardFlags & IMAGE_GUARD_SECURITY_COOKIE_UNUSED))
+        mitigations |= LC_MITIGATION_GS;
+    if (pe->coff.Machine == MACHINE_I386 && lc->SEHandlerTable)
+        mitigations |= LC_MITIGATION_SAFESEH;
+    if ((lc->GuardFlags & IMAGE_GUARD_CF_INSTRUMENTED) && (pe->opt.DllCharacteristics & DLL_GUARD_CF))
+        mitigations |= LC_MITIGATION_CFG;
+    if (lc->GuardFlags & IMAGE_GUARD_XFG_ENABLED)
+        mitigations |= LC_MITIGATION_XFG;
+    if (lc->GuardFlags & IMAGE_GUARD_EH_CONTINUATION_TABLE_PRESENT)
+        mitigations |= LC_MITIGATION_EHCONT;
+    if (lc->CHPEMetadataPointer)
+        mitigations |= LC_MITIGATION_CHPE;
+
+    return mitigations;
+}
+
+/* The following function is used to show the fields of the Load Configuration Structure that its version has,
+ * followed by the size of the CFG function table and the mitigations that the structure enables
+ * It takes the parsed model of the executable, on which PeFileLoadConfig() has been run, as a pointer argument
+ * It returns nothing and simply appends strings to the given output buffer
+ */
+void ExecutableLoadConfig(OutBuf *out, const PeFile *exes)
+{
+    const PeLoadConfig *lc = &exes->loadConfig;
+    int layout = exes->opt.Magic == PE32PLUS_MAGIC ? PE_LAYOUT_PE32PLUS : PE_LAYOUT_PE32;
+    PeFieldTable fields;
+    unsigned mitigations;
+    int m;
+
+    if (!PE_HEADERS_VALID(exes))
+    {
+        OutPrintf (out, "\nThe given executable doesn't have complete PE File Header information.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "\nLoad Configuration Structure: --\n\n");
+    if (!exes->hasLoadConfig)
+    {
+        OutPrintf (out, exes->loadConfigError == PE_ERROR_UNMAPPED ? "The Load Configuration Structure doesn't point into the file.\n\n"
+                        : exes->loadConfigError ? "The Load Configuration Structure is cut off by the end of its section or of the file.\n\n"
+                        : "The given executable doesn't have a Load Configuration Structure.\n\n");
+        return;
+    }
+
+    fields = PeLoadConfigFields(exes);
+    ShowFields(out, lc, &fields, layout);
+    if (exes->loadConfigError)
+        OutPrintf (out, "Warning: the Load Configuration Structure is cut off, only the fields before the cut are shown\n");
+
+    // Each entry of the CFG function table is a 4-byte RVA, followed by the number of extra bytes given by the high bits of GuardFlags
+    if (lc->GuardCFFunctionTable)
+        OutPrintf (out, "CFG Function Table Size: %llu bytes\n",
+                   (unsigned long long)lc->GuardCFFunctionCount * (4 + (lc->GuardFlags >> IMAGE_GUARD_CF_FUNCTION_TABLE_SIZE_SHIFT)));
+
+    mitigations = LoadConfigMitigations(exes);
+    OutPrintf (out, "\nMitigations:\n");
+    for (m = 0; m < PE_MITIGATION_COUNT; m++)
+    {
+        OutPrintf (out, "  %s: %s", LoadConfigMitigationText[m], mitigations & (1u << m) ? "yes" : "no");
+        if ((1u << m) == LC_MITIGATION_SAFESEH)
+        {
+            if (exes->coff.Machine != MACHINE_I386)
+                OutPrintf (out, " (only applies to x86 images)");
+            else if (mitigations & LC_MITIGATION_SAFESEH)
+                OutPrintf (out, " (%llu handlers)", (unsigned long long)lc->SEHandlerCount);
+            else if (exes->opt.DllCharacteristics & DLL_NO_SEH)
+                OutPrintf (out, " (the image has no exception handlers, IMAGE_DLLCHARACTERISTICS_NO_SEH)");
+        }
+        if ((1u << m) == LC_MITIGATION_CFG && !(mitigations & LC_MITIGATION_CFG) && (lc->GuardFlags & IMAGE_GUARD_CF_INSTRUMENTED))
+            OutPrintf (out, " (instrumented, but IMAGE_DLLCHARACTERISTICS_GUARD_CF isn't set)");
+        OutChar(out, '\n');
+    }
+
+    OutPrintf (out, "\n");
+}
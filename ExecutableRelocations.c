@@ -0,0 +1,292 @@
+/* C-program file that contains the
+   code for the function to decode and show
+   the base relocations of the image file, based on the Microsoft Documentation
+
+   This functionality of rpe64 follows the Base Relocation Table of the data directories, and walks
+   its blocks, each of which holds the relocations of one 4 KB page as 16-bit entries whose high 4 bits
+   are the type of the relocation and whose low 12 bits are its offset within the page.
+   The number of relocations of each type and of each page is counted, which gives the relocation density
+   of the image, e.g. for auditing ASLR across many files.
+
+   Large images have hundreds of thousands of relocations, so the entries aren't expanded into one structure each:
+   only a small record per block is kept, and the entries themselves, if asked for, are kept packed
+   as in the file, 2 bytes each, with the RVA of each entry given by the block that holds it.
+ */
+
+/* Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#the-reloc-section-image-only
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "rpe64Header.h"
+
+#define RELOC_BLOCK_HEADER_SIZE 8       // Size of the PageRVA and SizeOfBlock fields
+#define RELOC_ABSOLUTE 0                // Padding entry that's skipped by the loader
+#define RELOC_HIGHADJ 4                 // Entry that's followed by a second entry holding the low 16 bits of its adjustment
+
+// Names of the relocation types, for the types whose meaning doesn't depend on the machine type
+static const char *const RelocTypes[PE_RELOC_TYPES] = {
+    "ABSOLUTE", "HIGH", "LOW", "HIGHLOW", "HIGHADJ", NULL, "RESERVED", NULL,
+    NULL, NULL, "DIR64", NULL, NULL, NULL, NULL, NULL
+};
+
+// Returns the name of the given relocation type, some of which depend on the machine type of the image
+const char* PeRelocTypeName(const PeFile *pe, unsigned type)
+{
+    switch (pe->coff.Machine)
+    {
+        case 0x166:             // IMAGE_FILE_MACHINE_R4000
+        case 0x169:             // IMAGE_FILE_MACHINE_WCEMIPSV2
+        case 0x266:             // IMAGE_FILE_MACHINE_MIPS16
+        case 0x366:             // IMAGE_FILE_MACHINE_MIPSFPU
+        case 0x466:             // IMAGE_FILE_MACHINE_MIPSFPU16
+            if (type == 5)
+                return "MIPS_JMPADDR";
+            if (type == 9)
+                return "MIPS_JMPADDR16";
+            break;
+        case 0x1C0:             // IMAGE_FILE_MACHINE_ARM
+        case 0x1C2:             // IMAGE_FILE_MACHINE_THUMB
+        case 0x1C4:             // IMAGE_FILE_MACHINE_ARMNT
+            if (type == 5)
+                return "ARM_MOV32";
+            if (type == 7)
+                return "THUMB_MOV32";
+            break;
+        case 0x5032:            // IMAGE_FILE_MACHINE_RISCV32
+        case 0x5064:            // IMAGE_FILE_MACHINE_RISCV64
+        case 0x5128:            // IMAGE_FILE_MACHINE_RISCV128
+            if (type == 5)
+                return "RISCV_HIGH20";
+            if (type == 7)
+                return "RISCV_LOW12I";
+            if (type == 8)
+                return "RISCV_LOW12S";
+            break;
+        case 0x6232:            // IMAGE_FILE_MACHINE_LOONGARCH32
+        case 0x6264:            // IMAGE_FILE_MACHINE_LOONGARCH64
+            if (type == 8)
+                return "LOONGARCH_MARK_LA";
+            break;
+    }
+
+    return type < PE_RELOC_TYPES && RelocTypes[type] != NULL ? RelocTypes[type] : "UNKNOWN";
+}
+
+/* Walks the blocks of the Base Relocation Table into the model, and copies their entries into the packed
+ * array of the model if it's been allocated, which has room for every entry of the table
+ * It returns 1 if there's no memory for the blocks, otherwise it returns 0
+ */
+static int WalkRelocations(PeFile *pe, PeCursor *table)
+{
+    uint32_t capacity = 0, j;
+
+    while (CursorLeft(table) >= RELOC_BLOCK_HEADER_SIZE)
+    {
+        uint32_t pageRva = CursorU32(table);
+        uint32_t blockSize = CursorU32(table);
+        const unsigned char *entry;
+        PeRelocPage *page;
+
+        // Some linkers pad the table with an empty block, which ends it
+        if (blockSize == 0 && pageRva == 0)
+            break;
+        if (blockSize < RELOC_BLOCK_HEADER_SIZE)
+        {
+            PeSetError(&pe->relocsError, PE_ERROR_MALFORMED);
+            break;
+        }
+        entry = CursorBytes(table, blockSize - RELOC_BLOCK_HEADER_SIZE);
+        if (entry == NULL)
+        {
+            PeSetError(&pe->relocsError, PE_ERROR_TRUNCATED);
+            break;
+        }
+
+        if (pe->relocPageCount == capacity)
+        {
+            uint32_t count = capacity ? capacity * 2 : 64;
+            PeRelocPage *grown = realloc(pe->relocPages, count * sizeof(PeRelocPage));
+
+            if (grown == NULL)
+            {
+                PeSetError(&pe->relocsError, PE_ERROR_NO_MEMORY);
+                return 1;
+            }
+            pe->relocPages = grown;
+            capacity = count;
+        }
+
+        page = &pe->relocPages[pe->relocPageCount++];
+        page->rva = pageRva;
+        page->count = 0;
+        page->first = pe->relocEntryCount;
+        page->entries = (blockSize - RELOC_BLOCK_HEADER_SIZE) / 2;
+
+        for (j = 0; j < page->entries; j++)
+        {
+            unsigned type = entry[2 * j + 1] >> 4;
+
+            pe->relocTypes[type]++;
+            if (type != RELOC_ABSOLUTE)
+                page->count++;
+            if (type == RELOC_HIGHADJ)
+                j++;
+        }
+        // A HIGHADJ entry at the end of the block is missing the entry that holds its parameter
+        if (j > page->entries)
+            PeSetError(&pe->relocsError, PE_ERROR_MALFORMED);
+        pe->relocCount += page->count;
+
+        if (pe->relocEntries != NULL)
+        {
+            for (j = 0; j < page->entries; j++)
+                pe->relocEntries[pe->relocEntryCount + j] = ReadLe16(entry + 2 * j);
+            pe->relocEntryCount += page->entries;
+        }
+    }
+
+    return 0;
+}
+
+/* Points the given cursor at the Base Relocation Table, cut at the end of its section or of the file
+ * It returns 1 if the image has no relocations or they can't be found within the file
+ */
+static int RelocationTable(PeFile *pe, PeCursor *table)
+{
+    uint32_t rva = pe->dir[PE_DIR_BASERELOC].VirtualAddress;
+    uint32_t size = pe->dir[PE_DIR_BASERELOC].Size;
+
+    if (rva == 0 || size == 0)
+        return 1;
+    PeSetError(&pe->relocsError, PeCursorAtRva(table, pe, rva, size));
+    return table->size == 0;
+}
+
+/* This function decodes the blocks of the Base Relocation Table into the model, counting the relocations
+ * of each type and of each page, without keeping the entries themselves
+ * Blocks that are cut off or malformed end the table, and the relocsError field of the model is set
+ * It returns 0 on success, or 1 if the headers of the file couldn't be decoded
+ */
+int PeFileRelocations(PeFile *pe)
+{
+    PeCursor table;
+
+    if (!PE_HEADERS_VALID(pe))
+        return 1;
+    if (pe->parsed & PE_PARSED_RELOCATIONS)
+        return 0;
+    pe->parsed |= PE_PARSED_RELOCATIONS;
+
+    if (RelocationTable(pe, &table) == 0)
+        WalkRelocations(pe, &table);
+    return 0;
+}
+
+/* This function decodes the Base Relocation Table like PeFileRelocations(), and also keeps every entry,
+ * packed into the relocEntries array of the model
+ * It returns 0 on success, or 1 if the headers of the file couldn't be decoded
+ */
+int PeFileRelocationEntries(PeFile *pe)
+{
+    PeCursor table;
+
+    if (!PE_HEADERS_VALID(pe))
+        return 1;
+    if (pe->parsed & PE_PARSED_RELOC_ENTRIES)
+        return 0;
+
+    // The blocks are walked again if only the summary was decoded before
+    free(pe->relocPages);
+    pe->relocPages = NULL;
+    pe->relocPageCount = pe->relocEntryCount = pe->relocCount = 0;
+    memset(pe->relocTypes, 0, sizeof(pe->relocTypes));
+    pe->relocsError = PE_ERROR_NONE;
+    pe->parsed |= PE_PARSED_RELOCATIONS | PE_PARSED_RELOC_ENTRIES;
+
+    if (RelocationTable(pe, &table))
+        return 0;
+
+    pe->relocEntries = malloc((table.size / 2 ? table.size / 2 : 1) * sizeof(uint16_t));
+    if (pe->relocEntries == NULL)
+        PeSetError(&pe->relocsError, PE_ERROR_NO_MEMORY);
+    else
+        WalkRelocations(pe, &table);
+    return 0;
+}
+
+/* The following function is used to show the base relocations of the image file: the number of relocations of each type,
+ * the relocation density, and the number of relocations of each page, followed by every relocation if they were kept
+ * It takes the parsed model of the executable, on which PeFileRelocations() has been run, as a pointer argument
+ * It returns nothing and simply appends strings to the given output buffer
+ */
+void ExecutableRelocations(OutBuf *out, const PeFile *exes)
+{
+    uint32_t i, j, pages = 0, maxCount = 0, maxRva = 0;
+    unsigned type;
+
+    if (!PE_HEADERS_VALID(exes))
+    {
+        OutPrintf (out, "\nThe given executable doesn't have complete PE File Header information.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "\nBase Relocation Table: --\n\n");
+    if (exes->dir[PE_DIR_BASERELOC].VirtualAddress == 0 || exes->dir[PE_DIR_BASERELOC].Size == 0)
+    {
+        OutPrintf (out, "The given executable doesn't have any base relocations%s.\n\n",
+                   exes->coff.Characteristics & 0x0001 ? ", and they've been stripped (IMAGE_FILE_RELOCS_STRIPPED)" : "");
+        return;
+    }
+
+    for (i = 0; i < exes->relocPageCount; i++)
+    {
+        if (exes->relocPages[i].count)
+            pages++;
+        if (exes->relocPages[i].count > maxCount)
+        {
+            maxCount = exes->relocPages[i].count;
+            maxRva = exes->relocPages[i].rva;
+        }
+    }
+
+    OutPrintf (out, "Number of Blocks: %u\n", exes->relocPageCount);
+    OutPrintf (out, "Number of Relocations: %u\n", exes->relocCount);
+    if (exes->relocsError == PE_ERROR_UNMAPPED)
+        OutPrintf (out, "Warning: the Base Relocation Table doesn't point into the file\n");
+    else if (exes->relocsError == PE_ERROR_NO_MEMORY)
+        OutPrintf (out, "Warning: there was no memory for the relocation blocks, only the blocks before them are shown\n");
+    else if (exes->relocsError)
+        OutPrintf (out, "Warning: the relocation blocks are cut off or malformed, only the blocks before them are shown\n");
+    for (type = 0; type < PE_RELOC_TYPES; type++)
+        if (exes->relocTypes[type])
+            OutPrintf (out, "  %s: %u\n", PeRelocTypeName(exes, type), exes->relocTypes[type]);
+
+    if (pages)
+        OutPrintf (out, "Pages with Relocations: %u, %.1f relocations per page on average, at most %u (page 0x%08X)\n",
+                   pages, (double)exes->relocCount / pages, maxCount, maxRva);
+
+    OutPrintf (out, "\nPage RVA    Relocations\n");
+    for (i = 0; i < exes->relocPageCount; i++)
+    {
+        const PeRelocPage *page = &exes->relocPages[i];
+
+        OutPrintf (out, "0x%08X  %u\n", page->rva, page->count);
+        if (exes->relocEntries == NULL)
+            continue;
+
+        for (j = 0; j < page->entries; j++)
+        {
+            uint16_t entry = exes->relocEntries[page->first + j];
+
+            type = entry >> 12;
+            if (type == RELOC_ABSOLUTE)
+                continue;
+            OutPrintf (out, "    0x%08X  %s\n", page->rva + (entry & 0xFFF), PeRelocTypeName(exes, type));
+            if (type == RELOC_HIGHADJ)
+                j++;
+        }
+    }
+
+    OutPrintf (out, "\n");
+}
@@ -0,0 +1,613 @@
+/* C-program file that contains the
+   code for the function to decode and show
+   the resources of the image file, based on the Microsoft Documentation
+
+   This functionality of rpe64 follows the Resource Table of the data directories, and walks
+   the resource directory tree, whose three levels are the type, the name and the language of
+   each resource. The tree is walked iteratively, level by level, with a cap on its depth and on
+   the number of entries visited, so that a malformed or looping tree can't exhaust the stack or run forever.
+
+   The version information (the VS_VERSIONINFO structure of the RT_VERSION resource) is decoded into
+   the file and product versions and the strings of its StringFileInfo, like CompanyName and ProductName,
+   and the embedded manifest (the RT_MANIFEST resource) is copied out, for software inventory.
+ */
+
+/* Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#the-rsrc-section
+   https://docs.microsoft.com/en-us/windows/win32/menurc/vs-versioninfo
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "rpe64Header.h"
+
+#define RESOURCE_DIRECTORY_SIZE 16      // Size of a Resource Directory Table, which is followed by its entries
+#define RESOURCE_ENTRY_SIZE 8           // Size of a Resource Directory Entry
+#define RESOURCE_DATA_ENTRY_SIZE 16     // Size of a Resource Data Entry
+#define RESOURCE_MAX_DEPTH 3            // Levels of the tree: type, name and language
+#define RESOURCE_MAX_NODES 65536        // Maximum number of directory entries visited per file
+#define RESOURCE_MAX_NAME 256           // Maximum length of a resource name, in UTF-16 code units
+
+#define VERSION_MAX_BLOCKS 1024         // Maximum number of blocks of the version information visited
+#define VERSION_MAX_STRINGS 64          // Maximum number of version strings kept per file
+#define VERSION_MAX_VALUE 1024          // Maximum length of a version string, in UTF-16 code units
+#define VERSION_FIXED_SIZE 52           // Size of the VS_FIXEDFILEINFO structure
+#define VERSION_FIXED_SIGNATURE 0xFEEF04BD
+#define MANIFEST_MAX_SIZE (64 * 1024)   // Maximum number of bytes of the manifest kept per file
+
+#define RT_VERSION 16
+#define RT_MANIFEST 24
+
+// Names of the predefined resource types, indexed by type ID
+static const char *const ResourceTypes[] = {
+    NULL, "RT_CURSOR", "RT_BITMAP", "RT_ICON", "RT_MENU", "RT_DIALOG", "RT_STRING", "RT_FONTDIR", "RT_FONT",
+    "RT_ACCELERATOR", "RT_RCDATA", "RT_MESSAGETABLE", "RT_GROUP_CURSOR", NULL, "RT_GROUP_ICON", NULL,
+    "RT_VERSION", "RT_DLGINCLUDE", NULL, "RT_PLUGPLAY", "RT_VXD", "RT_ANICURSOR", "RT_ANIICON", "RT_HTML", "RT_MANIFEST"
+};
+
+// Version strings that are written as columns of the structured output formats, as used by software inventories
+static const char *const VersionKeys[] = {
+    "CompanyName", "ProductName", "FileDescription", "FileVersion", "ProductVersion",
+    "OriginalFilename", "InternalName", "LegalCopyright"
+};
+
+// Directory of the resource tree that is waiting to be walked, with the type and name of the entries that lead to it
+typedef struct ResourceNode
+{
+    uint32_t offset;            // Offset of the Resource Directory Table from the start of the tree
+    int level;                  // 0 for the root, 1 for a type directory, 2 for a name directory
+    uint32_t id[2];             // Type ID and name ID
+    const char *name[2];        // Interned type name and resource name, NULL if they're IDs
+} ResourceNode;
+
+// Block of the version information, i.e. a VS_VERSIONINFO, StringFileInfo, StringTable or String structure
+typedef struct VersionBlock
+{
+    uint32_t end;               // Offset just past the block
+    uint16_t valueLength;       // wValueLength, in bytes for binary values and in code units for text values
+    uint16_t type;              // wType, 1 for text values and 0 for binary values
+    char key[64];               // szKey, converted to UTF-8
+    uint32_t value;             // Offset of the value
+    uint32_t children;          // Offset of the first child block
+} VersionBlock;
+
+#define ALIGN4(x) (((uint64_t)(x) + 3) & ~(uint64_t)3)
+
+// Returns the number of UTF-16 code units of the given string before its terminating NUL, or the given maximum
+static size_t Utf16Length(const unsigned char *src, size_t maxUnits)
+{
+    size_t n;
+
+    for (n = 0; n < maxUnits && (src[2 * n] | src[2 * n + 1]); n++)
+        ;
+    return n;
+}
+
+/* Converts the given number of UTF-16LE code units to a NUL-terminated UTF-8 string of at most the given size,
+ * replacing unpaired surrogates with U+FFFD
+ * It returns the number of bytes written, not counting the NUL
+ */
+static size_t Utf16ToUtf8(const unsigned char *src, size_t units, char *dst, size_t size)
+{
+    size_t i, n = 0;
+
+    for (i = 0; i < units; i++)
+    {
+        uint32_t c = ReadLe16(src + 2 * i);
+        unsigned char bytes[4];
+        size_t len;
+
+        if (c >= 0xD800 && c < 0xDC00 && i + 1 < units && ReadLe16(src + 2 * i + 2) >= 0xDC00 && ReadLe16(src + 2 * i + 2) < 0xE000)
+        {
+            c = 0x10000 + ((c - 0xD800) << 10) + (ReadLe16(src + 2 * i + 2) - 0xDC00);
+            i++;
+        }
+        else if (c >= 0xD800 && c < 0xE000)
+            c = 0xFFFD;
+
+        if (c < 0x80)
+        {
+            bytes[0] = (unsigned char)c;
+            len = 1;
+        }
+        else if (c < 0x800)
+        {
+            bytes[0] = (unsigned char)(0xC0 | c >> 6);
+            bytes[1] = (unsigned char)(0x80 | (c & 0x3F));
+            len = 2;
+        }
+        else if (c < 0x10000)
+        {
+            bytes[0] = (unsigned char)(0xE0 | c >> 12);
+            bytes[1] = (unsigned char)(0x80 | (c >> 6 & 0x3F));
+            bytes[2] = (unsigned char)(0x80 | (c & 0x3F));
+            len = 3;
+        }
+        else
+        {
+            bytes[0] = (unsigned char)(0xF0 | c >> 18);
+            bytes[1] = (unsigned char)(0x80 | (c >> 12 & 0x3F));
+            bytes[2] = (unsigned char)(0x80 | (c >> 6 & 0x3F));
+            bytes[3] = (unsigned char)(0x80 | (c & 0x3F));
+            len = 4;
+        }
+
+        if (n + len >= size)
+            break;
+        memcpy(dst + n, bytes, len);
+        n += len;
+    }
+
+    dst[n] = '\0';
+    return n;
+}
+
+/* Reads and interns the length-prefixed UTF-16 name at the given offset of the resource tree
+ * It returns NULL and sets the resourcesError field of the model if the name runs past the end of the tree
+ */
+static const char* ResourceName(PeFile *pe, const PeCursor *tree, uint32_t offset)
+{
+    char name[RESOURCE_MAX_NAME * 3 + 1];
+    PeCursor at = *tree;
+    uint32_t units;
+    size_t len;
+
+    CursorSeek(&at, offset);
+    units = CursorU16(&at);
+    if (at.error != PE_ERROR_NONE)
+    {
+        PeSetError(&pe->resourcesError, at.error);
+        return NULL;
+    }
+
+    if (units > CursorLeft(&at) / 2)
+    {
+        units = CursorLeft(&at) / 2;
+        PeSetError(&pe->resourcesError, PE_ERROR_TRUNCATED);
+    }
+    if (units > RESOURCE_MAX_NAME)
+        units = RESOURCE_MAX_NAME;
+
+    len = Utf16ToUtf8(CursorBytes(&at, 2 * units), units, name, sizeof(name));
+    return StrIntern(name, len);
+}
+
+/* Adds the resource whose Resource Data Entry is at the given offset of the tree
+ * It returns 1 if there's no memory for it, otherwise it returns 0
+ */
+static int AddResource(PeFile *pe, const ResourceNode *node, uint32_t lang, const PeCursor *tree, uint32_t *capacity)
+{
+    PeCursor at = *tree;
+    PeResource *res;
+
+    if (CursorSeek(&at, node->offset) || CursorLeft(&at) < RESOURCE_DATA_ENTRY_SIZE)
+    {
+        PeSetError(&pe->resourcesError, PE_ERROR_TRUNCATED);
+        return 0;
+    }
+
+    if (pe->resourceCount == *capacity)
+    {
+        uint32_t count = *capacity ? *capacity * 2 : 16;
+        PeResource *grown = realloc(pe->resources, count * sizeof(PeResource));
+
+        if (grown == NULL)
+        {
+            PeSetError(&pe->resourcesError, PE_ERROR_NO_MEMORY);
+            return 1;
+        }
+        pe->resources = grown;
+        *capacity = count;
+    }
+
+    res = &pe->resources[pe->resourceCount++];
+    res->typeId = node->id[0];
+    res->typeName = node->name[0];
+    res->nameId = node->id[1];
+    res->name = node->name[1];
+    res->lang = lang;
+    res->rva = CursorU32(&at);
+    res->size = CursorU32(&at);
+    res->codePage = CursorU32(&at);
+    return 0;
+}
+
+/* Walks the resource tree of the given size level by level, using a queue of the directories still to be walked
+ * instead of recursion, so every directory of one level is walked before those of the next one
+ * Subdirectories deeper than the language level, and entries beyond the first RESOURCE_MAX_NODES, are left out
+ */
+static void WalkResourceTree(PeFile *pe, const PeCursor *tree)
+{
+    ResourceNode *queue = malloc(sizeof(ResourceNode)), *grown;
+    size_t head = 0, tail = 0, capacity = 1;
+    uint32_t nodes = 0, resCapacity = 0;
+
+    if (queue == NULL)
+    {
+        PeSetError(&pe->resourcesError, PE_ERROR_NO_MEMORY);
+        return;
+    }
+    memset(&queue[tail++], 0, sizeof(ResourceNode));
+
+    while (head < tail)
+    {
+        ResourceNode node = queue[head++];
+        PeCursor dir = *tree;
+        const unsigned char *header;
+        uint32_t count, i;
+
+        CursorSeek(&dir, node.offset);
+        header = CursorBytes(&dir, RESOURCE_DIRECTORY_SIZE);
+        if (header == NULL)
+        {
+            PeSetError(&pe->resourcesError, dir.error);
+            continue;
+        }
+
+        count = (uint32_t)ReadLe16(header + 12) + ReadLe16(header + 14);
+        if (count > CursorLeft(&dir) / RESOURCE_ENTRY_SIZE)
+        {
+            count = CursorLeft(&dir) / RESOURCE_ENTRY_SIZE;
+            PeSetError(&pe->resourcesError, PE_ERROR_TRUNCATED);
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            uint32_t ident = CursorU32(&dir), target = CursorU32(&dir);
+            ResourceNode child = node;
+
+            if (++nodes > RESOURCE_MAX_NODES)
+            {
+                PeSetError(&pe->resourcesError, PE_ERROR_LIMIT);
+                goto done;
+            }
+
+            // The high bit of the first field marks a name, and the high bit of the second field a subdirectory
+            child.offset = target & 0x7FFFFFFF;
+            child.level = node.level + 1;
+            if (node.level < 2)
+            {
+                child.id[node.level] = ident & 0x80000000 ? 0 : ident;
+                child.name[node.level] = ident & 0x80000000 ? ResourceName(pe, tree, ident & 0x7FFFFFFF) : NULL;
+            }
+
+            if (!(target & 0x80000000))
+            {
+                if (AddResource(pe, &child, node.level == 2 && !(ident & 0x80000000) ? ident : 0, tree, &resCapacity))
+                    goto done;
+                continue;
+            }
+
+            if (child.level >= RESOURCE_MAX_DEPTH)
+            {
+                PeSetError(&pe->resourcesError, PE_ERROR_LIMIT);
+                continue;
+            }
+
+            if (tail == capacity)
+            {
+                grown = realloc(queue, capacity * 2 * sizeof(ResourceNode));
+                if (grown == NULL)
+                {
+                    PeSetError(&pe->resourcesError, PE_ERROR_NO_MEMORY);
+                    goto done;
+                }
+                queue = grown;
+                capacity *= 2;
+            }
+            queue[tail++] = child;
+        }
+    }
+
+done:
+    free(queue);
+}
+
+/* Returns a pointer to the data of the given resource, and stores the number of bytes of it that are within the file
+ * It returns NULL if the data doesn't start within the file
+ */
+static const unsigned char* ResourceData(PeFile *pe, const PeResource *res, uint32_t *len)
+{
+    PeCursor data;
+
+    PeSetError(&pe->resourcesError, PeCursorAtRva(&data, pe, res->rva, res->size));
+    *len = data.size;
+    return data.data;
+}
+
+/* Decodes the header of the block of the version information at the given offset, which has to end before the given limit
+ * The offsets are relative to the start of the resource data, which is 32-bit aligned, as the value and the children are
+ * It returns 0 on success, or 1 if the block doesn't fit
+ */
+static int ReadVersionBlock(const unsigned char *data, uint32_t offset, uint32_t limit, VersionBlock *b)
+{
+    uint16_t len;
+    size_t units;
+    uint64_t at;
+
+    if (offset > limit || limit - offset < 6)
+        return 1;
+    len = ReadLe16(data + offset);
+    if (len < 6)
+        return 1;
+
+    b->end = len > limit - offset ? limit : offset + len;
+    b->valueLength = ReadLe16(data + offset + 2);
+    b->type = ReadLe16(data + offset + 4);
+
+    units = Utf16Length(data + offset + 6, (b->end - offset - 6) / 2);
+    Utf16ToUtf8(data + offset + 6, units, b->key, sizeof(b->key));
+
+    at = ALIGN4(offset + 6 + 2 * (units + 1));
+    b->value = at < b->end ? (uint32_t)at : b->end;
+    at = ALIGN4((uint64_t)b->value + (b->type == 1 ? 2 * (uint64_t)b->valueLength : b->valueLength));
+    b->children = at < b->end ? (uint32_t)at : b->end;
+    return 0;
+}
+
+// Adds the key and value of the given String structure to the version strings of the model
+static void AddVersionString(PeFile *pe, const unsigned char *data, const VersionBlock *b)
+{
+    char value[VERSION_MAX_VALUE * 3 + 1];
+    size_t units = Utf16Length(data + b->value, (b->end - b->value) / 2), len;
+    PeVersionString *str;
+
+    if (pe->versionStringCount == VERSION_MAX_STRINGS)
+    {
+        PeSetError(&pe->resourcesError, PE_ERROR_LIMIT);
+        return;
+    }
+    if (pe->versionStrings == NULL)
+    {
+        pe->versionStrings = malloc(VERSION_MAX_STRINGS * sizeof(PeVersionString));
+        if (pe->versionStrings == NULL)
+        {
+            PeSetError(&pe->resourcesError, PE_ERROR_NO_MEMORY);
+            return;
+        }
+    }
+
+    if (units > VERSION_MAX_VALUE)
+        units = VERSION_MAX_VALUE;
+    len = Utf16ToUtf8(data + b->value, units, value, sizeof(value));
+
+    str = &pe->versionStrings[pe->versionStringCount];
+    str->key = StrIntern(b->key, strlen(b->key));
+    str->value = StrIntern(value, len);
+    if (str->key != NULL && str->value != NULL)
+        pe->versionStringCount++;
+}
+
+/* Decodes the VS_VERSIONINFO structure of the given data into the model
+ * Its children are walked through a queue of the blocks whose children are still to be walked:
+ * the StringFileInfo, then its StringTables, whose children are the String structures
+ */
+static void ParseVersionInfo(PeFile *pe, const unsigned char *data, uint32_t len)
+{
+    VersionBlock queue[8], block, child;
+    int levels[8], head = 0, tail = 0, visited = 0;
+    uint32_t at;
+
+    if (ReadVersionBlock(data, 0, len, &block) || strcmp(block.key, "VS_VERSION_INFO") != 0)
+        return;
+
+    if (block.valueLength >= VERSION_FIXED_SIZE && block.end - block.value >= VERSION_FIXED_SIZE &&
+        ReadLe32(data + block.value) == VERSION_FIXED_SIGNATURE)
+    {
+        const unsigned char *fixed = data + block.value;
+
+        pe->fileVersion = (uint64_t)ReadLe32(fixed + 8) << 32 | ReadLe32(fixed + 12);
+        pe->productVersion = (uint64_t)ReadLe32(fixed + 16) << 32 | ReadLe32(fixed + 20);
+        pe->hasVersion = 1;
+    }
+
+    queue[tail] = block;
+    levels[tail++] = 0;
+
+    while (head < tail)
+    {
+        int level = levels[head];
+
+        block = queue[head++];
+        for (at = block.children; ReadVersionBlock(data, at, block.end, &child) == 0; at = (uint32_t)ALIGN4(child.end))
+        {
+            if (++visited > VERSION_MAX_BLOCKS)
+            {
+                PeSetError(&pe->resourcesError, PE_ERROR_LIMIT);
+                return;
+            }
+
+            if (level == 2)
+                AddVersionString(pe, data, &child);
+            else if ((level == 1 || strcmp(child.key, "StringFileInfo") == 0) && tail < 8)
+            {
+                queue[tail] = child;
+                levels[tail++] = level + 1;
+            }
+
+            if (ALIGN4(child.end) <= at)
+                break;
+        }
+    }
+}
+
+// Copies the manifest of the given data into the model, converting it to UTF-8 if it's in UTF-16
+static void CopyManifest(PeFile *pe, const unsigned char *data, uint32_t len)
+{
+    if (len > MANIFEST_MAX_SIZE)
+        len = MANIFEST_MAX_SIZE;
+
+    if (len >= 2 && data[0] == 0xFF && data[1] == 0xFE)
+    {
+        size_t units = Utf16Length(data + 2, (len - 2) / 2);
+
+        pe->manifest = malloc(units * 3 + 1);
+        if (pe->manifest != NULL)
+            Utf16ToUtf8(data + 2, units, pe->manifest, units * 3 + 1);
+        return;
+    }
+
+    // A UTF-8 byte order mark is dropped, and the manifest ends at its first NUL, if any
+    if (len >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF)
+    {
+        data += 3;
+        len -= 3;
+    }
+    {
+        const unsigned char *nul = memchr(data, 0, len);
+
+        if (nul != NULL)
+            len = (uint32_t)(nul - data);
+    }
+
+    pe->manifest = malloc(len + 1);
+    if (pe->manifest != NULL)
+    {
+        memcpy(pe->manifest, data, len);
+        pe->manifest[len] = '\0';
+    }
+}
+
+/* This function walks the resource tree of the image file into the model, and decodes
+ * the version information and the manifest of the first RT_VERSION and RT_MANIFEST resources
+ * Parts of the tree that are cut off or beyond the limits of the decoder are left out,
+ * and the resourcesError field of the model is set
+ * It returns 0 on success, or 1 if the headers of the file couldn't be decoded
+ */
+int PeFileResources(PeFile *pe)
+{
+    uint32_t rva = pe->dir[PE_DIR_RESOURCE].VirtualAddress, i;
+    int version = 0, manifest = 0;
+    PeCursor tree;
+
+    if (!PE_HEADERS_VALID(pe))
+        return 1;
+    if (pe->parsed & PE_PARSED_RESOURCES)
+        return 0;
+    pe->parsed |= PE_PARSED_RESOURCES;
+
+    if (rva == 0)
+        return 0;
+    // The offsets within the tree are relative to its root, and the tree can't run past the end of its section
+    if (PeCursorAtRva(&tree, pe, rva, UINT32_MAX) == PE_ERROR_UNMAPPED)
+    {
+        pe->resourcesError = PE_ERROR_UNMAPPED;
+        return 0;
+    }
+    WalkResourceTree(pe, &tree);
+
+    for (i = 0; i < pe->resourceCount && !(version && manifest); i++)
+    {
+        const PeResource *res = &pe->resources[i];
+        const unsigned char *data;
+        uint32_t len;
+
+        if (res->typeName != NULL || (res->typeId != RT_VERSION && res->typeId != RT_MANIFEST))
+            continue;
+        if ((res->typeId == RT_VERSION && version) || (res->typeId == RT_MANIFEST && manifest))
+            continue;
+
+        data = ResourceData(pe, res, &len);
+        if (data == NULL)
+            continue;
+
+        if (res->typeId == RT_VERSION)
+        {
+            ParseVersionInfo(pe, data, len);
+            version = 1;
+        }
+        else
+        {
+            CopyManifest(pe, data, len);
+            manifest = 1;
+        }
+    }
+
+    return 0;
+}
+
+// Returns the value of the first version string of the given key, or NULL if the image file has none
+const char* PeVersionValue(const PeFile *pe, const char *key)
+{
+    uint32_t i;
+
+    for (i = 0; i < pe->versionStringCount; i++)
+        if (strcmp(pe->versionStrings[i].key, key) == 0)
+            return pe->versionStrings[i].value;
+    return NULL;
+}
+
+// Writes the type or name of a resource, which is either a string or an ID, into the given buffer
+static const char* ResourceLabel(char *buf, size_t size, uint32_t id, const char *name, int type)
+{
+    if (name != NULL)
+        return name;
+    if (type && id < sizeof(ResourceTypes) / sizeof(ResourceTypes[0]) && ResourceTypes[id] != NULL)
+        return ResourceTypes[id];
+    snprintf(buf, size, "#%u", id);
+    return buf;
+}
+
+/* The following function is used to show the resources of the image file, its version information and its manifest
+ * It takes the parsed model of the executable, on which PeFileResources() has been run, as a pointer argument
+ * It returns nothing and simply appends strings to the given output buffer
+ */
+void ExecutableResources(OutBuf *out, const PeFile *exes)
+{
+    char type[16], name[16];
+    uint32_t i;
+
+    if (!PE_HEADERS_VALID(exes))
+    {
+        OutPrintf (out, "\nThe given executable doesn't have complete PE File Header information.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "\nResource Table: --\n\n");
+    if (exes->dir[PE_DIR_RESOURCE].VirtualAddress == 0)
+    {
+        OutPrintf (out, "The given executable doesn't have any resources.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "Number of Resources: %u\n", exes->resourceCount);
+    if (exes->resourcesError)
+        OutPrintf (out, "Warning: the resource tree or its data are %s, only the resources before the problem are shown\n", PeErrorText(exes->resourcesError));
+
+    OutPrintf (out, "\nType              Name              Language  RVA         Size\n");
+    for (i = 0; i < exes->resourceCount; i++)
+    {
+        const PeResource *res = &exes->resources[i];
+
+        OutPrintf (out, "%-16s  %-16s  0x%04X    0x%08X  %u\n",
+                   ResourceLabel(type, sizeof(type), res->typeId, res->typeName, 1),
+                   ResourceLabel(name, sizeof(name), res->nameId, res->name, 0), res->lang, res->rva, res->size);
+    }
+
+    if (exes->hasVersion || exes->versionStringCount)
+    {
+        OutPrintf (out, "\nVersion Information --\n");
+        if (exes->hasVersion)
+        {
+            OutPrintf (out, "File Version: %u.%u.%u.%u\n", (unsigned)(exes->fileVersion >> 48), (unsigned)(exes->fileVersion >> 32 & 0xFFFF),
+                       (unsigned)(exes->fileVersion >> 16 & 0xFFFF), (unsigned)(exes->fileVersion & 0xFFFF));
+            OutPrintf (out, "Product Version: %u.%u.%u.%u\n", (unsigned)(exes->productVersion >> 48), (unsigned)(exes->productVersion >> 32 & 0xFFFF),
+                       (unsigned)(exes->productVersion >> 16 & 0xFFFF), (unsigned)(exes->productVersion & 0xFFFF));
+        }
+        for (i = 0; i < exes->versionStringCount; i++)
+            OutPrintf (out, "%s: %s\n", exes->versionStrings[i].key, exes->versionStrings[i].value);
+    }
+
+    if (exes->manifest != NULL)
+        OutPrintf (out, "\nManifest --\n%s\n", exes->manifest);
+
+    OutPrintf (out, "\n");
+}
+
+/* Returns the number of version strings that are written as columns of the structured output formats,
+ * and stores the list of their keys
+ */
+size_t PeVersionKeys(const char *const **keys)
+{
+    *keys = VersionKeys;
+    return sizeof(VersionKeys) / sizeof(VersionKeys[0]);
+}
@@ -2,18 +2,133 @@
    code for the function to check
    the contents of the various sections
    within the image file based on the Microsoft Documentation
- */  
+
+   This functionality of rpe64 goes through every entry of the Section Table,
+   and shows the name, the virtual and raw address and size, and the characteristics
+   flags of each section. It also checks that the sections are aligned and laid out
+   the way the Microsoft Documentation requires, and warns about any that aren't.
+ */
 
 /* Written by Ranit Barman as a part of the Academia Internship project under Tezpur University
 
-   Main reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#machine-types
+   Main reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#section-table-section-headers
  */
 
 #include <stdlib.h>
 #include "rpe64Header.h"
 
-// This function hasn't been developed yet, and is there as a place holder
-void ExecutableSectionInfo(const char *exes) 
+// Problems found by SectionAnomalies(), one bit each
+#define SEC_ANOMALY_VA_ALIGN 0x01           // VirtualAddress isn't a multiple of SectionAlignment
+#define SEC_ANOMALY_RAW_PTR_ALIGN 0x02      // PointerToRawData isn't a multiple of FileAlignment
+#define SEC_ANOMALY_RAW_SIZE_ALIGN 0x04     // SizeOfRawData isn't a multiple of FileAlignment
+#define SEC_ANOMALY_RAW_PAST_EOF 0x08       // The raw data runs past the end of the file
+#define SEC_ANOMALY_NOT_ADJACENT 0x10       // The section doesn't start right where the previous one ends in memory
+#define SEC_ANOMALY_PAST_IMAGE 0x20         // The section runs past SizeOfImage
+#define SEC_ANOMALY_COUNT 6
+
+// Short names of the anomalies, in bit order, as used by the structured output formats
+const char *const SectionAnomalyNames[SEC_ANOMALY_COUNT] = {
+    "va_misaligned", "raw_pointer_misaligned", "raw_size_misaligned",
+    "raw_data_past_eof", "not_adjacent", "past_size_of_image"
+};
+
+// Descriptions of the anomalies, in bit order, for the text output
+static const char *const SectionAnomalyText[SEC_ANOMALY_COUNT] = {
+    "the virtual address isn't a multiple of the Section Alignment",
+    "the pointer to raw data isn't a multiple of the File Alignment",
+    "the size of raw data isn't a multiple of the File Alignment",
+    "the raw data runs past the end of the file",
+    "the section doesn't start where the previous section ends in memory",
+    "the section runs past the Size of the image file"
+};
+
+/* The following function checks whether the given section is aligned and laid out
+ * the way the Microsoft Documentation requires
+ * It returns a combination of the SEC_ANOMALY_ bits, which is 0 if no problems were found
+ */
+unsigned SectionAnomalies(const PeFile *pe, uint16_t index)
+{
+    const PeSection *sec = &pe->sections[index];
+    uint32_t sa = pe->opt.SectionAlignment, fa = pe->opt.FileAlignment;
+    unsigned anomalies = 0;
+
+    if (sa && sec->VirtualAddress % sa)
+        anomalies |= SEC_ANOMALY_VA_ALIGN;
+    if (fa && sec->SizeOfRawData && sec->PointerToRawData % fa)
+        anomalies |= SEC_ANOMALY_RAW_PTR_ALIGN;
+    if (fa && sec->SizeOfRawData % fa)
+        anomalies |= SEC_ANOMALY_RAW_SIZE_ALIGN;
+    if (sec->SizeOfRawData && (uint64_t)sec->PointerToRawData + sec->SizeOfRawData > pe->image.size)
+        anomalies |= SEC_ANOMALY_RAW_PAST_EOF;
+
+    // Sections must be in ascending order of virtual address, each starting where the previous one ends
+    if (index > 0 && sa && (sa & (sa - 1)) == 0)
+    {
+        const PeSection *prev = &pe->sections[index - 1];
+        uint64_t span = prev->VirtualSize ? prev->VirtualSize : prev->SizeOfRawData;
+        uint64_t end = prev->VirtualAddress + ((span + sa - 1) & ~(uint64_t)(sa - 1));
+
+        if (sec->VirtualAddress != end)
+            anomalies |= SEC_ANOMALY_NOT_ADJACENT;
+    }
+
+    if ((uint64_t)sec->VirtualAddress + sec->VirtualSize > pe->opt.SizeOfImage)
+        anomalies |= SEC_ANOMALY_PAST_IMAGE;
+
+    return anomalies;
+}
+
+/* The following function is used to show the contents of the Section Table of the image file
+ * It takes the parsed model of the executable passed to it by the main function as a pointer argument
+ * It returns nothing and simply appends strings to the given output buffer
+ */
+void ExecutableSectionInfo(OutBuf *out, const PeFile *exes)
 {
-    printf ("\nThis function is still being explored\n\n");
-}
\ No newline at end of file
+    uint16_t i;
+    int a;
+
+    if (exes->status == PE_STATUS_OPEN_FAILED)
+    {
+        OutPrintf (out, "\nThe given file couldn't be opened.\n\n");
+        return;
+    }
+    if (!PE_HEADERS_VALID(exes))
+    {
+        OutPrintf (out, "\nThe given executable doesn't have complete PE File Header information.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "\nSection Table: --\n\n");
+
+    if (exes->status == PE_STATUS_BAD_SECTIONS)
+    {
+        OutPrintf (out, "The Section Table of %u sections runs past the end of the file.\n\n", exes->coff.NumberOfSections);
+        return;
+    }
+
+    OutPrintf (out, "Number of Sections: %u\n", exes->sectionCount);
+
+    for (i = 0; i < exes->sectionCount; i++)
+    {
+        const PeSection *sec = &exes->sections[i];
+
+        OutPrintf (out, "\nSection %u --\n", i + 1);
+
+        /* Every field of the Section Table entry is shown by walking its field descriptor table (see PeFields.c)
+         * The Characteristics field contains the flags that describe the section, every one of which is shown,
+         * along with the alignment of the section's data, which is only meaningful in object files
+         */
+        ShowFields(out, sec, &PeSectionLayout, PE_LAYOUT_PE32);
+
+        // The entropy of the raw data, if it was computed, shows whether the section is packed or encrypted
+        if (exes->sectionEntropy != NULL)
+            OutPrintf (out, "Entropy: %.4f bits per byte\n", exes->sectionEntropy[i]);
+
+        unsigned anomalies = SectionAnomalies(exes, i);
+        for (a = 0; a < SEC_ANOMALY_COUNT; a++)
+            if (anomalies & (1u << a))
+                OutPrintf (out, "Warning: %s\n", SectionAnomalyText[a]);
+    }
+
+    OutPrintf (out, "\n");
+}
@@ -0,0 +1,772 @@
+/* C-program file that contains the
+   code for the function to scan the image file for byte signatures
+   and show the matches with their section and RVA
+
+   This functionality of rpe64 loads a rule file ('-S <rule file>') of hex patterns with wildcards, one per line:
+
+       # name       [scope]         pattern
+       upx_stub     section=UPX1    60 BE ?? ?? ?? ?? 8D BE ?? ?? ?? ?? 57
+       ep_pushad    entry           60 E8 00 00 00 00
+       ep_jump      entry:16        E9 ?? ?? ?? ??
+       mz_in_data   section=.data   4D 5A 9? 00
+       pe_magic     any             50 45 00 00
+
+   where a ?? byte matches any byte and a ? nibble any nibble, and the optional scope restricts the matches
+   to the raw data of the sections with the given name, or to the given number of bytes around the entry point
+   ('entry' alone only matches at the entry point), while 'any', like no scope at all, matches anywhere in the file.
+   Several lines may have the same name. When every rule has a scope, only the bytes within the scopes are scanned.
+
+   Every pattern is compiled into one Aho-Corasick automaton through its atom, its longest run of fixed bytes
+   (up to SIG_ATOM_MAX of them): the mapped file is scanned once, and each pattern is only compared in full where its atom
+   was found. Between matches, the automaton is back at its root, where a prefilter skips the bytes that can't
+   start an atom, by their pairs with the next byte: 32 pairs at a time with AVX2 when the processor has it,
+   through nibble lookup tables of the first and second bytes of the atoms, or one pair at a time from a bitmap.
+   Each match is reported with the section and the RVA it's loaded at, from the Section Table.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "rpe64Header.h"
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(SIG_NO_SIMD)
+#define SIG_HAVE_SIMD 1
+#include <immintrin.h>
+#endif
+
+#define SIG_ATOM_MAX 8                  // Largest number of bytes of a pattern that go into the automaton
+#define SIG_PATTERN_MAX 4096            // Largest number of bytes of a pattern
+#define SIG_NAME_MAX 64                 // Largest length of a rule name, including the NUL
+#define SIG_STATES_MAX 65536            // Largest number of states of the automaton, each of which takes 1 KB
+#define SIG_MATCH_MAX 256               // Largest number of matches kept per file
+#define SIG_NONE UINT32_MAX             // No state or pattern
+
+// Where the matches of a pattern may be
+#define SIG_SCOPE_ANY 0                 // Anywhere in the file
+#define SIG_SCOPE_SECTION 1             // Within the raw data of a section of the given name
+#define SIG_SCOPE_ENTRY 2               // Starting within the given number of bytes of the entry point
+
+// Pattern of a line of the rule file
+typedef struct SigPattern
+{
+    uint32_t name;              // Offset of the name of the rule within SigRules.names
+    uint32_t bytes;             // Offset of the values within SigRules.bytes, which are followed by the masks
+    uint32_t length;
+    uint32_t atom;              // Offset of the atom within the pattern
+    uint32_t atomLength;
+    int scope;                  // One of the SIG_SCOPE_ values
+    char section[9];            // Section name of SIG_SCOPE_SECTION
+    uint32_t window;            // Number of bytes around the entry point of SIG_SCOPE_ENTRY
+} SigPattern;
+
+struct SigRules
+{
+    SigPattern *patterns;
+    uint32_t patternCount, patternCap;
+    unsigned char *bytes;       // Values of each pattern (with the wildcard bits cleared), followed by its masks
+    size_t bytesLen, bytesCap;
+    char *names;                // NUL-terminated names of the rules
+    size_t namesLen, namesCap;
+    uint32_t *next;             // Transitions of the automaton, 256 per state, the root being state 0
+    uint32_t *out;              // First pattern whose atom ends at each state, SIG_NONE if there's none
+    uint32_t *dict;             // Nearest state on the failure chain of each state whose out isn't SIG_NONE, or SIG_NONE
+    uint32_t *patternNext;      // Next pattern with the same atom, SIG_NONE for the last one
+    uint32_t stateCount, stateCap;
+    unsigned char pairs[8192];  // Bitmap of the pairs of bytes that can start an atom, by (first << 8 | second)
+    unsigned char first[256];   // 1 for the bytes that can start an atom
+    unsigned char lo1[16], hi1[16], lo2[16], hi2[16];      // Nibble tables of the prefilter, see SigSkipAvx2()
+    size_t (*skip)(const SigRules*, const unsigned char*, size_t, size_t);
+    uint64_t hash;              // StrHash() of the rule file, for the options of the result cache
+    uint32_t unscoped;          // Number of patterns of SIG_SCOPE_ANY, the whole file is only scanned if there's one
+};
+
+// Range of file offsets that is scanned for the atoms
+typedef struct SigSpan
+{
+    size_t from, to;
+} SigSpan;
+
+// Checks whether an atom can start with the given pair of bytes
+static inline int SigPair(const SigRules *r, unsigned char a, unsigned char b)
+{
+    unsigned pair = (unsigned)a << 8 | b;
+
+    return r->pairs[pair >> 3] >> (pair & 7) & 1;
+}
+
+/* Returns the first position from the given one at which an atom can start, or the size of the data if there's none
+ * The last byte has no pair, and is only skipped if no atom starts with it
+ */
+static size_t SigSkipPortable(const SigRules *r, const unsigned char *data, size_t size, size_t i)
+{
+    for (; i + 1 < size; i++)
+        if (SigPair(r, data[i], data[i + 1]))
+            return i;
+    if (i < size && r->first[data[i]])
+        return i;
+    return size;
+}
+
+#ifdef SIG_HAVE_SIMD
+
+/* AVX2 kernel of SigSkipPortable(), which tests 32 pairs at a time
+ * The atoms are put into 8 buckets by the high nibble of their first byte. A byte passes the tables of its position
+ * if its low-nibble entry and its high-nibble entry have a bucket in common, and a pair passes if both of its bytes
+ * pass for a common bucket. That is true of every pair that starts an atom, and of a few others, which the bitmap rules out.
+ */
+__attribute__((target("avx2")))
+static size_t SigSkipAvx2(const SigRules *r, const unsigned char *data, size_t size, size_t i)
+{
+    const __m256i nibble = _mm256_set1_epi8(0x0F), zero = _mm256_setzero_si256();
+    const __m256i lo1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)r->lo1));
+    const __m256i hi1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)r->hi1));
+    const __m256i lo2 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)r->lo2));
+    const __m256i hi2 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)r->hi2));
+
+    for (; i + 33 <= size; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(data + i)), b = _mm256_loadu_si256((const __m256i*)(data + i + 1));
+        __m256i first = _mm256_and_si256(_mm256_shuffle_epi8(lo1, _mm256_and_si256(a, nibble)),
+                                         _mm256_shuffle_epi8(hi1, _mm256_and_si256(_mm256_srli_epi16(a, 4), nibble)));
+        __m256i second = _mm256_and_si256(_mm256_shuffle_epi8(lo2, _mm256_and_si256(b, nibble)),
+                                          _mm256_shuffle_epi8(hi2, _mm256_and_si256(_mm256_srli_epi16(b, 4), nibble)));
+        uint32_t hits = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(first, second), zero));
+
+        for (; hits; hits &= hits - 1)
+        {
+            size_t at = i + (unsigned)__builtin_ctz(hits);
+
+            if (SigPair(r, data[at], data[at + 1]))
+                return at;
+        }
+    }
+    return SigSkipPortable(r, data, size, i);
+}
+
+#endif
+
+// Appends the given bytes to a growable array, it returns 1 if there's no memory for them
+static int SigAppend(void *array, size_t *len, size_t *cap, const void *bytes, size_t count)
+{
+    unsigned char **data = array;
+
+    if (*cap - *len < count)
+    {
+        size_t grown = *cap ? *cap : 256;
+        unsigned char *p;
+
+        while (grown - *len < count)
+            grown *= 2;
+        p = realloc(*data, grown);
+        if (p == NULL)
+            return 1;
+        *data = p;
+        *cap = grown;
+    }
+    memcpy(*data + *len, bytes, count);
+    *len += count;
+    return 0;
+}
+
+static int SigHexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return c == '?' ? 16 : -1;
+}
+
+/* Picks the atom of a pattern: the window of up to SIG_ATOM_MAX fixed bytes with the fewest bytes that are
+ * common in image files (0x00, 0xFF, 0xCC and 0x90), among the longest ones, so that it's found at few places
+ */
+static void SigPickAtom(SigPattern *pat, const unsigned char *values, const unsigned char *masks)
+{
+    uint32_t i, best = 0, bestLen = 0;
+    int bestCommon = 0;
+
+    for (i = 0; i < pat->length; i++)
+    {
+        uint32_t len = 0, k;
+        int common = 0;
+
+        while (len < SIG_ATOM_MAX && i + len < pat->length && masks[i + len] == 0xFF)
+            len++;
+        for (k = i; k < i + len; k++)
+            common += values[k] == 0x00 || values[k] == 0xFF || values[k] == 0xCC || values[k] == 0x90;
+        if (len > bestLen || (len == bestLen && len && common < bestCommon))
+        {
+            best = i;
+            bestLen = len;
+            bestCommon = common;
+        }
+    }
+    pat->atom = best;
+    pat->atomLength = bestLen;
+}
+
+/* Parses one line of the rule file into a pattern
+ * It returns NULL on success, or the reason the line is invalid
+ */
+static const char* SigParseLine(SigRules *r, const char *line, size_t len)
+{
+    unsigned char values[SIG_PATTERN_MAX], masks[SIG_PATTERN_MAX];
+    SigPattern pat;
+    size_t i = 0, start;
+
+    memset(&pat, 0, sizeof(pat));
+    while (i < len && (line[i] == ' ' || line[i] == '\t'))
+        i++;
+    start = i;
+    while (i < len && line[i] != ' ' && line[i] != '\t')
+        i++;
+    if (i - start >= SIG_NAME_MAX)
+        return "the rule name is too long";
+    pat.name = (uint32_t)r->namesLen;
+    if (SigAppend(&r->names, &r->namesLen, &r->namesCap, line + start, i - start) || SigAppend(&r->names, &r->namesLen, &r->namesCap, "", 1))
+        return "out of memory";
+
+    while (i < len && (line[i] == ' ' || line[i] == '\t'))
+        i++;
+    start = i;
+    while (i < len && line[i] != ' ' && line[i] != '\t')
+        i++;
+    if (i - start > 8 && !strncmp(line + start, "section=", 8))
+    {
+        if (i - start - 8 > 8)
+            return "section names have at most 8 characters";
+        pat.scope = SIG_SCOPE_SECTION;
+        memcpy(pat.section, line + start + 8, i - start - 8);
+    }
+    else if (i - start >= 5 && !strncmp(line + start, "entry", 5))
+    {
+        char *end;
+
+        pat.scope = SIG_SCOPE_ENTRY;
+        if (i - start > 5)
+        {
+            unsigned long window = line[start + 5] == ':' ? strtoul(line + start + 6, &end, 0) : 0;
+
+            // 'entry:' has to be followed by a number, which strtoul() doesn't check
+            if (line[start + 5] != ':' || i - start == 6 || end != line + i || window > UINT32_MAX)
+                return "the scope of the entry point is 'entry' or 'entry:<bytes>'";
+            pat.window = (uint32_t)window;
+        }
+    }
+    else if (i - start == 3 && !strncmp(line + start, "any", 3))
+        ;
+    else
+        i = start;      // No scope, this is the start of the pattern
+
+    for (; i < len; i++)
+    {
+        int hi, lo;
+
+        if (line[i] == ' ' || line[i] == '\t')
+            continue;
+        if (i + 1 >= len || (hi = SigHexDigit(line[i])) < 0 || (lo = SigHexDigit(line[i + 1])) < 0)
+            return "the pattern has to be made of hex bytes, with '?' for the nibbles that match anything";
+        if (pat.length == SIG_PATTERN_MAX)
+            return "the pattern is too long";
+        masks[pat.length] = (unsigned char)((hi < 16 ? 0xF0 : 0) | (lo < 16 ? 0x0F : 0));
+        values[pat.length] = (unsigned char)(((hi & 15) << 4 | (lo & 15)) & masks[pat.length]);
+        pat.length++;
+        i++;
+    }
+    if (pat.length == 0)
+        return "the rule has no pattern";
+
+    SigPickAtom(&pat, values, masks);
+    if (pat.atomLength == 0)
+        return "the pattern needs at least one byte without wildcards";
+
+    pat.bytes = (uint32_t)r->bytesLen;
+    if (r->bytesLen + 2 * pat.length > UINT32_MAX || SigAppend(&r->bytes, &r->bytesLen, &r->bytesCap, values, pat.length)
+        || SigAppend(&r->bytes, &r->bytesLen, &r->bytesCap, masks, pat.length))
+        return "out of memory";
+    if (r->patternCount == r->patternCap)
+    {
+        uint32_t cap = r->patternCap ? r->patternCap * 2 : 64;
+        SigPattern *grown = realloc(r->patterns, cap * sizeof(SigPattern));
+
+        if (grown == NULL)
+            return "out of memory";
+        r->patterns = grown;
+        r->patternCap = cap;
+    }
+    r->patterns[r->patternCount++] = pat;
+    r->unscoped += pat.scope == SIG_SCOPE_ANY;
+    return NULL;
+}
+
+// Adds a state with no transitions to the automaton, it returns SIG_NONE if there can't be more states
+static uint32_t SigNewState(SigRules *r)
+{
+    if (r->stateCount == r->stateCap)
+    {
+        uint32_t cap = r->stateCap ? r->stateCap * 2 : 256, *next, *out;
+
+        if (r->stateCount == SIG_STATES_MAX)
+            return SIG_NONE;
+        next = realloc(r->next, (size_t)cap * 256 * sizeof(uint32_t));
+        if (next == NULL)
+            return SIG_NONE;
+        r->next = next;
+        out = realloc(r->out, (size_t)cap * sizeof(uint32_t));
+        if (out == NULL)
+            return SIG_NONE;
+        r->out = out;
+        r->stateCap = cap;
+    }
+    memset(r->next + (size_t)r->stateCount * 256, 0, 256 * sizeof(uint32_t));
+    r->out[r->stateCount] = SIG_NONE;
+    return r->stateCount++;
+}
+
+/* Builds the automaton of the atoms of every pattern: their trie first, then the failure links in breadth-first order,
+ * which turn the trie into a complete transition table, and the dictionary links, and the tables of the prefilter
+ * It returns NULL on success, or the reason it failed
+ */
+static const char* SigBuild(SigRules *r)
+{
+    uint32_t *fail = NULL, *queue = NULL, head = 0, tail = 0, p, s;
+    unsigned c, x;
+
+    r->patternNext = malloc((r->patternCount ? r->patternCount : 1) * sizeof(uint32_t));
+    if (r->patternNext == NULL || SigNewState(r) == SIG_NONE)
+        return "out of memory";
+
+    for (p = 0; p < r->patternCount; p++)
+    {
+        const SigPattern *pat = &r->patterns[p];
+        const unsigned char *atom = r->bytes + pat->bytes + pat->atom;
+        uint32_t k, to;
+
+        for (s = 0, k = 0; k < pat->atomLength; k++, s = to)
+        {
+            to = r->next[(size_t)s * 256 + atom[k]];
+            if (to == 0)
+            {
+                to = SigNewState(r);
+                if (to == SIG_NONE)
+                    return "too many patterns";
+                r->next[(size_t)s * 256 + atom[k]] = to;
+            }
+        }
+        r->patternNext[p] = r->out[s];
+        r->out[s] = p;
+
+        // The prefilter: atoms of a single byte can be followed by anything
+        r->first[atom[0]] = 1;
+        r->lo1[atom[0] & 15] |= (unsigned char)(1u << (atom[0] >> 4 & 7));
+        r->hi1[atom[0] >> 4] |= (unsigned char)(1u << (atom[0] >> 4 & 7));
+        for (x = 0; x < 256; x++)
+            if (pat->atomLength == 1 || x == atom[1])
+            {
+                unsigned pair = (unsigned)atom[0] << 8 | x;
+
+                r->pairs[pair >> 3] |= (unsigned char)(1u << (pair & 7));
+                r->lo2[x & 15] |= (unsigned char)(1u << (atom[0] >> 4 & 7));
+                r->hi2[x >> 4] |= (unsigned char)(1u << (atom[0] >> 4 & 7));
+            }
+    }
+
+    fail = malloc((size_t)r->stateCount * sizeof(uint32_t));
+    queue = malloc((size_t)r->stateCount * sizeof(uint32_t));
+    r->dict = malloc((size_t)r->stateCount * sizeof(uint32_t));
+    if (fail == NULL || queue == NULL || r->dict == NULL)
+    {
+        free(fail);
+        free(queue);
+        return "out of memory";
+    }
+
+    fail[0] = 0;
+    r->dict[0] = SIG_NONE;
+    queue[tail++] = 0;
+    while (head < tail)
+    {
+        s = queue[head++];
+        for (c = 0; c < 256; c++)
+        {
+            uint32_t *to = &r->next[(size_t)s * 256 + c];
+
+            if (*to != 0)
+            {
+                uint32_t child = *to, f = s == 0 ? 0 : r->next[(size_t)fail[s] * 256 + c];
+
+                fail[child] = f;
+                r->dict[child] = r->out[f] != SIG_NONE ? f : r->dict[f];
+                queue[tail++] = child;
+            }
+            else if (s != 0)
+                *to = r->next[(size_t)fail[s] * 256 + c];
+        }
+    }
+
+    free(fail);
+    free(queue);
+    return NULL;
+}
+
+/* This function compiles the rules of the given text, as read from the given rule file, into one automaton
+ * It returns NULL, after printing the line and the reason, if a rule is invalid.
+ */
+SigRules* SigRulesCompile(const char *text, size_t len, const char *source)
+{
+    SigRules *r = calloc(1, sizeof(SigRules));
+    const char *error = NULL;
+    size_t at = 0;
+    unsigned line = 0;
+
+    if (r == NULL)
+    {
+        fprintf(stderr, "%s: not enough memory for the rules\n", source);
+        return NULL;
+    }
+
+    while (at < len && error == NULL)
+    {
+        const char *eol = memchr(text + at, '\n', len - at), *hash;
+        size_t end = eol != NULL ? (size_t)(eol - text) : len, lineLen;
+
+        line++;
+        hash = memchr(text + at, '#', end - at);
+        lineLen = (hash != NULL ? (size_t)(hash - text) : end) - at;
+        while (lineLen && (text[at + lineLen - 1] == ' ' || text[at + lineLen - 1] == '\t' || text[at + lineLen - 1] == '\r'))
+            lineLen--;
+        if (strspn(text + at, " \t") < lineLen)
+            error = SigParseLine(r, text + at, lineLen);
+        at = end + 1;
+    }
+    if (error == NULL)
+    {
+        error = r->patternCount ? SigBuild(r) : "there are no rules";
+        line = 0;
+    }
+    if (error != NULL)
+    {
+        if (line)
+            fprintf(stderr, "%s:%u: %s\n", source, line, error);
+        else
+            fprintf(stderr, "%s: %s\n", source, error);
+        SigRulesFree(r);
+        return NULL;
+    }
+
+    r->hash = StrHash(text, len);
+    r->skip = SigSkipPortable;
+#ifdef SIG_HAVE_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        r->skip = SigSkipAvx2;
+#endif
+    return r;
+}
+
+/* This function reads the given rule file, and compiles its rules with SigRulesCompile()
+ * It returns NULL, after printing the reason, if the file can't be read or a rule is invalid.
+ */
+SigRules* SigRulesLoad(const char *path)
+{
+    PeImage img;
+    SigRules *r;
+
+    if (PeImageOpen(&img, path))
+    {
+        fprintf(stderr, "%s: can't open the rule file\n", path);
+        return NULL;
+    }
+    r = SigRulesCompile((const char*)img.data, img.size, path);
+    PeImageClose(&img);
+    return r;
+}
+
+// Returns the hash of the rule file the rules were compiled from, so that reports made with other rules aren't reused
+uint64_t SigRulesHash(const SigRules *r)
+{
+    return r->hash;
+}
+
+void SigRulesFree(SigRules *r)
+{
+    if (r == NULL)
+        return;
+    free(r->patterns);
+    free(r->bytes);
+    free(r->names);
+    free(r->next);
+    free(r->out);
+    free(r->dict);
+    free(r->patternNext);
+    free(r);
+}
+
+/* Checks the scope of the pattern, where its atom ended at the given offset, then compares the whole pattern with the file
+ * The scope only needs the offset, so the bytes are only compared, and the match only resolved to its RVA, within it
+ */
+static int SigVerify(const PeFile *pe, const SigPattern *pat, const unsigned char *values, size_t end, int64_t entry, PeSigMatch *m)
+{
+    const unsigned char *data = pe->image.data, *masks = values + pat->length;
+    size_t before = pat->atom + pat->atomLength, start, k;
+
+    if (end + 1 < before)
+        return 0;
+    start = end + 1 - before;
+    if (pat->length > pe->image.size - start)
+        return 0;
+
+    if (pat->scope == SIG_SCOPE_SECTION)
+    {
+        const PeRvaRange *range = PeFindRawRange(pe, start);
+        const PeSection *s = range != NULL ? &pe->sections[range->section] : NULL;
+
+        if (s == NULL || strcmp(s->Name, pat->section) || start + pat->length - s->PointerToRawData > s->SizeOfRawData)
+            return 0;
+    }
+    else if (pat->scope == SIG_SCOPE_ENTRY
+             && (entry < 0 || (start > (uint64_t)entry ? start - (uint64_t)entry : (uint64_t)entry - start) > pat->window))
+        return 0;
+
+    for (k = 0; k < pat->length; k++)
+        if ((data[start + k] & masks[k]) != values[k])
+            return 0;
+
+    m->offset = start;
+    m->mapped = !PeOffsetToRva(pe, start, &m->rva, &m->section);
+    return 1;
+}
+
+// Orders the matches by offset, then by rule
+static int SigMatchCompare(const void *a, const void *b)
+{
+    const PeSigMatch *x = a, *y = b;
+
+    if (x->offset != y->offset)
+        return x->offset < y->offset ? -1 : 1;
+    return strcmp(x->rule, y->rule);
+}
+
+/* Adds a match to the model: the first SIG_MATCH_MAX matches are kept, and the rule is added to the rules that matched
+ * It returns 1 if there's no memory for it
+ */
+static int SigAdd(PeFile *pe, const PeSigMatch *m)
+{
+    uint32_t r;
+
+    pe->sigMatchTotal++;
+    if (pe->sigMatchCount == SIG_MATCH_MAX)
+        PeSetError(&pe->sigError, PE_ERROR_LIMIT);
+    else
+    {
+        if (pe->sigMatches == NULL && (pe->sigMatches = malloc(SIG_MATCH_MAX * sizeof(PeSigMatch))) == NULL)
+            return 1;
+        pe->sigMatches[pe->sigMatchCount++] = *m;
+    }
+
+    for (r = 0; r < pe->sigRuleCount && pe->sigRules[r] != m->rule && strcmp(pe->sigRules[r], m->rule); r++)
+        ;
+    if (r == pe->sigRuleCount)
+    {
+        if ((r & (r - 1)) == 0)         // The array is grown whenever its size reaches a power of 2
+        {
+            const char **grown = realloc(pe->sigRules, (r ? 2 * r : 1) * sizeof(const char*));
+
+            if (grown == NULL)
+                return 1;
+            pe->sigRules = grown;
+        }
+        pe->sigRules[pe->sigRuleCount++] = m->rule;
+    }
+    return 0;
+}
+
+static int SigSpanCompare(const void *a, const void *b)
+{
+    const SigSpan *x = a, *y = b;
+
+    return x->from < y->from ? -1 : x->from > y->from;
+}
+
+/* Finds the ranges of file offsets that the scoped patterns can match within, when none of the patterns matches anywhere:
+ * around the entry point for the patterns of SIG_SCOPE_ENTRY, and the raw data of the sections of the names of SIG_SCOPE_SECTION.
+ * The ranges are sorted and merged, so that no offset is scanned twice.
+ * It returns the number of ranges, or -1 if there's no memory for them
+ */
+static int64_t SigScopeSpans(const PeFile *pe, const SigRules *rules, int64_t entry, SigSpan **spans)
+{
+    size_t size = pe->image.size, count = 0, merged = 0, k;
+    uint32_t p, r;
+    SigSpan *s = malloc(((size_t)rules->patternCount + pe->rawCount + 1) * sizeof(SigSpan));
+
+    *spans = s;
+    if (s == NULL)
+        return -1;
+
+    for (p = 0; p < rules->patternCount; p++)
+    {
+        const SigPattern *pat = &rules->patterns[p];
+
+        if (pat->scope == SIG_SCOPE_ENTRY && entry >= 0)
+        {
+            s[count].from = (uint64_t)entry > pat->window ? (size_t)entry - pat->window : 0;
+            s[count].to = (size_t)entry + pat->window + pat->length;
+            count++;
+        }
+    }
+
+    // The matches start within the range of a section in the offset index, and end within its raw data
+    for (r = 0; r < pe->rawCount; r++)
+    {
+        const PeSection *sec = &pe->sections[pe->rawIndex[r].section];
+
+        for (p = 0; p < rules->patternCount; p++)
+            if (rules->patterns[p].scope == SIG_SCOPE_SECTION && !strcmp(sec->Name, rules->patterns[p].section))
+            {
+                s[count].from = pe->rawIndex[r].rawOffset;
+                s[count].to = (size_t)sec->PointerToRawData + sec->SizeOfRawData;
+                count++;
+                break;
+            }
+    }
+
+    qsort(s, count, sizeof(SigSpan), SigSpanCompare);
+    for (k = 0; k < count; k++)
+    {
+        if (s[k].to > size)
+            s[k].to = size;
+        if (s[k].from >= s[k].to)
+            continue;
+        if (merged && s[k].from <= s[merged - 1].to)
+        {
+            if (s[k].to > s[merged - 1].to)
+                s[merged - 1].to = s[k].to;
+        }
+        else
+            s[merged++] = s[k];
+    }
+    return (int64_t)merged;
+}
+
+/* Scans the given range of file offsets with the automaton, from its root, and adds the matches to the model
+ * It returns 1 if there's no memory for a match, otherwise it returns 0
+ */
+static int SigScan(PeFile *pe, const SigRules *rules, size_t from, size_t to, int64_t entry)
+{
+    const unsigned char *data = pe->image.data;
+    size_t i = from;
+    uint32_t state = 0, s, p;
+
+    while (i < to)
+    {
+        if (state == 0)
+        {
+            i = rules->skip(rules, data, to, i);
+            if (i == to)
+                break;
+        }
+
+        state = rules->next[(size_t)state * 256 + data[i]];
+        for (s = rules->out[state] != SIG_NONE ? state : rules->dict[state]; s != SIG_NONE; s = rules->dict[s])
+            for (p = rules->out[s]; p != SIG_NONE; p = rules->patternNext[p])
+            {
+                const SigPattern *pat = &rules->patterns[p];
+                PeSigMatch m;
+
+                if (!SigVerify(pe, pat, rules->bytes + pat->bytes, i, entry, &m))
+                    continue;
+                m.rule = rules->names + pat->name;
+                if (SigAdd(pe, &m))
+                    return 1;
+            }
+        i++;
+    }
+    return 0;
+}
+
+/* This function scans the image file once for the patterns of the given rules, and stores their matches into the model,
+ * in file order, with the names of the rules that matched, in the order they were found.
+ * The whole file is scanned if a pattern can match anywhere, otherwise only the ranges of the scopes of the patterns are.
+ * Every match is counted, but only the first SIG_MATCH_MAX matches are kept, in which case the sigError field of the model is set.
+ * It returns 0 on success, or 1 if the headers of the file couldn't be decoded
+ */
+int PeFileSignatures(PeFile *pe, const SigRules *rules)
+{
+    SigSpan whole = { 0, pe->image.size }, *spans = &whole;
+    int64_t entry = -1, count = 1, k;
+    uint32_t entryOffset, avail;
+
+    if (!PE_HEADERS_VALID(pe))
+        return 1;
+    if (pe->parsed & PE_PARSED_SIGNATURES)
+        return 0;
+    pe->parsed |= PE_PARSED_SIGNATURES;
+
+    if (!PeRvaToOffset(pe, pe->opt.AddressOfEntryPoint, &entryOffset, &avail))
+        entry = entryOffset;
+
+    if (!rules->unscoped && (count = SigScopeSpans(pe, rules, entry, &spans)) < 0)
+    {
+        pe->sigError = PE_ERROR_NO_MEMORY;
+        return 0;
+    }
+    for (k = 0; k < count; k++)
+        if (SigScan(pe, rules, spans[k].from, spans[k].to, entry))
+        {
+            pe->sigError = PE_ERROR_NO_MEMORY;
+            break;
+        }
+    if (spans != &whole)
+        free(spans);
+
+    if (pe->sigMatchCount)
+        qsort(pe->sigMatches, pe->sigMatchCount, sizeof(PeSigMatch), SigMatchCompare);
+    return 0;
+}
+
+/* The following function is used to show the matches of the signature rules, with where each one is loaded
+ * It takes the parsed model of the executable, on which PeFileSignatures() has been run, as a pointer argument
+ * It returns nothing and simply appends strings to the given output buffer
+ */
+void ExecutableSignatures(OutBuf *out, const PeFile *exes)
+{
+    uint32_t i, entryOffset, avail;
+
+    if (!PE_HEADERS_VALID(exes))
+    {
+        OutPrintf (out, "\nThe given executable doesn't have complete PE File Header information.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "\nSignatures: --\n\n");
+    if (exes->sigMatchTotal == 0)
+    {
+        OutPrintf (out, exes->sigError ? "The file couldn't be scanned for lack of memory.\n\n" : "No rule matched the given executable.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "Number of Matches: %llu\n", (unsigned long long)exes->sigMatchTotal);
+    if (exes->sigError == PE_ERROR_LIMIT)
+        OutPrintf (out, "Warning: only the first %u matches found are shown\n", exes->sigMatchCount);
+    else if (exes->sigError != PE_ERROR_NONE)
+        OutPrintf (out, "Warning: the file couldn't be scanned to its end for lack of memory\n");
+
+    for (i = 0; i < exes->sigMatchCount; i++)
+    {
+        const PeSigMatch *m = &exes->sigMatches[i];
+
+        OutPrintf (out, "%s: offset 0x%llX", m->rule, (unsigned long long)m->offset);
+        if (!m->mapped)
+            OutPrintf (out, ", outside the sections of the image");
+        else if (m->section < 0)
+            OutPrintf (out, ", RVA 0x%08X in the headers", m->rva);
+        else
+            OutPrintf (out, ", RVA 0x%08X in %s", m->rva, exes->sections[m->section].Name);
+        if (!PeRvaToOffset(exes, exes->opt.AddressOfEntryPoint, &entryOffset, &avail) && m->offset == entryOffset)
+            OutPrintf (out, ", at the entry point");
+        OutChar(out, '\n');
+    }
+
+    OutPrintf (out, "\n");
+}
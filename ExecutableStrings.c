@@ -0,0 +1,288 @@
+/* C-program file that contains the
+   code for the function to extract the ASCII and UTF-16LE strings of the image file
+   and show them with their section and RVA
+
+   This functionality of rpe64 does what the 'strings' tool does, in the same run as the other options ('-n <min length>'):
+   it finds the runs of printable ASCII characters (0x20 to 0x7E, and the tab), and the runs of the same characters
+   stored as UTF-16LE, i.e. each followed by a zero byte, that are at least the given number of characters long,
+   and resolves the file offset of each one to its section and RVA with a binary search of the offset index of the model.
+
+   The file is classified 64 bytes at a time into two bitmasks, one of its printable bytes and one of its zero bytes,
+   with SSE2 or AVX2 compares on x86-64 (the choice of the AVX2 kernel is made once, at run time).
+   The runs are then found from the bits where the masks change, so that the bytes themselves are never looked at
+   one by one: a UTF-16LE character is a printable bit followed by a zero bit, and its strings are the runs of
+   such characters 2 bytes apart, found the same way on every other bit.
+   The strings are passed to a callback as they're found rather than kept in the model, so that they stream
+   into the text or JSON output without being stored, however many there are.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "rpe64Header.h"
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(STRINGS_NO_SIMD)
+#define STRINGS_HAVE_SIMD 1
+#include <immintrin.h>
+#endif
+
+#define STRINGS_BLOCK 64                // Number of bytes classified at a time, one per bit of the masks
+
+/* Portable kernel, which classifies the given number of bytes, up to STRINGS_BLOCK, into the bitmasks
+ * of the printable bytes and of the zero bytes, bit i standing for byte i
+ */
+static void StringMasksPortable(const unsigned char *data, size_t len, uint64_t *printable, uint64_t *zero)
+{
+    uint64_t p = 0, z = 0;
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        p |= (uint64_t)((data[i] >= 0x20 && data[i] <= 0x7E) || data[i] == '\t') << i;
+        z |= (uint64_t)(data[i] == 0) << i;
+    }
+    *printable = p;
+    *zero = z;
+}
+
+#ifdef STRINGS_HAVE_SIMD
+
+/* SSE2 kernel, which classifies a whole block as four 16-byte vectors
+ * The compares are signed, so bytes from 0x80 up are negative and never above 0x1F
+ */
+static void StringMasksSse2(const unsigned char *data, size_t len, uint64_t *printable, uint64_t *zero)
+{
+    const __m128i low = _mm_set1_epi8(0x1F), high = _mm_set1_epi8(0x7F), tab = _mm_set1_epi8('\t'), nul = _mm_setzero_si128();
+    uint64_t p = 0, z = 0;
+    int k;
+
+    if (len < STRINGS_BLOCK)
+    {
+        StringMasksPortable(data, len, printable, zero);
+        return;
+    }
+    for (k = 0; k < STRINGS_BLOCK / 16; k++)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + 16 * k));
+        __m128i print = _mm_or_si128(_mm_and_si128(_mm_cmpgt_epi8(v, low), _mm_cmpgt_epi8(high, v)), _mm_cmpeq_epi8(v, tab));
+
+        p |= (uint64_t)(uint16_t)_mm_movemask_epi8(print) << (16 * k);
+        z |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nul)) << (16 * k);
+    }
+    *printable = p;
+    *zero = z;
+}
+
+// AVX2 kernel, which classifies a whole block as two 32-byte vectors
+__attribute__((target("avx2")))
+static void StringMasksAvx2(const unsigned char *data, size_t len, uint64_t *printable, uint64_t *zero)
+{
+    const __m256i low = _mm256_set1_epi8(0x1F), high = _mm256_set1_epi8(0x7F), tab = _mm256_set1_epi8('\t'), nul = _mm256_setzero_si256();
+    __m256i lo, hi, printLo, printHi;
+
+    if (len < STRINGS_BLOCK)
+    {
+        StringMasksPortable(data, len, printable, zero);
+        return;
+    }
+    lo = _mm256_loadu_si256((const __m256i*)data);
+    hi = _mm256_loadu_si256((const __m256i*)(data + 32));
+    printLo = _mm256_or_si256(_mm256_and_si256(_mm256_cmpgt_epi8(lo, low), _mm256_cmpgt_epi8(high, lo)), _mm256_cmpeq_epi8(lo, tab));
+    printHi = _mm256_or_si256(_mm256_and_si256(_mm256_cmpgt_epi8(hi, low), _mm256_cmpgt_epi8(high, hi)), _mm256_cmpeq_epi8(hi, tab));
+    *printable = (uint64_t)(uint32_t)_mm256_movemask_epi8(printLo) | (uint64_t)(uint32_t)_mm256_movemask_epi8(printHi) << 32;
+    *zero = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, nul))
+            | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, nul)) << 32;
+}
+
+#endif
+
+// Kernel of the classification, chosen once for the processor by StringMasksSelect()
+#ifdef STRINGS_HAVE_SIMD
+static void (*StringMasks)(const unsigned char*, size_t, uint64_t*, uint64_t*) = StringMasksSse2;
+#else
+static void (*StringMasks)(const unsigned char*, size_t, uint64_t*, uint64_t*) = StringMasksPortable;
+#endif
+static pthread_once_t StringMasksOnce = PTHREAD_ONCE_INIT;
+
+static void StringMasksSelect(void)
+{
+#ifdef STRINGS_HAVE_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        StringMasks = StringMasksAvx2;
+#endif
+}
+
+// State of a scan for strings, carried from one block to the next
+typedef struct StringScan
+{
+    const PeFile *pe;
+    uint32_t minLength;
+    PeStringFn fn;
+    void *ctx;
+    uint64_t *counts;
+    uint64_t start;             // Offset of the ASCII string being found
+    uint64_t wideStart[2];      // Offset of the UTF-16LE string being found, at even and odd offsets
+} StringScan;
+
+// Passes a string that was found to the callback, if it's long enough
+static void StringFound(StringScan *s, uint64_t start, uint64_t end, int wide)
+{
+    PeString str;
+
+    str.length = wide ? (end - start) / 2 : end - start;
+    if (str.length < s->minLength)
+        return;
+    s->counts[wide]++;
+    if (s->fn == NULL)
+        return;
+    str.offset = start;
+    str.wide = wide;
+    str.data = s->pe->image.data + start;
+    str.mapped = !PeOffsetToRva(s->pe, start, &str.rva, &str.section);
+    s->fn(s->ctx, &str);
+}
+
+/* Finds the strings that start or end within a block, from the masks of its printable bytes and of its UTF-16LE characters
+ * and those of the previous block, whose last bits carry the strings that run on into this block
+ */
+static void StringBlock(StringScan *s, uint64_t base, uint64_t print, uint64_t prevPrint, uint64_t wide, uint64_t prevWide)
+{
+    uint64_t edges = print ^ (print << 1 | prevPrint >> 63);
+
+    // Every change of the printable mask starts or ends an ASCII string
+    for (; edges; edges &= edges - 1)
+    {
+        int bit = __builtin_ctzll(edges);
+
+        if (print >> bit & 1)
+            s->start = base + bit;
+        else
+            StringFound(s, s->start, base + bit, 0);
+    }
+
+    // and the UTF-16LE strings change every other bit, the even and odd ones being apart
+    edges = wide ^ (wide << 2 | prevWide >> 62);
+    for (; edges; edges &= edges - 1)
+    {
+        int bit = __builtin_ctzll(edges);
+
+        if (wide >> bit & 1)
+            s->wideStart[bit & 1] = base + bit;
+        else
+            StringFound(s, s->wideStart[bit & 1], base + bit, 1);
+    }
+}
+
+/* This function extracts the ASCII and UTF-16LE strings of at least the given number of characters from the whole image file,
+ * and calls the given function for each of them, in the order in which they're found, unless it's NULL.
+ * It stores the number of ASCII strings and of UTF-16LE strings through the last argument.
+ * It returns 0 on success, or 1 if the headers of the file couldn't be decoded
+ */
+int PeStringScan(const PeFile *pe, uint32_t minLength, PeStringFn fn, void *ctx, uint64_t counts[2])
+{
+    const unsigned char *data = pe->image.data;
+    size_t size = pe->image.size, base;
+    uint64_t print, zero, nextPrint = 0, nextZero = 0, prevPrint = 0, prevWide = 0, wide;
+    StringScan s;
+
+    counts[0] = counts[1] = 0;
+    if (!PE_HEADERS_VALID(pe))
+        return 1;
+
+    pthread_once(&StringMasksOnce, StringMasksSelect);
+    memset(&s, 0, sizeof(s));
+    s.pe = pe;
+    s.minLength = minLength ? minLength : 1;
+    s.fn = fn;
+    s.ctx = ctx;
+    s.counts = counts;
+
+    /* The characters of a block need the first zero bit of the next block, so the masks are made a block ahead.
+     * One more empty block past the end of the file ends the strings that run to the end.
+     */
+    StringMasks(data, size < STRINGS_BLOCK ? size : STRINGS_BLOCK, &nextPrint, &nextZero);
+    for (base = 0; base < size + STRINGS_BLOCK; base += STRINGS_BLOCK)
+    {
+        print = nextPrint;
+        zero = nextZero;
+        nextPrint = nextZero = 0;
+        if (base + STRINGS_BLOCK < size)
+            StringMasks(data + base + STRINGS_BLOCK, size - base - STRINGS_BLOCK < STRINGS_BLOCK ? size - base - STRINGS_BLOCK : STRINGS_BLOCK,
+                        &nextPrint, &nextZero);
+
+        wide = print & (zero >> 1 | nextZero << 63);
+        StringBlock(&s, base, print, prevPrint, wide, prevWide);
+        prevPrint = print;
+        prevWide = wide;
+    }
+    return 0;
+}
+
+/* Copies the characters of a string found by PeStringScan() into the given buffer, as a NUL-terminated string,
+ * keeping the low byte of each UTF-16LE character, which is the whole character since they're all ASCII
+ * It's used by both the text and the record output, so that they show the same characters
+ */
+void PeStringText(OutBuf *text, const PeString *str)
+{
+    uint64_t i;
+
+    OutReset(text);
+    if (!str->wide)
+        OutWrite(text, str->data, (size_t)str->length);
+    else
+        for (i = 0; i < str->length; i++)
+            OutChar(text, (char)str->data[2 * i]);
+    OutChar(text, '\0');
+}
+
+// Output of ExecutableStrings(), as the context of its callback
+typedef struct StringPrinter
+{
+    OutBuf *out;
+    OutBuf text;
+    const PeFile *pe;
+} StringPrinter;
+
+static void StringPrint(void *ctx, const PeString *str)
+{
+    StringPrinter *p = ctx;
+
+    PeStringText(&p->text, str);
+    OutPrintf (p->out, "0x%08llX  ", (unsigned long long)str->offset);
+    if (!str->mapped)
+        OutPrintf (p->out, "%-10s  %-8s", "-", "overlay");
+    else
+        OutPrintf (p->out, "0x%08X  %-8s", str->rva, str->section >= 0 ? p->pe->sections[str->section].Name : "headers");
+    OutPrintf (p->out, "  %-8s  ", str->wide ? "UTF-16LE" : "ASCII");
+    OutPuts(p->out, p->text.data);
+    OutChar(p->out, '\n');
+}
+
+/* The following function is used to show the strings of the file, with their offset, RVA and section
+ * It takes the parsed model of the executable as a pointer argument, and the least number of characters of the strings
+ * It returns nothing and simply appends strings to the given output buffer
+ */
+void ExecutableStrings(OutBuf *out, const PeFile *exes, uint32_t minLength)
+{
+    StringPrinter printer;
+    uint64_t counts[2];
+
+    if (!PE_HEADERS_VALID(exes))
+    {
+        OutPrintf (out, "\nThe given executable doesn't have complete PE File Header information.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "\nStrings: --\n\n");
+    OutPrintf (out, "Minimum Length: %u characters\n\n", minLength);
+    OutPrintf (out, "%-10s  %-10s  %-8s  %-8s  %s\n", "Offset", "RVA", "Section", "Encoding", "String");
+
+    printer.out = out;
+    printer.pe = exes;
+    OutInit(&printer.text);
+    PeStringScan(exes, minLength, StringPrint, &printer, counts);
+    OutFree(&printer.text);
+
+    OutPrintf (out, "\nNumber of Strings: %llu ASCII, %llu UTF-16LE\n\n", (unsigned long long)counts[0], (unsigned long long)counts[1]);
+}
@@ -0,0 +1,170 @@
+/* C-program file that contains the
+   code for the function to decode and show
+   the TLS Directory of the image file and its callbacks, based on the Microsoft Documentation
+
+   This functionality of rpe64 follows the Thread Local Storage Table of the data directories, and reads
+   the TLS Directory, whose addresses are virtual addresses based on the ImageBase rather than RVAs.
+   The TLS callbacks it lists are run by the loader before the entry point of the image, which makes them
+   a common place for malware to hide code, so every callback is reported with the section and the function
+   (from the Exception Table, see ExecutableFunctions.c) that it points into.
+ */
+
+/* Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#the-tls-section
+ */
+
+#include <stdlib.h>
+#include "rpe64Header.h"
+
+#define TLS_DIRECTORY_SIZE32 24         // Size of the TLS Directory of PE32 images
+#define TLS_DIRECTORY_SIZE64 40         // Size of the TLS Directory of PE32+ images
+#define TLS_MAX_CALLBACKS 256           // Maximum number of callbacks decoded per file
+#define SCN_MEM_EXECUTE 0x20000000      // IMAGE_SCN_MEM_EXECUTE
+
+// Converts the given virtual address to an RVA, returning 1 if it's not within the 4 GB above the ImageBase
+static int VaToRva(const PeFile *pe, uint64_t va, uint32_t *rva)
+{
+    if (va < pe->opt.ImageBase || va - pe->opt.ImageBase > 0xFFFFFFFFu)
+        return 1;
+    *rva = (uint32_t)(va - pe->opt.ImageBase);
+    return 0;
+}
+
+/* This function decodes the TLS Directory of the image file and the array of its callbacks into the model
+ * If the directory or the array are cut off, or the array has more than TLS_MAX_CALLBACKS entries,
+ * the callbacks before the cut are kept and the tlsError field of the model is set
+ * It returns 0 on success, or 1 if the headers of the file couldn't be decoded
+ */
+int PeFileTls(PeFile *pe)
+{
+    uint32_t rva = pe->dir[PE_DIR_TLS].VirtualAddress, at;
+    int wide = pe->opt.Magic == PE32PLUS_MAGIC;
+    PeCursor dir, slots;
+    int rc;
+
+    if (!PE_HEADERS_VALID(pe))
+        return 1;
+    if (pe->parsed & PE_PARSED_TLS)
+        return 0;
+    pe->parsed |= PE_PARSED_TLS;
+
+    if (rva == 0)
+        return 0;
+    rc = PeCursorAtRva(&dir, pe, rva, wide ? TLS_DIRECTORY_SIZE64 : TLS_DIRECTORY_SIZE32);
+    if (rc != PE_ERROR_NONE)
+    {
+        pe->tlsError = rc;
+        return 0;
+    }
+
+    pe->hasTls = 1;
+    pe->tls.rawDataStart = CursorAddr(&dir, wide);
+    pe->tls.rawDataEnd = CursorAddr(&dir, wide);
+    pe->tls.addressOfIndex = CursorAddr(&dir, wide);
+    pe->tls.addressOfCallbacks = CursorAddr(&dir, wide);
+    pe->tls.sizeOfZeroFill = CursorU32(&dir);
+    pe->tls.characteristics = CursorU32(&dir);
+
+    if (pe->tls.addressOfCallbacks == 0)
+        return 0;
+    if (VaToRva(pe, pe->tls.addressOfCallbacks, &at) || PeCursorAtRva(&slots, pe, at, UINT32_MAX) == PE_ERROR_UNMAPPED)
+    {
+        pe->tlsError = PE_ERROR_UNMAPPED;
+        return 0;
+    }
+
+    // The array ends with a zero entry, which has to be within the section that holds the array
+    for (;;)
+    {
+        uint64_t callback = CursorAddr(&slots, wide);
+
+        if (slots.error != PE_ERROR_NONE)
+        {
+            pe->tlsError = slots.error;
+            break;
+        }
+        if (callback == 0)
+            break;
+        if (pe->tlsCallbackCount == TLS_MAX_CALLBACKS)
+        {
+            pe->tlsError = PE_ERROR_LIMIT;
+            break;
+        }
+
+        if (pe->tlsCallbacks == NULL)
+        {
+            pe->tlsCallbacks = malloc(TLS_MAX_CALLBACKS * sizeof(uint64_t));
+            if (pe->tlsCallbacks == NULL)
+            {
+                pe->tlsError = PE_ERROR_NO_MEMORY;
+                break;
+            }
+        }
+        pe->tlsCallbacks[pe->tlsCallbackCount++] = callback;
+    }
+
+    return 0;
+}
+
+/* The following function is used to show the TLS Directory and where each TLS callback points to
+ * It takes the parsed model of the executable, on which PeFileTls() has been run, as a pointer argument
+ * The functions containing the callbacks are only shown if PeFileFunctions() has been run too
+ * It returns nothing and simply appends strings to the given output buffer
+ */
+void ExecutableTls(OutBuf *out, const PeFile *exes)
+{
+    uint32_t i;
+
+    if (!PE_HEADERS_VALID(exes))
+    {
+        OutPrintf (out, "\nThe given executable doesn't have complete PE File Header information.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "\nTLS Directory: --\n\n");
+    if (!exes->hasTls)
+    {
+        OutPrintf (out, exes->tlsError == PE_ERROR_UNMAPPED ? "The TLS Directory doesn't point into the file.\n\n"
+                        : exes->tlsError ? "The TLS Directory is cut off by the end of its section or of the file.\n\n"
+                        : "The given executable doesn't have a TLS Directory.\n\n");
+        return;
+    }
+
+    OutPrintf (out, "Start of Raw Data: 0x%llX\n", (unsigned long long)exes->tls.rawDataStart);
+    OutPrintf (out, "End of Raw Data: 0x%llX\n", (unsigned long long)exes->tls.rawDataEnd);
+    OutPrintf (out, "Address of Index: 0x%llX\n", (unsigned long long)exes->tls.addressOfIndex);
+    OutPrintf (out, "Address of Callbacks: 0x%llX\n", (unsigned long long)exes->tls.addressOfCallbacks);
+    OutPrintf (out, "Size of Zero Fill: %u\n", exes->tls.sizeOfZeroFill);
+    OutPrintf (out, "Characteristics: 0x%X\n", exes->tls.characteristics);
+    OutPrintf (out, "Number of Callbacks: %u\n", exes->tlsCallbackCount);
+    if (exes->tlsError == PE_ERROR_UNMAPPED)
+        OutPrintf (out, "Warning: the array of callbacks doesn't point into the file\n");
+    else if (exes->tlsError == PE_ERROR_LIMIT)
+        OutPrintf (out, "Warning: the array of callbacks has more than %d entries, only the first ones are shown\n", TLS_MAX_CALLBACKS);
+    else if (exes->tlsError)
+        OutPrintf (out, "Warning: the array of callbacks is cut off, only the callbacks before the cut are shown\n");
+
+    for (i = 0; i < exes->tlsCallbackCount; i++)
+    {
+        uint64_t va = exes->tlsCallbacks[i];
+        uint32_t rva;
+        int section;
+        const PeFunction *func;
+
+        OutPrintf (out, "Callback %u: 0x%llX", i + 1, (unsigned long long)va);
+        if (VaToRva(exes, va, &rva) || (section = PeSectionOfRva(exes, rva)) < 0)
+        {
+            OutPrintf (out, ", outside the sections of the image\n");
+            continue;
+        }
+
+        OutPrintf (out, ", RVA 0x%08X in %s", rva, exes->sections[section].Name);
+        func = PeFindFunction(exes, rva);
+        if (func != NULL)
+            OutPrintf (out, ", in the function at 0x%08X-0x%08X", func->begin, func->end);
+        if (!(exes->sections[section].Characteristics & SCN_MEM_EXECUTE))
+            OutPrintf (out, " (warning: the section isn't executable)");
+        OutChar(out, '\n');
+    }
+
+    OutPrintf (out, "\n");
+}
@@ -20,17 +20,17 @@
 /* The following finction is used to check whether then name of a given executable is valid or not.
  * It takes the name of the executable that is passed to it from the main function as the argument,
  * and passes it to the actual filename-checking function as a string parameter.
- * It returns nothing and simply displays a string in the standard output.
+ * It returns nothing and simply appends a string to the given output buffer.
  */
-void FilenameCheck(char argf[])
+void FilenameCheck(OutBuf *out, char argf[])
 {
-    if (!FilenameValid(argf))               /* Passes the name of exe to the filename-checking function as a string parameter,
+    if (!FilenameValid(out, argf))               /* Passes the name of exe to the filename-checking function as a string parameter,
                                              * and prints a string saying the filename of the given exe is valid if the invoked function returns 0,
                                              * otherwise prints a string saying the filename of the given exe is invalid.
                                              */
-        printf("\nThe filename of the given executable is valid\n\n");
+        OutPrintf(out, "\nThe filename of the given executable is valid\n\n");
     else
-        printf("\nThe filename of the given executable is invalid since it's using some reserved names or characters.\n\n");
+        OutPrintf(out, "\nThe filename of the given executable is invalid since it's using some reserved names or characters.\n\n");
 }
 
 /* This is the actual function that checks if the filename of the executable
@@ -39,7 +39,7 @@ void FilenameCheck(char argf[])
  * It takes the name of the exe as a string parameter, and
  * it returns 0 if it does follow the naming standards, otherwise it returns 1.
  */
-int FilenameValid(char exeName[])
+int FilenameValid(OutBuf *out, char exeName[])
 {
     int i, j;
     
@@ -62,7 +62,7 @@ int FilenameValid(char exeName[])
      */
     if (exeName[len - 5] == '.')
     {
-        printf("\nThis executable has a period at the end of its filename.\n");
+        OutPrintf(out, "\nThis executable has a period at the end of its filename.\n");
         return 1;
     }
 
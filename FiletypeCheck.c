@@ -17,76 +17,64 @@
  */
 
 #include <stdlib.h>
-#include <string.h>
 #include "rpe64Header.h"
 
 /* The following function is used to check whether a given executable is valid or not.
- * It takes the executable passed to it by the main function as a character pointer,
- * and then passes it to the actual filetype validity-checking function as a character pointer too.
- * It returns nothing and simply displays strings in the standard output.
+ * It takes the parsed model of the executable passed to it by the main function as a pointer,
+ * and then passes it to the actual filetype validity-checking function as a pointer too.
+ * It returns nothing and simply appends strings to the given output buffer.
  */
-void FiletypeCheck(const char *argt)
+void FiletypeCheck(OutBuf *out, const PeFile *argt)
 {
-    if (FiletypeValid(argt))     /* Passes the address of exe to the filetype validity-checking function as a character pointer parameter,
+    if (FiletypeValid(out, argt))     /* Passes the model of exe to the filetype validity-checking function as a pointer parameter,
                                   * and prints a string saying the filetype of the given exe is valid if the invoked function returns 0,
                                   * otherwise prints a string saying the filetype of the given exe is invalid.
                                   */
-      printf("\nThe given executable isn't a valid PE executable and may have been just been named as an 'exe'.\n\n");
+      OutPrintf(out, "\nThe given executable isn't a valid PE executable and may have been just been named as an 'exe'.\n\n");
 }
 
 /* This is the actual function that checks whether the given executable is a valid executable or not,
  * and displays whether it's a 64-bit PE32+ or 32-bit PE32 executable file.
  * 
- * It takes the input executable as a character pointer parameter, and
+ * It takes the parsed model of the input executable as a pointer parameter, and
  * it returns 0 if it is a valid PE executable, otherwise it returns 1.
  * It also prints a string saying whether it's a 64-bit or 32-bit executable by checking
  * the value of its magic number in the Optional Image Header.
  */
-int FiletypeValid(const char *exev)
+int FiletypeValid(OutBuf *out, const PeFile *exev)
 {
-  int flag = 0;
-    char buffer[512]; // 512 bytes is just a random value that is large enough to hold the required to no. of bytes
-
-    FILE *infile = fopen(exev, "rb");
-    // Reads 176 bytes of binary data from the start of the given executable file.
-    fread(&buffer, 16, 32, infile);
-    fclose(infile);
+    if (exev->status == PE_STATUS_OPEN_FAILED)
+    {
+        OutPrintf(out, "\nThe given executable couldn't be opened.\n");
+        return 1;
+    }
 
-    unsigned char e_lfanewc[4] = {*(buffer+63), *(buffer+62), *(buffer+61), *(buffer+60)};
-    uint32_t e_lfanew = HexToDec(e_lfanewc);    // Stores the PE File Header offset in decimal format
-    
-    if (strstr(buffer + e_lfanew, "PE")) /* Checks for the presence of the PE file signature(PE\0\0) using string comparison function
-                                          * in the given PE File offset and prints a string saying the given execuable is valid
-                                          * if the comparison returns true.
-                                          */
+    /* Checks whether the PE file signature(PE\0\0) was found at the PE File Header offset given by e_lfanew
+     * while parsing, and prints a string saying the given execuable is valid if it was.
+     */
+    if (exev->status == PE_STATUS_NOT_PE)
     {
-        printf("\nThe given executable is a valid PE image file since it has the 4-byte Dword signature within the PE File Header.\n");
-        flag = 1;
+        // If the signature isn't present, it prints a string saying that the given executable is invalid.
+        OutPrintf(out, "\nThe given executable is NOT a valid PE image file since it doesn't have the 4-byte Dword signature within the PE File Header.\n");
+        return 1;
     }
-    else
-        // If the comparison returns false, it prints a string saying that the given executable is invalid.
-        printf("\nThe given executable is NOT a valid PE image file since it doesn't have the 4-byte Dword signature within the PE File Header.\n");
 
-    uint32_t IOH = e_lfanew+24;      // Stores the offset of the Image Optional Header in decimal format
-    
-    // The following code is executed only if it is found that the given executable is valid.
-    if (flag)
+    OutPrintf(out, "\nThe given executable is a valid PE image file since it has the 4-byte Dword signature within the PE File Header.\n");
+
+    if (exev->opt.Magic == PE32PLUS_MAGIC)     /* Checks what magic code is present in the Image Optional Header, which
+                                                * is the last part of the PE File Header, and gives the output
+                                                * accordingly, i.e. gives the output as 64-bit if the magic code present
+                                                * is 0x20b(0B 02), or as 32-bit if the
+                                                * magic code present is 0x10b(0B 01) in the same offset.
+                                                */
+    {
+        OutPrintf(out, "\nThe given executable is a 64-bit executable.\n\n");
+        return 0;
+    }
+    else if (exev->opt.Magic == PE32_MAGIC)
     {
-        if ((*(buffer + IOH) == 0x0B) && (*(buffer + IOH + 1) == 0x02)) /* Checks what magic code is present in the Image Optional Header, which
-                                                                     * is the last part of the PE File Header, and gives the output
-                                                                     * accordingly, i.e. gives the output as 64-bit if the magic code present
-                                                                     * in the offset 0x00000099 is 0x20b(0B 02), or as 32-bit if the
-                                                                     * magic code present is 0x10b(0B 01) in the same offset.
-                                                                     */
-        {
-            printf("\nThe given executable is a 64-bit executable.\n\n");
-            return 0;
-        }
-        else if ((*(buffer + IOH) == 0x0B) && (*(buffer + IOH + 1) == 0x01))
-        {
-            printf("\nThe given executable is a 32-bit executable.\n\n");
-            return 0;
-        }
+        OutPrintf(out, "\nThe given executable is a 32-bit executable.\n\n");
+        return 0;
     }
 
     return 1;
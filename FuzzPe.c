@@ -0,0 +1,149 @@
+/* C-program file that contains the
+   code for the fuzz harness of rpe64.
+
+   This functionality of rpe64 feeds arbitrary bytes to every directory decoder and to every output format,
+   through the LLVMFuzzerTestOneInput() entry point of libFuzzer, so that inputs which make the decoders
+   read out of bounds, leak or crash are found when it's built with the sanitizers ('make fuzz').
+   Built with FUZZ_STANDALONE defined ('make fuzz-standalone'), it has its own main() instead, which runs
+   the same function on each file given on the command line, or on the standard input if there are none,
+   e.g. for AFL, or for replaying the inputs found by libFuzzer on machines without clang.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "rpe64Header.h"
+
+// Rules of every scope and kind of wildcard, which the files are scanned for with '-S'
+static const char FuzzRules[] =
+    "mz any 4D 5A\n"
+    "pe 50 45 00 00 ?? ??\n"
+    "call section=.text E8 ?? ?? ?? ??\n"
+    "prologue entry:64 5? 8B E? 83 EC\n"
+    "entry_jump entry E9 ?? ?? ?? ?? # the entry point only\n"
+    "zeros 00 00 00 00 00 00 00 00 00 00 00 00 ?0\n";
+
+/* Runs every decoder on the given bytes, formats them as text, JSON, CSV and columnar rows, and computes their MinHash signature
+ * The output is thrown away, only the sanitizers are interested in how it was made
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static const int formats[] = {RPE_FORMAT_TEXT, RPE_FORMAT_JSON, RPE_FORMAT_CSV, RPE_FORMAT_COLUMNAR};
+    RpeOptions opts;
+    OutBuf out;
+    PeFile pe;
+    uint32_t sig[SIM_HASHES];
+    size_t f;
+    static SigRules *rules;
+
+    if (rules == NULL)
+        rules = SigRulesCompile(FuzzRules, sizeof(FuzzRules) - 1, "fuzz");
+
+    memset(&opts, 0, sizeof(opts));
+    opts.fieldValues = opts.sectionInfo = opts.imports = opts.exports = opts.hashes = opts.entropy = 1;
+    opts.resources = opts.certificates = opts.functions = opts.tls = opts.debug = opts.loadConfig = 1;
+    opts.relocations = 2;
+    opts.signatures = rules;
+    opts.strings = 4;
+
+    OutInit(&out);
+    for (f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+    {
+        opts.format = formats[f];
+        if (opts.format == RPE_FORMAT_CSV)
+            CsvHeader(&out, &opts);
+
+        PeFileOpenMemory(&pe, "fuzz", data, size);
+        ReportPe(&out, &pe, &opts);
+        PeFileClose(&pe);
+        OutReset(&out);
+    }
+    OutFree(&out);
+
+    // The Rich header is only read for the signatures of the similarity index
+    PeFileOpenMemory(&pe, "fuzz", data, size);
+    PeFileMinHash(&pe, sig);
+    PeFileClose(&pe);
+    return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+
+/* Reads the whole of the given stream into a heap buffer of exactly its size,
+ * so that the address sanitizer catches reads past its end, which a memory mapping would hide
+ * It returns NULL if the stream can't be read
+ */
+static unsigned char* ReadInput(FILE *fp, size_t *size)
+{
+    unsigned char *data = NULL, *grown;
+    size_t cap = 0;
+
+    *size = 0;
+    for (;;)
+    {
+        if (*size == cap)
+        {
+            cap = cap ? cap * 2 : 65536;
+            grown = realloc(data, cap);
+            if (grown == NULL)
+            {
+                free(data);
+                return NULL;
+            }
+            data = grown;
+        }
+
+        size_t got = fread(data + *size, 1, cap - *size, fp);
+
+        if (got == 0)
+            break;
+        *size += got;
+    }
+
+    if (ferror(fp))
+    {
+        free(data);
+        return NULL;
+    }
+    grown = malloc(*size ? *size : 1);
+    if (grown != NULL)
+        memcpy(grown, data, *size);
+    free(data);
+    return grown;
+}
+
+// Runs the harness on each file given on the command line, or on the standard input
+int main(int argc, char *argv[])
+{
+    int i, rc = 0;
+
+    for (i = 1; i < argc || i == 1; i++)
+    {
+        FILE *fp = i < argc ? fopen(argv[i], "rb") : stdin;
+        unsigned char *data;
+        size_t size;
+
+        if (fp == NULL)
+        {
+            fprintf(stderr, "%s: can't open the file\n", argv[i]);
+            rc = 1;
+            continue;
+        }
+
+        data = ReadInput(fp, &size);
+        if (fp != stdin)
+            fclose(fp);
+        if (data == NULL)
+        {
+            fprintf(stderr, "%s: can't read the file\n", i < argc ? argv[i] : "-");
+            rc = 1;
+            continue;
+        }
+
+        LLVMFuzzerTestOneInput(data, size);
+        free(data);
+    }
+
+    return rc;
+}
+
+#endif
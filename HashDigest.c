@@ -0,0 +1,517 @@
+/* C-program file that contains the
+   code for the MD5, SHA-1 and SHA-256 message digests used by the hashing stage of rpe64.
+
+   Each digest is computed incrementally through an Init/Update/Final context, so that the
+   hashing stage can feed all of them from a single streaming pass over the mapped file.
+   The portable implementations work on any host, independent of its byte order.
+
+   On x86 processors with the SHA extensions (SHA-NI), the SHA-1 and SHA-256 block functions
+   use the dedicated instructions instead, which is several times faster than the portable code.
+   The choice is made once, at run time, so the same program runs on processors without them.
+ */
+
+/* Reference material used: FIPS 180-4 (Secure Hash Standard), RFC 1321 (The MD5 Message-Digest Algorithm),
+                            Intel SHA Extensions white paper
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "rpe64Header.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(HASH_NO_SHA_NI)
+#define HASH_HAVE_SHA_NI 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static uint32_t LoadBe32(const unsigned char *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint32_t LoadLe32(const unsigned char *p)
+{
+    return (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0];
+}
+
+static void StoreBe32(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+static void StoreLe32(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+/* The following function feeds the given bytes to a 64-byte block function,
+ * buffering the bytes of an incomplete block in the context until the next call
+ * All three digests use 64-byte blocks, and count the message length in bytes
+ */
+static void HashFeed(unsigned char block[64], size_t *used, uint64_t *length, void *state,
+                     void (*blocks)(void*, const unsigned char*, size_t), const void *data, size_t len)
+{
+    const unsigned char *p = data;
+
+    *length += len;
+
+    if (*used)
+    {
+        size_t take = 64 - *used < len ? 64 - *used : len;
+
+        memcpy(block + *used, p, take);
+        *used += take;
+        p += take;
+        len -= take;
+        if (*used < 64)
+            return;
+        blocks(state, block, 1);
+        *used = 0;
+    }
+
+    // Whole blocks are hashed straight from the given bytes, without being copied
+    if (len >= 64)
+    {
+        blocks(state, p, len / 64);
+        p += len & ~(size_t)63;
+        len &= 63;
+    }
+
+    memcpy(block, p, len);
+    *used = len;
+}
+
+/* Pads the last block with a 1 bit, zeros and the message length in bits,
+ * stored big-endian for SHA-1 and SHA-256 and little-endian for MD5
+ */
+static void HashPad(unsigned char block[64], size_t used, uint64_t length, void *state,
+                    void (*blocks)(void*, const unsigned char*, size_t), int bigEndian)
+{
+    uint64_t bits = length * 8;
+    int i;
+
+    block[used++] = 0x80;
+    if (used > 56)
+    {
+        memset(block + used, 0, 64 - used);
+        blocks(state, block, 1);
+        used = 0;
+    }
+    memset(block + used, 0, 56 - used);
+
+    for (i = 0; i < 8; i++)
+        block[bigEndian ? 63 - i : 56 + i] = (unsigned char)(bits >> (8 * i));
+    blocks(state, block, 1);
+}
+
+/* MD5 --
+ */
+
+static const uint32_t Md5K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static const unsigned char Md5S[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+static void Md5Blocks(void *context, const unsigned char *data, size_t count)
+{
+    uint32_t *state = context;
+
+    for (; count--; data += 64)
+    {
+        uint32_t m[16], a = state[0], b = state[1], c = state[2], d = state[3];
+        int i;
+
+        for (i = 0; i < 16; i++)
+            m[i] = LoadLe32(data + 4 * i);
+
+        for (i = 0; i < 64; i++)
+        {
+            uint32_t f, t;
+            int g;
+
+            if (i < 16)
+            {
+                f = d ^ (b & (c ^ d));
+                g = i;
+            }
+            else if (i < 32)
+            {
+                f = c ^ (d & (b ^ c));
+                g = (5 * i + 1) & 15;
+            }
+            else if (i < 48)
+            {
+                f = b ^ c ^ d;
+                g = (3 * i + 5) & 15;
+            }
+            else
+            {
+                f = c ^ (b | ~d);
+                g = (7 * i) & 15;
+            }
+
+            t = d;
+            d = c;
+            c = b;
+            b = b + ROL32(a + f + Md5K[i] + m[g], Md5S[i]);
+            a = t;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+    }
+}
+
+void Md5Init(Md5Ctx *ctx)
+{
+    static const uint32_t init[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+    memcpy(ctx->state, init, sizeof(init));
+    ctx->length = 0;
+    ctx->used = 0;
+}
+
+void Md5Update(Md5Ctx *ctx, const void *data, size_t len)
+{
+    HashFeed(ctx->block, &ctx->used, &ctx->length, ctx->state, Md5Blocks, data, len);
+}
+
+void Md5Final(Md5Ctx *ctx, unsigned char digest[16])
+{
+    int i;
+
+    HashPad(ctx->block, ctx->used, ctx->length, ctx->state, Md5Blocks, 0);
+    for (i = 0; i < 4; i++)
+        StoreLe32(digest + 4 * i, ctx->state[i]);
+}
+
+/* SHA-1 --
+ */
+
+static void Sha1BlocksPortable(void *context, const unsigned char *data, size_t count)
+{
+    uint32_t *state = context;
+
+    for (; count--; data += 64)
+    {
+        uint32_t w[80], a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        int i;
+
+        for (i = 0; i < 16; i++)
+            w[i] = LoadBe32(data + 4 * i);
+        for (; i < 80; i++)
+            w[i] = ROL32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        for (i = 0; i < 80; i++)
+        {
+            uint32_t f, k, t;
+
+            if (i < 20)
+            {
+                f = d ^ (b & (c ^ d));
+                k = 0x5a827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (d & (b | c));
+                k = 0x8f1bbcdc;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+
+            t = ROL32(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = ROL32(b, 30);
+            b = a;
+            a = t;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+/* SHA-256 --
+ */
+
+static const uint32_t Sha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static void Sha256BlocksPortable(void *context, const unsigned char *data, size_t count)
+{
+    uint32_t *state = context;
+
+    for (; count--; data += 64)
+    {
+        uint32_t w[64], a, b, c, d, e, f, g, h;
+        int i;
+
+        for (i = 0; i < 16; i++)
+            w[i] = LoadBe32(data + 4 * i);
+        for (; i < 64; i++)
+        {
+            uint32_t s0 = ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        a = state[0], b = state[1], c = state[2], d = state[3];
+        e = state[4], f = state[5], g = state[6], h = state[7];
+        for (i = 0; i < 64; i++)
+        {
+            uint32_t t1 = h + (ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25)) + (g ^ (e & (f ^ g))) + Sha256K[i] + w[i];
+            uint32_t t2 = (ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22)) + ((a & b) | (c & (a | b)));
+
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#ifdef HASH_HAVE_SHA_NI
+
+/* SHA-256 block function using the SHA-NI instructions
+ * The state is kept as the ABEF and CDGH halves that SHA256RNDS2 works on,
+ * and each group of 4 rounds extends the message schedule with SHA256MSG1/SHA256MSG2
+ */
+__attribute__((target("sha,sse4.1")))
+static void Sha256BlocksShaNi(void *context, const unsigned char *data, size_t count)
+{
+    uint32_t *state = context;
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, tmp;
+    int g;
+
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0xB1);          // CDAB
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(state + 4)), 0x1B); // EFGH
+    state0 = _mm_alignr_epi8(tmp, state1, 8);                                       // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);                                    // CDGH
+
+    for (; count--; data += 64)
+    {
+        __m128i abef = state0, cdgh = state1, w[4], msg;
+
+        for (g = 0; g < 4; g++)
+            w[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * g)), mask);
+
+        for (g = 0; g < 16; g++)
+        {
+            // From the fifth group on, the next 4 schedule words replace the oldest ones
+            if (g >= 4)
+            {
+                __m128i next = _mm_sha256msg1_epu32(w[g & 3], w[(g + 1) & 3]);
+
+                next = _mm_add_epi32(next, _mm_alignr_epi8(w[(g + 3) & 3], w[(g + 2) & 3], 4));
+                w[g & 3] = _mm_sha256msg2_epu32(next, w[(g + 3) & 3]);
+            }
+
+            msg = _mm_add_epi32(w[g & 3], _mm_loadu_si128((const __m128i *)(Sha256K + 4 * g)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);          // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);       // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);    // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);       // HGFE
+    _mm_storeu_si128((__m128i *)state, state0);
+    _mm_storeu_si128((__m128i *)(state + 4), state1);
+}
+
+/* SHA-1 block function using the SHA-NI instructions
+ * SHA1RNDS4 does 4 rounds at a time, with its immediate selecting the round function of each group of 20 rounds,
+ * and SHA1NEXTE derives the E value of the next 4 rounds from the A value before the previous 4 rounds
+ */
+__attribute__((target("sha,sse4.1")))
+static void Sha1BlocksShaNi(void *context, const unsigned char *data, size_t count)
+{
+    uint32_t *state = context;
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+    __m128i abcd, e0;
+    int g;
+
+    abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0x1B);
+    e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+
+    for (; count--; data += 64)
+    {
+        __m128i abcdSave = abcd, w[4], e, prev;
+
+        for (g = 0; g < 4; g++)
+            w[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * g)), mask);
+
+        e = _mm_add_epi32(e0, w[0]);
+        prev = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e, 0);
+
+        for (g = 1; g < 20; g++)
+        {
+            if (g >= 4)
+                w[g & 3] = _mm_sha1msg2_epu32(_mm_xor_si128(_mm_sha1msg1_epu32(w[g & 3], w[(g + 1) & 3]),
+                                                            w[(g + 2) & 3]), w[(g + 3) & 3]);
+
+            e = _mm_sha1nexte_epu32(prev, w[g & 3]);
+            prev = abcd;
+
+            // The immediate has to be a constant
+            switch (g / 5)
+            {
+                case 0:
+                    abcd = _mm_sha1rnds4_epu32(abcd, e, 0);
+                    break;
+                case 1:
+                    abcd = _mm_sha1rnds4_epu32(abcd, e, 1);
+                    break;
+                case 2:
+                    abcd = _mm_sha1rnds4_epu32(abcd, e, 2);
+                    break;
+                default:
+                    abcd = _mm_sha1rnds4_epu32(abcd, e, 3);
+                    break;
+            }
+        }
+
+        e0 = _mm_sha1nexte_epu32(prev, e0);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+    }
+
+    _mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+
+#endif
+
+// Block functions of SHA-1 and SHA-256, chosen once for the processor by HashSelect()
+static void (*Sha1Blocks)(void*, const unsigned char*, size_t) = Sha1BlocksPortable;
+static void (*Sha256Blocks)(void*, const unsigned char*, size_t) = Sha256BlocksPortable;
+static pthread_once_t HashOnce = PTHREAD_ONCE_INIT;
+
+static void HashSelect(void)
+{
+#ifdef HASH_HAVE_SHA_NI
+    unsigned int eax, ebx, ecx, edx;
+
+    // CPUID leaf 7 reports the SHA extensions in bit 29 of EBX, and leaf 1 reports SSSE3 and SSE4.1 in ECX
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1u << 29)) &&
+        __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1u << 9)) && (ecx & (1u << 19)))
+    {
+        Sha1Blocks = Sha1BlocksShaNi;
+        Sha256Blocks = Sha256BlocksShaNi;
+    }
+#endif
+}
+
+void Sha1Init(Sha1Ctx *ctx)
+{
+    static const uint32_t init[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+    pthread_once(&HashOnce, HashSelect);
+    memcpy(ctx->state, init, sizeof(init));
+    ctx->length = 0;
+    ctx->used = 0;
+}
+
+void Sha1Update(Sha1Ctx *ctx, const void *data, size_t len)
+{
+    HashFeed(ctx->block, &ctx->used, &ctx->length, ctx->state, Sha1Blocks, data, len);
+}
+
+void Sha1Final(Sha1Ctx *ctx, unsigned char digest[20])
+{
+    int i;
+
+    HashPad(ctx->block, ctx->used, ctx->length, ctx->state, Sha1Blocks, 1);
+    for (i = 0; i < 5; i++)
+        StoreBe32(digest + 4 * i, ctx->state[i]);
+}
+
+void Sha256Init(Sha256Ctx *ctx)
+{
+    static const uint32_t init[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    pthread_once(&HashOnce, HashSelect);
+    memcpy(ctx->state, init, sizeof(init));
+    ctx->length = 0;
+    ctx->used = 0;
+}
+
+void Sha256Update(Sha256Ctx *ctx, const void *data, size_t len)
+{
+    HashFeed(ctx->block, &ctx->used, &ctx->length, ctx->state, Sha256Blocks, data, len);
+}
+
+void Sha256Final(Sha256Ctx *ctx, unsigned char digest[32])
+{
+    int i;
+
+    HashPad(ctx->block, ctx->used, ctx->length, ctx->state, Sha256Blocks, 1);
+    for (i = 0; i < 8; i++)
+        StoreBe32(digest + 4 * i, ctx->state[i]);
+}
@@ -0,0 +1,268 @@
+/* C-program file that contains the
+   code for the growable output buffer that is used by every output function.
+
+   Instead of writing to the standard output directly, the output functions of rpe64
+   append their text to an output buffer, which is then written out in one go.
+   This lets the batch mode build the report of each file on a worker thread,
+   and write the complete reports out in order without interleaving them.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "rpe64Header.h"
+
+#define OUT_INITIAL_SIZE 4096       // Initial capacity of an output buffer
+
+// Initializes an empty output buffer
+void OutInit(OutBuf *out)
+{
+    out->data = NULL;
+    out->len = 0;
+    out->cap = 0;
+}
+
+// Releases the memory held by the output buffer
+void OutFree(OutBuf *out)
+{
+    free(out->data);
+    OutInit(out);
+}
+
+// Empties the output buffer while keeping its memory for reuse
+void OutReset(OutBuf *out)
+{
+    out->len = 0;
+}
+
+/* Makes room for at least the given number of additional bytes in the output buffer
+ * It returns 0 on success, otherwise it returns 1 and leaves the buffer unchanged
+ */
+int OutReserve(OutBuf *out, size_t extra)
+{
+    if (out->cap - out->len > extra)
+        return 0;
+
+    size_t cap = out->cap ? out->cap : OUT_INITIAL_SIZE;
+    while (cap - out->len <= extra)
+        cap *= 2;
+
+    char *data = realloc(out->data, cap);
+    if (data == NULL)
+        return 1;
+
+    out->data = data;
+    out->cap = cap;
+    return 0;
+}
+
+// Appends the given bytes to the output buffer
+void OutWrite(OutBuf *out, const void *bytes, size_t len)
+{
+    if (OutReserve(out, len))
+        return;
+
+    memcpy(out->data + out->len, bytes, len);
+    out->len += len;
+}
+
+// Appends a NUL-terminated string to the output buffer
+void OutPuts(OutBuf *out, const char *str)
+{
+    OutWrite(out, str, strlen(str));
+}
+
+// Appends the text produced by the given printf-style format string to the output buffer
+void OutPrintf(OutBuf *out, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(out->data ? out->data + out->len : NULL, out->cap - out->len, fmt, ap);
+    va_end(ap);
+
+    if (n < 0)
+        return;
+
+    // The text didn't fit in the remaining space, so the buffer is grown and the text is formatted again
+    if ((size_t)n >= out->cap - out->len)
+    {
+        if (OutReserve(out, (size_t)n))
+            return;
+
+        va_start(ap, fmt);
+        vsnprintf(out->data + out->len, out->cap - out->len, fmt, ap);
+        va_end(ap);
+    }
+
+    out->len += (size_t)n;
+}
+
+/* Writes the contents of the output buffer to the given stream and empties the buffer
+ * It returns 0 on success, otherwise it returns 1
+ */
+int OutFlush(OutBuf *out, FILE *stream)
+{
+    int rc = 0;
+
+    if (out->len && fwrite(out->data, 1, out->len, stream) != out->len)
+        rc = 1;
+
+    out->len = 0;
+    return rc;
+}
+
+/* The following functions append single values to the output buffer without going through
+ * a printf format string, for the structured output formats that write millions of fields
+ */
+
+// Appends a single character
+void OutChar(OutBuf *out, char c)
+{
+    if (out->cap - out->len > 1 || OutReserve(out, 1) == 0)
+        out->data[out->len++] = c;
+}
+
+// Appends an unsigned number in decimal
+void OutU64(OutBuf *out, uint64_t value)
+{
+    char digits[20];
+    int n = 0;
+
+    do
+    {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+
+    if (OutReserve(out, (size_t)n))
+        return;
+    while (n)
+        out->data[out->len++] = digits[--n];
+}
+
+/* Returns the number of bytes of the well-formed UTF-8 sequence at the start of the given string, or 0 if it isn't one,
+ * i.e. it's truncated, overlong, a surrogate, or past U+10FFFF (RFC 3629)
+ */
+static size_t Utf8Length(const unsigned char *p)
+{
+    if (p[0] >= 0xC2 && p[0] <= 0xDF)
+        return (p[1] & 0xC0) == 0x80 ? 2 : 0;
+    if (p[0] >= 0xE0 && p[0] <= 0xEF)
+    {
+        unsigned char lo = p[0] == 0xE0 ? 0xA0 : 0x80, hi = p[0] == 0xED ? 0x9F : 0xBF;
+
+        return p[1] >= lo && p[1] <= hi && (p[2] & 0xC0) == 0x80 ? 3 : 0;
+    }
+    if (p[0] >= 0xF0 && p[0] <= 0xF4)
+    {
+        unsigned char lo = p[0] == 0xF0 ? 0x90 : 0x80, hi = p[0] == 0xF4 ? 0x8F : 0xBF;
+
+        return p[1] >= lo && p[1] <= hi && (p[2] & 0xC0) == 0x80 && (p[3] & 0xC0) == 0x80 ? 4 : 0;
+    }
+    return 0;
+}
+
+/* Appends a string as a JSON string literal, escaping quotes, backslashes and control characters
+ * Bytes that aren't part of a well-formed UTF-8 sequence, as in names read from the file, are written as \u00XX,
+ * i.e. as if they were Latin-1, so that every record is valid UTF-8
+ */
+void OutJsonString(OutBuf *out, const char *str)
+{
+    static const char hex[] = "0123456789abcdef";
+    const unsigned char *p;
+    size_t len;
+
+    OutChar(out, '"');
+    for (p = (const unsigned char *)str; *p; p++)
+    {
+        if (*p == '"' || *p == '\\')
+        {
+            OutChar(out, '\\');
+            OutChar(out, (char)*p);
+        }
+        else if (*p < 0x20 || (*p >= 0x80 && (len = Utf8Length(p)) == 0))
+        {
+            char esc[6] = {'\\', 'u', '0', '0', hex[*p >> 4], hex[*p & 15]};
+            OutWrite(out, esc, sizeof(esc));
+        }
+        else if (*p >= 0x80)
+        {
+            OutWrite(out, p, len);
+            p += len - 1;
+        }
+        else
+            OutChar(out, (char)*p);
+    }
+    OutChar(out, '"');
+}
+
+// Appends a string as a CSV field, quoting it if it contains a separator, a quote or a line break
+void OutCsvString(OutBuf *out, const char *str)
+{
+    const char *p;
+
+    if (strpbrk(str, ",\"\r\n") == NULL)
+    {
+        OutPuts(out, str);
+        return;
+    }
+
+    OutChar(out, '"');
+    for (p = str; *p; p++)
+    {
+        if (*p == '"')
+            OutChar(out, '"');
+        OutChar(out, *p);
+    }
+    OutChar(out, '"');
+}
+
+// Appends the given bytes as lowercase hexadecimal digits, as digests are usually written
+void OutHex(OutBuf *out, const unsigned char *bytes, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t i;
+
+    if (OutReserve(out, 2 * len))
+        return;
+    for (i = 0; i < len; i++)
+    {
+        out->data[out->len++] = hex[bytes[i] >> 4];
+        out->data[out->len++] = hex[bytes[i] & 15];
+    }
+}
+
+/* Appends a number with 4 decimal places, with the same digits as "%.4f"
+ * The number is scaled by 10000 and rounded to an integer, whose digits are written like OutU64() does.
+ * The scaling is off by less than 1e-7 below 100000, so only the numbers within 1e-6 of a tie between
+ * two results, and those that are negative, too large or not numbers, go through printf
+ */
+void OutFixed4(OutBuf *out, double value)
+{
+    double scaled = value * 10000.0, frac;
+    uint64_t q;
+    char digits[4];
+    int n;
+
+    if (!(scaled >= 0 && scaled < 1e9))
+    {
+        OutPrintf(out, "%.4f", value);
+        return;
+    }
+    q = (uint64_t)scaled;
+    frac = scaled - (double)q;
+    if (frac > 0.5 - 1e-6 && frac < 0.5 + 1e-6)
+    {
+        OutPrintf(out, "%.4f", value);
+        return;
+    }
+    q += frac > 0.5;
+
+    OutU64(out, q / 10000);
+    OutChar(out, '.');
+    for (n = 3, q %= 10000; n >= 0; n--, q /= 10)
+        digits[n] = (char)('0' + q % 10);
+    OutWrite(out, digits, 4);
+}
@@ -0,0 +1,186 @@
+/* C-program file that contains the
+   code for the verification of the CheckSum field of the Image Optional Header.
+
+   The PE checksum is the one's complement sum of the file as 16-bit little-endian words, with the
+   CheckSum field itself taken as 0 and the carries folded back into the low 16 bits, plus the size of the file.
+   As the end-around carries can be folded in at any time, the words are summed into wide accumulators,
+   and the carries are only folded in once at the end, so the sum is a plain vector addition over the file.
+   With AVX2, 16 words are added per instruction into 32-bit lanes, which are widened to 64 bits
+   before they could overflow, so the checksum of a large file runs at the speed of memory.
+   The choice of the AVX2 kernel is made once, at run time, and x86-64 processors use SSE2 otherwise.
+ */
+
+/* Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#optional-header-windows-specific-fields-image-only
+                            RFC 1071 (Computing the Internet Checksum), for the deferred carries
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "rpe64Header.h"
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(CHECKSUM_NO_SIMD)
+#define CHECKSUM_HAVE_SIMD 1
+#include <immintrin.h>
+#endif
+
+#define CHECKSUM_FIELD_OFFSET 64        // Offset of the CheckSum field within the Image Optional Header
+#define CHECKSUM_FLUSH_WORDS 32768      // Pairs of words added into a 32-bit lane before it's widened
+
+/* Portable kernel, which adds 4 words at a time from a 64-bit load into two 32-bit lanes of a 64-bit accumulator
+ * Each lane takes at most 2 * 0xFFFF per load, so the lanes are widened every CHECKSUM_FLUSH_WORDS loads
+ */
+static uint64_t ChecksumPortable(const unsigned char *data, size_t len)
+{
+    uint64_t sum = 0, lanes = 0, x;
+    size_t i = 0, n = 0;
+
+    for (; i + 8 <= len; i += 8)
+    {
+        x = ReadLe64(data + i);
+        lanes += (x & 0x0000FFFF0000FFFFULL) + (x >> 16 & 0x0000FFFF0000FFFFULL);
+        if (++n == CHECKSUM_FLUSH_WORDS)
+        {
+            sum += (lanes & 0xFFFFFFFF) + (lanes >> 32);
+            lanes = 0;
+            n = 0;
+        }
+    }
+    sum += (lanes & 0xFFFFFFFF) + (lanes >> 32);
+
+    for (; i + 2 <= len; i += 2)
+        sum += ReadLe16(data + i);
+    if (i < len)
+        sum += data[i];     // A last odd byte is the low byte of a word whose high byte is 0
+    return sum;
+}
+
+#ifdef CHECKSUM_HAVE_SIMD
+
+// Adds the four 32-bit lanes of the given vector into the 64-bit sum
+static inline uint64_t ChecksumWiden128(__m128i lanes)
+{
+    uint32_t v[4];
+
+    _mm_storeu_si128((__m128i*)v, lanes);
+    return (uint64_t)v[0] + v[1] + v[2] + v[3];
+}
+
+// SSE2 kernel, which is part of every x86-64 processor, adding 8 words per load into four 32-bit lanes
+static uint64_t ChecksumSse2(const unsigned char *data, size_t len)
+{
+    const __m128i low = _mm_set1_epi32(0xFFFF);
+    __m128i lanes = _mm_setzero_si128();
+    uint64_t sum = 0;
+    size_t i = 0, n = 0;
+
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+
+        lanes = _mm_add_epi32(lanes, _mm_add_epi32(_mm_and_si128(v, low), _mm_srli_epi32(v, 16)));
+        if (++n == CHECKSUM_FLUSH_WORDS)
+        {
+            sum += ChecksumWiden128(lanes);
+            lanes = _mm_setzero_si128();
+            n = 0;
+        }
+    }
+    sum += ChecksumWiden128(lanes);
+    return sum + ChecksumPortable(data + i, len - i);
+}
+
+/* AVX2 kernel, adding 16 words per load into eight 32-bit lanes
+ * Two loads are summed per iteration into separate accumulators, so that the additions of one don't wait on the other
+ */
+__attribute__((target("avx2")))
+static uint64_t ChecksumAvx2(const unsigned char *data, size_t len)
+{
+    const __m256i low = _mm256_set1_epi32(0xFFFF);
+    __m256i a = _mm256_setzero_si256(), b = _mm256_setzero_si256();
+    uint64_t sum = 0;
+    size_t i = 0, n = 0;
+
+    for (; i + 64 <= len; i += 64)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i w = _mm256_loadu_si256((const __m256i*)(data + i + 32));
+
+        a = _mm256_add_epi32(a, _mm256_add_epi32(_mm256_and_si256(v, low), _mm256_srli_epi32(v, 16)));
+        b = _mm256_add_epi32(b, _mm256_add_epi32(_mm256_and_si256(w, low), _mm256_srli_epi32(w, 16)));
+        if (++n == CHECKSUM_FLUSH_WORDS)
+        {
+            __m256i ab = _mm256_add_epi64(_mm256_unpacklo_epi32(a, _mm256_setzero_si256()), _mm256_unpackhi_epi32(a, _mm256_setzero_si256()));
+
+            ab = _mm256_add_epi64(ab, _mm256_add_epi64(_mm256_unpacklo_epi32(b, _mm256_setzero_si256()), _mm256_unpackhi_epi32(b, _mm256_setzero_si256())));
+            sum += (uint64_t)_mm256_extract_epi64(ab, 0) + (uint64_t)_mm256_extract_epi64(ab, 1) +
+                   (uint64_t)_mm256_extract_epi64(ab, 2) + (uint64_t)_mm256_extract_epi64(ab, 3);
+            a = _mm256_setzero_si256();
+            b = _mm256_setzero_si256();
+            n = 0;
+        }
+    }
+    sum += ChecksumWiden128(_mm256_castsi256_si128(a)) + ChecksumWiden128(_mm256_extracti128_si256(a, 1));
+    sum += ChecksumWiden128(_mm256_castsi256_si128(b)) + ChecksumWiden128(_mm256_extracti128_si256(b, 1));
+    return sum + ChecksumSse2(data + i, len - i);
+}
+
+#endif
+
+// Kernel of the checksum, chosen once for the processor by ChecksumSelect()
+#ifdef CHECKSUM_HAVE_SIMD
+static uint64_t (*ChecksumKernel)(const unsigned char*, size_t) = ChecksumSse2;
+#else
+static uint64_t (*ChecksumKernel)(const unsigned char*, size_t) = ChecksumPortable;
+#endif
+static pthread_once_t ChecksumOnce = PTHREAD_ONCE_INIT;
+
+static void ChecksumSelect(void)
+{
+#ifdef CHECKSUM_HAVE_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        ChecksumKernel = ChecksumAvx2;
+#endif
+}
+
+/* This function returns the sum of the given bytes as 16-bit little-endian words, without folding any carries
+ * The bytes have to start at an even offset of the file, so that they pair up into the same words as in the file
+ */
+uint64_t PeChecksumAdd(const unsigned char *data, size_t len)
+{
+    pthread_once(&ChecksumOnce, ChecksumSelect);
+    return ChecksumKernel(data, len);
+}
+
+/* This function turns the sum of every word of the file into the PE checksum, and stores it into the model:
+ * the bytes of the CheckSum field are taken out of the sum, whatever their alignment, the carries are folded
+ * into the low 16 bits, and the size of the file is added
+ */
+void PeChecksumFinish(PeFile *pe, uint64_t sum)
+{
+    uint64_t field = (uint64_t)pe->dos.e_lfanew + PE_NT_FIXED_SIZE + CHECKSUM_FIELD_OFFSET;
+    int i;
+
+    for (i = 0; i < 4; i++)
+        if (field + i < pe->image.size)
+            sum -= (uint64_t)pe->image.data[field + i] << ((field + i) & 1 ? 8 : 0);
+
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+
+    pe->checksum = (uint32_t)(sum + pe->image.size);
+    pe->parsed |= PE_PARSED_CHECKSUM;
+}
+
+/* This function computes the PE checksum of the image file into the model, unless PeFileHashes() already did in its pass
+ * It returns 0 on success, or 1 if the headers of the file couldn't be decoded
+ */
+int PeFileChecksum(PeFile *pe)
+{
+    if (!PE_HEADERS_VALID(pe))
+        return 1;
+    if (!(pe->parsed & PE_PARSED_CHECKSUM))
+        PeChecksumFinish(pe, PeChecksumAdd(pe->image.data, pe->image.size));
+    return 0;
+}
@@ -0,0 +1,504 @@
+/* C-program file that contains the
+   field descriptor tables of the headers of the image file, based on the Microsoft Documentation.
+
+   Every field of the DOS Header, of the Image File Header, of the Image Optional Header and of
+   a Section Table entry is described once, by its name, its offset and width within the header
+   (which differ between PE32 and PE32+ images for some fields of the Image Optional Header),
+   where it's stored in the model, and how its value is shown. The headers are decoded by one
+   generic loop over these tables (PeDecodeFields()), and the text output and the JSON and CSV
+   records walk the same tables, so adding a field is a single table entry.
+
+   Flag fields are named through bitmask tables, in which every set flag is named rather than
+   only the first one that matches, and machine types through a dense table indexed by a hash
+   of the machine type, which finds the name without comparing it against every known type.
+ */
+
+/* Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#machine-types
+   https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#characteristics
+   https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#dll-characteristics
+   https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#load-configuration-layout
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "rpe64Header.h"
+
+#define COUNT(table) (sizeof(table) / sizeof((table)[0]))
+
+/* Entry of a descriptor table of a field that has the same offset and width in PE32 and PE32+ images
+ * FIELD2 and FLAGS2 are used for the fields of the Image Optional Header and the Load Configuration Structure
+ * whose offset or width differ
+ */
+#define FIELD(type, field, label, offset, width, show) \
+    { #field, label, {offset, offset}, {width, width}, offsetof(type, field), sizeof(((type*)0)->field), show, NULL, 0 }
+#define FIELD2(type, field, label, offset32, width32, offset64, width64, show) \
+    { #field, label, {offset32, offset64}, {width32, width64}, offsetof(type, field), sizeof(((type*)0)->field), show, NULL, 0 }
+#define FLAGS(type, field, label, offset, width, show, flags) \
+    { #field, label, {offset, offset}, {width, width}, offsetof(type, field), sizeof(((type*)0)->field), show, flags, COUNT(flags) }
+#define FLAGS2(type, field, label, offset32, width32, offset64, width64, show, flags) \
+    { #field, label, {offset32, offset64}, {width32, width64}, offsetof(type, field), sizeof(((type*)0)->field), show, flags, COUNT(flags) }
+
+/* Slot of a machine type within the dense machine table
+ * The multiplier was chosen so that every known machine type gets a slot of its own
+ */
+#define MACHINE_SLOT(machine) ((((machine) * 0x3F1u) & 0xFFFF) >> 10)
+
+// Names of the machine types, each in the slot given by MACHINE_SLOT()
+static const struct
+{
+    uint16_t machine;
+    const char *name;
+} MachineTable[64] = {
+    [MACHINE_SLOT(0x0)] = {0x0, "IMAGE_FILE_MACHINE_UNKNOWN"},          // Applicable to any machine type
+    [MACHINE_SLOT(0x184)] = {0x184, "IMAGE_FILE_MACHINE_ALPHA"},        // Alpha AXP, 32-bit address space
+    [MACHINE_SLOT(0x284)] = {0x284, "IMAGE_FILE_MACHINE_ALPHA64"},      // Alpha 64, 64-bit address space (also AXP64)
+    [MACHINE_SLOT(0x1D3)] = {0x1D3, "IMAGE_FILE_MACHINE_AM33"},         // Matsushita AM33
+    [MACHINE_SLOT(0x8664)] = {0x8664, "IMAGE_FILE_MACHINE_AMD64"},      // 64-bit Intel/AMD microprocessors
+    [MACHINE_SLOT(0x1C0)] = {0x1C0, "IMAGE_FILE_MACHINE_ARM"},          // ARM little endian
+    [MACHINE_SLOT(0xAA64)] = {0xAA64, "IMAGE_FILE_MACHINE_ARM64"},      // ARM64 little endian
+    [MACHINE_SLOT(0xA641)] = {0xA641, "IMAGE_FILE_MACHINE_ARM64EC"},    // ARM64 code that interoperates with x64 code
+    [MACHINE_SLOT(0xA64E)] = {0xA64E, "IMAGE_FILE_MACHINE_ARM64X"},     // ARM64 and ARM64EC code in one image
+    [MACHINE_SLOT(0x1C4)] = {0x1C4, "IMAGE_FILE_MACHINE_ARMNT"},        // ARM Thumb-2 little endian
+    [MACHINE_SLOT(0x3A64)] = {0x3A64, "IMAGE_FILE_MACHINE_CHPE_X86"},   // x86 code compiled for ARM64 hosts
+    [MACHINE_SLOT(0xEBC)] = {0xEBC, "IMAGE_FILE_MACHINE_EBC"},          // EFI byte code
+    [MACHINE_SLOT(0x14C)] = {0x14C, "IMAGE_FILE_MACHINE_I386"},         // Intel 386 or later processors, 32-bit
+    [MACHINE_SLOT(0x200)] = {0x200, "IMAGE_FILE_MACHINE_IA64"},         // Intel Itanium processor family
+    [MACHINE_SLOT(0x6232)] = {0x6232, "IMAGE_FILE_MACHINE_LOONGARCH32"},// LoongArch 32-bit processor family
+    [MACHINE_SLOT(0x6264)] = {0x6264, "IMAGE_FILE_MACHINE_LOONGARCH64"},// LoongArch 64-bit processor family
+    [MACHINE_SLOT(0x9041)] = {0x9041, "IMAGE_FILE_MACHINE_M32R"},       // Mitsubishi M32R little endian
+    [MACHINE_SLOT(0x266)] = {0x266, "IMAGE_FILE_MACHINE_MIPS16"},       // MIPS16
+    [MACHINE_SLOT(0x366)] = {0x366, "IMAGE_FILE_MACHINE_MIPSFPU"},      // MIPS with FPU
+    [MACHINE_SLOT(0x466)] = {0x466, "IMAGE_FILE_MACHINE_MIPSFPU16"},    // MIPS16 with FPU
+    [MACHINE_SLOT(0x1F0)] = {0x1F0, "IMAGE_FILE_MACHINE_POWERPC"},      // Power PC little endian
+    [MACHINE_SLOT(0x1F1)] = {0x1F1, "IMAGE_FILE_MACHINE_POWERPCFP"},    // Power PC with floating point support
+    [MACHINE_SLOT(0x166)] = {0x166, "IMAGE_FILE_MACHINE_R4000"},        // MIPS little endian
+    [MACHINE_SLOT(0x5032)] = {0x5032, "IMAGE_FILE_MACHINE_RISCV32"},    // RISC-V 32-bit address space
+    [MACHINE_SLOT(0x5064)] = {0x5064, "IMAGE_FILE_MACHINE_RISCV64"},    // RISC-V 64-bit address space
+    [MACHINE_SLOT(0x5128)] = {0x5128, "IMAGE_FILE_MACHINE_RISCV128"},   // RISC-V 128-bit address space
+    [MACHINE_SLOT(0x1A2)] = {0x1A2, "IMAGE_FILE_MACHINE_SH3"},          // Hitachi SH3
+    [MACHINE_SLOT(0x1A3)] = {0x1A3, "IMAGE_FILE_MACHINE_SH3DSP"},       // Hitachi SH3 DSP
+    [MACHINE_SLOT(0x1A6)] = {0x1A6, "IMAGE_FILE_MACHINE_SH4"},          // Hitachi SH4
+    [MACHINE_SLOT(0x1A8)] = {0x1A8, "IMAGE_FILE_MACHINE_SH5"},          // Hitachi SH5
+    [MACHINE_SLOT(0x1C2)] = {0x1C2, "IMAGE_FILE_MACHINE_THUMB"},        // Thumb
+    [MACHINE_SLOT(0x169)] = {0x169, "IMAGE_FILE_MACHINE_WCEMIPSV2"},    // MIPS little-endian WCE v2
+};
+
+// Characteristics flags of the Image File Header
+static const PeFlag CoffFlags[] = {
+    {0x0001, 0x0001, "IMAGE_FILE_RELOCS_STRIPPED"},         // No base relocations, so the image must be loaded at its preferred base address
+    {0x0002, 0x0002, "IMAGE_FILE_EXECUTABLE_IMAGE"},        // The image file is valid and can be run
+    {0x0004, 0x0004, "IMAGE_FILE_LINE_NUMS_STRIPPED"},      // COFF line numbers have been removed (deprecated)
+    {0x0008, 0x0008, "IMAGE_FILE_LOCAL_SYMS_STRIPPED"},     // COFF symbols for local symbols have been removed (deprecated)
+    {0x0010, 0x0010, "IMAGE_FILE_AGGRESSIVE_WS_TRIM"},      // Aggressively trim working set (obsolete)
+    {0x0020, 0x0020, "IMAGE_FILE_LARGE_ADDRESS_AWARE"},     // The application can handle addresses above 2 GB
+    {0x0080, 0x0080, "IMAGE_FILE_BYTES_REVERSED_LO"},       // Little endian (deprecated)
+    {0x0100, 0x0100, "IMAGE_FILE_32BIT_MACHINE"},           // The machine is based on a 32-bit word architecture
+    {0x0200, 0x0200, "IMAGE_FILE_DEBUG_STRIPPED"},          // Debugging information has been removed from the image file
+    {0x0400, 0x0400, "IMAGE_FILE_REMOVABLE_RUN_FROM_SWAP"}, // Run from the swap file if the image is on removable media
+    {0x0800, 0x0800, "IMAGE_FILE_NET_RUN_FROM_SWAP"},       // Run from the swap file if the image is on network media
+    {0x1000, 0x1000, "IMAGE_FILE_SYSTEM"},                  // The image file is a system file, not a user program
+    {0x2000, 0x2000, "IMAGE_FILE_DLL"},                     // The image file is a dynamic-link library (DLL)
+    {0x4000, 0x4000, "IMAGE_FILE_UP_SYSTEM_ONLY"},          // Run only on a uniprocessor machine
+    {0x8000, 0x8000, "IMAGE_FILE_BYTES_REVERSED_HI"},       // Big endian (deprecated)
+};
+
+// Magic numbers of the Image Optional Header
+static const PeFlag OptionalMagics[] = {
+    {0xFFFF, PE32_MAGIC, "PE32"},
+    {0xFFFF, PE32PLUS_MAGIC, "PE32+"},
+    {0xFFFF, 0x107, "ROM"},
+};
+
+// Subsystems that are required to run the image file
+static const PeFlag Subsystems[] = {
+    {0xFFFF, 0, "IMAGE_SUBSYSTEM_UNKNOWN"},
+    {0xFFFF, 1, "IMAGE_SUBSYSTEM_NATIVE"},                  // Device drivers and native Windows processes
+    {0xFFFF, 2, "IMAGE_SUBSYSTEM_WINDOWS_GUI"},
+    {0xFFFF, 3, "IMAGE_SUBSYSTEM_WINDOWS_CUI"},
+    {0xFFFF, 5, "IMAGE_SUBSYSTEM_OS2_CUI"},
+    {0xFFFF, 7, "IMAGE_SUBSYSTEM_POSIX_CUI"},
+    {0xFFFF, 8, "IMAGE_SUBSYSTEM_NATIVE_WINDOWS"},
+    {0xFFFF, 9, "IMAGE_SUBSYSTEM_WINDOWS_CE_GUI"},
+    {0xFFFF, 10, "IMAGE_SUBSYSTEM_EFI_APPLICATION"},
+    {0xFFFF, 11, "IMAGE_SUBSYSTEM_EFI_BOOT_SERVICE_DRIVER"},
+    {0xFFFF, 12, "IMAGE_SUBSYSTEM_EFI_RUNTIME_DRIVER"},
+    {0xFFFF, 13, "IMAGE_SUBSYSTEM_EFI_ROM"},
+    {0xFFFF, 14, "IMAGE_SUBSYSTEM_XBOX"},
+    {0xFFFF, 16, "IMAGE_SUBSYSTEM_WINDOWS_BOOT_APPLICATION"},
+};
+
+// DLL Characteristics flags of the Image Optional Header
+static const PeFlag DllFlags[] = {
+    {0x0020, 0x0020, "IMAGE_DLLCHARACTERISTICS_HIGH_ENTROPY_VA"},       // Can handle a high entropy 64-bit virtual address space
+    {0x0040, 0x0040, "IMAGE_DLLCHARACTERISTICS_DYNAMIC_BASE"},          // Can be relocated at load time
+    {0x0080, 0x0080, "IMAGE_DLLCHARACTERISTICS_FORCE_INTEGRITY"},       // Code integrity checks are enforced
+    {0x0100, 0x0100, "IMAGE_DLLCHARACTERISTICS_NX_COMPAT"},             // Compatible with data execution prevention
+    {0x0200, 0x0200, "IMAGE_DLLCHARACTERISTICS_NO_ISOLATION"},          // Isolation aware, but shouldn't be isolated
+    {0x0400, 0x0400, "IMAGE_DLLCHARACTERISTICS_NO_SEH"},                // Doesn't use structured exception handling
+    {0x0800, 0x0800, "IMAGE_DLLCHARACTERISTICS_NO_BIND"},               // Shouldn't be bound
+    {0x1000, 0x1000, "IMAGE_DLLCHARACTERISTICS_APPCONTAINER"},          // Must be executed in an AppContainer
+    {0x2000, 0x2000, "IMAGE_DLLCHARACTERISTICS_WDM_DRIVER"},            // A Windows-Driver-Model (WDM) driver
+    {0x4000, 0x4000, "IMAGE_DLLCHARACTERISTICS_GUARD_CF"},              // Supports Control Flow Guard
+    {0x8000, 0x8000, "IMAGE_DLLCHARACTERISTICS_TERMINAL_SERVER_AWARE"}, // Terminal Server aware
+};
+
+/* Characteristics flags of a section
+ * Bits 20 to 23 hold the alignment of the section's data as a 4-bit value rather than as flags,
+ * which is only meaningful in object files
+ */
+static const PeFlag SectionFlags[] = {
+    {0x00000008, 0x00000008, "IMAGE_SCN_TYPE_NO_PAD"},              // Obsolete flag, replaced by IMAGE_SCN_ALIGN_1BYTES
+    {0x00000020, 0x00000020, "IMAGE_SCN_CNT_CODE"},                 // The section contains executable code
+    {0x00000040, 0x00000040, "IMAGE_SCN_CNT_INITIALIZED_DATA"},     // The section contains initialized data
+    {0x00000080, 0x00000080, "IMAGE_SCN_CNT_UNINITIALIZED_DATA"},   // The section contains uninitialized data
+    {0x00000200, 0x00000200, "IMAGE_SCN_LNK_INFO"},                 // The section contains comments or other information (object files only)
+    {0x00000800, 0x00000800, "IMAGE_SCN_LNK_REMOVE"},               // The section won't become part of the image (object files only)
+    {0x00001000, 0x00001000, "IMAGE_SCN_LNK_COMDAT"},               // The section contains COMDAT data (object files only)
+    {0x00008000, 0x00008000, "IMAGE_SCN_GPREL"},                    // The section contains data referenced through the global pointer
+    {0x00F00000, 0x00100000, "IMAGE_SCN_ALIGN_1BYTES"},
+    {0x00F00000, 0x00200000, "IMAGE_SCN_ALIGN_2BYTES"},
+    {0x00F00000, 0x00300000, "IMAGE_SCN_ALIGN_4BYTES"},
+    {0x00F00000, 0x00400000, "IMAGE_SCN_ALIGN_8BYTES"},
+    {0x00F00000, 0x00500000, "IMAGE_SCN_ALIGN_16BYTES"},
+    {0x00F00000, 0x00600000, "IMAGE_SCN_ALIGN_32BYTES"},
+    {0x00F00000, 0x00700000, "IMAGE_SCN_ALIGN_64BYTES"},
+    {0x00F00000, 0x00800000, "IMAGE_SCN_ALIGN_128BYTES"},
+    {0x00F00000, 0x00900000, "IMAGE_SCN_ALIGN_256BYTES"},
+    {0x00F00000, 0x00A00000, "IMAGE_SCN_ALIGN_512BYTES"},
+    {0x00F00000, 0x00B00000, "IMAGE_SCN_ALIGN_1024BYTES"},
+    {0x00F00000, 0x00C00000, "IMAGE_SCN_ALIGN_2048BYTES"},
+    {0x00F00000, 0x00D00000, "IMAGE_SCN_ALIGN_4096BYTES"},
+    {0x00F00000, 0x00E00000, "IMAGE_SCN_ALIGN_8192BYTES"},
+    {0x01000000, 0x01000000, "IMAGE_SCN_LNK_NRELOC_OVFL"},          // The section contains extended relocations
+    {0x02000000, 0x02000000, "IMAGE_SCN_MEM_DISCARDABLE"},          // The section can be discarded as needed
+    {0x04000000, 0x04000000, "IMAGE_SCN_MEM_NOT_CACHED"},           // The section can't be cached
+    {0x08000000, 0x08000000, "IMAGE_SCN_MEM_NOT_PAGED"},            // The section isn't pageable
+    {0x10000000, 0x10000000, "IMAGE_SCN_MEM_SHARED"},               // The section can be shared in memory
+    {0x20000000, 0x20000000, "IMAGE_SCN_MEM_EXECUTE"},              // The section can be executed as code
+    {0x40000000, 0x40000000, "IMAGE_SCN_MEM_READ"},                 // The section can be read
+    {0x80000000, 0x80000000, "IMAGE_SCN_MEM_WRITE"},                // The section can be written to
+};
+
+// GuardFlags of the Load Configuration Structure, whose high 4 bits are the stride of the CFG function table rather than flags
+static const PeFlag GuardFlags[] = {
+    {0x00000100, 0x00000100, "IMAGE_GUARD_CF_INSTRUMENTED"},                    // Control Flow Guard checks and support
+    {0x00000200, 0x00000200, "IMAGE_GUARD_CFW_INSTRUMENTED"},                   // CFG checks of writes
+    {0x00000400, 0x00000400, "IMAGE_GUARD_CF_FUNCTION_TABLE_PRESENT"},          // Has the table of valid call targets
+    {0x00000800, 0x00000800, "IMAGE_GUARD_SECURITY_COOKIE_UNUSED"},             // Doesn't use the /GS security cookie
+    {0x00001000, 0x00001000, "IMAGE_GUARD_PROTECT_DELAYLOAD_IAT"},              // The Delay-load IAT is read-only
+    {0x00002000, 0x00002000, "IMAGE_GUARD_DELAYLOAD_IAT_IN_ITS_OWN_SECTION"},
+    {0x00004000, 0x00004000, "IMAGE_GUARD_CF_EXPORT_SUPPRESSION_INFO_PRESENT"},
+    {0x00008000, 0x00008000, "IMAGE_GUARD_CF_ENABLE_EXPORT_SUPPRESSION"},
+    {0x00010000, 0x00010000, "IMAGE_GUARD_CF_LONGJUMP_TABLE_PRESENT"},          // Has the table of valid longjmp targets
+    {0x00020000, 0x00020000, "IMAGE_GUARD_RF_INSTRUMENTED"},                    // Return Flow Guard instrumentation
+    {0x00040000, 0x00040000, "IMAGE_GUARD_RF_ENABLE"},
+    {0x00080000, 0x00080000, "IMAGE_GUARD_RF_STRICT"},
+    {0x00100000, 0x00100000, "IMAGE_GUARD_RETPOLINE_PRESENT"},                  // Built with retpoline support
+    {0x00400000, 0x00400000, "IMAGE_GUARD_EH_CONTINUATION_TABLE_PRESENT"},      // Has the table of valid exception continuations, for CET
+    {0x00800000, 0x00800000, "IMAGE_GUARD_XFG_ENABLED"},                        // eXtended Flow Guard, with type-based call checks
+    {0x01000000, 0x01000000, "IMAGE_GUARD_CASTGUARD_PRESENT"},
+    {0x02000000, 0x02000000, "IMAGE_GUARD_MEMCPY_PRESENT"},
+};
+
+// Important fields of the DOS Header
+static const PeField DosFields[] = {
+    FIELD(PeDos, e_magic, "Magic Number", 0, 2, PE_SHOW_CHARS),                         // 'MZ' magic number
+    FIELD(PeDos, e_lfanew, "PE File Header offset(e_lfanew)", 60, 4, PE_SHOW_HEX),      // File offset of the PE signature
+};
+
+// PE signature and Image File Header, at offsets from the start of the signature
+static const PeField CoffFields[] = {
+    FIELD(PeCoff, Signature, "Signature", 0, 4, PE_SHOW_CHARS),                         // 'PE\0\0', which identifies the file as a PE image file
+    FIELD(PeCoff, Machine, "Machine", 4, 2, PE_SHOW_MACHINE),                           // Type of the target machine
+    FIELD(PeCoff, NumberOfSections, "Number of Sections", 6, 2, PE_SHOW_DEC),           // Size of the Section Table
+    FIELD(PeCoff, TimeDateStamp, "Date/time stamp", 8, 4, PE_SHOW_DEC),                 // Seconds since 00:00 January 1, 1970 when the file was created
+    FIELD(PeCoff, PointerToSymbolTable, "Symbol Table Offset", 12, 4, PE_SHOW_HEX),     // File offset of the COFF symbol table, 0 if there's none
+    FIELD(PeCoff, NumberOfSymbols, "Number of Symbols", 16, 4, PE_SHOW_DEC),
+    FIELD(PeCoff, SizeOfOptionalHeader, "Size of Optional Header", 20, 2, PE_SHOW_BYTES),
+    FLAGS(PeCoff, Characteristics, "Characteristics", 22, 2, PE_SHOW_FLAGS, CoffFlags), // Attributes of the image file
+};
+
+/* Standard and Windows-specific fields of the Image Optional Header, up to the data directories
+ * BaseOfData is only present in PE32 images, and the fields from ImageBase on are moved or widened in PE32+ images
+ * Win32VersionValue and LoaderFlags are reserved and always 0, so they're left out of the text output
+ */
+static const PeField OptionalFields[] = {
+    FLAGS(PeOptional, Magic, "Magic Number", 0, 2, PE_SHOW_ENUM, OptionalMagics),
+    FIELD(PeOptional, MajorLinkerVersion, "Major Linker Version", 2, 1, PE_SHOW_DEC),
+    FIELD(PeOptional, MinorLinkerVersion, "Minor Linker Version", 3, 1, PE_SHOW_DEC),
+    FIELD(PeOptional, SizeOfCode, "Size of .text section", 4, 4, PE_SHOW_BYTES),
+    FIELD(PeOptional, SizeOfInitializedData, "Size of .data section", 8, 4, PE_SHOW_BYTES),
+    FIELD(PeOptional, SizeOfUninitializedData, "Size of .bss section", 12, 4, PE_SHOW_BYTES),
+    FIELD(PeOptional, AddressOfEntryPoint, "Address of Entrypoint", 16, 4, PE_SHOW_HEX),    // 0 if there's no entry point, as in most DLLs
+    FIELD(PeOptional, BaseOfCode, "Address of .text section", 20, 4, PE_SHOW_HEX),
+    FIELD2(PeOptional, BaseOfData, "Address of .data section", 24, 4, 0, 0, PE_SHOW_HEX),
+    FIELD2(PeOptional, ImageBase, "ImageBase", 28, 4, 24, 8, PE_SHOW_HEX),                 // Preferred address of the image when loaded into memory
+    FIELD(PeOptional, SectionAlignment, "Section Alignment", 32, 4, PE_SHOW_DEC),
+    FIELD(PeOptional, FileAlignment, "Alignment Factor", 36, 4, PE_SHOW_DEC),
+    FIELD(PeOptional, MajorOperatingSystemVersion, "Major Version of Required OS", 40, 2, PE_SHOW_DEC),
+    FIELD(PeOptional, MinorOperatingSystemVersion, "Minor Version of Required OS", 42, 2, PE_SHOW_DEC),
+    FIELD(PeOptional, MajorImageVersion, "Major Version of Image", 44, 2, PE_SHOW_DEC),
+    FIELD(PeOptional, MinorImageVersion, "Minor Version of Image", 46, 2, PE_SHOW_DEC),
+    FIELD(PeOptional, MajorSubsystemVersion, "Major version of Subsystem", 48, 2, PE_SHOW_DEC),
+    FIELD(PeOptional, MinorSubsystemVersion, "Minor version of the Subsystem", 50, 2, PE_SHOW_DEC),
+    FIELD(PeOptional, Win32VersionValue, NULL, 52, 4, PE_SHOW_DEC),
+    FIELD(PeOptional, SizeOfImage, "Size of the image file", 56, 4, PE_SHOW_BYTES),        // Size of the image in memory, including all headers
+    FIELD(PeOptional, SizeOfHeaders, "Size of the headers", 60, 4, PE_SHOW_BYTES),         // Size of the headers, rounded up to FileAlignment
+    FIELD(PeOptional, CheckSum, "Checksum", 64, 4, PE_SHOW_HEX),
+    FLAGS(PeOptional, Subsystem, "Subsystem", 68, 2, PE_SHOW_ENUM, Subsystems),
+    FLAGS(PeOptional, DllCharacteristics, "DLL Characteristics", 70, 2, PE_SHOW_FLAGS, DllFlags),
+    FIELD2(PeOptional, SizeOfStackReserve, "Size of stack space that is to be reserved", 72, 4, 72, 8, PE_SHOW_BYTES),
+    FIELD2(PeOptional, SizeOfStackCommit, "Size of stack space that is to be committed", 76, 4, 80, 8, PE_SHOW_BYTES),
+    FIELD2(PeOptional, SizeOfHeapReserve, "Size of heap space that is to be reserved", 80, 4, 88, 8, PE_SHOW_BYTES),
+    FIELD2(PeOptional, SizeOfHeapCommit, "Size of heap space that is to be committed", 84, 4, 96, 8, PE_SHOW_BYTES),
+    FIELD2(PeOptional, LoaderFlags, NULL, 88, 4, 104, 4, PE_SHOW_HEX),
+    FIELD2(PeOptional, NumberOfRvaAndSizes, "Number of data directory entries", 92, 4, 108, 4, PE_SHOW_DEC),
+};
+
+// Fields of a Section Table entry
+static const PeField SectionFields[] = {
+    FIELD(PeSection, Name, "Name", 0, 8, PE_SHOW_NAME),                                 // 8-byte, NUL-padded UTF-8 name
+    FIELD(PeSection, VirtualSize, "Virtual Size", 8, 4, PE_SHOW_BYTES),                 // Size in memory, zero-filled beyond SizeOfRawData
+    FIELD(PeSection, VirtualAddress, "Virtual Address", 12, 4, PE_SHOW_HEX),            // Address of the section relative to the ImageBase
+    FIELD(PeSection, SizeOfRawData, "Size of Raw Data", 16, 4, PE_SHOW_BYTES),          // Size of the initialized data in the file
+    FIELD(PeSection, PointerToRawData, "Pointer to Raw Data", 20, 4, PE_SHOW_HEX),      // File offset of the first byte of the section
+    FIELD(PeSection, PointerToRelocations, "Pointer to Relocations", 24, 4, PE_SHOW_HEX),   // The relocation and line number fields are only used by object files
+    FIELD(PeSection, PointerToLinenumbers, "Pointer to Line Numbers", 28, 4, PE_SHOW_HEX),
+    FIELD(PeSection, NumberOfRelocations, "Number of Relocations", 32, 2, PE_SHOW_DEC),
+    FIELD(PeSection, NumberOfLinenumbers, "Number of Line Numbers", 34, 2, PE_SHOW_DEC),
+    FLAGS(PeSection, Characteristics, "Characteristics", 36, 4, PE_SHOW_FLAGS, SectionFlags),
+};
+
+/* Fields of the Load Configuration Structure, in the order of the PE32+ structure
+ * The fields from DeCommitFreeBlockThreshold on are moved or widened in PE32+ images, and ProcessHeapFlags
+ * comes before ProcessAffinityMask in PE32 images, but after it in PE32+ images
+ * The heap and global flag fields, which the loader mostly ignores, are left out of the text output
+ */
+static const PeField LoadConfigFields[] = {
+    FIELD(PeLoadConfig, Size, "Size", 0, 4, PE_SHOW_BYTES),                                 // Size of the structure, which gives its version
+    FIELD(PeLoadConfig, TimeDateStamp, "Date/time stamp", 4, 4, PE_SHOW_DEC),
+    FIELD(PeLoadConfig, MajorVersion, "Major Version", 8, 2, PE_SHOW_DEC),
+    FIELD(PeLoadConfig, MinorVersion, "Minor Version", 10, 2, PE_SHOW_DEC),
+    FIELD(PeLoadConfig, GlobalFlagsClear, NULL, 12, 4, PE_SHOW_HEX),
+    FIELD(PeLoadConfig, GlobalFlagsSet, NULL, 16, 4, PE_SHOW_HEX),
+    FIELD(PeLoadConfig, CriticalSectionDefaultTimeout, NULL, 20, 4, PE_SHOW_DEC),
+    FIELD2(PeLoadConfig, DeCommitFreeBlockThreshold, NULL, 24, 4, 24, 8, PE_SHOW_DEC),
+    FIELD2(PeLoadConfig, DeCommitTotalFreeThreshold, NULL, 28, 4, 32, 8, PE_SHOW_DEC),
+    FIELD2(PeLoadConfig, LockPrefixTable, "Lock Prefix Table", 32, 4, 40, 8, PE_SHOW_HEX),   // x86 only
+    FIELD2(PeLoadConfig, MaximumAllocationSize, NULL, 36, 4, 48, 8, PE_SHOW_DEC),
+    FIELD2(PeLoadConfig, VirtualMemoryThreshold, NULL, 40, 4, 56, 8, PE_SHOW_DEC),
+    FIELD2(PeLoadConfig, ProcessAffinityMask, NULL, 48, 4, 64, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, ProcessHeapFlags, NULL, 44, 4, 72, 4, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, CSDVersion, NULL, 52, 2, 76, 2, PE_SHOW_DEC),
+    FIELD2(PeLoadConfig, DependentLoadFlags, "Dependent Load Flags", 54, 2, 78, 2, PE_SHOW_HEX),    // LOAD_LIBRARY_SEARCH flags of the static imports
+    FIELD2(PeLoadConfig, EditList, NULL, 56, 4, 80, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, SecurityCookie, "Security Cookie", 60, 4, 88, 8, PE_SHOW_HEX),    // VA of the /GS stack cookie
+    FIELD2(PeLoadConfig, SEHandlerTable, "SafeSEH Handler Table", 64, 4, 96, 8, PE_SHOW_HEX),   // x86 only
+    FIELD2(PeLoadConfig, SEHandlerCount, "SafeSEH Handler Count", 68, 4, 104, 8, PE_SHOW_DEC),
+    FIELD2(PeLoadConfig, GuardCFCheckFunctionPointer, "CFG Check Function Pointer", 72, 4, 112, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, GuardCFDispatchFunctionPointer, "CFG Dispatch Function Pointer", 76, 4, 120, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, GuardCFFunctionTable, "CFG Function Table", 80, 4, 128, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, GuardCFFunctionCount, "CFG Function Count", 84, 4, 136, 8, PE_SHOW_DEC),
+    FLAGS2(PeLoadConfig, GuardFlags, "Guard Flags", 88, 4, 144, 4, PE_SHOW_FLAGS, GuardFlags),
+    FIELD2(PeLoadConfig, CodeIntegrityFlags, "Code Integrity Flags", 92, 2, 148, 2, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, CodeIntegrityCatalog, NULL, 94, 2, 150, 2, PE_SHOW_DEC),
+    FIELD2(PeLoadConfig, CodeIntegrityCatalogOffset, NULL, 96, 4, 152, 4, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, GuardAddressTakenIatEntryTable, "CFG Address-taken IAT Table", 104, 4, 160, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, GuardAddressTakenIatEntryCount, "CFG Address-taken IAT Count", 108, 4, 168, 8, PE_SHOW_DEC),
+    FIELD2(PeLoadConfig, GuardLongJumpTargetTable, "CFG Long Jump Target Table", 112, 4, 176, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, GuardLongJumpTargetCount, "CFG Long Jump Target Count", 116, 4, 184, 8, PE_SHOW_DEC),
+    FIELD2(PeLoadConfig, DynamicValueRelocTable, "Dynamic Value Relocation Table", 120, 4, 192, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, CHPEMetadataPointer, "CHPE Metadata Pointer", 124, 4, 200, 8, PE_SHOW_HEX),    // Hybrid ARM64/x86 or ARM64EC metadata
+    FIELD2(PeLoadConfig, GuardRFFailureRoutine, NULL, 128, 4, 208, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, GuardRFFailureRoutineFunctionPointer, NULL, 132, 4, 216, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, DynamicValueRelocTableOffset, NULL, 136, 4, 224, 4, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, DynamicValueRelocTableSection, NULL, 140, 2, 228, 2, PE_SHOW_DEC),
+    FIELD2(PeLoadConfig, GuardRFVerifyStackPointerFunctionPointer, NULL, 144, 4, 232, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, HotPatchTableOffset, "Hot Patch Table Offset", 148, 4, 240, 4, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, EnclaveConfigurationPointer, "Enclave Configuration Pointer", 156, 4, 248, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, VolatileMetadataPointer, "Volatile Metadata Pointer", 160, 4, 256, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, GuardEHContinuationTable, "EH Continuation Table", 164, 4, 264, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, GuardEHContinuationCount, "EH Continuation Count", 168, 4, 272, 8, PE_SHOW_DEC),
+    FIELD2(PeLoadConfig, GuardXFGCheckFunctionPointer, "XFG Check Function Pointer", 172, 4, 280, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, GuardXFGDispatchFunctionPointer, "XFG Dispatch Function Pointer", 176, 4, 288, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, GuardXFGTableDispatchFunctionPointer, "XFG Table Dispatch Function Pointer", 180, 4, 296, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, CastGuardOsDeterminedFailureMode, NULL, 184, 4, 304, 8, PE_SHOW_HEX),
+    FIELD2(PeLoadConfig, GuardMemcpyFunctionPointer, "Guard Memcpy Function Pointer", 188, 4, 312, 8, PE_SHOW_HEX),
+};
+
+const PeFieldTable PeDosLayout = {DosFields, COUNT(DosFields)};
+const PeFieldTable PeCoffLayout = {CoffFields, COUNT(CoffFields)};
+const PeFieldTable PeOptionalLayout = {OptionalFields, COUNT(OptionalFields)};
+const PeFieldTable PeSectionLayout = {SectionFields, COUNT(SectionFields)};
+const PeFieldTable PeLoadConfigLayout = {LoadConfigFields, COUNT(LoadConfigFields)};
+
+/* This function decodes every field of the given table from the raw header into the model of the header
+ * It takes the layout of the header, i.e. PE_LAYOUT_PE32 or PE_LAYOUT_PE32PLUS, as the last argument
+ * The raw header must be large enough for every field of the table in that layout,
+ * and the fields that aren't present in the layout are left as they are in the model
+ */
+void PeDecodeFields(void *model, const unsigned char *raw, const PeFieldTable *table, int layout)
+{
+    uint16_t i;
+
+    for (i = 0; i < table->count; i++)
+    {
+        const PeField *field = &table->fields[i];
+        const unsigned char *src = raw + field->offset[layout];
+        unsigned char *dst = (unsigned char*)model + field->member;
+        uint64_t value;
+
+        switch (field->width[layout])
+        {
+            case 0:
+                continue;
+            case 1:
+                value = src[0];
+                break;
+            case 2:
+                value = ReadLe16(src);
+                break;
+            case 4:
+                value = ReadLe32(src);
+                break;
+            default:
+                if (field->show == PE_SHOW_NAME)
+                {
+                    memcpy(dst, src, field->width[layout]);
+                    dst[field->width[layout]] = '\0';
+                    continue;
+                }
+                value = ReadLe64(src);
+                break;
+        }
+
+        switch (field->size)
+        {
+            case 1:
+                *dst = (uint8_t)value;
+                break;
+            case 2:
+                *(uint16_t*)dst = (uint16_t)value;
+                break;
+            case 4:
+                *(uint32_t*)dst = (uint32_t)value;
+                break;
+            default:
+                *(uint64_t*)dst = value;
+                break;
+        }
+    }
+}
+
+// Returns the value of the given numeric field from the model of its header
+uint64_t PeFieldValue(const void *model, const PeField *field)
+{
+    const unsigned char *src = (const unsigned char*)model + field->member;
+
+    switch (field->size)
+    {
+        case 1:
+            return *src;
+        case 2:
+            return *(const uint16_t*)src;
+        case 4:
+            return *(const uint32_t*)src;
+        default:
+            return *(const uint64_t*)src;
+    }
+}
+
+// Returns the name of the given machine type from the dense machine table, or NULL if it isn't a known type
+const char* PeMachineName(uint16_t machine)
+{
+    unsigned slot = MACHINE_SLOT(machine);
+
+    if (MachineTable[slot].name == NULL || MachineTable[slot].machine != machine)
+        return NULL;
+    return MachineTable[slot].name;
+}
+
+/* This function appends the names of the flags of the given table that match the given value, each after a space
+ * If first is non-zero, only the first matching name is appended, as for enumerated values
+ */
+void ShowFlags(OutBuf *out, uint32_t value, const PeFlag *flags, size_t count, int first)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++)
+        if ((value & flags[i].mask) == flags[i].value)
+        {
+            OutChar(out, ' ');
+            OutPuts(out, flags[i].name);
+            if (first)
+                return;
+        }
+}
+
+/* The following function shows every field of the given table that has a label and is present in the given layout,
+ * one line per field, from the given model of the header
+ * It returns nothing and simply appends strings to the given output buffer
+ */
+void ShowFields(OutBuf *out, const void *model, const PeFieldTable *table, int layout)
+{
+    uint16_t i;
+
+    for (i = 0; i < table->count; i++)
+    {
+        const PeField *field = &table->fields[i];
+        uint64_t value;
+
+        if (field->label == NULL || field->width[layout] == 0)
+            continue;
+
+        OutPuts(out, field->label);
+        OutPuts(out, ": ");
+        if (field->show == PE_SHOW_NAME)
+        {
+            OutPuts(out, (const char*)model + field->member);
+            OutChar(out, '\n');
+            continue;
+        }
+
+        value = PeFieldValue(model, field);
+        switch (field->show)
+        {
+            case PE_SHOW_DEC:
+                OutU64(out, value);
+                break;
+            case PE_SHOW_BYTES:
+                OutU64(out, value);
+                OutPuts(out, " bytes");
+                break;
+            case PE_SHOW_CHARS:
+            {
+                // The bytes of the value, in file order, up to the first unprintable one
+                char chars[9];
+                int n;
+
+                for (n = 0; n < field->width[layout] && (value >> 8 * n & 0xFF) >= 0x20 && (value >> 8 * n & 0xFF) < 0x7F; n++)
+                    chars[n] = (char)(value >> 8 * n);
+                chars[n] = '\0';
+                OutPrintf(out, "0x%llX (%s)", (unsigned long long)value, chars);
+                break;
+            }
+            case PE_SHOW_MACHINE:
+            {
+                const char *name = PeMachineName((uint16_t)value);
+
+                OutPrintf(out, "0x%llX %s", (unsigned long long)value, name ? name : "unknown machine type");
+                break;
+            }
+            case PE_SHOW_FLAGS:
+            case PE_SHOW_ENUM:
+                OutPrintf(out, "0x%llX", (unsigned long long)value);
+                ShowFlags(out, (uint32_t)value, field->flags, field->flagCount, field->show == PE_SHOW_ENUM);
+                break;
+            default:
+                OutPrintf(out, "0x%llX", (unsigned long long)value);
+                break;
+        }
+        OutChar(out, '\n');
+    }
+}
@@ -0,0 +1,271 @@
+/* C-program file that contains the
+   code for the shared read-only view of an image file.
+
+   This functionality of rpe64 maps the whole input file into memory once (using mmap),
+   so that every analyzer reads the same bytes in place instead of copying
+   a fixed-size prefix of the file into its own buffer.
+   If the file can't be mapped, e.g. because it's a pipe or a special file,
+   its contents are read into a heap buffer instead (using pread/read).
+   All the accessors below are bounds-checked, and return NULL instead of
+   a pointer whenever the requested range doesn't lie completely within the file.
+   RVAs are resolved to file offsets by the RVA index of the parsed model (see PeParse.c).
+ */
+
+/* Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "rpe64Header.h"
+
+#define PE_READ_CHUNK 65536     // Growth step of the heap buffer used when the size of the input isn't known in advance
+
+/* Reads the complete contents of a regular file of known size into a heap buffer using pread,
+ * which is used when the file can't be memory-mapped.
+ * It returns 0 on success, otherwise it returns 1.
+ */
+static int PeImagePread(PeImage *img, int fd, size_t size)
+{
+    unsigned char *data = malloc(size ? size : 1);
+    size_t done = 0;
+
+    if (data == NULL)
+        return 1;
+
+    while (done < size)
+    {
+        ssize_t got = pread(fd, data + done, size - done, (off_t)done);
+
+        if (got <= 0)
+        {
+            free(data);
+            return 1;
+        }
+        done += (size_t)got;
+    }
+
+    img->data = data;
+    img->size = size;
+    img->mapped = 0;
+    return 0;
+}
+
+/* Reads everything that is available from a pipe or a special file into a heap buffer,
+ * since such files can neither be memory-mapped nor have a size that is known in advance.
+ * It returns 0 on success, otherwise it returns 1.
+ */
+static int PeImageSlurp(PeImage *img, int fd)
+{
+    unsigned char *data = NULL;
+    size_t size = 0, cap = 0;
+
+    for (;;)
+    {
+        if (size == cap)
+        {
+            unsigned char *grown = realloc(data, cap + PE_READ_CHUNK);
+
+            if (grown == NULL)
+            {
+                free(data);
+                return 1;
+            }
+            data = grown;
+            cap += PE_READ_CHUNK;
+        }
+
+        ssize_t got = read(fd, data + size, cap - size);
+
+        if (got < 0)
+        {
+            free(data);
+            return 1;
+        }
+        if (got == 0)
+            break;
+        size += (size_t)got;
+    }
+
+    img->data = data;
+    img->size = size;
+    img->mapped = 0;
+    return 0;
+}
+
+/* This function opens the given file and makes its complete contents available through the image object.
+ * It takes a pointer to the image object that is to be filled in and the name of the file as arguments.
+ * It returns 0 if the file could be opened, otherwise it returns 1 and leaves the image object empty.
+ */
+int PeImageOpen(PeImage *img, const char *path)
+{
+    struct stat st;
+    int rc;
+
+    img->data = NULL;
+    img->size = 0;
+    img->mapped = 0;
+    img->borrowed = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 1;
+
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return 1;
+    }
+
+    if (S_ISREG(st.st_mode))
+    {
+        size_t size = (size_t)st.st_size;
+
+        if (size > 0)
+        {
+            void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (map != MAP_FAILED)
+            {
+                img->data = map;
+                img->size = size;
+                img->mapped = 1;
+                close(fd);
+                return 0;
+            }
+        }
+        rc = PeImagePread(img, fd, size);
+    }
+    else
+        rc = PeImageSlurp(img, fd);
+
+    close(fd);
+    return rc;
+}
+
+/* Makes the given bytes, which stay owned by the caller, available through the image object,
+ * e.g. for the inputs of the fuzz harness (see FuzzPe.c), which are never written to a file
+ */
+void PeImageFromMemory(PeImage *img, const void *data, size_t size)
+{
+    img->data = data;
+    img->size = size;
+    img->mapped = 0;
+    img->borrowed = 1;
+}
+
+// Releases the mapping or the heap buffer that is held by the image object
+void PeImageClose(PeImage *img)
+{
+    if (!img->borrowed)
+    {
+        if (img->mapped)
+            munmap((void *)img->data, img->size);
+        else
+            free((void *)img->data);
+    }
+
+    img->data = NULL;
+    img->size = 0;
+    img->mapped = 0;
+    img->borrowed = 0;
+}
+
+/* Returns a pointer to the given range of file offsets within the image,
+ * or NULL if any part of the range lies outside the file
+ */
+const unsigned char* PeImageView(const PeImage *img, uint64_t offset, uint64_t length)
+{
+    if (img->data == NULL || offset > img->size || length > img->size - offset)
+        return NULL;
+
+    return img->data + offset;
+}
+
+/* Points the given cursor at the given range of file offsets within the image, cut at the end of the file
+ * Ranges of more than 4 GB are cut to 4 GB, which no directory decoder reads
+ * It returns PE_ERROR_UNMAPPED if the range doesn't start within the file, in which case the cursor is empty,
+ * PE_ERROR_TRUNCATED if the range was cut at the end of the file, otherwise it returns PE_ERROR_NONE
+ */
+int PeCursorAtOffset(PeCursor *c, const PeImage *img, uint64_t offset, uint64_t size)
+{
+    int rc = PE_ERROR_NONE;
+
+    c->data = NULL;
+    c->size = c->pos = 0;
+    c->error = PE_ERROR_NONE;
+    if (img->data == NULL || offset >= img->size)
+        return PE_ERROR_UNMAPPED;
+
+    if (size > img->size - offset)
+    {
+        size = img->size - offset;
+        rc = PE_ERROR_TRUNCATED;
+    }
+    c->data = img->data + offset;
+    c->size = size > UINT32_MAX ? UINT32_MAX : (uint32_t)size;
+    return rc;
+}
+
+/* Returns a pointer to the 64-byte DOS Header if the file starts with the 'MZ' magic number,
+ * otherwise it returns NULL
+ */
+const unsigned char* PeDosHeader(const PeImage *img)
+{
+    const unsigned char *dos = PeImageView(img, 0, PE_DOS_HEADER_SIZE);
+
+    if (dos == NULL || dos[0] != 'M' || dos[1] != 'Z')
+        return NULL;
+
+    return dos;
+}
+
+/* Returns a pointer to the NT headers, i.e. the 4-byte PE signature followed by the
+ * Image File Header and the complete Image Optional Header (as given by SizeOfOptionalHeader).
+ * It returns NULL if the signature is missing or if any of these headers are cut off by the end of the file.
+ */
+const unsigned char* PeNtHeaders(const PeImage *img)
+{
+    const unsigned char *dos = PeDosHeader(img);
+
+    if (dos == NULL)
+        return NULL;
+
+    uint32_t e_lfanew = ReadLe32(dos + 60);
+
+    const unsigned char *nt = PeImageView(img, e_lfanew, PE_NT_FIXED_SIZE);
+    if (nt == NULL || memcmp(nt, "PE\0\0", 4) != 0)
+        return NULL;
+
+    uint16_t SoOHn = ReadLe16(nt + 20);
+
+    return PeImageView(img, e_lfanew, (uint64_t)PE_NT_FIXED_SIZE + SoOHn);
+}
+
+/* Returns a pointer to the Section Table, which immediately follows the Image Optional Header,
+ * and stores the number of 40-byte section headers in it through the count argument.
+ * It returns NULL if the table doesn't lie completely within the file.
+ */
+const unsigned char* PeSectionTable(const PeImage *img, uint16_t *count)
+{
+    const unsigned char *nt = PeNtHeaders(img);
+
+    *count = 0;
+    if (nt == NULL)
+        return NULL;
+
+    uint16_t NoScn = ReadLe16(nt + 6);
+    uint16_t SoOHn = ReadLe16(nt + 20);
+
+    uint64_t offset = (uint64_t)(nt - img->data) + PE_NT_FIXED_SIZE + SoOHn;
+    const unsigned char *table = PeImageView(img, offset, (uint64_t)NoScn * PE_SECTION_HEADER_SIZE);
+
+    if (table != NULL)
+        *count = NoScn;
+    return table;
+}
@@ -0,0 +1,578 @@
+/* C-program file that contains the
+   code for decoding the headers of the image file
+   into the parse-once model that is shared by all the output functions.
+
+   This functionality of rpe64 opens the given file once, and decodes the DOS Header,
+   the Image File Header, the PE32/PE32+ Image Optional Header, the data directories
+   and the Section Table in a single pass over the mapped file.
+   The output functions then print the decoded fields from the model,
+   instead of opening and decoding the file on their own.
+
+   The sections are also sorted by virtual address into an RVA index, so that the
+   directory-level decoders can resolve any RVA to a file offset with a binary search,
+   and those with raw data by file offset into an offset index, for the reverse.
+ */
+
+/* Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "rpe64Header.h"
+
+#define PE32_WINDOWS_FIELDS_END 96      // Size of the PE32 Image Optional Header up to the data directories
+#define PE32PLUS_WINDOWS_FIELDS_END 112 // Size of the PE32+ Image Optional Header up to the data directories
+
+/* This function opens the given file and decodes its headers into the model.
+ * It takes a pointer to the model that is to be filled in and the name of the file as arguments.
+ * It returns 0 if all the headers were decoded, otherwise it returns 1,
+ * and the reason is given by the status field of the model.
+ * The model must be released with PeFileClose() in either case.
+ */
+int PeFileOpen(PeFile *pe, const char *path)
+{
+    memset(pe, 0, sizeof(*pe));
+    pe->path = path;
+
+    if (PeImageOpen(&pe->image, path))
+    {
+        pe->status = PE_STATUS_OPEN_FAILED;
+        return 1;
+    }
+
+    return ParsePeHeaders(pe);
+}
+
+/* This function decodes the headers of the given bytes into the model, like PeFileOpen() does for a file
+ * The bytes stay owned by the caller, and must outlive the model, which is released with PeFileClose()
+ * It returns 0 if all the headers were decoded, otherwise it returns 1
+ */
+int PeFileOpenMemory(PeFile *pe, const char *name, const void *data, size_t size)
+{
+    memset(pe, 0, sizeof(*pe));
+    pe->path = name;
+    PeImageFromMemory(&pe->image, data, size);
+
+    return ParsePeHeaders(pe);
+}
+
+// Releases the section headers, the RVA and offset indexes, the decoded directories and the mapped file held by the model
+void PeFileClose(PeFile *pe)
+{
+    free(pe->sections);
+    free(pe->rvaIndex);
+    free(pe->rawIndex);
+    free(pe->importDlls);
+    free(pe->importFuncs);
+    free(pe->exports);
+    free(pe->exportSlots);
+    free(pe->sectionSha256);
+    free(pe->sectionEntropy);
+    free(pe->resources);
+    free(pe->versionStrings);
+    free(pe->manifest);
+    free(pe->certificates);
+    free(pe->relocPages);
+    free(pe->relocEntries);
+    free(pe->functions);
+    free(pe->tlsCallbacks);
+    free(pe->debugEntries);
+    free(pe->pogoEntries);
+    free(pe->sigMatches);
+    free(pe->sigRules);
+    PeImageClose(&pe->image);
+    memset(pe, 0, sizeof(*pe));
+}
+
+/* Decodes the Image Optional Header that starts at the given pointer and is of the given size
+ * It returns 0 if the header is large enough for its magic number, otherwise it returns 1
+ */
+static int ParseOptionalHeader(PeFile *pe, const unsigned char *ioh, uint16_t size)
+{
+    PeOptional *opt = &pe->opt;
+    uint32_t dirs;      // Offset of the data directories within the Image Optional Header
+    uint32_t i;
+
+    if (size < 2)
+        return 1;
+
+    opt->Magic = ReadLe16(ioh);
+
+    if (opt->Magic == PE32_MAGIC)
+        dirs = PE32_WINDOWS_FIELDS_END;
+    else if (opt->Magic == PE32PLUS_MAGIC)
+        dirs = PE32PLUS_WINDOWS_FIELDS_END;
+    else
+        return 1;
+
+    if (size < dirs)
+        return 1;
+
+    // Standard and Windows-specific fields, some of which are moved or widened in PE32+ images
+    PeDecodeFields(opt, ioh, &PeOptionalLayout, opt->Magic == PE32PLUS_MAGIC ? PE_LAYOUT_PE32PLUS : PE_LAYOUT_PE32);
+
+    /* Data directories, each of which is an 8-byte RVA and size pair
+     * Only the entries that are both counted by NumberOfRvaAndSizes and
+     * present within SizeOfOptionalHeader are decoded
+     */
+    for (i = 0; i < PE_NUM_DATA_DIRECTORIES && i < opt->NumberOfRvaAndSizes && dirs + 8 * i + 8 <= size; i++)
+    {
+        pe->dir[i].VirtualAddress = ReadLe32(ioh + dirs + 8 * i);
+        pe->dir[i].Size = ReadLe32(ioh + dirs + 8 * i + 4);
+    }
+
+    return 0;
+}
+
+/* Decodes the Section Table into an array of section headers
+ * It returns 0 if the complete table lies within the file, otherwise it returns 1
+ */
+static int ParseSectionTable(PeFile *pe)
+{
+    uint16_t count, i;
+    const unsigned char *table = PeSectionTable(&pe->image, &count);
+
+    if (table == NULL)
+        return pe->coff.NumberOfSections != 0;
+    if (count == 0)
+        return 0;
+
+    pe->sections = calloc(count, sizeof(PeSection));
+    if (pe->sections == NULL)
+        return 1;
+
+    for (i = 0; i < count; i++)
+        PeDecodeFields(&pe->sections[i], table + (size_t)i * PE_SECTION_HEADER_SIZE, &PeSectionLayout, PE_LAYOUT_PE32);
+
+    pe->sectionCount = count;
+    return 0;
+}
+
+static int RvaRangeCompare(const void *a, const void *b)
+{
+    const PeRvaRange *x = a, *y = b;
+
+    if (x->start != y->start)
+        return x->start < y->start ? -1 : 1;
+    return x->section < y->section ? -1 : x->section > y->section;
+}
+
+/* Builds the RVA index from the decoded section headers
+ * Each section occupies its VirtualSize (or SizeOfRawData if VirtualSize is 0) rounded up to SectionAlignment,
+ * of which only the first SizeOfRawData bytes (at most) are backed by the file
+ * It returns 0 on success, otherwise it returns 1
+ */
+static int BuildRvaIndex(PeFile *pe)
+{
+    uint32_t align = pe->opt.SectionAlignment;
+    uint16_t i;
+
+    if (pe->sectionCount == 0)
+        return 0;
+
+    pe->rvaIndex = malloc(pe->sectionCount * sizeof(PeRvaRange));
+    if (pe->rvaIndex == NULL)
+        return 1;
+
+    for (i = 0; i < pe->sectionCount; i++)
+    {
+        const PeSection *sec = &pe->sections[i];
+        PeRvaRange *range = &pe->rvaIndex[i];
+        uint64_t span = sec->VirtualSize ? sec->VirtualSize : sec->SizeOfRawData;
+
+        if (align && (align & (align - 1)) == 0)
+            span = (span + align - 1) & ~(uint64_t)(align - 1);
+
+        range->start = sec->VirtualAddress;
+        range->end = (uint64_t)sec->VirtualAddress + span > UINT32_MAX ? UINT32_MAX : (uint32_t)(sec->VirtualAddress + span);
+        range->rawOffset = sec->PointerToRawData;
+        range->rawSize = sec->SizeOfRawData < span ? sec->SizeOfRawData : (uint32_t)span;
+        range->section = i;
+    }
+
+    qsort(pe->rvaIndex, pe->sectionCount, sizeof(PeRvaRange), RvaRangeCompare);
+    pe->rvaCount = pe->sectionCount;
+    return 0;
+}
+
+// Start or end of the raw data of an entry of the RVA index, for building the offset index
+typedef struct RawEdge
+{
+    uint64_t at;                // File offset of the edge
+    uint32_t range;             // Index of the entry within the RVA index
+    int open;                   // 1 where the raw data starts, 0 just past its end
+} RawEdge;
+
+static int RawEdgeCompare(const void *a, const void *b)
+{
+    const RawEdge *x = a, *y = b;
+
+    return x->at < y->at ? -1 : x->at > y->at;
+}
+
+// Adds an entry of the RVA index to the binary min-heap of the entries whose raw data holds the current offset
+static void RawHeapPush(uint32_t *heap, uint32_t *len, uint32_t range)
+{
+    uint32_t k = (*len)++;
+
+    for (; k && heap[(k - 1) / 2] > range; k = (k - 1) / 2)
+        heap[k] = heap[(k - 1) / 2];
+    heap[k] = range;
+}
+
+// Removes the smallest entry from the heap
+static void RawHeapPop(uint32_t *heap, uint32_t *len)
+{
+    uint32_t k = 0, last = heap[--(*len)], child;
+
+    for (; (child = 2 * k + 1) < *len; k = child)
+    {
+        if (child + 1 < *len && heap[child + 1] < heap[child])
+            child++;
+        if (heap[child] >= last)
+            break;
+        heap[k] = heap[child];
+    }
+    heap[k] = last;
+}
+
+/* Builds the offset index from the RVA index: the raw data of the sections is cut into disjoint ranges, sorted by file offset,
+ * each of which belongs to the first section, in the order of the RVA index, whose raw data holds it,
+ * so that overlapping sections resolve to the same section as a walk of the RVA index would find.
+ * The ranges are found in one sweep over the starts and ends of the raw data, with a heap of the sections that hold the current offset
+ * It returns 0 on success, otherwise it returns 1
+ */
+static int BuildRawIndex(PeFile *pe)
+{
+    uint32_t n = pe->rvaCount, edgeCount = 0, heapLen = 0, i, k;
+    RawEdge *edges;
+    uint32_t *heap;
+    unsigned char *holds;
+
+    if (n == 0)
+        return 0;
+
+    edges = malloc(2 * (size_t)n * sizeof(RawEdge));
+    heap = malloc(n * sizeof(uint32_t));
+    holds = calloc(n, 1);
+    pe->rawIndex = malloc(2 * (size_t)n * sizeof(PeRvaRange));
+    if (edges == NULL || heap == NULL || holds == NULL || pe->rawIndex == NULL)
+    {
+        free(edges);
+        free(heap);
+        free(holds);
+        return 1;
+    }
+
+    for (i = 0; i < n; i++)
+        if (pe->rvaIndex[i].rawSize)
+        {
+            edges[edgeCount++] = (RawEdge){ pe->rvaIndex[i].rawOffset, i, 1 };
+            edges[edgeCount++] = (RawEdge){ (uint64_t)pe->rvaIndex[i].rawOffset + pe->rvaIndex[i].rawSize, i, 0 };
+        }
+    qsort(edges, edgeCount, sizeof(RawEdge), RawEdgeCompare);
+
+    // The sections whose raw data has ended are only dropped from the heap once they come to its top
+    for (k = 0; k < edgeCount && edges[k].at <= UINT32_MAX; )
+    {
+        uint64_t at = edges[k].at;
+
+        for (; k < edgeCount && edges[k].at == at; k++)
+        {
+            holds[edges[k].range] = (unsigned char)edges[k].open;
+            if (edges[k].open)
+                RawHeapPush(heap, &heapLen, edges[k].range);
+        }
+        while (heapLen && !holds[heap[0]])
+            RawHeapPop(heap, &heapLen);
+
+        if (heapLen && k < edgeCount)
+        {
+            const PeRvaRange *from = &pe->rvaIndex[heap[0]];
+            PeRvaRange *last = pe->rawCount ? &pe->rawIndex[pe->rawCount - 1] : NULL;
+            uint32_t size = (uint32_t)(edges[k].at - at);
+
+            if (last != NULL && last->section == from->section && (uint64_t)last->rawOffset + last->rawSize == at)
+                last->rawSize += size;
+            else
+            {
+                PeRvaRange *range = &pe->rawIndex[pe->rawCount++];
+
+                *range = *from;
+                range->start = from->start + (uint32_t)(at - from->rawOffset);
+                range->rawOffset = (uint32_t)at;
+                range->rawSize = size;
+            }
+        }
+    }
+
+    free(edges);
+    free(heap);
+    free(holds);
+    return 0;
+}
+
+/* Finds the entry of the RVA index that contains the given RVA using a binary search
+ * It returns NULL if no section contains the RVA
+ */
+static const PeRvaRange* FindRvaRange(const PeFile *pe, uint32_t rva)
+{
+    size_t lo = 0, hi = pe->rvaCount;
+
+    // Finds the last range that starts at or before the RVA
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (pe->rvaIndex[mid].start <= rva)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo == 0 || rva >= pe->rvaIndex[lo - 1].end)
+        return NULL;
+    return &pe->rvaIndex[lo - 1];
+}
+
+/* Resolves an RVA to a file offset
+ * It stores the file offset, and the number of bytes from there on that are backed by the file
+ * within the same section (or the headers), through the last two arguments.
+ * It returns 0 on success, or 1 if the RVA isn't backed by the file.
+ */
+int PeRvaToOffset(const PeFile *pe, uint32_t rva, uint32_t *offset, uint32_t *avail)
+{
+    const PeRvaRange *range = FindRvaRange(pe, rva);
+
+    if (range != NULL)
+    {
+        uint32_t delta = rva - range->start;
+
+        if (delta >= range->rawSize)        // The RVA is in the zero-filled part of the section
+            return 1;
+        *offset = range->rawOffset + delta;
+        *avail = range->rawSize - delta;
+        return 0;
+    }
+
+    // RVAs within SizeOfHeaders are part of the headers, which are loaded at their file offsets
+    if (rva < pe->opt.SizeOfHeaders)
+    {
+        *offset = rva;
+        *avail = pe->opt.SizeOfHeaders - rva;
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Finds the entry of the offset index whose raw data contains the given file offset using a binary search
+ * It returns NULL if no section's raw data contains the offset
+ */
+const PeRvaRange* PeFindRawRange(const PeFile *pe, uint64_t offset)
+{
+    size_t lo = 0, hi = pe->rawCount;
+
+    // Finds the last range that starts at or before the offset
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (pe->rawIndex[mid].rawOffset <= offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo == 0 || offset - pe->rawIndex[lo - 1].rawOffset >= pe->rawIndex[lo - 1].rawSize)
+        return NULL;
+    return &pe->rawIndex[lo - 1];
+}
+
+/* Resolves a file offset to the RVA it's loaded at, the reverse of PeRvaToOffset()
+ * It stores the RVA, and the index of the section whose raw data holds the offset, -1 in the headers, through the last two arguments.
+ * It returns 0 on success, or 1 if the offset isn't loaded into memory, e.g. in the overlay.
+ */
+int PeOffsetToRva(const PeFile *pe, uint64_t offset, uint32_t *rva, int *section)
+{
+    const PeRvaRange *range = PeFindRawRange(pe, offset);
+
+    *section = -1;
+    *rva = 0;
+    if (range != NULL)
+    {
+        *section = range->section;
+        *rva = range->start + (uint32_t)(offset - range->rawOffset);
+        return 0;
+    }
+
+    if (offset < pe->opt.SizeOfHeaders)
+    {
+        *rva = (uint32_t)offset;
+        return 0;
+    }
+    return 1;
+}
+
+// Returns the index of the section that contains the given RVA, or -1 if none does
+int PeSectionOfRva(const PeFile *pe, uint32_t rva)
+{
+    const PeRvaRange *range = FindRvaRange(pe, rva);
+
+    return range != NULL ? range->section : -1;
+}
+
+/* Returns a pointer to the bytes that are loaded at the given RVA
+ * It returns NULL if the range isn't completely backed by the file within a single section
+ */
+const unsigned char* PeFileRvaView(const PeFile *pe, uint32_t rva, uint32_t length)
+{
+    uint32_t offset, avail;
+
+    if (PeRvaToOffset(pe, rva, &offset, &avail) || length > avail)
+        return NULL;
+    return PeImageView(&pe->image, offset, length);
+}
+
+/* Points the given cursor at the bytes that are loaded from the given RVA on, up to the given size,
+ * cut at the end of the section that holds the RVA (or of the headers) and at the end of the file
+ * It returns PE_ERROR_UNMAPPED if the RVA isn't backed by the file, in which case the cursor is empty,
+ * PE_ERROR_TRUNCATED if fewer bytes than the given size are backed by the file, otherwise it returns PE_ERROR_NONE
+ * Tables that end with a zero entry rather than at a known size are viewed with the size UINT32_MAX,
+ * so that only PE_ERROR_UNMAPPED is an error for them
+ */
+int PeCursorAtRva(PeCursor *c, const PeFile *pe, uint32_t rva, uint32_t size)
+{
+    uint32_t offset, avail;
+    int rc;
+
+    if (PeRvaToOffset(pe, rva, &offset, &avail))
+        return PeCursorAtOffset(c, &pe->image, pe->image.size, 0);
+
+    rc = PeCursorAtOffset(c, &pe->image, offset, size < avail ? size : avail);
+    return rc == PE_ERROR_NONE && size > avail ? PE_ERROR_TRUNCATED : rc;
+}
+
+// Names of the PE_STATUS_ values, as used by the structured output formats
+static const char *const StatusNames[] = {"ok", "open_failed", "not_pe", "bad_optional_header", "bad_section_table"};
+
+// Returns the name of the given PE_STATUS_ value
+const char* PeStatusName(int status)
+{
+    return status >= 0 && status < (int)(sizeof(StatusNames) / sizeof(StatusNames[0])) ? StatusNames[status] : "unknown";
+}
+
+// Names of the PE_ERROR_ values, as used by the structured output formats
+static const char *const ErrorNames[PE_ERROR_COUNT] = {
+    "none", "unmapped", "truncated", "malformed", "limit", "no_memory"
+};
+
+// Returns the name of the given PE_ERROR_ value
+const char* PeErrorName(int error)
+{
+    return error >= 0 && error < PE_ERROR_COUNT ? ErrorNames[error] : "unknown";
+}
+
+// Describes the given PE_ERROR_ value for the text output, as what is wrong with a table
+const char* PeErrorText(int error)
+{
+    switch (error)
+    {
+        case PE_ERROR_UNMAPPED: return "outside the file";
+        case PE_ERROR_TRUNCATED: return "cut off by the end of their section or of the file";
+        case PE_ERROR_MALFORMED: return "malformed";
+        case PE_ERROR_LIMIT: return "larger than the limits of the decoder";
+        case PE_ERROR_NO_MEMORY: return "too large for the available memory";
+    }
+    return "complete";
+}
+
+/* Finds the first error of the directory decoders that have been run on the model, in the order they're run in
+ * It stores the name of the decoder, as used by the structured output formats, through the last argument
+ * It returns one of the PE_ERROR_ values, PE_ERROR_NONE if no decoder found a problem, in which case the name is NULL
+ */
+int PeFileError(const PeFile *pe, const char **stage)
+{
+    const struct { int error; const char *name; } errors[] = {
+        {pe->certificatesError, "certificates"}, {pe->importsError, "imports"}, {pe->exportsError, "exports"},
+        {pe->resourcesError, "resources"}, {pe->relocsError, "relocations"}, {pe->functionsError, "functions"},
+        {pe->tlsError, "tls"}, {pe->debugError, "debug"}, {pe->loadConfigError, "load_config"}, {pe->sigError, "signatures"}
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(errors) / sizeof(errors[0]); i++)
+        if (errors[i].error != PE_ERROR_NONE)
+        {
+            *stage = errors[i].name;
+            return errors[i].error;
+        }
+
+    *stage = NULL;
+    return PE_ERROR_NONE;
+}
+
+/* Returns a pointer to the NUL-terminated string that is loaded at the given RVA
+ * It stores the length of the string through the last argument.
+ * It returns NULL if no NUL is found within the given maximum length, or within the bytes backed by the file
+ */
+const char* PeFileRvaString(const PeFile *pe, uint32_t rva, size_t maxLen, size_t *len)
+{
+    PeCursor c;
+    const char *str, *nul;
+
+    if (PeCursorAtRva(&c, pe, rva, maxLen < UINT32_MAX ? (uint32_t)maxLen + 1 : UINT32_MAX) == PE_ERROR_UNMAPPED)
+        return NULL;
+
+    str = (const char *)c.data;
+    nul = memchr(str, '\0', c.size);
+    if (nul == NULL)
+        return NULL;
+
+    *len = (size_t)(nul - str);
+    return str;
+}
+
+/* This is the function that decodes all the headers of the mapped file into the model in one pass.
+ * It returns 0 if all the headers were decoded, otherwise it returns 1
+ * and sets the status field of the model to say how far the decoding got.
+ */
+int ParsePeHeaders(PeFile *pe)
+{
+    const unsigned char *dos = PeDosHeader(&pe->image);
+
+    if (dos == NULL)
+    {
+        pe->status = PE_STATUS_NOT_PE;
+        return 1;
+    }
+
+    // Important fields of the DOS Header
+    PeDecodeFields(&pe->dos, dos, &PeDosLayout, PE_LAYOUT_PE32);
+
+    // The PE signature and the Image File Header
+    const unsigned char *nt = PeImageView(&pe->image, pe->dos.e_lfanew, PE_NT_FIXED_SIZE);
+    if (nt == NULL || memcmp(nt, "PE\0\0", 4) != 0)
+    {
+        pe->status = PE_STATUS_NOT_PE;
+        return 1;
+    }
+
+    PeDecodeFields(&pe->coff, nt, &PeCoffLayout, PE_LAYOUT_PE32);
+
+    // The Image Optional Header, which must lie completely within the file
+    nt = PeNtHeaders(&pe->image);
+    if (nt == NULL || ParseOptionalHeader(pe, nt + PE_NT_FIXED_SIZE, pe->coff.SizeOfOptionalHeader))
+    {
+        pe->status = PE_STATUS_BAD_OPTIONAL;
+        return 1;
+    }
+
+    if (ParseSectionTable(pe) || BuildRvaIndex(pe) || BuildRawIndex(pe))
+    {
+        pe->status = PE_STATUS_BAD_SECTIONS;
+        return 1;
+    }
+
+    pe->status = PE_STATUS_OK;
+    return 0;
+}
@@ -0,0 +1,945 @@
+/* C-program file that contains the
+   code for the machine-readable output formats of rpe64.
+
+   This functionality of rpe64 writes one record per file, either as a line of JSON (JSON Lines)
+   or as a row of comma-separated values (CSV), holding every field that rpe64 decodes:
+   the DOS Header, the Image File Header, the Image Optional Header and the 16 data directories.
+   The first problem found by the directory decoders, if any, comes right after the status of the file,
+   and the digests, the PE checksum and the entropy of the file come next, if their stages were run.
+   The version information, the Authenticode signature and the relocation, function, TLS, debug and load configuration summaries come next in CSV, and after the exports in JSON,
+   where the version information is within the resources.
+   The JSON records also hold the Section Table, and the imports, exports and resources if they were decoded,
+   as arrays, which CSV has no columns for.
+   The fields are appended straight to the output buffer without any printf format strings.
+
+   Both formats are produced by walking the same list of fields, so the CSV header row,
+   the CSV rows and the JSON keys always agree with each other.
+   Nested JSON objects become dotted column names in CSV, e.g. "coff.Machine".
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "rpe64Header.h"
+
+// Names of the 16 data directories, as used for JSON keys and CSV columns
+static const char *const DirectoryNames[PE_NUM_DATA_DIRECTORIES] = {
+    "export", "import", "resource", "exception", "certificate", "basereloc", "debug", "architecture",
+    "globalptr", "tls", "load_config", "bound_import", "iat", "delay_import", "clr_runtime", "reserved"
+};
+
+// What a RecordWriter produces while walking the fields
+#define REC_JSON 0          // "key":value pairs of a JSON object
+#define REC_CSV_HEADER 1    // Column names of the CSV header row
+#define REC_CSV_ROW 2       // Values of a CSV row
+
+typedef struct RecordWriter
+{
+    OutBuf *out;
+    int mode;               // One of the REC_ values
+    int empty;              // In a CSV row, write empty values instead of the field values
+    char prefix[64];        // Dotted name of the enclosing JSON object, for CSV column names
+} RecordWriter;
+
+// Writes the separator and the name of the next field
+static void RecordKey(RecordWriter *w, const char *name)
+{
+    OutBuf *out = w->out;
+
+    if (w->mode == REC_JSON)
+    {
+        char last = out->len ? out->data[out->len - 1] : '{';
+
+        if (last != '{' && last != '[')
+            OutChar(out, ',');
+        OutChar(out, '"');
+        OutPuts(out, name);
+        OutPuts(out, "\":");
+        return;
+    }
+
+    if (out->len && out->data[out->len - 1] != '\n')
+        OutChar(out, ',');
+    if (w->mode == REC_CSV_HEADER)
+    {
+        OutPuts(out, w->prefix);
+        OutPuts(out, name);
+    }
+}
+
+// Writes a numeric field
+static void RecordU64(RecordWriter *w, const char *name, uint64_t value)
+{
+    RecordKey(w, name);
+    if (w->mode == REC_JSON || (w->mode == REC_CSV_ROW && !w->empty))
+        OutU64(w->out, value);
+}
+
+// Writes a string field
+static void RecordString(RecordWriter *w, const char *name, const char *value)
+{
+    RecordKey(w, name);
+    if (w->mode == REC_JSON)
+        OutJsonString(w->out, value);
+    else if (w->mode == REC_CSV_ROW && !w->empty)
+        OutCsvString(w->out, value);
+}
+
+// Writes a digest field as lowercase hexadecimal digits, or an empty value if the digest is missing
+static void RecordHex(RecordWriter *w, const char *name, const unsigned char *bytes, size_t len)
+{
+    RecordKey(w, name);
+    if (w->mode == REC_JSON)
+    {
+        OutChar(w->out, '"');
+        if (bytes != NULL)
+            OutHex(w->out, bytes, len);
+        OutChar(w->out, '"');
+    }
+    else if (w->mode == REC_CSV_ROW && !w->empty && bytes != NULL)
+        OutHex(w->out, bytes, len);
+}
+
+// Writes a fractional field with 4 decimal places
+static void RecordDouble(RecordWriter *w, const char *name, double value)
+{
+    RecordKey(w, name);
+    if (w->mode == REC_JSON || (w->mode == REC_CSV_ROW && !w->empty))
+        OutFixed4(w->out, value);
+}
+
+// Starts a nested object, whose fields get the name of the object as a prefix in CSV
+static void RecordBegin(RecordWriter *w, const char *name)
+{
+    if (w->mode == REC_JSON)
+    {
+        RecordKey(w, name);
+        OutChar(w->out, '{');
+    }
+    else
+    {
+        size_t len = strlen(w->prefix);
+        snprintf(w->prefix + len, sizeof(w->prefix) - len, "%s.", name);
+    }
+}
+
+// Ends the nested object started last
+static void RecordEnd(RecordWriter *w)
+{
+    if (w->mode == REC_JSON)
+        OutChar(w->out, '}');
+    else
+    {
+        size_t len = strlen(w->prefix);
+
+        // Drops the last "name." from the prefix
+        if (len)
+            len--;
+        while (len && w->prefix[len - 1] != '.')
+            len--;
+        w->prefix[len] = '\0';
+    }
+}
+
+/* The following functions write JSON arrays, which have no CSV equivalent
+ * They are only used when writing JSON, so the CSV columns stay fixed
+ */
+
+// Starts an array field
+static void RecordArrayBegin(RecordWriter *w, const char *name)
+{
+    RecordKey(w, name);
+    OutChar(w->out, '[');
+}
+
+// Ends the array started last
+static void RecordArrayEnd(RecordWriter *w)
+{
+    OutChar(w->out, ']');
+}
+
+// Starts an object element of the enclosing array
+static void RecordItemBegin(RecordWriter *w)
+{
+    if (w->out->data[w->out->len - 1] != '[')
+        OutChar(w->out, ',');
+    OutChar(w->out, '{');
+}
+
+// Writes a string element of the enclosing array
+static void RecordItemString(RecordWriter *w, const char *value)
+{
+    if (w->out->data[w->out->len - 1] != '[')
+        OutChar(w->out, ',');
+    OutJsonString(w->out, value);
+}
+
+// Writes a numeric element of the enclosing array
+static void RecordItemU64(RecordWriter *w, uint64_t value)
+{
+    if (w->out->data[w->out->len - 1] != '[')
+        OutChar(w->out, ',');
+    OutU64(w->out, value);
+}
+
+/* Walks every field of the given descriptor table, from the given model of the header
+ * Fields that aren't present in the layout of the file, like BaseOfData in PE32+ images, are written as 0,
+ * so that the CSV columns stay the same for every file
+ */
+static void RecordFields(RecordWriter *w, const void *model, const PeFieldTable *table)
+{
+    uint16_t i;
+
+    for (i = 0; i < table->count; i++)
+    {
+        const PeField *field = &table->fields[i];
+
+        if (field->show == PE_SHOW_NAME)
+            RecordString(w, field->name, (const char*)model + field->member);
+        else
+            RecordU64(w, field->name, PeFieldValue(model, field));
+    }
+}
+
+// Walks every entry of the section table, as a JSON array
+static void RecordSections(RecordWriter *w, const PeFile *pe)
+{
+    uint16_t i;
+    int a;
+
+    RecordArrayBegin(w, "sections");
+    for (i = 0; i < pe->sectionCount; i++)
+    {
+        const PeSection *sec = &pe->sections[i];
+        unsigned anomalies = SectionAnomalies(pe, i);
+
+        RecordItemBegin(w);
+        RecordFields(w, sec, &PeSectionLayout);
+        if (pe->sectionSha256 != NULL)
+            RecordHex(w, "sha256", pe->sectionSha256[i], 32);
+        if (pe->sectionEntropy != NULL)
+            RecordDouble(w, "entropy", pe->sectionEntropy[i]);
+        RecordArrayBegin(w, "anomalies");
+        for (a = 0; anomalies >> a; a++)
+            if (anomalies & (1u << a))
+                RecordItemString(w, SectionAnomalyNames[a]);
+        RecordArrayEnd(w);
+        RecordEnd(w);
+    }
+    RecordArrayEnd(w);
+}
+
+// Walks the imported DLLs and functions, as a JSON array, with functions imported by ordinal written as "#<ordinal>"
+static void RecordImports(RecordWriter *w, const PeFile *pe)
+{
+    uint32_t i, j;
+    char ordinal[8];
+
+    RecordU64(w, "imports_truncated", pe->importsError != PE_ERROR_NONE);
+    RecordArrayBegin(w, "imports");
+    for (i = 0; i < pe->importDllCount; i++)
+    {
+        const PeImportDll *dll = &pe->importDlls[i];
+
+        RecordItemBegin(w);
+        RecordString(w, "dll", dll->name);
+        RecordU64(w, "delay_load", dll->delayLoad);
+        RecordArrayBegin(w, "functions");
+        for (j = dll->first; j < dll->first + dll->count; j++)
+        {
+            const PeImportFunc *func = &pe->importFuncs[j];
+
+            if (func->name != NULL)
+                RecordItemString(w, func->name);
+            else
+            {
+                snprintf(ordinal, sizeof(ordinal), "#%u", func->ordinal);
+                RecordItemString(w, ordinal);
+            }
+        }
+        RecordArrayEnd(w);
+        RecordEnd(w);
+    }
+    RecordArrayEnd(w);
+}
+
+// Walks the exported functions, leaving out the unused entries of the Export Address Table
+static void RecordExports(RecordWriter *w, const PeFile *pe)
+{
+    uint32_t i;
+
+    RecordBegin(w, "exports");
+    if (pe->exportDllName != NULL)
+        RecordString(w, "dll", pe->exportDllName);
+    RecordU64(w, "ordinal_base", pe->exportOrdinalBase);
+    RecordU64(w, "truncated", pe->exportsError != PE_ERROR_NONE);
+    RecordArrayBegin(w, "functions");
+    for (i = 0; i < pe->exportCount; i++)
+    {
+        const PeExport *exp = &pe->exports[i];
+
+        if (exp->rva == 0)
+            continue;
+
+        RecordItemBegin(w);
+        RecordU64(w, "ordinal", exp->ordinal);
+        RecordU64(w, "rva", exp->rva);
+        if (exp->name != NULL)
+            RecordString(w, "name", exp->name);
+        if (exp->forwarder != NULL)
+            RecordString(w, "forwarder", exp->forwarder);
+        RecordEnd(w);
+    }
+    RecordArrayEnd(w);
+    RecordEnd(w);
+}
+
+// Walks the first problem found by the directory decoders, as its PE_ERROR_ name and the name of the decoder that found it
+static void RecordError(RecordWriter *w, const PeFile *pe)
+{
+    const char *stage;
+    int error = PeFileError(pe, &stage);
+
+    RecordString(w, "error", PeErrorName(error));
+    RecordString(w, "error_in", stage != NULL ? stage : "");
+}
+
+// Walks the digests of the whole file, which are present even if its headers couldn't be decoded
+static void RecordHashes(RecordWriter *w, const PeFile *pe)
+{
+    const PeHashes *h = &pe->hashes;
+
+    RecordHex(w, "md5", h->md5, sizeof(h->md5));
+    RecordHex(w, "sha1", h->sha1, sizeof(h->sha1));
+    RecordHex(w, "sha256", h->sha256, sizeof(h->sha256));
+    RecordHex(w, "imphash", h->hasImphash ? h->imphash : NULL, sizeof(h->imphash));
+}
+
+/* Walks the PE checksum of the file and whether it matches the CheckSum field,
+ * which are 0 if the headers of the file couldn't be decoded
+ */
+static void RecordChecksum(RecordWriter *w, const PeFile *pe)
+{
+    RecordBegin(w, "checksum");
+    RecordU64(w, "computed", pe->checksum);
+    RecordU64(w, "matches", (pe->parsed & PE_PARSED_CHECKSUM) && pe->checksum == pe->opt.CheckSum);
+    RecordEnd(w);
+}
+
+// Walks the entropy of the whole file and of its overlay
+static void RecordEntropy(RecordWriter *w, const PeFile *pe)
+{
+    RecordDouble(w, "entropy", pe->entropy.file);
+    RecordBegin(w, "overlay");
+    RecordU64(w, "offset", pe->entropy.overlayOffset);
+    RecordU64(w, "size", pe->entropy.overlaySize);
+    RecordDouble(w, "entropy", pe->entropy.overlay);
+    RecordEnd(w);
+}
+
+// Writes a version of the VS_FIXEDFILEINFO as "major.minor.build.revision", or an empty string if there's none
+static void RecordVersionNumber(RecordWriter *w, const char *name, const PeFile *pe, uint64_t version)
+{
+    char text[24] = "";
+
+    if (pe->hasVersion)
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", (unsigned)(version >> 48), (unsigned)(version >> 32 & 0xFFFF),
+                 (unsigned)(version >> 16 & 0xFFFF), (unsigned)(version & 0xFFFF));
+    RecordString(w, name, text);
+}
+
+/* Walks the file and product versions and the main version strings, which are empty if the image file has none
+ * The keys are fixed, so that the CSV columns stay the same for every file
+ */
+static void RecordVersion(RecordWriter *w, const PeFile *pe)
+{
+    const char *const *keys;
+    size_t count = PeVersionKeys(&keys), i;
+
+    RecordBegin(w, "version");
+    RecordVersionNumber(w, "file", pe, pe->fileVersion);
+    RecordVersionNumber(w, "product", pe, pe->productVersion);
+    for (i = 0; i < count; i++)
+    {
+        const char *value = PeVersionValue(pe, keys[i]);
+
+        RecordString(w, keys[i], value != NULL ? value : "");
+    }
+    RecordEnd(w);
+}
+
+// Walks the resources of the image file as a JSON array, followed by its version information and manifest
+static void RecordResources(RecordWriter *w, const PeFile *pe)
+{
+    uint32_t i;
+
+    RecordBegin(w, "resources");
+    RecordU64(w, "truncated", pe->resourcesError != PE_ERROR_NONE);
+    RecordArrayBegin(w, "entries");
+    for (i = 0; i < pe->resourceCount; i++)
+    {
+        const PeResource *res = &pe->resources[i];
+
+        RecordItemBegin(w);
+        if (res->typeName != NULL)
+            RecordString(w, "type_name", res->typeName);
+        else
+            RecordU64(w, "type", res->typeId);
+        if (res->name != NULL)
+            RecordString(w, "name", res->name);
+        else
+            RecordU64(w, "id", res->nameId);
+        RecordU64(w, "lang", res->lang);
+        RecordU64(w, "rva", res->rva);
+        RecordU64(w, "size", res->size);
+        RecordEnd(w);
+    }
+    RecordArrayEnd(w);
+    RecordVersion(w, pe);
+    if (pe->manifest != NULL)
+        RecordString(w, "manifest", pe->manifest);
+    RecordEnd(w);
+}
+
+// Writes a digest of the given PE_DIGEST_ algorithm, or an empty value if there's none
+static void RecordDigest(RecordWriter *w, const char *name, int alg, const unsigned char *digest)
+{
+    RecordHex(w, name, alg != PE_DIGEST_NONE ? digest : NULL, PeDigestSize(alg));
+}
+
+// Writes whether the signed digest of the given entry matches the Authenticode digest of the image, which is 0 if it can't be checked
+static void RecordDigestMatch(RecordWriter *w, const PeFile *pe, const PeCertificate *cert)
+{
+    RecordU64(w, "matches", cert != NULL && cert->digestAlg != PE_DIGEST_NONE && cert->digestAlg == pe->authenticodeAlg &&
+              memcmp(cert->digest, pe->authenticode, PeDigestSize(cert->digestAlg)) == 0);
+}
+
+/* Walks the Authenticode digest of the image and its first signature, whose fields are empty if it isn't signed
+ * The JSON records also hold every entry of the certificate table, as an array
+ */
+static void RecordAuthenticode(RecordWriter *w, const PeFile *pe)
+{
+    const PeCertificate *first = NULL;
+    uint32_t i;
+
+    for (i = 0; i < pe->certificateCount && first == NULL; i++)
+        if (pe->certificates[i].type == WIN_CERT_TYPE_PKCS_SIGNED_DATA)
+            first = &pe->certificates[i];
+
+    RecordBegin(w, "authenticode");
+    RecordString(w, "algorithm", pe->parsed & PE_PARSED_AUTHENTICODE ? PeDigestName(pe->authenticodeAlg) : "");
+    RecordDigest(w, "digest", pe->parsed & PE_PARSED_AUTHENTICODE ? pe->authenticodeAlg : PE_DIGEST_NONE, pe->authenticode);
+    RecordU64(w, "signed", first != NULL);
+    RecordDigest(w, "signed_digest", first != NULL ? first->digestAlg : PE_DIGEST_NONE, first != NULL ? first->digest : NULL);
+    RecordDigestMatch(w, pe, first);
+    RecordString(w, "subject", first != NULL && first->subject != NULL ? first->subject : "");
+    RecordString(w, "issuer", first != NULL && first->issuer != NULL ? first->issuer : "");
+    RecordU64(w, "truncated", pe->certificatesError != PE_ERROR_NONE);
+
+    if (w->mode == REC_JSON)
+    {
+        RecordArrayBegin(w, "certificates");
+        for (i = 0; i < pe->certificateCount; i++)
+        {
+            const PeCertificate *cert = &pe->certificates[i];
+
+            RecordItemBegin(w);
+            RecordU64(w, "offset", cert->offset);
+            RecordU64(w, "length", cert->length);
+            RecordU64(w, "revision", cert->revision);
+            RecordU64(w, "type", cert->type);
+            if (cert->digestAlg != PE_DIGEST_NONE)
+            {
+                RecordString(w, "digest_algorithm", PeDigestName(cert->digestAlg));
+                RecordDigest(w, "signed_digest", cert->digestAlg, cert->digest);
+                RecordDigestMatch(w, pe, cert);
+            }
+            if (cert->subject != NULL)
+                RecordString(w, "subject", cert->subject);
+            if (cert->issuer != NULL)
+                RecordString(w, "issuer", cert->issuer);
+            RecordEnd(w);
+        }
+        RecordArrayEnd(w);
+    }
+    RecordEnd(w);
+}
+
+/* Walks the summary of the base relocations: the number of blocks, relocations and pages with relocations,
+ * the largest number of relocations of a page, and the number of entries of the common types
+ * The JSON records also hold the number of entries of every type that occurs, and the number of relocations of each page,
+ * with the entries of the page, packed as in the file (type << 12 | offset), if they were kept
+ */
+static void RecordRelocations(RecordWriter *w, const PeFile *pe)
+{
+    uint32_t i, j, pages = 0, maxCount = 0;
+    unsigned type;
+
+    for (i = 0; i < pe->relocPageCount; i++)
+    {
+        if (pe->relocPages[i].count)
+            pages++;
+        if (pe->relocPages[i].count > maxCount)
+            maxCount = pe->relocPages[i].count;
+    }
+
+    RecordBegin(w, "relocations");
+    RecordU64(w, "blocks", pe->relocPageCount);
+    RecordU64(w, "count", pe->relocCount);
+    RecordU64(w, "pages", pages);
+    RecordU64(w, "max_per_page", maxCount);
+    RecordU64(w, "highlow", pe->relocTypes[3]);
+    RecordU64(w, "dir64", pe->relocTypes[10]);
+    RecordU64(w, "truncated", pe->relocsError != PE_ERROR_NONE);
+
+    if (w->mode == REC_JSON)
+    {
+        RecordBegin(w, "types");
+        for (type = 0; type < PE_RELOC_TYPES; type++)
+            if (pe->relocTypes[type])
+                RecordU64(w, PeRelocTypeName(pe, type), pe->relocTypes[type]);
+        RecordEnd(w);
+
+        RecordArrayBegin(w, "blocks_by_page");
+        for (i = 0; i < pe->relocPageCount; i++)
+        {
+            const PeRelocPage *page = &pe->relocPages[i];
+
+            RecordItemBegin(w);
+            RecordU64(w, "rva", page->rva);
+            RecordU64(w, "count", page->count);
+            if (pe->relocEntries != NULL)
+            {
+                RecordArrayBegin(w, "entries");
+                for (j = 0; j < page->entries; j++)
+                    RecordItemU64(w, pe->relocEntries[page->first + j]);
+                RecordArrayEnd(w);
+            }
+            RecordEnd(w);
+        }
+        RecordArrayEnd(w);
+    }
+    RecordEnd(w);
+}
+
+/* Walks the summary of the Exception Table: the number of functions, the checks of its entries, and the bytes of code they cover
+ * The JSON records also hold every function, sorted by address, as its begin and end RVAs and the RVA of its unwind information
+ */
+static void RecordFunctions(RecordWriter *w, const PeFile *pe)
+{
+    uint32_t i;
+
+    RecordBegin(w, "functions");
+    RecordU64(w, "count", pe->functionCount);
+    RecordU64(w, "unsorted", pe->functionsUnsorted);
+    RecordU64(w, "overlaps", pe->functionOverlaps);
+    RecordU64(w, "invalid", pe->functionsInvalid);
+    RecordU64(w, "bytes", pe->functionBytes);
+    RecordU64(w, "code_bytes", PeExecutableBytes(pe));
+    RecordU64(w, "truncated", pe->functionsError != PE_ERROR_NONE);
+
+    if (w->mode == REC_JSON)
+    {
+        RecordArrayBegin(w, "entries");
+        for (i = 0; i < pe->functionCount; i++)
+        {
+            RecordItemBegin(w);
+            RecordU64(w, "begin", pe->functions[i].begin);
+            RecordU64(w, "end", pe->functions[i].end);
+            RecordU64(w, "unwind", pe->functions[i].unwind);
+            RecordEnd(w);
+        }
+        RecordArrayEnd(w);
+    }
+    RecordEnd(w);
+}
+
+// Walks the TLS Directory: whether the image has one, and the number of its callbacks, which the JSON records also list as virtual addresses
+static void RecordTls(RecordWriter *w, const PeFile *pe)
+{
+    uint32_t i;
+
+    RecordBegin(w, "tls");
+    RecordU64(w, "present", pe->hasTls);
+    RecordU64(w, "callbacks", pe->tlsCallbackCount);
+    RecordU64(w, "truncated", pe->tlsError != PE_ERROR_NONE);
+
+    if (w->mode == REC_JSON)
+    {
+        RecordU64(w, "address_of_callbacks", pe->tls.addressOfCallbacks);
+        RecordArrayBegin(w, "callback_addresses");
+        for (i = 0; i < pe->tlsCallbackCount; i++)
+            RecordItemU64(w, pe->tlsCallbacks[i]);
+        RecordArrayEnd(w);
+    }
+    RecordEnd(w);
+}
+
+/* Walks the Debug Directory: the number of entries, the identity of the PDB from the CodeView record, and whether the image has
+ * REPRO and POGO entries
+ * The JSON records also hold every entry, and the COFF groups of the POGO entry
+ */
+static void RecordDebug(RecordWriter *w, const PeFile *pe)
+{
+    const PeCodeView *cv = &pe->codeView;
+    char guid[39], key[41];
+    uint32_t i;
+
+    PeCodeViewGuid(cv, guid);
+    PeCodeViewKey(cv, key);
+
+    RecordBegin(w, "debug");
+    RecordU64(w, "entries", pe->debugCount);
+    RecordString(w, "pdb_guid", guid);
+    RecordU64(w, "pdb_age", cv->age);
+    RecordString(w, "pdb_path", cv->pdbPath != NULL ? cv->pdbPath : "");
+    RecordString(w, "symbol_key", key);
+    RecordU64(w, "repro", pe->hasRepro);
+    RecordHex(w, "repro_hash", pe->reproHashSize ? pe->reproHash : NULL, pe->reproHashSize);
+    RecordU64(w, "pogo", pe->pogoCount);
+    RecordU64(w, "truncated", pe->debugError != PE_ERROR_NONE);
+
+    if (w->mode == REC_JSON)
+    {
+        RecordArrayBegin(w, "directory");
+        for (i = 0; i < pe->debugCount; i++)
+        {
+            const PeDebugEntry *entry = &pe->debugEntries[i];
+
+            RecordItemBegin(w);
+            RecordString(w, "type", PeDebugTypeName(entry->type));
+            RecordU64(w, "time_stamp", entry->timeDateStamp);
+            RecordU64(w, "size", entry->sizeOfData);
+            RecordU64(w, "rva", entry->addressOfRawData);
+            RecordU64(w, "offset", entry->pointerToRawData);
+            RecordEnd(w);
+        }
+        RecordArrayEnd(w);
+
+        RecordArrayBegin(w, "pogo_groups");
+        for (i = 0; i < pe->pogoCount; i++)
+        {
+            RecordItemBegin(w);
+            RecordString(w, "name", pe->pogoEntries[i].name);
+            RecordU64(w, "rva", pe->pogoEntries[i].rva);
+            RecordU64(w, "size", pe->pogoEntries[i].size);
+            RecordEnd(w);
+        }
+        RecordArrayEnd(w);
+    }
+    RecordEnd(w);
+}
+
+/* Walks the Load Configuration Structure: every field of the latest version of the structure, 0 if it isn't in the version of the file,
+ * the size of the CFG function table, and the mitigations that the structure enables
+ */
+static void RecordLoadConfig(RecordWriter *w, const PeFile *pe)
+{
+    const PeLoadConfig *lc = &pe->loadConfig;
+    unsigned mitigations = LoadConfigMitigations(pe);
+    int m;
+
+    RecordBegin(w, "load_config");
+    RecordU64(w, "present", pe->hasLoadConfig);
+    RecordU64(w, "decoded_size", pe->loadConfigSize);
+    RecordU64(w, "truncated", pe->loadConfigError != PE_ERROR_NONE);
+    RecordFields(w, lc, &PeLoadConfigLayout);
+    RecordU64(w, "cfg_table_bytes", lc->GuardCFFunctionCount * (4 + (lc->GuardFlags >> IMAGE_GUARD_CF_FUNCTION_TABLE_SIZE_SHIFT)));
+
+    RecordBegin(w, "mitigations");
+    for (m = 0; m < PE_MITIGATION_COUNT; m++)
+        RecordU64(w, LoadConfigMitigationNames[m], (mitigations >> m) & 1);
+    RecordEnd(w);
+    RecordEnd(w);
+}
+
+/* Walks the matches of the signature rules: their number, and the names of the rules that matched, which the CSV rows join with ';'
+ * The JSON records also hold every match, with its file offset, and its RVA and section if it's loaded into memory
+ */
+static void RecordSignatures(RecordWriter *w, const PeFile *pe)
+{
+    uint32_t i;
+
+    RecordBegin(w, "signatures");
+    RecordU64(w, "matches", pe->sigMatchTotal);
+    RecordU64(w, "truncated", pe->sigError != PE_ERROR_NONE);
+
+    if (w->mode == REC_JSON)
+    {
+        RecordArrayBegin(w, "rules");
+        for (i = 0; i < pe->sigRuleCount; i++)
+            RecordItemString(w, pe->sigRules[i]);
+        RecordArrayEnd(w);
+
+        RecordArrayBegin(w, "hits");
+        for (i = 0; i < pe->sigMatchCount; i++)
+        {
+            const PeSigMatch *m = &pe->sigMatches[i];
+
+            RecordItemBegin(w);
+            RecordString(w, "rule", m->rule);
+            RecordU64(w, "offset", m->offset);
+            if (m->mapped)
+                RecordU64(w, "rva", m->rva);
+            if (m->section >= 0)
+                RecordString(w, "section", pe->sections[m->section].Name);
+            RecordEnd(w);
+        }
+        RecordArrayEnd(w);
+    }
+    else
+    {
+        OutBuf joined;
+
+        OutInit(&joined);
+        for (i = 0; i < pe->sigRuleCount; i++)
+        {
+            if (i)
+                OutChar(&joined, ';');
+            OutPuts(&joined, pe->sigRules[i]);
+        }
+        OutChar(&joined, '\0');
+        RecordString(w, "rules", joined.data != NULL ? joined.data : "");
+        OutFree(&joined);
+    }
+    RecordEnd(w);
+}
+
+// Output of RecordStrings(), as the context of its callback
+typedef struct RecordStringsCtx
+{
+    RecordWriter *w;
+    OutBuf text;
+    const PeFile *pe;
+} RecordStringsCtx;
+
+// Writes one string of the JSON records as soon as it's found
+static void RecordStringItem(void *ctx, const PeString *str)
+{
+    RecordStringsCtx *c = ctx;
+
+    PeStringText(&c->text, str);
+    RecordItemBegin(c->w);
+    RecordU64(c->w, "offset", str->offset);
+    if (str->mapped)
+        RecordU64(c->w, "rva", str->rva);
+    if (str->section >= 0)
+        RecordString(c->w, "section", c->pe->sections[str->section].Name);
+    RecordString(c->w, "encoding", str->wide ? "utf-16le" : "ascii");
+    RecordString(c->w, "value", c->text.data);
+    RecordEnd(c->w);
+}
+
+/* Walks the strings of the file of at least the given number of characters: the number of ASCII and of UTF-16LE strings,
+ * which the JSON records follow with every string, with its file offset, RVA and section, as it's found
+ */
+static void RecordStrings(RecordWriter *w, const PeFile *pe, uint32_t minLength)
+{
+    RecordStringsCtx ctx = {w, {NULL, 0, 0}, pe};
+    uint64_t counts[2] = {0, 0};
+
+    RecordBegin(w, "strings");
+    RecordU64(w, "min_length", minLength);
+    if (w->mode == REC_JSON)
+    {
+        RecordArrayBegin(w, "hits");
+        PeStringScan(pe, minLength, RecordStringItem, &ctx, counts);
+        RecordArrayEnd(w);
+        OutFree(&ctx.text);
+    }
+    else if (w->mode == REC_CSV_ROW && !w->empty)
+        PeStringScan(pe, minLength, NULL, NULL, counts);
+    RecordU64(w, "ascii", counts[0]);
+    RecordU64(w, "utf16", counts[1]);
+    RecordEnd(w);
+}
+
+// Walks every header field of the model
+static void RecordHeaderFields(RecordWriter *w, const PeFile *pe)
+{
+    int i;
+
+    RecordBegin(w, "dos");
+    RecordFields(w, &pe->dos, &PeDosLayout);
+    RecordEnd(w);
+
+    RecordBegin(w, "coff");
+    RecordFields(w, &pe->coff, &PeCoffLayout);
+    RecordEnd(w);
+
+    RecordBegin(w, "optional");
+    RecordFields(w, &pe->opt, &PeOptionalLayout);
+    RecordEnd(w);
+
+    RecordBegin(w, "data_directories");
+    for (i = 0; i < PE_NUM_DATA_DIRECTORIES; i++)
+    {
+        RecordBegin(w, DirectoryNames[i]);
+        RecordU64(w, "rva", pe->dir[i].VirtualAddress);
+        RecordU64(w, "size", pe->dir[i].Size);
+        RecordEnd(w);
+    }
+    RecordEnd(w);
+}
+
+/* Appends the CSV header row, which names every column of the rows written by CsvRecord()
+ * It has to be written once, before the first row
+ * The digest, checksum, entropy, version, Authenticode, relocation, function, TLS, debug, load configuration, signature and string columns are only present if their stages are selected by the given options
+ */
+void CsvHeader(OutBuf *out, const RpeOptions *opts)
+{
+    RecordWriter w = {out, REC_CSV_HEADER, 0, ""};
+    PeFile blank;
+
+    memset(&blank, 0, sizeof(blank));
+    OutPuts(out, "file,status");
+    RecordError(&w, &blank);
+    if (opts->hashes)
+        RecordHashes(&w, &blank);
+    if (opts->hashes || opts->fieldValues)
+        RecordChecksum(&w, &blank);
+    if (opts->entropy)
+        RecordEntropy(&w, &blank);
+    if (opts->resources)
+        RecordVersion(&w, &blank);
+    if (opts->certificates)
+        RecordAuthenticode(&w, &blank);
+    if (opts->relocations)
+        RecordRelocations(&w, &blank);
+    if (opts->functions)
+        RecordFunctions(&w, &blank);
+    if (opts->tls)
+        RecordTls(&w, &blank);
+    if (opts->debug)
+        RecordDebug(&w, &blank);
+    if (opts->loadConfig)
+        RecordLoadConfig(&w, &blank);
+    if (opts->signatures != NULL)
+        RecordSignatures(&w, &blank);
+    if (opts->strings)
+        RecordStrings(&w, &blank, opts->strings);
+    RecordHeaderFields(&w, &blank);
+    OutChar(out, '\n');
+}
+
+/* Appends one CSV row for the given file, with the columns selected by the given options,
+ * which are empty if the file couldn't be opened or its headers couldn't be decoded
+ */
+void CsvRecord(OutBuf *out, const PeFile *pe, const RpeOptions *opts)
+{
+    RecordWriter w = {out, REC_CSV_ROW, 0, ""};
+
+    OutCsvString(out, pe->path);
+    OutChar(out, ',');
+    OutPuts(out, PeStatusName(pe->status));
+    RecordError(&w, pe);
+    if (opts->hashes)
+    {
+        w.empty = !(pe->parsed & PE_PARSED_HASHES);
+        RecordHashes(&w, pe);
+    }
+    if (opts->hashes || opts->fieldValues)
+    {
+        w.empty = !(pe->parsed & PE_PARSED_CHECKSUM);
+        RecordChecksum(&w, pe);
+    }
+    if (opts->entropy)
+    {
+        w.empty = !(pe->parsed & PE_PARSED_ENTROPY);
+        RecordEntropy(&w, pe);
+    }
+    if (opts->resources)
+    {
+        w.empty = !(pe->parsed & PE_PARSED_RESOURCES);
+        RecordVersion(&w, pe);
+    }
+    if (opts->certificates)
+    {
+        w.empty = !(pe->parsed & PE_PARSED_CERTIFICATES);
+        RecordAuthenticode(&w, pe);
+    }
+    if (opts->relocations)
+    {
+        w.empty = !(pe->parsed & PE_PARSED_RELOCATIONS);
+        RecordRelocations(&w, pe);
+    }
+    if (opts->functions)
+    {
+        w.empty = !(pe->parsed & PE_PARSED_FUNCTIONS);
+        RecordFunctions(&w, pe);
+    }
+    if (opts->tls)
+    {
+        w.empty = !(pe->parsed & PE_PARSED_TLS);
+        RecordTls(&w, pe);
+    }
+    if (opts->debug)
+    {
+        w.empty = !(pe->parsed & PE_PARSED_DEBUG);
+        RecordDebug(&w, pe);
+    }
+    if (opts->loadConfig)
+    {
+        w.empty = !(pe->parsed & PE_PARSED_LOAD_CONFIG);
+        RecordLoadConfig(&w, pe);
+    }
+    if (opts->signatures != NULL)
+    {
+        w.empty = !(pe->parsed & PE_PARSED_SIGNATURES);
+        RecordSignatures(&w, pe);
+    }
+    if (opts->strings)
+    {
+        w.empty = !PE_HEADERS_VALID(pe);
+        RecordStrings(&w, pe, opts->strings);
+    }
+    w.empty = !PE_HEADERS_VALID(pe);
+    RecordHeaderFields(&w, pe);
+    OutChar(out, '\n');
+}
+
+/* Appends one line of JSON for the given file, which only has the file name, status and digests if its headers couldn't be decoded
+ * The strings of the file are extracted into it if the given options ask for them
+ */
+void JsonRecord(OutBuf *out, const PeFile *pe, const RpeOptions *opts)
+{
+    RecordWriter w = {out, REC_JSON, 0, ""};
+
+    OutChar(out, '{');
+    RecordString(&w, "file", pe->path);
+    RecordString(&w, "status", PeStatusName(pe->status));
+    RecordError(&w, pe);
+    if (pe->parsed & PE_PARSED_HASHES)
+        RecordHashes(&w, pe);
+    if (pe->parsed & PE_PARSED_CHECKSUM)
+        RecordChecksum(&w, pe);
+    if (pe->parsed & PE_PARSED_ENTROPY)
+        RecordEntropy(&w, pe);
+    if (PE_HEADERS_VALID(pe))
+    {
+        RecordHeaderFields(&w, pe);
+        RecordSections(&w, pe);
+        if (pe->parsed & PE_PARSED_IMPORTS)
+            RecordImports(&w, pe);
+        if (pe->parsed & PE_PARSED_EXPORTS)
+            RecordExports(&w, pe);
+        if (pe->parsed & PE_PARSED_RESOURCES)
+            RecordResources(&w, pe);
+        if (pe->parsed & PE_PARSED_CERTIFICATES)
+            RecordAuthenticode(&w, pe);
+        if (pe->parsed & PE_PARSED_RELOCATIONS)
+            RecordRelocations(&w, pe);
+        if (pe->parsed & PE_PARSED_FUNCTIONS)
+            RecordFunctions(&w, pe);
+        if (pe->parsed & PE_PARSED_TLS)
+            RecordTls(&w, pe);
+        if (pe->parsed & PE_PARSED_DEBUG)
+            RecordDebug(&w, pe);
+        if (pe->parsed & PE_PARSED_LOAD_CONFIG)
+            RecordLoadConfig(&w, pe);
+        if (pe->parsed & PE_PARSED_SIGNATURES)
+            RecordSignatures(&w, pe);
+        if (opts->strings)
+            RecordStrings(&w, pe, opts->strings);
+    }
+    OutPuts(out, "}\n");
+}
@@ -0,0 +1,120 @@
+/* C-program file that contains the
+   code for the function that reports on a single file
+   for the direct options and the batch mode of rpe64.
+ */
+
+#include <stdlib.h>
+#include "rpe64Header.h"
+
+/* The following function runs the directory decoders selected by the command-line options on the given model,
+ * whose headers have been decoded, and appends their information to the given output buffer.
+ * In the JSON and CSV formats, a single record holding every decoded field is appended, and in the columnar format,
+ * the row of the file that ColumnAdd() takes.
+ * In the text format, if no PE File Header, Section Table, Import Table, Export Table, hash, entropy, resource, certificate, relocation, exception, TLS, debug or load configuration information is selected,
+ * only the filetype check is reported.
+ * It's also run on the inputs of the fuzz harness (see FuzzPe.c), which aren't files.
+ */
+void ReportPe(OutBuf *out, PeFile *pe, const RpeOptions *opts)
+{
+    /* The directory decoders are only run when their information is selected
+     * The certificate table is decoded before hashing, so that the Authenticode digest is computed in the same pass
+     */
+    if (opts->certificates)
+        PeFileCertificates(pe);
+    if (opts->imports || opts->format == RPE_FORMAT_COLUMNAR)      // The DLL names are a column of the columnar format
+        PeFileImports(pe);
+    if (opts->exports)
+        PeFileExports(pe);
+    if (opts->hashes)
+        PeFileHashes(pe);
+    if (opts->fieldValues || opts->hashes)
+        PeFileChecksum(pe);
+    if (opts->entropy)
+        PeFileEntropy(pe);
+    if (opts->resources)
+        PeFileResources(pe);
+    if (opts->certificates)
+        PeFileAuthenticode(pe);
+    if (opts->relocations > 1)
+        PeFileRelocationEntries(pe);
+    else if (opts->relocations)
+        PeFileRelocations(pe);
+    if (opts->functions)
+        PeFileFunctions(pe);
+    if (opts->tls)
+        PeFileTls(pe);
+    if (opts->debug)
+        PeFileDebug(pe);
+    if (opts->loadConfig)
+        PeFileLoadConfig(pe);
+    if (opts->signatures != NULL)
+        PeFileSignatures(pe, opts->signatures);
+
+    if (opts->format == RPE_FORMAT_JSON)
+        JsonRecord(out, pe, opts);
+    else if (opts->format == RPE_FORMAT_CSV)
+        CsvRecord(out, pe, opts);
+    else if (opts->format == RPE_FORMAT_COLUMNAR)
+        ColumnRecord(out, pe);
+    else if (!opts->fieldValues && !opts->sectionInfo && !opts->imports && !opts->exports && !opts->hashes && !opts->entropy && !opts->resources && !opts->certificates && !opts->relocations && !opts->functions && !opts->tls && !opts->debug && !opts->loadConfig && opts->signatures == NULL && !opts->strings)
+        FiletypeCheck(out, pe);
+    else
+    {
+        if (opts->fieldValues)
+            ExecutableFieldValues(out, pe);
+        if (opts->sectionInfo)
+            ExecutableSectionInfo(out, pe);
+        if (opts->imports)
+            ExecutableImports(out, pe);
+        if (opts->exports)
+            ExecutableExports(out, pe);
+        if (opts->hashes)
+            ExecutableHashes(out, pe);
+        if (opts->entropy)
+            ExecutableEntropy(out, pe);
+        if (opts->resources)
+            ExecutableResources(out, pe);
+        if (opts->certificates)
+            ExecutableCertificates(out, pe);
+        if (opts->relocations)
+            ExecutableRelocations(out, pe);
+        if (opts->functions)
+            ExecutableFunctions(out, pe);
+        if (opts->tls)
+            ExecutableTls(out, pe);
+        if (opts->debug)
+            ExecutableDebug(out, pe);
+        if (opts->loadConfig)
+            ExecutableLoadConfig(out, pe);
+        if (opts->signatures != NULL)
+            ExecutableSignatures(out, pe);
+        if (opts->strings)
+            ExecutableStrings(out, pe, opts->strings);
+    }
+}
+
+/* The following function opens the given file once, decodes its headers, and reports on it with ReportPe().
+ * With a result cache, files that haven't changed since they were cached are reported on from the cache instead,
+ * without being opened, and the reports made for the others are added to it.
+ * With a similarity index, the signature of the file is added to it as well.
+ * It returns 0 if the headers of the file could be decoded, otherwise it returns 1.
+ */
+int ReportFile(OutBuf *out, const char *path, const RpeOptions *opts)
+{
+    PeFile pe;
+    CacheKey key;
+    size_t start = out->len;
+    int rc;
+
+    if (opts->cache != NULL && !CacheLookup(opts->cache, path, &key, out, &rc))
+        return rc;
+
+    rc = PeFileOpen(&pe, path);
+    ReportPe(out, &pe, opts);
+    if (opts->similarity != NULL)
+        SimilarAdd(opts->similarity, &pe);
+    PeFileClose(&pe);
+    if (opts->cache != NULL && out->len > start)
+        CacheStore(opts->cache, &key, path, out->data + start, out->len - start, rc);
+    return rc;
+}
@@ -0,0 +1,648 @@
+/* C-program file that contains the
+   code for the persistent result cache of rpe64.
+
+   This functionality of rpe64 keeps the report of every file it scanned in a cache file ('-C <cache file>'),
+   so that the files which haven't changed since the previous scan are reported on again without being
+   opened and parsed at all: nightly scans of the same software shares mostly find the same files.
+   A file is identified by its device, inode, size, modification and status-change times (see stat()),
+   together with its path and a fingerprint of the options that shaped the report. With '-V', the hash
+   of its contents is compared as well, which still avoids parsing it but reads every byte of it.
+
+   The cache is made of two files:
+   - '<cache file>', the log, which the reports are only ever appended to. Each record holds the key of
+     a file, the path and the report itself, and a hash of both so that damaged records are never used.
+     A later record of the same file supersedes the earlier ones, which stay in the log until it's deleted.
+   - '<cache file>.idx', an open-addressing hash table from the hash of each key to the offset of its
+     latest record, covering the log up to a given size. It's memory-mapped as it is on startup, together
+     with the log, and the records appended past that size are indexed by a table on the heap instead.
+     It's rewritten (through a temporary file and a rename) when the cache is closed.
+   A record cut short by a crash, at the end of the log, is dropped when the cache is opened.
+   Both files are in the native byte order, they're meant for the machine that wrote them.
+   The log is locked while it's open, and a second rpe64 using the same cache runs without it.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "rpe64Header.h"
+
+#define CACHE_VERSION 1                 // Version of the layout of the files, and of the reports, bump it whenever either changes
+#define CACHE_INITIAL_SLOTS 1024        // Initial size of the hash table of the records appended past the index, a power of 2
+#define CACHE_RACY_SECONDS 2            // Files modified less than this long ago aren't cached, since they may still be changing within the same time stamp
+#define CACHE_HAS_CONTENT 0x1           // Flag of the records that hold the hash of the contents of their file
+
+static const char CacheLogMagic[8] = {'R', 'P', 'E', '6', '4', 'L', 'O', 'G'};
+static const char CacheIndexMagic[8] = {'R', 'P', 'E', '6', '4', 'I', 'D', 'X'};
+
+// Header at the start of the log
+typedef struct CacheLogHeader
+{
+    char magic[8];              // CacheLogMagic
+    uint32_t version;           // CACHE_VERSION
+    uint32_t recordSize;        // sizeof(CacheRecord)
+} CacheLogHeader;
+
+/* Header of each record of the log, followed by the path, the report, and padding to a multiple of 8 bytes
+ * so that the next header is aligned within the memory-mapped log
+ */
+typedef struct CacheRecord
+{
+    uint32_t magic;             // CACHE_RECORD_MAGIC
+    uint32_t flags;             // CACHE_HAS_ flags
+    uint64_t dev, ino, size, mtime, ctime;      // Key of the file, with its times in nanoseconds
+    uint64_t options;           // Fingerprint of the options the report was made with
+    uint64_t content;           // Hash of the contents of the file, if CACHE_HAS_CONTENT is set
+    uint64_t check;             // StrHash() of the path and the report
+    uint32_t pathLen;
+    uint32_t reportLen;
+    int32_t rc;                 // Return value of ReportFile() for the file
+    uint32_t reserved;
+} CacheRecord;
+
+#define CACHE_RECORD_MAGIC 0x44524352u      // 'RCRD'
+
+// Header at the start of the index, followed by slotCount CacheSlot entries
+typedef struct CacheIndexHeader
+{
+    char magic[8];              // CacheIndexMagic
+    uint32_t version;           // CACHE_VERSION
+    uint32_t recordSize;        // sizeof(CacheRecord)
+    uint64_t slotCount;         // A power of 2
+    uint64_t used;              // Number of slots in use
+    uint64_t logSize;           // Number of bytes of the log that are indexed
+} CacheIndexHeader;
+
+// Entry of the hash tables, for the latest record of a key
+typedef struct CacheSlot
+{
+    uint64_t hash;              // Hash of the key and the path, see CacheKeyHash()
+    uint64_t offset;            // Offset of the record within the log, 0 if the slot is empty
+} CacheSlot;
+
+struct ResultCache
+{
+    pthread_mutex_t lock;       // Protects the heap table and the end of the log
+    int fd;                     // Descriptor of the log, open for reading and writing
+    char *indexPath;
+    uint64_t options;           // Fingerprint of the options of this run
+    int verify;                 // 1 with '-V': hits need the hash of the contents to match as well
+    const unsigned char *log;   // Memory-mapped log, as it was when the cache was opened
+    size_t logMapped;
+    size_t logKept;             // Number of bytes of the mapped log up to the end of its last valid record
+    const CacheSlot *index;     // Slots of the memory-mapped index, NULL if there's no usable index
+    uint64_t indexSlots;
+    uint64_t indexUsed;
+    void *indexMap;
+    size_t indexMapped;
+    int indexStale;             // 1 if the index doesn't cover the log, and has to be written out again
+    CacheSlot *slots;           // Heap table of the records past the index
+    uint64_t slotCount;
+    uint64_t used;
+    uint64_t logEnd;            // Offset that the next record is appended at
+    int failed;                 // 1 once appending to the log failed, after which nothing more is appended
+};
+
+static size_t CachePad(size_t len)
+{
+    return (len + 7) & ~(size_t)7;
+}
+
+// Hashes the key of a file together with its path, this is what the hash tables are keyed by
+static uint64_t CacheKeyHash(const CacheKey *key, uint64_t options, const char *path, size_t pathLen)
+{
+    uint64_t words[6] = {key->dev, key->ino, key->size, key->mtime, key->ctime, options};
+
+    return StrHash((const char*)words, sizeof(words)) ^ (StrHash(path, pathLen) * 0x9E3779B97F4A7C15ULL);
+}
+
+/* Fingerprints the options that change what's reported for a file, so that a report is only reused by runs
+ * which would have made the same one, with the same signature rules. The thread count, the order of the reports and the input lists don't count.
+ */
+static uint64_t CacheOptions(const RpeOptions *opts)
+{
+    int32_t fields[] = {CACHE_VERSION, opts->format, opts->fieldValues, opts->sectionInfo, opts->imports, opts->exports,
+                        opts->hashes, opts->entropy, opts->resources, opts->certificates, opts->relocations,
+                        opts->functions, opts->tls, opts->debug, opts->loadConfig, (int32_t)opts->strings};
+    uint64_t rules = opts->signatures != NULL ? SigRulesHash(opts->signatures) : 0;
+
+    return StrHash((const char*)fields, sizeof(fields)) ^ rules * 0x9E3779B97F4A7C15ULL;
+}
+
+/* Hashes the contents of a file four 64-bit words at a time, for '-V'
+ * This detects files whose contents were changed while keeping their size and time stamps,
+ * it isn't meant to withstand files crafted to collide, which the '-H' digests are for
+ */
+static uint64_t CacheContentHash(const unsigned char *data, size_t size)
+{
+    uint64_t lanes[4] = {0x243F6A8885A308D3ULL, 0x13198A2E03707344ULL, 0xA4093822299F31D0ULL, 0x082EFA98EC4E6C89ULL};
+    uint64_t h = size;
+    size_t i = 0;
+    int l;
+
+    for (; i + 32 <= size; i += 32)
+        for (l = 0; l < 4; l++)
+        {
+            uint64_t w;
+
+            memcpy(&w, data + i + 8 * l, 8);
+            lanes[l] = (lanes[l] ^ w) * 0x9E3779B97F4A7C15ULL;
+            lanes[l] ^= lanes[l] >> 29;
+        }
+    for (l = 0; l < 4; l++)
+    {
+        h = (h ^ lanes[l]) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 32;
+    }
+    return h ^ StrHash((const char*)data + i, size - i);
+}
+
+// Looks a hash up in the given table, it returns the offset of its record, or 0 if it isn't there
+static uint64_t CacheProbe(const CacheSlot *slots, uint64_t slotCount, uint64_t hash)
+{
+    uint64_t mask = slotCount - 1, i;
+
+    if (slots == NULL)
+        return 0;
+
+    for (i = hash & mask; slots[i].offset != 0; i = (i + 1) & mask)
+        if (slots[i].hash == hash)
+            return slots[i].offset;
+    return 0;
+}
+
+// Adds a hash to the given table, replacing the earlier record of the same hash, the table must have a free slot
+static int CacheInsertSlot(CacheSlot *slots, uint64_t slotCount, uint64_t hash, uint64_t offset)
+{
+    uint64_t mask = slotCount - 1, i;
+
+    for (i = hash & mask; slots[i].offset != 0; i = (i + 1) & mask)
+        if (slots[i].hash == hash)
+        {
+            slots[i].offset = offset;
+            return 0;
+        }
+    slots[i].hash = hash;
+    slots[i].offset = offset;
+    return 1;
+}
+
+/* Adds a record to the heap table, which is doubled once it's half full
+ * It returns 1 if the table couldn't be grown, in which case the record is simply not found later
+ */
+static int CacheInsert(ResultCache *c, uint64_t hash, uint64_t offset)
+{
+    if ((c->used + 1) * 2 > c->slotCount)
+    {
+        uint64_t count = c->slotCount ? c->slotCount * 2 : CACHE_INITIAL_SLOTS, i;
+        CacheSlot *slots = calloc(count, sizeof(CacheSlot));
+
+        if (slots == NULL)
+            return 1;
+        for (i = 0; i < c->slotCount; i++)
+            if (c->slots[i].offset != 0)
+                CacheInsertSlot(slots, count, c->slots[i].hash, c->slots[i].offset);
+        free(c->slots);
+        c->slots = slots;
+        c->slotCount = count;
+    }
+
+    c->used += CacheInsertSlot(c->slots, c->slotCount, hash, offset);
+    return 0;
+}
+
+/* Checks whether a record header read from the given offset is well-formed, and fits within the given log size
+ * It returns the number of bytes of the whole record, or 0 if it's damaged or cut short
+ */
+static uint64_t CacheRecordSize(const CacheRecord *rec, uint64_t offset, uint64_t logSize)
+{
+    uint64_t size;
+
+    if (rec->magic != CACHE_RECORD_MAGIC || rec->pathLen == 0)
+        return 0;
+    size = sizeof(CacheRecord) + CachePad((size_t)rec->pathLen + rec->reportLen);
+    if (size > logSize - offset)
+        return 0;
+    return size;
+}
+
+/* Maps the index, if it's there and describes the given log
+ * It returns the number of bytes of the log that it covers, i.e. where the log has to be scanned from
+ */
+static uint64_t CacheMapIndex(ResultCache *c, uint64_t logSize)
+{
+    CacheIndexHeader hdr;
+    struct stat st;
+    void *map;
+    int fd = open(c->indexPath, O_RDONLY);
+
+    if (fd < 0)
+        return sizeof(CacheLogHeader);
+
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(hdr)
+        || (map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+    {
+        close(fd);
+        return sizeof(CacheLogHeader);
+    }
+    close(fd);
+
+    memcpy(&hdr, map, sizeof(hdr));
+    if (memcmp(hdr.magic, CacheIndexMagic, sizeof(hdr.magic)) || hdr.version != CACHE_VERSION
+        || hdr.recordSize != sizeof(CacheRecord) || hdr.slotCount == 0 || (hdr.slotCount & (hdr.slotCount - 1))
+        || hdr.slotCount > ((uint64_t)st.st_size - sizeof(hdr)) / sizeof(CacheSlot)
+        || (uint64_t)st.st_size != sizeof(hdr) + hdr.slotCount * sizeof(CacheSlot)
+        || hdr.used >= hdr.slotCount || hdr.logSize < sizeof(CacheLogHeader) || hdr.logSize > logSize)
+    {
+        munmap(map, (size_t)st.st_size);        // Written for another log, or by another version, it's rebuilt from the log
+        return sizeof(CacheLogHeader);
+    }
+
+    c->indexMap = map;
+    c->indexMapped = (size_t)st.st_size;
+    c->index = (const CacheSlot*)((const unsigned char*)map + sizeof(hdr));
+    c->indexSlots = hdr.slotCount;
+    c->indexUsed = hdr.used;
+    return hdr.logSize;
+}
+
+/* Indexes the records of the log past the given offset, and drops the end of the log from the first damaged record on
+ * It returns the offset of the end of the valid records
+ */
+static uint64_t CacheScanLog(ResultCache *c, uint64_t offset, uint64_t logSize)
+{
+    while (logSize - offset >= sizeof(CacheRecord))
+    {
+        CacheRecord rec;
+        CacheKey key;
+        uint64_t size;
+
+        memcpy(&rec, c->log + offset, sizeof(rec));
+        size = CacheRecordSize(&rec, offset, logSize);
+        if (size == 0)
+            break;
+
+        key.dev = rec.dev;
+        key.ino = rec.ino;
+        key.size = rec.size;
+        key.mtime = rec.mtime;
+        key.ctime = rec.ctime;
+        CacheInsert(c, CacheKeyHash(&key, rec.options, (const char*)c->log + offset + sizeof(rec), rec.pathLen), offset);
+        offset += size;
+    }
+
+    if (offset != logSize)
+    {
+        if (ftruncate(c->fd, (off_t)offset) != 0)
+            c->failed = 1;
+        c->indexStale = 1;
+    }
+    return offset;
+}
+
+/* Starts a new, empty log in the given file, e.g. when the cache is first created
+ * It returns 0 on success, otherwise it returns 1.
+ */
+static int CacheStartLog(int fd)
+{
+    CacheLogHeader hdr;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CacheLogMagic, sizeof(hdr.magic));
+    hdr.version = CACHE_VERSION;
+    hdr.recordSize = sizeof(CacheRecord);
+    if (ftruncate(fd, 0) != 0 || pwrite(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr))
+        return 1;
+    return 0;
+}
+
+/* This function opens the result cache in the given file, creating it if it doesn't exist, for a run with the given options.
+ * It returns NULL, after printing the reason, if the cache can't be used, in which case rpe64 runs without it.
+ */
+ResultCache* CacheOpen(const char *path, const RpeOptions *opts)
+{
+    ResultCache *c;
+    CacheLogHeader hdr;
+    struct flock lock;
+    struct stat st;
+    uint64_t logSize, covered;
+
+    c = calloc(1, sizeof(*c));
+    if (c == NULL || (c->indexPath = malloc(strlen(path) + sizeof(".idx"))) == NULL)
+    {
+        free(c);
+        fprintf(stderr, "%s: not enough memory for the result cache\n", path);
+        return NULL;
+    }
+    strcpy(c->indexPath, path);
+    strcat(c->indexPath, ".idx");
+    c->options = CacheOptions(opts);
+    c->verify = opts->verifyCache;
+
+    c->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (c->fd < 0)
+    {
+        fprintf(stderr, "%s: can't open the result cache\n", path);
+        free(c->indexPath);
+        free(c);
+        return NULL;
+    }
+
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    if (fcntl(c->fd, F_SETLK, &lock) != 0)
+    {
+        fprintf(stderr, "%s: the result cache is in use by another rpe64, running without it\n", path);
+        goto fail;
+    }
+
+    // A file which isn't a result cache is left alone, a cache of another version is started over
+    if (fstat(c->fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        fprintf(stderr, "%s: the result cache isn't a regular file\n", path);
+        goto fail;
+    }
+    if ((uint64_t)st.st_size >= sizeof(hdr) && pread(c->fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr))
+    {
+        fprintf(stderr, "%s: can't read the result cache\n", path);
+        goto fail;
+    }
+    if (st.st_size != 0 && ((uint64_t)st.st_size < sizeof(hdr) || memcmp(hdr.magic, CacheLogMagic, sizeof(hdr.magic))))
+    {
+        fprintf(stderr, "%s: isn't a result cache of rpe64, running without it\n", path);
+        goto fail;
+    }
+    if (st.st_size == 0 || hdr.version != CACHE_VERSION || hdr.recordSize != sizeof(CacheRecord))
+    {
+        if (CacheStartLog(c->fd))
+        {
+            fprintf(stderr, "%s: can't write the result cache\n", path);
+            goto fail;
+        }
+        unlink(c->indexPath);
+        logSize = sizeof(hdr);
+    }
+    else
+        logSize = (uint64_t)st.st_size;
+
+    c->logMapped = (size_t)logSize;
+    c->log = mmap(NULL, c->logMapped, PROT_READ, MAP_SHARED, c->fd, 0);
+    if (c->log == MAP_FAILED)
+    {
+        c->log = NULL;
+        fprintf(stderr, "%s: can't map the result cache\n", path);
+        goto fail;
+    }
+
+    covered = CacheMapIndex(c, logSize);
+    if (covered != logSize)
+        c->indexStale = 1;
+    c->logEnd = CacheScanLog(c, covered, logSize);
+    c->logKept = (size_t)c->logEnd;        // A dropped damaged end isn't read again, even though it's still mapped
+
+    pthread_mutex_init(&c->lock, NULL);
+    return c;
+
+fail:
+    close(c->fd);
+    free(c->indexPath);
+    free(c);
+    return NULL;
+}
+
+/* Reads the record at the given offset, from the mapped log if it was there on startup, otherwise from the file
+ * It returns a pointer to its path, followed by its report, or NULL if it's damaged. *owned is set to the
+ * buffer that has to be freed afterwards, if any.
+ */
+static const char* CacheReadRecord(ResultCache *c, uint64_t offset, uint64_t logEnd, CacheRecord *rec, char **owned)
+{
+    *owned = NULL;
+
+    if (offset < c->logKept)
+    {
+        if (c->logKept - offset < sizeof(*rec))
+            return NULL;
+        memcpy(rec, c->log + offset, sizeof(*rec));
+        if (CacheRecordSize(rec, offset, c->logKept) == 0)
+            return NULL;
+        return (const char*)c->log + offset + sizeof(*rec);
+    }
+
+    if (logEnd - offset < sizeof(*rec) || pread(c->fd, rec, sizeof(*rec), (off_t)offset) != (ssize_t)sizeof(*rec)
+        || CacheRecordSize(rec, offset, logEnd) == 0)
+        return NULL;
+
+    size_t len = (size_t)rec->pathLen + rec->reportLen;
+
+    *owned = malloc(len);
+    if (*owned == NULL || pread(c->fd, *owned, len, (off_t)(offset + sizeof(*rec))) != (ssize_t)len)
+    {
+        free(*owned);
+        *owned = NULL;
+        return NULL;
+    }
+    return *owned;
+}
+
+/* This function looks the given file up in the result cache, and appends its cached report to the output buffer if it's there.
+ * It fills in the key of the file either way, for CacheStore() to add the report made on a miss.
+ * It returns 0 on a hit, with *rc set to what ReportFile() returned for the file, otherwise it returns 1.
+ */
+int CacheLookup(ResultCache *c, const char *path, CacheKey *key, OutBuf *out, int *rc)
+{
+    struct stat st;
+    CacheRecord rec;
+    const char *payload;
+    char *owned;
+    size_t pathLen = strlen(path);
+    uint64_t hash, offset, logEnd;
+
+    memset(key, 0, sizeof(*key));
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode) || pathLen == 0 || pathLen > UINT32_MAX)
+        return 1;
+
+    key->dev = (uint64_t)st.st_dev;
+    key->ino = (uint64_t)st.st_ino;
+    key->size = (uint64_t)st.st_size;
+    key->mtime = (uint64_t)st.st_mtim.tv_sec * 1000000000u + (uint64_t)st.st_mtim.tv_nsec;
+    key->ctime = (uint64_t)st.st_ctim.tv_sec * 1000000000u + (uint64_t)st.st_ctim.tv_nsec;
+    // Files modified just now may change again within the same time stamp, so they're neither stored nor looked up
+    key->valid = time(NULL) - st.st_mtim.tv_sec >= CACHE_RACY_SECONDS && time(NULL) - st.st_ctim.tv_sec >= CACHE_RACY_SECONDS;
+    if (!key->valid)
+        return 1;
+
+    if (c->verify)
+    {
+        PeImage img;
+
+        if (PeImageOpen(&img, path))
+        {
+            key->valid = 0;
+            return 1;
+        }
+        key->content = CacheContentHash(img.data, img.size);
+        key->hasContent = 1;
+        PeImageClose(&img);
+    }
+
+    hash = CacheKeyHash(key, c->options, path, pathLen);
+    pthread_mutex_lock(&c->lock);
+    offset = CacheProbe(c->slots, c->slotCount, hash);      // The records past the index are the latest ones
+    logEnd = c->logEnd;
+    pthread_mutex_unlock(&c->lock);
+    if (offset == 0)
+        offset = CacheProbe(c->index, c->indexSlots, hash);
+    if (offset == 0)
+        return 1;
+
+    payload = CacheReadRecord(c, offset, logEnd, &rec, &owned);
+    if (payload == NULL || rec.dev != key->dev || rec.ino != key->ino || rec.size != key->size || rec.mtime != key->mtime
+        || rec.ctime != key->ctime || rec.options != c->options || rec.pathLen != pathLen || memcmp(payload, path, pathLen)
+        || (key->hasContent && (!(rec.flags & CACHE_HAS_CONTENT) || rec.content != key->content))
+        || rec.check != StrHash(payload, (size_t)rec.pathLen + rec.reportLen))
+    {
+        free(owned);
+        return 1;
+    }
+
+    OutWrite(out, payload + pathLen, rec.reportLen);
+    *rc = rec.rc;
+    free(owned);
+    return 0;
+}
+
+/* This function appends the report made for the given file to the result cache, under the key CacheLookup() filled in.
+ * Nothing is stored for files whose key couldn't be made, or once the log can't be written to.
+ */
+void CacheStore(ResultCache *c, const CacheKey *key, const char *path, const char *report, size_t len, int rc)
+{
+    CacheRecord rec;
+    size_t pathLen = strlen(path), size;
+    unsigned char *buf;
+
+    if (!key->valid || len > UINT32_MAX || c->failed)
+        return;
+
+    size = sizeof(rec) + CachePad(pathLen + len);
+    buf = calloc(1, size);
+    if (buf == NULL)
+        return;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = CACHE_RECORD_MAGIC;
+    rec.flags = key->hasContent ? CACHE_HAS_CONTENT : 0;
+    rec.dev = key->dev;
+    rec.ino = key->ino;
+    rec.size = key->size;
+    rec.mtime = key->mtime;
+    rec.ctime = key->ctime;
+    rec.options = c->options;
+    rec.content = key->content;
+    rec.pathLen = (uint32_t)pathLen;
+    rec.reportLen = (uint32_t)len;
+    rec.rc = rc;
+    memcpy(buf + sizeof(rec), path, pathLen);
+    if (len)
+        memcpy(buf + sizeof(rec) + pathLen, report, len);
+    rec.check = StrHash((const char*)buf + sizeof(rec), pathLen + len);
+    memcpy(buf, &rec, sizeof(rec));
+
+    // The whole record is written at once, so that a crash leaves at most one incomplete record at the end of the log
+    pthread_mutex_lock(&c->lock);
+    if (!c->failed)
+    {
+        if (pwrite(c->fd, buf, size, (off_t)c->logEnd) == (ssize_t)size)
+        {
+            CacheInsert(c, CacheKeyHash(key, c->options, path, pathLen), c->logEnd);
+            c->logEnd += size;
+        }
+        else
+        {
+            if (ftruncate(c->fd, (off_t)c->logEnd) != 0)
+                fprintf(stderr, "can't write the result cache\n");
+            c->failed = 1;
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+    free(buf);
+}
+
+/* Writes the index of the whole log, i.e. the mapped index merged with the heap table, to a temporary file
+ * that then replaces the index, so that a crash leaves either the old index or the new one
+ */
+static void CacheWriteIndex(ResultCache *c)
+{
+    CacheIndexHeader hdr;
+    CacheSlot *slots;
+    uint64_t count = CACHE_INITIAL_SLOTS, used = 0, i;
+    size_t tmpLen = strlen(c->indexPath) + sizeof(".tmp");
+    char *tmp = malloc(tmpLen);
+    FILE *fp;
+
+    while (count < (c->indexUsed + c->used + 1) * 2)
+        count *= 2;
+    slots = calloc(count, sizeof(CacheSlot));
+    if (slots == NULL || tmp == NULL)
+    {
+        free(slots);
+        free(tmp);
+        return;
+    }
+
+    for (i = 0; i < c->indexSlots; i++)
+        if (c->index[i].offset != 0)
+            used += CacheInsertSlot(slots, count, c->index[i].hash, c->index[i].offset);
+    for (i = 0; i < c->slotCount; i++)
+        if (c->slots[i].offset != 0)
+            used += CacheInsertSlot(slots, count, c->slots[i].hash, c->slots[i].offset);
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CacheIndexMagic, sizeof(hdr.magic));
+    hdr.version = CACHE_VERSION;
+    hdr.recordSize = sizeof(CacheRecord);
+    hdr.slotCount = count;
+    hdr.used = used;
+    hdr.logSize = c->logEnd;
+
+    snprintf(tmp, tmpLen, "%s.tmp", c->indexPath);
+    fp = fopen(tmp, "wb");
+    if (fp != NULL)
+    {
+        int bad = fwrite(&hdr, sizeof(hdr), 1, fp) != 1 || fwrite(slots, sizeof(CacheSlot), count, fp) != count;
+
+        if (fclose(fp) != 0 || bad || rename(tmp, c->indexPath) != 0)
+        {
+            fprintf(stderr, "%s: can't write the index of the result cache\n", c->indexPath);
+            remove(tmp);
+        }
+    }
+    free(slots);
+    free(tmp);
+}
+
+// This function writes out the index of the result cache if it changed, and closes the cache
+void CacheClose(ResultCache *c)
+{
+    if (c == NULL)
+        return;
+
+    if (c->used != 0 || c->indexStale)
+        CacheWriteIndex(c);
+
+    if (c->indexMap != NULL)
+        munmap(c->indexMap, c->indexMapped);
+    if (c->log != NULL)
+        munmap((void*)c->log, c->logMapped);
+    close(c->fd);       // Also releases the lock
+    pthread_mutex_destroy(&c->lock);
+    free(c->slots);
+    free(c->indexPath);
+    free(c);
+}
@@ -0,0 +1,934 @@
+/* C-program file that contains the
+   code for the similarity index of rpe64.
+
+   This functionality of rpe64 finds related image files, e.g. variants of the same malware family or builds of
+   the same product, without comparing every pair of them. Each file is summarized by a MinHash signature of
+   three sets of features, each given its own share of the SIM_HASHES values:
+   - its imports, as 'dll.function' in lowercase like for the imphash, delay-load imports included,
+   - its sections, as the name, the size of the raw data rounded to a quarter of a power of 2 and the
+     shared, execute, read and write flags,
+   - the entries of its Rich header, i.e. the tools of the linker that built it and how many objects each made.
+   The share of equal values of two signatures estimates the Jaccard similarity of each set, whose average
+   over the sets that aren't empty in both files is their similarity.
+
+   The signatures are kept in an index file ('-L <index file>'), by locality-sensitive hashing: the signature
+   is cut into bands of SIM_ROWS values, and files which have the same values in any band are the candidates
+   of each other, so that a query only compares the files sharing a band with it. The index is made of:
+   - '<index file>', the log, which a record with the signature and the path of each file is appended to,
+   - '<index file>.bands', the hash of every band of the latest record of each path, with the record it
+     belongs to, sorted by hash so that each band is found by a binary search. It's rebuilt from the log
+     (through a temporary file and a rename) when the index is closed after files were added to it.
+   Bands shared by more than SIM_BUCKET_MAX files, e.g. the sections of every build of a common toolchain,
+   tell nothing about a file and are skipped by queries.
+   Both files are in the native byte order, they're meant for the machine that wrote them.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "rpe64Header.h"
+
+#define SIM_IMPORT_HASHES 64            // Values of the signature for the imports, followed by those of the sections and of the Rich header
+#define SIM_SECTION_HASHES 32
+#define SIM_RICH_HASHES 32
+#define SIM_ROWS 4                      // Values per band, fewer make lower similarities likely to be found but the buckets bigger
+#define SIM_BANDS (SIM_HASHES / SIM_ROWS)
+#define SIM_BUCKET_MAX 4096             // Largest number of files sharing a band that a query compares
+#define SIM_EMPTY UINT32_MAX            // Value of the signature of an empty set, which no feature hashes to
+#define SIM_RICH_MAGIC 0x68636952u      // 'Rich'
+#define SIM_DANS_MAGIC 0x536E6144u      // 'DanS'
+
+// Sets of features of the signature, in order
+static const struct
+{
+    unsigned first, count;
+} SimParts[] = {{0, SIM_IMPORT_HASHES}, {SIM_IMPORT_HASHES, SIM_SECTION_HASHES}, {SIM_IMPORT_HASHES + SIM_SECTION_HASHES, SIM_RICH_HASHES}};
+
+// Final mix of splitmix64, which turns a hash and the index of a value into an independent hash for that value
+static uint64_t SimMix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Adds the feature in the given buffer to the values of one set of the signature, then empties the buffer
+static void SimAddFeature(uint32_t *values, unsigned count, OutBuf *feature)
+{
+    uint64_t h = StrHash(feature->data, feature->len);
+    unsigned i;
+
+    for (i = 0; i < count; i++)
+    {
+        uint32_t v = (uint32_t)(SimMix(h + (i + 1) * 0x9E3779B97F4A7C15ULL) >> 32);
+
+        if (v == SIM_EMPTY)
+            v--;
+        if (v < values[i])
+            values[i] = v;
+    }
+    OutReset(feature);
+}
+
+// Rounds a size down to a quarter of a power of 2, so that sections which grew a little between builds still match
+static unsigned SimSizeBucket(uint32_t size)
+{
+    unsigned top;
+
+    if (size < 4)
+        return size;
+    top = 31 - (unsigned)__builtin_clz(size);
+    return top * 4 + ((size >> (top - 2)) & 3);
+}
+
+/* Adds the entries of the Rich header to the given values, i.e. the product and build of each tool
+ * that made objects of the image, with the number of objects as a power of 2
+ * The header lies between the DOS Header and the PE signature: it ends with 'Rich' and an XOR key,
+ * and starts with 'DanS' XOR the key, followed by three padding words and pairs of words for each entry.
+ * It returns the number of entries.
+ */
+static unsigned SimRichHeader(const PeFile *pe, uint32_t *values, unsigned count, OutBuf *feature)
+{
+    uint32_t end = pe->dos.e_lfanew, rich, dans, key, i;
+    const unsigned char *stub = PeImageView(&pe->image, 0, end);
+    unsigned entries = 0;
+
+    if (stub == NULL)
+        return 0;
+
+    for (rich = 0x40; rich + 8 <= end; rich += 4)
+        if (ReadLe32(stub + rich) == SIM_RICH_MAGIC)
+            break;
+    if (rich + 8 > end)
+        return 0;
+    key = ReadLe32(stub + rich + 4);
+
+    for (dans = rich; dans > 0x40; )
+    {
+        dans -= 4;
+        if ((ReadLe32(stub + dans) ^ key) == SIM_DANS_MAGIC)
+            break;
+    }
+    if ((ReadLe32(stub + dans) ^ key) != SIM_DANS_MAGIC)
+        return 0;
+
+    for (i = dans + 16; i + 8 <= rich; i += 8)
+    {
+        uint32_t id = ReadLe32(stub + i) ^ key, objects = ReadLe32(stub + i + 4) ^ key;
+
+        OutPrintf(feature, "%u.%u:%u", id >> 16, id & 0xFFFF, objects ? 32 - (unsigned)__builtin_clz(objects) : 0);
+        SimAddFeature(values, count, feature);
+        entries++;
+    }
+    return entries;
+}
+
+/* This function computes the MinHash signature of the imports, sections and Rich header of the given model,
+ * decoding its imports if they haven't been already.
+ * The values of a set the file has nothing of are SIM_EMPTY.
+ * It returns the number of features found, 0 if the headers couldn't be decoded or the file has none.
+ */
+int PeFileMinHash(PeFile *pe, uint32_t sig[SIM_HASHES])
+{
+    OutBuf feature;
+    unsigned features = 0;
+    uint32_t i, j;
+
+    for (i = 0; i < SIM_HASHES; i++)
+        sig[i] = SIM_EMPTY;
+    if (!PE_HEADERS_VALID(pe))
+        return 0;
+    PeFileImports(pe);
+
+    OutInit(&feature);
+    for (i = 0; i < pe->importDllCount; i++)
+    {
+        const PeImportDll *dll = &pe->importDlls[i];
+        const char *dot = strrchr(dll->name, '.');
+        size_t nameLen = strlen(dll->name), k;
+
+        if (dot != NULL && (!strcasecmp(dot, ".dll") || !strcasecmp(dot, ".ocx") || !strcasecmp(dot, ".sys")))
+            nameLen = (size_t)(dot - dll->name);
+
+        for (j = dll->first; j < dll->first + dll->count; j++)
+        {
+            const PeImportFunc *func = &pe->importFuncs[j];
+
+            OutWrite(&feature, dll->name, nameLen);
+            OutChar(&feature, '.');
+            if (func->name != NULL)
+                OutPuts(&feature, func->name);
+            else
+                OutPrintf(&feature, "ord%u", func->ordinal);
+            for (k = 0; k < feature.len; k++)
+                if (feature.data[k] >= 'A' && feature.data[k] <= 'Z')
+                    feature.data[k] += 'a' - 'A';
+            SimAddFeature(sig + SimParts[0].first, SimParts[0].count, &feature);
+            features++;
+        }
+    }
+
+    for (i = 0; i < pe->sectionCount; i++)
+    {
+        const PeSection *s = &pe->sections[i];
+
+        OutPrintf(&feature, "%s:%u:%x", s->Name, SimSizeBucket(s->SizeOfRawData ? s->SizeOfRawData : s->VirtualSize),
+                  s->Characteristics >> 28);
+        SimAddFeature(sig + SimParts[1].first, SimParts[1].count, &feature);
+        features++;
+    }
+
+    features += SimRichHeader(pe, sig + SimParts[2].first, SimParts[2].count, &feature);
+    OutFree(&feature);
+    return (int)features;
+}
+
+/* Estimates the similarity of two files from their signatures, as the average of the share of equal values
+ * of each set, leaving out the sets that both files have nothing of
+ */
+static double SimSimilarity(const uint32_t *a, const uint32_t *b)
+{
+    double sum = 0;
+    unsigned p, i, parts = 0;
+
+    for (p = 0; p < sizeof(SimParts) / sizeof(SimParts[0]); p++)
+    {
+        unsigned first = SimParts[p].first, equal = 0;
+
+        if (a[first] == SIM_EMPTY && b[first] == SIM_EMPTY)
+            continue;
+        for (i = first; i < first + SimParts[p].count; i++)
+            equal += a[i] == b[i];
+        sum += (double)equal / SimParts[p].count;
+        parts++;
+    }
+    return parts ? sum / parts : 0;
+}
+
+// Hashes one band of a signature, together with its number so that equal values in different bands don't collide
+static uint32_t SimBandKey(unsigned band, const uint32_t *rows)
+{
+    return (uint32_t)SimMix(StrHash((const char*)rows, SIM_ROWS * sizeof(uint32_t)) + band);
+}
+
+#define SIM_VERSION 1                   // Version of the layout of the files and of the signatures, bump it whenever either changes
+#define SIM_RECORD_MAGIC 0x43455253u    // 'SREC'
+
+static const char SimLogMagic[8] = {'R', 'P', 'E', '6', '4', 'S', 'I', 'M'};
+static const char SimBandsMagic[8] = {'R', 'P', 'E', '6', '4', 'B', 'N', 'D'};
+
+// Header at the start of the log
+typedef struct SimLogHeader
+{
+    char magic[8];              // SimLogMagic
+    uint32_t version;           // SIM_VERSION
+    uint32_t hashes;            // SIM_HASHES
+} SimLogHeader;
+
+// Header of each record of the log, followed by the path and padding to a multiple of 8 bytes
+typedef struct SimRecord
+{
+    uint32_t magic;             // SIM_RECORD_MAGIC
+    uint32_t pathLen;
+    uint64_t check;             // StrHash() of the signature and the path
+    uint32_t sig[SIM_HASHES];
+} SimRecord;
+
+/* Header at the start of the band table, followed by recordCount offsets of records within the log (uint64_t),
+ * then by entryCount SimEntry entries sorted by key
+ */
+typedef struct SimBandsHeader
+{
+    char magic[8];              // SimBandsMagic
+    uint32_t version;           // SIM_VERSION
+    uint32_t hashes;            // SIM_HASHES
+    uint64_t logSize;           // Number of bytes of the log that are indexed
+    uint64_t recordCount;
+    uint64_t entryCount;
+} SimBandsHeader;
+
+// Band of the signature of a record, by the hash of its values
+typedef struct SimEntry
+{
+    uint32_t key;               // SimBandKey() of the band
+    uint32_t record;            // Index of the record within the offsets of the band table
+} SimEntry;
+
+struct SimilarityIndex
+{
+    pthread_mutex_t lock;       // Protects the end of the log
+    int fd;                     // Descriptor of the log, open for reading and writing
+    char *bandsPath;
+    uint64_t logEnd;            // Offset that the next record is appended at
+    int stale;                  // 1 if the band table doesn't cover the log, and has to be rebuilt
+    int failed;                 // 1 once appending to the log failed, after which nothing more is appended
+};
+
+static size_t SimPad(size_t len)
+{
+    return (len + 7) & ~(size_t)7;
+}
+
+/* Checks whether a record read from the given offset is well-formed, and fits within the given log size
+ * It returns the number of bytes of the whole record, or 0 if it's damaged or cut short
+ */
+static uint64_t SimRecordSize(const SimRecord *rec, uint64_t offset, uint64_t logSize)
+{
+    uint64_t size;
+
+    if (rec->magic != SIM_RECORD_MAGIC || rec->pathLen == 0)
+        return 0;
+    size = sizeof(SimRecord) + SimPad(rec->pathLen);
+    if (size > logSize - offset)
+        return 0;
+    return size;
+}
+
+// Returns the size of the log that the band table covers, or the size of the log header if there's no usable table
+static uint64_t SimBandsCover(const char *bandsPath, uint64_t logSize)
+{
+    SimBandsHeader hdr;
+    FILE *fp = fopen(bandsPath, "rb");
+    int ok;
+
+    if (fp == NULL)
+        return sizeof(SimLogHeader);
+    ok = fread(&hdr, sizeof(hdr), 1, fp) == 1 && !memcmp(hdr.magic, SimBandsMagic, sizeof(hdr.magic))
+         && hdr.version == SIM_VERSION && hdr.hashes == SIM_HASHES
+         && hdr.logSize >= sizeof(SimLogHeader) && hdr.logSize <= logSize;
+    fclose(fp);
+    return ok ? hdr.logSize : sizeof(SimLogHeader);
+}
+
+/* Starts a new, empty log in the given file, e.g. when the index is first created
+ * It returns 0 on success, otherwise it returns 1.
+ */
+static int SimStartLog(int fd)
+{
+    SimLogHeader hdr;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SimLogMagic, sizeof(hdr.magic));
+    hdr.version = SIM_VERSION;
+    hdr.hashes = SIM_HASHES;
+    if (ftruncate(fd, 0) != 0 || pwrite(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr))
+        return 1;
+    return 0;
+}
+
+/* This function opens the similarity index in the given file, creating it if it doesn't exist, for the files of a scan to be added to it.
+ * It returns NULL, after printing the reason, if the index can't be used, in which case rpe64 runs without it.
+ */
+SimilarityIndex* SimilarOpen(const char *path)
+{
+    SimilarityIndex *s;
+    SimLogHeader hdr;
+    struct flock lock;
+    struct stat st;
+    uint64_t logSize, offset;
+
+    s = calloc(1, sizeof(*s));
+    if (s == NULL || (s->bandsPath = malloc(strlen(path) + sizeof(".bands"))) == NULL)
+    {
+        free(s);
+        fprintf(stderr, "%s: not enough memory for the similarity index\n", path);
+        return NULL;
+    }
+    strcpy(s->bandsPath, path);
+    strcat(s->bandsPath, ".bands");
+
+    s->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (s->fd < 0)
+    {
+        fprintf(stderr, "%s: can't open the similarity index\n", path);
+        free(s->bandsPath);
+        free(s);
+        return NULL;
+    }
+
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    if (fcntl(s->fd, F_SETLK, &lock) != 0)
+    {
+        fprintf(stderr, "%s: the similarity index is in use by another rpe64, running without it\n", path);
+        goto fail;
+    }
+
+    // A file which isn't a similarity index is left alone, an index of another version is started over
+    if (fstat(s->fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        fprintf(stderr, "%s: the similarity index isn't a regular file\n", path);
+        goto fail;
+    }
+    if ((uint64_t)st.st_size >= sizeof(hdr) && pread(s->fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr))
+    {
+        fprintf(stderr, "%s: can't read the similarity index\n", path);
+        goto fail;
+    }
+    if (st.st_size != 0 && ((uint64_t)st.st_size < sizeof(hdr) || memcmp(hdr.magic, SimLogMagic, sizeof(hdr.magic))))
+    {
+        fprintf(stderr, "%s: isn't a similarity index of rpe64, running without it\n", path);
+        goto fail;
+    }
+    if (st.st_size == 0 || hdr.version != SIM_VERSION || hdr.hashes != SIM_HASHES)
+    {
+        if (SimStartLog(s->fd))
+        {
+            fprintf(stderr, "%s: can't write the similarity index\n", path);
+            goto fail;
+        }
+        unlink(s->bandsPath);
+        logSize = sizeof(hdr);
+        s->stale = 1;
+    }
+    else
+        logSize = (uint64_t)st.st_size;
+
+    // The records past the band table are checked, and the end of the log is dropped from the first damaged one on
+    offset = SimBandsCover(s->bandsPath, logSize);
+    if (offset != logSize)
+        s->stale = 1;
+    while (logSize - offset >= sizeof(SimRecord))
+    {
+        SimRecord rec;
+        uint64_t size;
+
+        if (pread(s->fd, &rec, sizeof(rec), (off_t)offset) != (ssize_t)sizeof(rec))
+            break;
+        size = SimRecordSize(&rec, offset, logSize);
+        if (size == 0)
+            break;
+        offset += size;
+    }
+    if (offset != logSize && ftruncate(s->fd, (off_t)offset) != 0)
+        s->failed = 1;
+    s->logEnd = offset;
+
+    pthread_mutex_init(&s->lock, NULL);
+    return s;
+
+fail:
+    close(s->fd);
+    free(s->bandsPath);
+    free(s);
+    return NULL;
+}
+
+/* This function adds the signature of the given model to the similarity index, under its path.
+ * Files whose headers couldn't be decoded, or that have no imports, sections or Rich header, aren't added.
+ */
+void SimilarAdd(SimilarityIndex *s, PeFile *pe)
+{
+    SimRecord rec;
+    size_t pathLen = strlen(pe->path), size;
+    unsigned char *buf;
+
+    if (s->failed || pathLen == 0 || pathLen > UINT32_MAX)
+        return;
+
+    memset(&rec, 0, sizeof(rec));
+    if (PeFileMinHash(pe, rec.sig) == 0)
+        return;
+
+    size = sizeof(rec) + SimPad(pathLen);
+    buf = calloc(1, size);
+    if (buf == NULL)
+        return;
+    rec.magic = SIM_RECORD_MAGIC;
+    rec.pathLen = (uint32_t)pathLen;
+    memcpy(buf, &rec, sizeof(rec));
+    memcpy(buf + sizeof(rec), pe->path, pathLen);
+    rec.check = StrHash((const char*)buf + offsetof(SimRecord, sig), sizeof(rec.sig) + pathLen);
+    memcpy(buf, &rec, sizeof(rec));
+
+    // The whole record is written at once, so that a crash leaves at most one incomplete record at the end of the log
+    pthread_mutex_lock(&s->lock);
+    if (!s->failed)
+    {
+        if (pwrite(s->fd, buf, size, (off_t)s->logEnd) == (ssize_t)size)
+        {
+            s->logEnd += size;
+            s->stale = 1;
+        }
+        else
+        {
+            if (ftruncate(s->fd, (off_t)s->logEnd) != 0)
+                fprintf(stderr, "can't write the similarity index\n");
+            s->failed = 1;
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+    free(buf);
+}
+
+// Orders the entries of the band table by key, then by record
+static int SimEntryCompare(const void *a, const void *b)
+{
+    const SimEntry *x = a, *y = b;
+
+    if (x->key != y->key)
+        return x->key < y->key ? -1 : 1;
+    return (x->record > y->record) - (x->record < y->record);
+}
+
+/* Returns the record at the given offset of the mapped log if it's intact, i.e. its check matches,
+ * otherwise it returns NULL
+ */
+static const SimRecord* SimRecordAt(const unsigned char *log, uint64_t logSize, uint64_t offset)
+{
+    const SimRecord *rec;
+
+    if (offset < sizeof(SimLogHeader) || offset > logSize || logSize - offset < sizeof(SimRecord) || (offset & 7))
+        return NULL;
+    rec = (const SimRecord*)(log + offset);
+    if (SimRecordSize(rec, offset, logSize) == 0
+        || rec->check != StrHash((const char*)rec->sig, sizeof(rec->sig) + rec->pathLen))
+        return NULL;
+    return rec;
+}
+
+/* Rebuilds the band table from the whole log, keeping only the latest record of each path,
+ * into a temporary file that then replaces the table, so that a crash leaves either the old table or the new one
+ * It returns 0 on success, otherwise it returns 1.
+ */
+static int SimWriteBands(SimilarityIndex *s)
+{
+    SimBandsHeader hdr;
+    const unsigned char *log;
+    uint64_t *offsets = NULL, *slots = NULL, offset, count = 0, slotCount = 16, i, used = 0;
+    SimEntry *entries = NULL;
+    size_t tmpLen = strlen(s->bandsPath) + sizeof(".tmp");
+    char *tmp = malloc(tmpLen);
+    int rc = 1;
+    FILE *fp;
+
+    if (tmp == NULL)
+        return 1;
+    log = mmap(NULL, (size_t)s->logEnd, PROT_READ, MAP_SHARED, s->fd, 0);
+    if (log == MAP_FAILED)
+    {
+        free(tmp);
+        return 1;
+    }
+
+    for (offset = sizeof(SimLogHeader); s->logEnd - offset >= sizeof(SimRecord); count++)
+    {
+        uint64_t size = SimRecordSize((const SimRecord*)(log + offset), offset, s->logEnd);
+
+        if (size == 0)
+            break;
+        offset += size;
+    }
+    while (slotCount < count * 2)
+        slotCount *= 2;
+    offsets = malloc((count ? count : 1) * sizeof(uint64_t));
+    slots = calloc(slotCount, sizeof(uint64_t));
+    if (offsets == NULL || slots == NULL)
+        goto done;
+
+    // The slots of the hash table of the paths hold the index of the record plus 1, a later record of a path replaces the earlier one
+    for (offset = sizeof(SimLogHeader); s->logEnd - offset >= sizeof(SimRecord); )
+    {
+        const SimRecord *rec = (const SimRecord*)(log + offset);
+        const char *path = (const char*)(rec + 1);
+        uint64_t size = SimRecordSize(rec, offset, s->logEnd);
+
+        if (size == 0)
+            break;
+        if (SimRecordAt(log, s->logEnd, offset) != NULL)
+        {
+            for (i = StrHash(path, rec->pathLen) & (slotCount - 1); slots[i] != 0; i = (i + 1) & (slotCount - 1))
+            {
+                const SimRecord *other = (const SimRecord*)(log + offsets[slots[i] - 1]);
+
+                if (other->pathLen == rec->pathLen && !memcmp(other + 1, path, rec->pathLen))
+                    break;
+            }
+            if (slots[i] == 0)
+                slots[i] = ++used;
+            offsets[slots[i] - 1] = offset;
+        }
+        offset += size;
+    }
+
+    entries = malloc((used ? used : 1) * SIM_BANDS * sizeof(SimEntry));
+    if (entries == NULL)
+        goto done;
+    count = 0;
+    for (i = 0; i < used; i++)
+    {
+        const SimRecord *rec = (const SimRecord*)(log + offsets[i]);
+        unsigned b;
+
+        for (b = 0; b < SIM_BANDS; b++)
+            if (rec->sig[b * SIM_ROWS] != SIM_EMPTY)        // The bands of empty sets would put every file without them in one bucket
+            {
+                entries[count].key = SimBandKey(b, rec->sig + b * SIM_ROWS);
+                entries[count].record = (uint32_t)i;
+                count++;
+            }
+    }
+    qsort(entries, count, sizeof(SimEntry), SimEntryCompare);
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SimBandsMagic, sizeof(hdr.magic));
+    hdr.version = SIM_VERSION;
+    hdr.hashes = SIM_HASHES;
+    hdr.logSize = s->logEnd;
+    hdr.recordCount = used;
+    hdr.entryCount = count;
+
+    snprintf(tmp, tmpLen, "%s.tmp", s->bandsPath);
+    fp = fopen(tmp, "wb");
+    if (fp != NULL)
+    {
+        int bad = fwrite(&hdr, sizeof(hdr), 1, fp) != 1 || fwrite(offsets, sizeof(uint64_t), used, fp) != used
+                  || fwrite(entries, sizeof(SimEntry), count, fp) != count;
+
+        if (fclose(fp) != 0 || bad || rename(tmp, s->bandsPath) != 0)
+            remove(tmp);
+        else
+            rc = 0;
+    }
+
+done:
+    munmap((void*)log, (size_t)s->logEnd);
+    free(entries);
+    free(slots);
+    free(offsets);
+    free(tmp);
+    return rc;
+}
+
+/* This function rebuilds the band table of the similarity index if files were added to it, and closes the index
+ * It returns 0 on success, otherwise it returns 1 after printing the reason.
+ */
+int SimilarClose(SimilarityIndex *s)
+{
+    int rc = 0;
+
+    if (s == NULL)
+        return 0;
+
+    if (s->stale && SimWriteBands(s))
+    {
+        fprintf(stderr, "%s: can't write the band table of the similarity index\n", s->bandsPath);
+        rc = 1;
+    }
+    if (s->failed)
+        rc = 1;
+
+    close(s->fd);       // Also releases the lock
+    pthread_mutex_destroy(&s->lock);
+    free(s->bandsPath);
+    free(s);
+    return rc;
+}
+
+// Files found similar to a query, with their similarity
+typedef struct SimMatch
+{
+    const SimRecord *rec;
+    double similarity;
+} SimMatch;
+
+// Index being queried, with its files mapped
+typedef struct SimQuery
+{
+    PeImage log, bands;
+    SimBandsHeader hdr;
+    const uint64_t *offsets;
+    const SimEntry *entries;
+    uint32_t *seen;             // Number of the last query that compared each record, so that it's compared only once per query
+    uint32_t queries;
+    double threshold;           // Lowest similarity that's reported
+    uint64_t limit;             // Largest number of matches reported per query
+    SimMatch *matches;
+    uint64_t matchCount, matchCap;
+    OutBuf out, path;
+} SimQuery;
+
+static void SimUsage(void)
+{
+    fprintf(stderr, "usage: rpe64 similar [-n <matches>] [-t <similarity>] <index file> <file>...\n"
+                    "       rpe64 similar [-n <matches>] [-t <similarity>] -a <index file>\n"
+                    "  writes the files of the index ('-L <index file>') most similar to each given file, as CSV\n"
+                    "  -n: largest number of matches per file (default: 10)\n"
+                    "  -t: lowest similarity, between 0 and 1 (default: 0.5)\n"
+                    "  -a: compares every file of the index with the others, writing each pair once\n");
+}
+
+// Orders the matches by decreasing similarity, then by path
+static int SimMatchCompare(const void *a, const void *b)
+{
+    const SimMatch *x = a, *y = b;
+    uint32_t len = x->rec->pathLen < y->rec->pathLen ? x->rec->pathLen : y->rec->pathLen;
+    int c;
+
+    if (x->similarity != y->similarity)
+        return x->similarity > y->similarity ? -1 : 1;
+    c = memcmp(x->rec + 1, y->rec + 1, len);
+    return c ? c : (x->rec->pathLen > y->rec->pathLen) - (x->rec->pathLen < y->rec->pathLen);
+}
+
+/* Maps the index and its band table, and checks that the table fits the log
+ * It returns 0 on success, otherwise it returns 1 after printing the reason.
+ */
+static int SimQueryOpen(SimQuery *q, const char *path)
+{
+    size_t bandsLen = strlen(path) + sizeof(".bands");
+    char *bandsPath = malloc(bandsLen);
+    uint64_t tables;
+
+    if (bandsPath == NULL || PeImageOpen(&q->log, path))
+    {
+        fprintf(stderr, "rpe64 similar: can't open '%s'\n", path);
+        free(bandsPath);
+        return 1;
+    }
+    snprintf(bandsPath, bandsLen, "%s.bands", path);
+    if (q->log.size < sizeof(SimLogHeader) || memcmp(q->log.data, SimLogMagic, sizeof(SimLogMagic)))
+    {
+        fprintf(stderr, "rpe64 similar: '%s' isn't a similarity index of rpe64 ('-L <index file>')\n", path);
+        goto fail;
+    }
+    if (PeImageOpen(&q->bands, bandsPath))
+    {
+        fprintf(stderr, "rpe64 similar: can't open '%s', scan files into the index with '-L %s' first\n", bandsPath, path);
+        goto fail;
+    }
+
+    if (q->bands.size >= sizeof(q->hdr))
+        memcpy(&q->hdr, q->bands.data, sizeof(q->hdr));
+    tables = q->hdr.recordCount * sizeof(uint64_t) + q->hdr.entryCount * sizeof(SimEntry);
+    if (q->bands.size < sizeof(q->hdr) || memcmp(q->hdr.magic, SimBandsMagic, sizeof(SimBandsMagic))
+        || q->hdr.version != SIM_VERSION || q->hdr.hashes != SIM_HASHES || q->hdr.logSize > q->log.size
+        || q->hdr.recordCount > UINT32_MAX || q->hdr.entryCount > q->hdr.recordCount * SIM_BANDS
+        || tables != q->bands.size - sizeof(q->hdr))
+    {
+        fprintf(stderr, "rpe64 similar: '%s' is damaged or was written by another version of rpe64, scan the files again\n", bandsPath);
+        PeImageClose(&q->bands);
+        goto fail;
+    }
+    if (q->hdr.logSize < q->log.size)
+        fprintf(stderr, "rpe64 similar: the last scan into '%s' didn't finish, the files it added are left out\n", path);
+
+    q->offsets = (const uint64_t*)(q->bands.data + sizeof(q->hdr));
+    q->entries = (const SimEntry*)(q->offsets + q->hdr.recordCount);
+    free(bandsPath);
+    return 0;
+
+fail:
+    PeImageClose(&q->log);
+    free(bandsPath);
+    return 1;
+}
+
+/* Finds the files of the index that share a band with the given signature, and keeps those at least as similar as the threshold
+ * Records up to the given one are left out, so that '-a' writes each pair once. It returns 1 if it ran out of memory.
+ */
+static int SimQueryFind(SimQuery *q, const uint32_t *sig, uint64_t after)
+{
+    unsigned b;
+
+    q->matchCount = 0;
+    if (++q->queries == 0)
+    {
+        memset(q->seen, 0, q->hdr.recordCount * sizeof(uint32_t));
+        q->queries = 1;
+    }
+
+    for (b = 0; b < SIM_BANDS; b++)
+    {
+        uint32_t key;
+        uint64_t lo = 0, hi = q->hdr.entryCount, end;
+
+        if (sig[b * SIM_ROWS] == SIM_EMPTY)
+            continue;
+        key = SimBandKey(b, sig + b * SIM_ROWS);
+
+        while (lo < hi)
+        {
+            uint64_t mid = lo + (hi - lo) / 2;
+
+            if (q->entries[mid].key < key)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        for (end = lo; end < q->hdr.entryCount && q->entries[end].key == key; end++)
+            ;
+        if (end - lo > SIM_BUCKET_MAX)
+            continue;
+
+        for (; lo < end; lo++)
+        {
+            uint32_t r = q->entries[lo].record;
+            const SimRecord *rec;
+            double similarity;
+
+            if (r >= q->hdr.recordCount || q->seen[r] == q->queries || (after != UINT64_MAX && r <= after))
+                continue;
+            q->seen[r] = q->queries;
+            rec = SimRecordAt(q->log.data, q->hdr.logSize, q->offsets[r]);
+            if (rec == NULL)
+                continue;
+            similarity = SimSimilarity(sig, rec->sig);
+            if (similarity < q->threshold)
+                continue;
+
+            if (q->matchCount == q->matchCap)
+            {
+                uint64_t cap = q->matchCap ? q->matchCap * 2 : 64;
+                SimMatch *grown = realloc(q->matches, cap * sizeof(SimMatch));
+
+                if (grown == NULL)
+                    return 1;
+                q->matches = grown;
+                q->matchCap = cap;
+            }
+            q->matches[q->matchCount].rec = rec;
+            q->matches[q->matchCount].similarity = similarity;
+            q->matchCount++;
+        }
+    }
+
+    if (q->matchCount)
+        qsort(q->matches, q->matchCount, sizeof(SimMatch), SimMatchCompare);
+    return 0;
+}
+
+// Writes a path of the given length as a CSV field, the paths of the log aren't NUL-terminated
+static void SimWritePath(SimQuery *q, const char *path, size_t len)
+{
+    OutReset(&q->path);
+    OutWrite(&q->path, path, len);
+    OutChar(&q->path, '\0');
+    OutCsvString(&q->out, q->path.data);
+}
+
+// Writes the best matches of a query as CSV rows
+static void SimQueryWrite(SimQuery *q, const char *file, size_t fileLen)
+{
+    uint64_t i;
+
+    for (i = 0; i < q->matchCount && (q->limit == 0 || i < q->limit); i++)
+    {
+        SimWritePath(q, file, fileLen);
+        OutPrintf(&q->out, ",%.3f,", q->matches[i].similarity);
+        SimWritePath(q, (const char*)(q->matches[i].rec + 1), q->matches[i].rec->pathLen);
+        OutChar(&q->out, '\n');
+    }
+    if (q->out.len >= 65536)
+        OutFlush(&q->out, stdout);
+}
+
+/* This function runs 'rpe64 similar', which writes the files of a similarity index that are most similar to the given files,
+ * or every pair of similar files of the index with '-a', as CSV rows of the file, the similarity and the similar file.
+ * It returns 0 on success, otherwise it returns 1.
+ */
+int SimilarMain(int argc, char *argv[])
+{
+    SimQuery q;
+    int ch, i, all = 0, oom = 0, rc = 0;
+
+    memset(&q, 0, sizeof(q));
+    q.threshold = 0.5;
+    q.limit = 10;
+    optind = 1;
+    while ((ch = getopt(argc, argv, "n:t:a")) != -1)
+        switch (ch)
+        {
+            case 'n':
+                q.limit = strtoull(optarg, NULL, 10);
+                break;
+            case 't':
+                q.threshold = atof(optarg);
+                break;
+            case 'a':
+                all = 1;
+                break;
+            default:
+                SimUsage();
+                return 1;
+        }
+    argc -= optind;
+    argv += optind;
+    if (argc < 1 || (all ? argc != 1 : argc < 2))
+    {
+        SimUsage();
+        return 1;
+    }
+
+    if (SimQueryOpen(&q, argv[0]))
+        return 1;
+    q.seen = calloc(q.hdr.recordCount ? q.hdr.recordCount : 1, sizeof(uint32_t));
+    if (q.seen == NULL)
+    {
+        fprintf(stderr, "rpe64 similar: out of memory\n");
+        PeImageClose(&q.bands);
+        PeImageClose(&q.log);
+        return 1;
+    }
+
+    OutInit(&q.out);
+    OutInit(&q.path);
+    OutPuts(&q.out, "file,similarity,match\n");
+    if (all)
+    {
+        uint64_t r;
+
+        for (r = 0; r < q.hdr.recordCount && !oom; r++)
+        {
+            const SimRecord *rec = SimRecordAt(q.log.data, q.hdr.logSize, q.offsets[r]);
+
+            if (rec == NULL)
+                continue;
+            oom = SimQueryFind(&q, rec->sig, r);
+            SimQueryWrite(&q, (const char*)(rec + 1), rec->pathLen);
+        }
+    }
+    else
+        for (i = 1; i < argc && !oom; i++)
+        {
+            uint32_t sig[SIM_HASHES];
+            PeFile pe;
+
+            if (PeFileOpen(&pe, argv[i]) || PeFileMinHash(&pe, sig) == 0)
+            {
+                fprintf(stderr, "rpe64 similar: '%s' isn't a PE image file with imports, sections or a Rich header\n", argv[i]);
+                PeFileClose(&pe);
+                rc = 1;
+                continue;
+            }
+            PeFileClose(&pe);
+            oom = SimQueryFind(&q, sig, UINT64_MAX);
+            SimQueryWrite(&q, argv[i], strlen(argv[i]));
+        }
+    if (oom)
+    {
+        fprintf(stderr, "rpe64 similar: out of memory\n");
+        rc = 1;
+    }
+
+    if (OutFlush(&q.out, stdout))
+        rc = 1;
+    OutFree(&q.out);
+    OutFree(&q.path);
+    free(q.matches);
+    free(q.seen);
+    PeImageClose(&q.bands);
+    PeImageClose(&q.log);
+    return rc;
+}
@@ -0,0 +1,172 @@
+/* C-program file that contains the
+   code for the interned string pool shared by the directory decoders.
+
+   The names found within image files (DLL names, imported and exported function names)
+   repeat across almost every file of a batch scan: thousands of files import
+   'KERNEL32.dll!CreateFileW', and each of them would otherwise hold its own copy.
+   StrIntern() stores every distinct string once, in large arena chunks instead of
+   one allocation per name, and returns the same pointer for equal strings,
+   so interned strings can also be compared by pointer.
+
+   The pool is shared by all the worker threads of the batch mode. It's split into
+   shards, each with its own lock, hash table and arena, so that threads interning
+   different strings rarely wait for each other. Interned strings live until the program exits.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "rpe64Header.h"
+
+#define POOL_SHARDS 16                  // Number of independently locked parts of the pool, a power of 2
+#define POOL_INITIAL_SLOTS 1024         // Initial size of the hash table of each shard, a power of 2
+#define POOL_CHUNK_SIZE (64 * 1024)     // Size of each arena chunk the strings are copied into
+
+// Entry of the hash table of a shard
+typedef struct PoolSlot
+{
+    uint64_t hash;
+    uint32_t len;
+    const char *str;            // NULL if the slot is empty
+} PoolSlot;
+
+typedef struct PoolShard
+{
+    pthread_mutex_t lock;
+    PoolSlot *slots;
+    size_t slotCount;           // Size of the hash table, a power of 2
+    size_t used;                // Number of strings in the hash table
+    char *chunk;                // Arena chunk that new strings are copied into
+    size_t chunkLeft;           // Number of free bytes at the end of the chunk
+} PoolShard;
+
+static PoolShard Shards[POOL_SHARDS];
+static pthread_once_t PoolOnce = PTHREAD_ONCE_INIT;
+
+static void PoolInit(void)
+{
+    int i;
+
+    for (i = 0; i < POOL_SHARDS; i++)
+        pthread_mutex_init(&Shards[i].lock, NULL);
+}
+
+// 64-bit FNV-1a hash of the given bytes, which is also used by the hash tables of the directory decoders
+uint64_t StrHash(const char *str, size_t len)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)str[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/* Doubles the hash table of the shard, or creates it if it's empty
+ * It returns 0 on success, otherwise it returns 1 and leaves the table unchanged
+ */
+static int PoolGrow(PoolShard *shard)
+{
+    size_t count = shard->slotCount ? shard->slotCount * 2 : POOL_INITIAL_SLOTS;
+    PoolSlot *slots = calloc(count, sizeof(PoolSlot));
+    size_t i;
+
+    if (slots == NULL)
+        return 1;
+
+    for (i = 0; i < shard->slotCount; i++)
+    {
+        const PoolSlot *old = &shard->slots[i];
+        size_t at;
+
+        if (old->str == NULL)
+            continue;
+        for (at = old->hash & (count - 1); slots[at].str != NULL; at = (at + 1) & (count - 1))
+            ;
+        slots[at] = *old;
+    }
+
+    free(shard->slots);
+    shard->slots = slots;
+    shard->slotCount = count;
+    return 0;
+}
+
+// Copies a string into the arena of the shard, returning NULL if there's no memory for it
+static const char* PoolCopy(PoolShard *shard, const char *str, size_t len)
+{
+    char *copy;
+
+    // Strings too long for a chunk get an allocation of their own
+    if (len + 1 > POOL_CHUNK_SIZE / 4)
+        copy = malloc(len + 1);
+    else
+    {
+        if (len + 1 > shard->chunkLeft)
+        {
+            shard->chunk = malloc(POOL_CHUNK_SIZE);
+            shard->chunkLeft = shard->chunk ? POOL_CHUNK_SIZE : 0;
+            if (shard->chunk == NULL)
+                return NULL;
+        }
+        copy = shard->chunk;
+        shard->chunk += len + 1;
+        shard->chunkLeft -= len + 1;
+    }
+
+    if (copy == NULL)
+        return NULL;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+/* This function returns the interned copy of the given string of the given length,
+ * which doesn't need to be NUL-terminated, adding it to the pool if it isn't already there.
+ * Equal strings always get the same pointer.
+ * It returns NULL if there's no memory for a new string.
+ */
+const char* StrIntern(const char *str, size_t len)
+{
+    uint64_t hash = StrHash(str, len);
+    PoolShard *shard = &Shards[hash >> 60 & (POOL_SHARDS - 1)];
+    const char *found = NULL;
+    size_t at;
+
+    if (len > UINT32_MAX)
+        return NULL;
+
+    pthread_once(&PoolOnce, PoolInit);
+    pthread_mutex_lock(&shard->lock);
+
+    // The table is kept at most 3/4 full, so that the probe sequences stay short
+    if ((shard->used + 1) * 4 > shard->slotCount * 3 && PoolGrow(shard))
+        goto done;
+
+    for (at = hash & (shard->slotCount - 1); shard->slots[at].str != NULL; at = (at + 1) & (shard->slotCount - 1))
+    {
+        const PoolSlot *slot = &shard->slots[at];
+
+        if (slot->hash == hash && slot->len == len && memcmp(slot->str, str, len) == 0)
+        {
+            found = slot->str;
+            goto done;
+        }
+    }
+
+    found = PoolCopy(shard, str, len);
+    if (found != NULL)
+    {
+        shard->slots[at].hash = hash;
+        shard->slots[at].len = (uint32_t)len;
+        shard->slots[at].str = found;
+        shard->used++;
+    }
+
+done:
+    pthread_mutex_unlock(&shard->lock);
+    return found;
+}
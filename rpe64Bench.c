@@ -0,0 +1,309 @@
+/* C-program file that contains the
+   main function of the rpe64bench program, the benchmark of the stages of rpe64.
+
+   This program writes a corpus of synthetic image files (see BenchCorpus.c), or takes the given files,
+   and runs every stage of rpe64 on each of them in turn, timing each stage on its own:
+   opening and mapping the file, decoding the headers and showing them as ExecutableFieldValues() does,
+   decoding the Section Table, the imports and the exports, hashing, entropy, extracting the strings, the PE checksum,
+   and formatting the JSON and CSV records.
+   For each stage it reports the throughput in files and megabytes per second, and the median (p50)
+   and 99th percentile (p99) latency per file, so that the effect of a change on throughput can be measured.
+
+   The corpus is cached by the operating system after it's written, so the benchmark measures
+   rpe64 itself rather than the disk. Every file is run through the stages once per round.
+ */
+
+#define _POSIX_C_SOURCE 200809L    // for getopt(), clock_gettime() and mkdir() under -std=c17
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "rpe64Header.h"
+
+#define BENCH_DEFAULT_FILES 200
+#define BENCH_DEFAULT_ROUNDS 3
+#define BENCH_DEFAULT_SEED 1
+#define BENCH_DEFAULT_DIR "bench_corpus"
+#define BENCH_STRING_LENGTH 4       // Least number of characters of the strings extracted, as by 'strings'
+
+// Stages of rpe64 that are timed on their own, in the order in which they're run on each file
+enum
+{
+    STAGE_OPEN,         // PeImageOpen(): opening and mapping the file
+    STAGE_HEADERS,      // ParsePeHeaders() and ExecutableFieldValues()
+    STAGE_SECTIONS,     // ExecutableSectionInfo()
+    STAGE_IMPORTS,      // PeFileImports() and ExecutableImports()
+    STAGE_EXPORTS,      // PeFileExports() and ExecutableExports()
+    STAGE_HASHES,       // PeFileHashes()
+    STAGE_ENTROPY,      // PeFileEntropy()
+    STAGE_STRINGS,      // PeStringScan()
+    STAGE_CHECKSUM,     // PeFileChecksum()
+    STAGE_FORMAT,       // JsonRecord() and CsvRecord()
+    STAGE_CLOSE,        // PeFileClose()
+    STAGE_COUNT
+};
+
+static const char *const StageNames[STAGE_COUNT + 1] =
+{
+    "open/map", "headers", "sections", "imports", "exports", "hashes", "entropy", "strings", "checksum", "format", "close", "total"
+};
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int LatencyCompare(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Runs every stage on the given file, and stores the time each stage took, in seconds, into the given array
+ * The output of the stages is appended to the given buffer, which is emptied after each file
+ */
+static void BenchFile(const char *path, OutBuf *out, const RpeOptions *opts, double times[STAGE_COUNT])
+{
+    PeFile pe;
+    double t0, t1;
+    uint64_t counts[2];
+
+    memset(&pe, 0, sizeof(pe));
+    pe.path = path;
+
+    t0 = Now();
+    if (PeImageOpen(&pe.image, path))
+        pe.status = PE_STATUS_OPEN_FAILED;
+    t1 = Now();
+    times[STAGE_OPEN] = t1 - t0;
+
+    t0 = t1;
+    if (pe.status != PE_STATUS_OPEN_FAILED)
+        ParsePeHeaders(&pe);
+    ExecutableFieldValues(out, &pe);
+    t1 = Now();
+    times[STAGE_HEADERS] = t1 - t0;
+
+    t0 = t1;
+    ExecutableSectionInfo(out, &pe);
+    t1 = Now();
+    times[STAGE_SECTIONS] = t1 - t0;
+
+    t0 = t1;
+    PeFileImports(&pe);
+    ExecutableImports(out, &pe);
+    t1 = Now();
+    times[STAGE_IMPORTS] = t1 - t0;
+
+    t0 = t1;
+    PeFileExports(&pe);
+    ExecutableExports(out, &pe);
+    t1 = Now();
+    times[STAGE_EXPORTS] = t1 - t0;
+
+    t0 = t1;
+    PeFileHashes(&pe);
+    t1 = Now();
+    times[STAGE_HASHES] = t1 - t0;
+
+    t0 = t1;
+    PeFileEntropy(&pe);
+    t1 = Now();
+    times[STAGE_ENTROPY] = t1 - t0;
+
+    t0 = t1;
+    PeStringScan(&pe, BENCH_STRING_LENGTH, NULL, NULL, counts);
+    t1 = Now();
+    times[STAGE_STRINGS] = t1 - t0;
+
+    // The hashing pass computes the checksum as well, so it's computed again on its own to time it
+    t0 = t1;
+    pe.parsed &= ~PE_PARSED_CHECKSUM;
+    PeFileChecksum(&pe);
+    t1 = Now();
+    times[STAGE_CHECKSUM] = t1 - t0;
+
+    t0 = t1;
+    JsonRecord(out, &pe, opts);
+    CsvRecord(out, &pe, opts);
+    t1 = Now();
+    times[STAGE_FORMAT] = t1 - t0;
+
+    t0 = t1;
+    PeFileClose(&pe);
+    t1 = Now();
+    times[STAGE_CLOSE] = t1 - t0;
+
+    OutReset(out);
+}
+
+/* Writes the synthetic corpus of the given seed into the given directory, and stores the paths of its files
+ * It returns 0 on success, otherwise it returns 1
+ */
+static int WriteCorpus(const char *dir, int count, uint32_t seed, char **paths)
+{
+    int i;
+
+    if (mkdir(dir, 0755) && errno != EEXIST)
+    {
+        fprintf(stderr, "rpe64bench: can't create the directory '%s'\n", dir);
+        return 1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        BenchShape shape;
+        size_t len = strlen(dir) + 32;
+
+        paths[i] = malloc(len);
+        if (paths[i] == NULL)
+            return 1;
+        snprintf(paths[i], len, "%s/bench%05d.exe", dir, i);
+
+        BenchRandomShape(&shape, seed, (uint32_t)i);
+        if (BenchWritePe(paths[i], &shape) == 0)
+        {
+            fprintf(stderr, "rpe64bench: can't write '%s'\n", paths[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "Usage: rpe64bench [-n files] [-r rounds] [-S seed] [-d directory] [file...]\n\n"
+            "Writes a corpus of synthetic PE32 and PE32+ image files (%d by default) into the directory\n"
+            "('%s' by default), or takes the given files instead, and times every stage of rpe64 on them\n"
+            "over a number of rounds (%d by default). The same seed always gives the same corpus.\n",
+            BENCH_DEFAULT_FILES, BENCH_DEFAULT_DIR, BENCH_DEFAULT_ROUNDS);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *dir = BENCH_DEFAULT_DIR;
+    int files = BENCH_DEFAULT_FILES, rounds = BENCH_DEFAULT_ROUNDS, ch, i, r, s;
+    uint32_t seed = BENCH_DEFAULT_SEED;
+    char **paths;
+    double *latency[STAGE_COUNT + 1], times[STAGE_COUNT], total[STAGE_COUNT + 1];
+    uint64_t bytes = 0;
+    size_t runs;
+    RpeOptions opts;
+    OutBuf out;
+
+    while ((ch = getopt(argc, argv, "n:r:S:d:")) != -1)
+        switch (ch)
+        {
+            case 'n':
+                files = atoi(optarg);
+                break;
+            case 'r':
+                rounds = atoi(optarg);
+                break;
+            case 'S':
+                seed = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'd':
+                dir = optarg;
+                break;
+            default:
+                usage();
+                return 1;
+        }
+
+    if (optind < argc)
+        files = argc - optind;
+    if (files <= 0 || rounds <= 0)
+    {
+        usage();
+        return 1;
+    }
+
+    paths = calloc((size_t)files, sizeof(char*));
+    if (paths == NULL)
+        return 1;
+
+    if (optind < argc)
+        for (i = 0; i < files; i++)
+            paths[i] = argv[optind + i];
+    else
+    {
+        double t0 = Now();
+
+        if (WriteCorpus(dir, files, seed, paths))
+            return 1;
+        printf("Wrote %d synthetic image files with seed %u into '%s' in %.2f s\n", files, seed, dir, Now() - t0);
+    }
+
+    for (i = 0; i < files; i++)
+    {
+        PeImage img;
+
+        if (PeImageOpen(&img, paths[i]) == 0)
+        {
+            bytes += img.size;
+            PeImageClose(&img);
+        }
+    }
+
+    // Every stage is measured with everything else rpe64 would report, i.e. with the hash and entropy columns
+    memset(&opts, 0, sizeof(opts));
+    opts.format = RPE_FORMAT_CSV;
+    opts.hashes = 1;
+    opts.entropy = 1;
+    OutInit(&out);
+
+    runs = (size_t)files * (size_t)rounds;
+    for (s = 0; s <= STAGE_COUNT; s++)
+    {
+        latency[s] = malloc(runs * sizeof(double));
+        if (latency[s] == NULL)
+            return 1;
+        total[s] = 0;
+    }
+
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < files; i++)
+        {
+            size_t run = (size_t)r * (size_t)files + (size_t)i;
+            double sum = 0;
+
+            BenchFile(paths[i], &out, &opts, times);
+            for (s = 0; s < STAGE_COUNT; s++)
+            {
+                latency[s][run] = times[s];
+                total[s] += times[s];
+                sum += times[s];
+            }
+            latency[STAGE_COUNT][run] = sum;
+            total[STAGE_COUNT] += sum;
+        }
+
+    printf("%d files, %.1f MB, %d rounds\n\n", files, (double)bytes / 1e6, rounds);
+    printf("%-10s %12s %10s %12s %12s\n", "Stage", "Files/s", "MB/s", "p50 (us)", "p99 (us)");
+    for (s = 0; s <= STAGE_COUNT; s++)
+    {
+        double seconds = total[s] > 0 ? total[s] : 1e-9;
+
+        qsort(latency[s], runs, sizeof(double), LatencyCompare);
+        printf("%-10s %12.0f %10.1f %12.1f %12.1f\n", StageNames[s],
+               (double)runs / seconds, (double)bytes * rounds / 1e6 / seconds,
+               latency[s][(runs - 1) * 50 / 100] * 1e6, latency[s][(runs - 1) * 99 / 100] * 1e6);
+        free(latency[s]);
+    }
+
+    OutFree(&out);
+    if (optind >= argc)
+        for (i = 0; i < files; i++)
+            free(paths[i]);
+    free(paths);
+    return 0;
+}
@@ -1,16 +1,1013 @@
 #include <stdio.h>      // for standard I/O
+#include <stddef.h>     // for size_t
 #include <stdint.h>     //for uint16_t, uint32_t and uint64_t
+#include <string.h>     // for memcpy() in the field loads below
 
-int FilenameValid (char[]);
-int FiletypeValid (const char*);
-void FilenameCheck (char[]);
-void FiletypeCheck (const char*);
+/* Loads of the little-endian fields of the image file, straight from the mapped bytes
+ * The bytes are copied with memcpy(), which is safe at any alignment and compiles to a single load,
+ * and are only swapped on big-endian hosts, which is decided at compile time.
+ * Compilers that don't say the byte order of the host get the portable shifts, which work on any host.
+ */
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define PE_LOAD(type, p, swap) type v; memcpy(&v, p, sizeof(v)); return v
+#elif defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define PE_LOAD(type, p, swap) type v; memcpy(&v, p, sizeof(v)); return swap(v)
+#else
+#define PE_PORTABLE_LOADS
+#endif
+
+static inline uint16_t ReadLe16 (const unsigned char *p)
+{
+#ifdef PE_PORTABLE_LOADS
+    return (uint16_t)(p[0] | p[1] << 8);
+#else
+    PE_LOAD(uint16_t, p, __builtin_bswap16);
+#endif
+}
+
+static inline uint32_t ReadLe32 (const unsigned char *p)
+{
+#ifdef PE_PORTABLE_LOADS
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+#else
+    PE_LOAD(uint32_t, p, __builtin_bswap32);
+#endif
+}
+
+static inline uint64_t ReadLe64 (const unsigned char *p)
+{
+#ifdef PE_PORTABLE_LOADS
+    return (uint64_t)ReadLe32(p) | (uint64_t)ReadLe32(p + 4) << 32;
+#else
+    PE_LOAD(uint64_t, p, __builtin_bswap64);
+#endif
+}
+
+/* Read-only view of the complete contents of an image file
+ * The bytes are either memory-mapped from the file, or read into a heap buffer
+ * if the file can't be mapped (pipes and special files)
+ */
+typedef struct PeImage
+{
+    const unsigned char *data;  // First byte of the file
+    size_t size;                // Number of bytes in the file
+    int mapped;                 // 1 if data is a memory mapping, 0 if it's a heap buffer
+    int borrowed;               // 1 if data belongs to the caller, and isn't released by PeImageClose()
+} PeImage;
+
+// Errors of the directory decoders, stored in the xxxError fields of PeFile
+#define PE_ERROR_NONE 0             // The directory was decoded completely
+#define PE_ERROR_UNMAPPED 1         // An RVA or file offset of the directory doesn't point into the file
+#define PE_ERROR_TRUNCATED 2        // The directory runs past the end of its section or of the file
+#define PE_ERROR_MALFORMED 3        // A size, count or offset within the directory is inconsistent
+#define PE_ERROR_LIMIT 4            // The directory has more entries than the decoder keeps
+#define PE_ERROR_NO_MEMORY 5        // There was no memory for the decoded entries
+#define PE_ERROR_COUNT 6
+
+// Records the given error of a directory decoder, unless an earlier one has been recorded already
+static inline void PeSetError (int *error, int code)
+{
+    if (*error == PE_ERROR_NONE)
+        *error = code;
+}
+
+/* Bounds-checked cursor over a range of the mapped file, through which the directory decoders read the tables they walk
+ * A read past the end of the range returns 0 (or NULL) instead of reading out of bounds, moves the cursor to the end,
+ * and sets the error of the cursor to PE_ERROR_TRUNCATED, which stays set, so a walk only has to check it once
+ */
+typedef struct PeCursor
+{
+    const unsigned char *data;  // First byte of the range, NULL if the range is empty
+    uint32_t size;              // Number of bytes in the range
+    uint32_t pos;               // Offset of the next read within the range
+    int error;                  // PE_ERROR_NONE, or PE_ERROR_TRUNCATED once a read has run past the end
+} PeCursor;
+
+// Checks that the given number of bytes can be read, and otherwise moves the cursor to the end and sets its error
+static inline int CursorNeed (PeCursor *c, uint32_t n)
+{
+    if (c->size - c->pos >= n)
+        return 1;
+    c->pos = c->size;
+    c->error = PE_ERROR_TRUNCATED;
+    return 0;
+}
+
+static inline uint16_t CursorU16 (PeCursor *c)
+{
+    if (!CursorNeed(c, 2))
+        return 0;
+    c->pos += 2;
+    return ReadLe16(c->data + c->pos - 2);
+}
+
+static inline uint32_t CursorU32 (PeCursor *c)
+{
+    if (!CursorNeed(c, 4))
+        return 0;
+    c->pos += 4;
+    return ReadLe32(c->data + c->pos - 4);
+}
+
+static inline uint64_t CursorU64 (PeCursor *c)
+{
+    if (!CursorNeed(c, 8))
+        return 0;
+    c->pos += 8;
+    return ReadLe64(c->data + c->pos - 8);
+}
+
+// Reads a field that is 4 bytes wide in PE32 images and 8 bytes wide in PE32+ images, as given by wide
+static inline uint64_t CursorAddr (PeCursor *c, int wide)
+{
+    return wide ? CursorU64(c) : CursorU32(c);
+}
+
+// Returns a pointer to the next n bytes and moves past them, or returns NULL if they run past the end
+static inline const unsigned char* CursorBytes (PeCursor *c, uint32_t n)
+{
+    if (!CursorNeed(c, n))
+        return NULL;
+    c->pos += n;
+    return c->data + c->pos - n;
+}
+
+// Moves the cursor to the given offset within its range, returning 1 and setting its error if it's past the end
+static inline int CursorSeek (PeCursor *c, uint32_t pos)
+{
+    if (pos > c->size)
+    {
+        c->pos = c->size;
+        c->error = PE_ERROR_TRUNCATED;
+        return 1;
+    }
+    c->pos = pos;
+    return 0;
+}
+
+// Returns the number of bytes left to read
+static inline uint32_t CursorLeft (const PeCursor *c)
+{
+    return c->size - c->pos;
+}
+
+#define PE_DOS_HEADER_SIZE 64       // Size of the DOS Header, which ends with the e_lfanew field
+#define PE_NT_FIXED_SIZE 24         // Size of the PE signature and the Image File Header
+#define PE_SECTION_HEADER_SIZE 40   // Size of each entry within the Section Table
+#define PE_NUM_DATA_DIRECTORIES 16  // Number of data directory entries defined by the Microsoft Documentation
+
+#define PE32_MAGIC 0x10B            // Optional Header Magic Number of 32-bit executables
+#define PE32PLUS_MAGIC 0x20B        // Optional Header Magic Number of 64-bit executables
+
+// Outcome of parsing the headers of an image file, stored in PeFile.status
+#define PE_STATUS_OK 0              // All the headers were decoded
+#define PE_STATUS_OPEN_FAILED 1     // The file couldn't be opened or read
+#define PE_STATUS_NOT_PE 2          // The 'MZ' magic number or the PE signature is missing
+#define PE_STATUS_BAD_OPTIONAL 3    // The Image Optional Header is cut off, too small, or has an unknown magic number
+#define PE_STATUS_BAD_SECTIONS 4    // The headers were decoded, but the Section Table is cut off by the end of the file
+
+// Checks whether the Image File Header and the Image Optional Header of a parsed file can be used
+#define PE_HEADERS_VALID(pe) ((pe)->status == PE_STATUS_OK || (pe)->status == PE_STATUS_BAD_SECTIONS)
+
+// Important fields of the DOS Header
+typedef struct PeDos
+{
+    uint16_t e_magic;           // 'MZ' magic number
+    uint32_t e_lfanew;          // File offset of the PE signature
+} PeDos;
+
+// Fields of the Image File Header (COFF File Header)
+typedef struct PeCoff
+{
+    uint32_t Signature;
+    uint16_t Machine;
+    uint16_t NumberOfSections;
+    uint32_t TimeDateStamp;
+    uint32_t PointerToSymbolTable;
+    uint32_t NumberOfSymbols;
+    uint16_t SizeOfOptionalHeader;
+    uint16_t Characteristics;
+} PeCoff;
+
+/* Fields of the Image Optional Header, for both PE32 and PE32+ images
+ * The fields that are 4 bytes wide in PE32 and 8 bytes wide in PE32+ are stored as 64-bit values
+ * BaseOfData is only present in PE32 images, and is 0 for PE32+ images
+ */
+typedef struct PeOptional
+{
+    uint16_t Magic;
+    uint8_t MajorLinkerVersion;
+    uint8_t MinorLinkerVersion;
+    uint32_t SizeOfCode;
+    uint32_t SizeOfInitializedData;
+    uint32_t SizeOfUninitializedData;
+    uint32_t AddressOfEntryPoint;
+    uint32_t BaseOfCode;
+    uint32_t BaseOfData;
+    uint64_t ImageBase;
+    uint32_t SectionAlignment;
+    uint32_t FileAlignment;
+    uint16_t MajorOperatingSystemVersion;
+    uint16_t MinorOperatingSystemVersion;
+    uint16_t MajorImageVersion;
+    uint16_t MinorImageVersion;
+    uint16_t MajorSubsystemVersion;
+    uint16_t MinorSubsystemVersion;
+    uint32_t Win32VersionValue;
+    uint32_t SizeOfImage;
+    uint32_t SizeOfHeaders;
+    uint32_t CheckSum;
+    uint16_t Subsystem;
+    uint16_t DllCharacteristics;
+    uint64_t SizeOfStackReserve;
+    uint64_t SizeOfStackCommit;
+    uint64_t SizeOfHeapReserve;
+    uint64_t SizeOfHeapCommit;
+    uint32_t LoaderFlags;
+    uint32_t NumberOfRvaAndSizes;
+} PeOptional;
+
+// Relative virtual address and size of a data directory entry
+typedef struct PeDataDir
+{
+    uint32_t VirtualAddress;
+    uint32_t Size;
+} PeDataDir;
+
+// Fields of a Section Table entry
+typedef struct PeSection
+{
+    char Name[9];               // 8-byte name, always NUL-terminated here
+    uint32_t VirtualSize;
+    uint32_t VirtualAddress;
+    uint32_t SizeOfRawData;
+    uint32_t PointerToRawData;
+    uint32_t PointerToRelocations;
+    uint32_t PointerToLinenumbers;
+    uint16_t NumberOfRelocations;
+    uint16_t NumberOfLinenumbers;
+    uint32_t Characteristics;
+} PeSection;
+
+/* Fields of the Load Configuration Structure (IMAGE_LOAD_CONFIG_DIRECTORY), for both PE32 and PE32+ images
+ * The structure has grown with each version of Windows, and its Size field says how many of its fields are present,
+ * those beyond it being 0 here
+ * The fields that are 4 bytes wide in PE32 and 8 bytes wide in PE32+, mostly virtual addresses, are stored as 64-bit values
+ */
+typedef struct PeLoadConfig
+{
+    uint32_t Size;
+    uint32_t TimeDateStamp;
+    uint16_t MajorVersion;
+    uint16_t MinorVersion;
+    uint32_t GlobalFlagsClear;
+    uint32_t GlobalFlagsSet;
+    uint32_t CriticalSectionDefaultTimeout;
+    uint64_t DeCommitFreeBlockThreshold;
+    uint64_t DeCommitTotalFreeThreshold;
+    uint64_t LockPrefixTable;
+    uint64_t MaximumAllocationSize;
+    uint64_t VirtualMemoryThreshold;
+    uint64_t ProcessAffinityMask;
+    uint32_t ProcessHeapFlags;
+    uint16_t CSDVersion;
+    uint16_t DependentLoadFlags;
+    uint64_t EditList;
+    uint64_t SecurityCookie;
+    uint64_t SEHandlerTable;
+    uint64_t SEHandlerCount;
+    uint64_t GuardCFCheckFunctionPointer;
+    uint64_t GuardCFDispatchFunctionPointer;
+    uint64_t GuardCFFunctionTable;
+    uint64_t GuardCFFunctionCount;
+    uint32_t GuardFlags;
+    uint16_t CodeIntegrityFlags;
+    uint16_t CodeIntegrityCatalog;
+    uint32_t CodeIntegrityCatalogOffset;
+    uint64_t GuardAddressTakenIatEntryTable;
+    uint64_t GuardAddressTakenIatEntryCount;
+    uint64_t GuardLongJumpTargetTable;
+    uint64_t GuardLongJumpTargetCount;
+    uint64_t DynamicValueRelocTable;
+    uint64_t CHPEMetadataPointer;
+    uint64_t GuardRFFailureRoutine;
+    uint64_t GuardRFFailureRoutineFunctionPointer;
+    uint32_t DynamicValueRelocTableOffset;
+    uint16_t DynamicValueRelocTableSection;
+    uint64_t GuardRFVerifyStackPointerFunctionPointer;
+    uint32_t HotPatchTableOffset;
+    uint64_t EnclaveConfigurationPointer;
+    uint64_t VolatileMetadataPointer;
+    uint64_t GuardEHContinuationTable;
+    uint64_t GuardEHContinuationCount;
+    uint64_t GuardXFGCheckFunctionPointer;
+    uint64_t GuardXFGDispatchFunctionPointer;
+    uint64_t GuardXFGTableDispatchFunctionPointer;
+    uint64_t CastGuardOsDeterminedFailureMode;
+    uint64_t GuardMemcpyFunctionPointer;
+} PeLoadConfig;
+
+#define PE_LOAD_CONFIG_SIZE32 192       // Size of the latest Load Configuration Structure of PE32 images
+#define PE_LOAD_CONFIG_SIZE64 320       // Size of the latest Load Configuration Structure of PE32+ images
+
+// GuardFlags of the Load Configuration Structure that the mitigation summary is based on
+#define IMAGE_GUARD_CF_INSTRUMENTED 0x00000100
+#define IMAGE_GUARD_SECURITY_COOKIE_UNUSED 0x00000800
+#define IMAGE_GUARD_EH_CONTINUATION_TABLE_PRESENT 0x00400000
+#define IMAGE_GUARD_XFG_ENABLED 0x00800000
+#define IMAGE_GUARD_CF_FUNCTION_TABLE_SIZE_SHIFT 28     // The high 4 bits are the number of extra bytes of each entry of the CFG function table
+
+#define PE_MITIGATION_COUNT 6       // Number of mitigations found by LoadConfigMitigations(), i.e. of LoadConfigMitigationNames
+
+/* Range of RVAs that a section occupies in memory, as stored in the RVA index
+ * The index is sorted by start RVA, so that an RVA is resolved with a binary search,
+ * and the offset index by rawOffset, so that a file offset is resolved the same way
+ */
+typedef struct PeRvaRange
+{
+    uint32_t start;             // First RVA of the section
+    uint32_t end;               // RVA just past the section, i.e. VirtualSize rounded up to SectionAlignment
+    uint32_t rawOffset;         // File offset of the raw data of the section (PointerToRawData)
+    uint32_t rawSize;           // Number of bytes at the start of the range that are backed by raw data
+    uint16_t section;           // Index of the section within PeFile.sections
+} PeRvaRange;
+
+/* Flag or value of a header field, for naming the value through a table
+ * A flag matches when the bits of its mask in the value are equal to its value,
+ * so that fields holding multi-bit values, like the alignment of a section, are named correctly
+ */
+typedef struct PeFlag
+{
+    uint32_t mask;
+    uint32_t value;
+    const char *name;
+} PeFlag;
+
+// How the value of a header field is shown in the text output, stored in PeField.show
+#define PE_SHOW_DEC 0               // Decimal number
+#define PE_SHOW_HEX 1               // Hexadecimal number
+#define PE_SHOW_BYTES 2             // Decimal number of bytes
+#define PE_SHOW_CHARS 3             // Hexadecimal number followed by its bytes as characters, for signatures
+#define PE_SHOW_NAME 4              // NUL-padded name, stored as a string in the model
+#define PE_SHOW_MACHINE 5           // Machine type, named through the dense machine table
+#define PE_SHOW_FLAGS 6             // Bit flags, named through every matching entry of the flag table of the field
+#define PE_SHOW_ENUM 7              // Enumerated value, named through the first matching entry of the flag table of the field
+
+// Layouts of the headers, i.e. the index into PeField.offset and PeField.width
+#define PE_LAYOUT_PE32 0
+#define PE_LAYOUT_PE32PLUS 1
+
+/* Descriptor of a field of a header, which says where the field is in the file and in the model, and how it's shown
+ * Every header is decoded, shown as text and written as JSON or CSV by walking the descriptor table of its layout
+ */
+typedef struct PeField
+{
+    const char *name;           // Name from the Microsoft Documentation, also used for JSON keys and CSV columns
+    const char *label;          // Description in the text output, NULL if the field is left out of it
+    uint16_t offset[2];         // Offset of the field within the header, in PE32 and PE32+ images
+    uint8_t width[2];           // Width of the field in bytes, in PE32 and PE32+ images, 0 if it isn't present
+    uint16_t member;            // Offset of the field within the model of the header
+    uint8_t size;               // Size of the field within the model of the header
+    uint8_t show;               // One of the PE_SHOW_ values
+    const PeFlag *flags;        // Flag table of PE_SHOW_FLAGS and PE_SHOW_ENUM fields
+    uint8_t flagCount;
+} PeField;
+
+// Descriptor table of the fields of one header
+typedef struct PeFieldTable
+{
+    const PeField *fields;
+    uint16_t count;
+} PeFieldTable;
+
+// Function imported from a DLL, by name or by ordinal
+typedef struct PeImportFunc
+{
+    const char *name;           // Interned name of the function, NULL if it's imported by ordinal
+    uint16_t ordinal;           // Ordinal if the function is imported by ordinal, otherwise the hint
+    uint32_t iatRva;            // RVA of the Import Address Table slot the loader fills in for the function
+} PeImportFunc;
+
+// DLL imported through the Import Table or the Delay-load Import Table
+typedef struct PeImportDll
+{
+    const char *name;           // Interned name of the DLL
+    uint32_t timeDateStamp;     // Non-zero if the imports are bound
+    int delayLoad;              // 1 if the DLL is imported through the Delay-load Import Table
+    uint32_t first;             // Index of the first function of the DLL within PeFile.importFuncs
+    uint32_t count;             // Number of functions imported from the DLL
+} PeImportDll;
+
+// Entry of the Export Address Table, i.e. a function exported by the image file
+typedef struct PeExport
+{
+    const char *name;           // Interned name of the export, NULL if it's exported by ordinal only
+    uint32_t ordinal;           // Ordinal of the export, i.e. its index in the Export Address Table plus the ordinal base
+    uint32_t rva;               // RVA of the exported function or data, 0 for unused ordinals
+    const char *forwarder;      // Interned 'DLL.Function' or 'DLL.#Ordinal' the export is forwarded to, or NULL
+} PeExport;
+
+// Entry of the hash table that finds an export by name
+typedef struct PeExportSlot
+{
+    const char *name;           // Interned name, NULL if the slot is empty
+    uint32_t hash;              // Low 32 bits of StrHash() of the name
+    uint32_t index;             // Index of the export within PeFile.exports
+} PeExportSlot;
+
+// Digests of the whole file, computed by PeFileHashes()
+typedef struct PeHashes
+{
+    unsigned char md5[16];
+    unsigned char sha1[20];
+    unsigned char sha256[32];
+    unsigned char imphash[16];  // MD5 of the normalised list of imports
+    int hasImphash;             // 1 if the file has imports, and so an imphash
+} PeHashes;
+
+// Entropy of the whole file and of its overlay in bits per byte, computed by PeFileEntropy()
+typedef struct PeEntropy
+{
+    double file;
+    double overlay;
+    uint64_t overlayOffset;     // File offset just past the headers and the raw data of every section
+    uint64_t overlaySize;       // Number of bytes from there to the end of the file
+} PeEntropy;
+
+// Leaf of the resource tree, i.e. one resource of the image file in one language
+typedef struct PeResource
+{
+    uint32_t typeId;            // Resource type, e.g. 16 for RT_VERSION, if typeName is NULL
+    const char *typeName;       // Interned name of the resource type, NULL if it's identified by typeId
+    uint32_t nameId;            // Resource ID, if name is NULL
+    const char *name;           // Interned name of the resource, NULL if it's identified by nameId
+    uint32_t lang;              // Language ID, e.g. 0x409 for English (United States)
+    uint32_t rva;               // RVA of the data of the resource
+    uint32_t size;              // Number of bytes of data
+    uint32_t codePage;
+} PeResource;
+
+// Key and value of a String structure of the StringFileInfo of the version information
+typedef struct PeVersionString
+{
+    const char *key;            // Interned key, e.g. "CompanyName"
+    const char *value;          // Interned value, converted from UTF-16 to UTF-8
+} PeVersionString;
+
+// Algorithms of the Authenticode digests
+#define PE_DIGEST_NONE 0            // Unknown or unsupported algorithm
+#define PE_DIGEST_SHA1 1
+#define PE_DIGEST_SHA256 2
+
+// Certificate types of the Attribute Certificate Table
+#define WIN_CERT_TYPE_X509 1
+#define WIN_CERT_TYPE_PKCS_SIGNED_DATA 2    // Authenticode signature
+#define WIN_CERT_TYPE_TS_STACK_SIGNED 4
+
+// Entry of the Attribute Certificate Table, i.e. a WIN_CERTIFICATE structure, decoded by PeFileCertificates()
+typedef struct PeCertificate
+{
+    uint32_t offset;            // File offset of the structure
+    uint32_t length;            // dwLength, including the 8-byte header
+    uint16_t revision;          // wRevision, 0x0200 for WIN_CERT_REVISION_2_0
+    uint16_t type;              // wCertificateType, 2 for WIN_CERT_TYPE_PKCS_SIGNED_DATA
+    int digestAlg;              // One of the PE_DIGEST_ values, for the signed digest of the image
+    unsigned char digest[32];   // Signed digest of the image, from the SpcIndirectDataContent of the PKCS #7 SignedData
+    const char *subject;        // Interned distinguished name of the signer, NULL if its certificate isn't included
+    const char *issuer;         // Interned distinguished name of the issuer of the signer's certificate, NULL if unknown
+} PeCertificate;
+
+// Block of the Base Relocation Table, i.e. the relocations of one 4 KB page
+typedef struct PeRelocPage
+{
+    uint32_t rva;               // PageRVA of the block
+    uint32_t count;             // Number of relocations, leaving out the ABSOLUTE padding and the parameters of HIGHADJ
+    uint32_t first;             // Index of the first entry of the block within PeFile.relocEntries
+    uint32_t entries;           // Number of 16-bit entries of the block
+} PeRelocPage;
+
+#define PE_RELOC_TYPES 16           // Relocation types, i.e. values of the high 4 bits of an entry
+
+// Entry of the Exception Table of x64 images, i.e. a RUNTIME_FUNCTION structure, giving the bounds of one function
+typedef struct PeFunction
+{
+    uint32_t begin;             // RVA of the first byte of the function
+    uint32_t end;               // RVA just past the function
+    uint32_t unwind;            // RVA of the UNWIND_INFO of the function
+} PeFunction;
+
+// TLS Directory, whose addresses are virtual addresses rather than RVAs
+typedef struct PeTls
+{
+    uint64_t rawDataStart;      // StartAddressOfRawData, the template of the TLS data
+    uint64_t rawDataEnd;        // EndAddressOfRawData
+    uint64_t addressOfIndex;    // Where the loader stores the TLS index
+    uint64_t addressOfCallbacks;    // NULL-terminated array of the TLS callbacks, which run before the entry point
+    uint32_t sizeOfZeroFill;
+    uint32_t characteristics;
+} PeTls;
+
+// Debug types of the Debug Directory, in PeDebugEntry.type
+#define IMAGE_DEBUG_TYPE_CODEVIEW 2
+#define IMAGE_DEBUG_TYPE_POGO 13
+#define IMAGE_DEBUG_TYPE_REPRO 16
+
+// Entry of the Debug Directory, i.e. an IMAGE_DEBUG_DIRECTORY structure
+typedef struct PeDebugEntry
+{
+    uint32_t characteristics;
+    uint32_t timeDateStamp;
+    uint16_t majorVersion;
+    uint16_t minorVersion;
+    uint32_t type;              // One of the IMAGE_DEBUG_TYPE_ values
+    uint32_t sizeOfData;
+    uint32_t addressOfRawData;  // RVA of the debug data, 0 if it isn't loaded into memory
+    uint32_t pointerToRawData;  // File offset of the debug data
+} PeDebugEntry;
+
+// CodeView record of the PDB of the image file, from an RSDS (PDB 7.0) or NB10 (PDB 2.0) debug entry
+typedef struct PeCodeView
+{
+    uint32_t signature;         // 'RSDS' or 'NB10' as a little-endian number, 0 if there's no CodeView record
+    unsigned char guid[16];     // GUID of the PDB as stored, i.e. with its first three fields little-endian, RSDS only
+    uint32_t stamp;             // Signature (time stamp) of the PDB, NB10 only
+    uint32_t age;               // Age of the PDB, which is incremented each time it's updated
+    const char *pdbPath;        // Interned path of the PDB, as given to the linker
+} PeCodeView;
+
+// Section contribution of a POGO debug entry, i.e. a COFF group of the linker, e.g. ".text$mn"
+typedef struct PePogoEntry
+{
+    uint32_t rva;
+    uint32_t size;
+    const char *name;           // Interned name of the group
+} PePogoEntry;
+
+#define PE_REPRO_HASH_MAX 64        // Largest hash of a REPRO debug entry that's kept
+
+// Directory decoders that have been run on a PeFile, stored in PeFile.parsed
+#define PE_PARSED_IMPORTS 0x01      // PeFileImports()
+#define PE_PARSED_EXPORTS 0x02      // PeFileExports()
+#define PE_PARSED_HASHES 0x04       // PeFileHashes()
+#define PE_PARSED_ENTROPY 0x08      // PeFileEntropy()
+#define PE_PARSED_RESOURCES 0x10    // PeFileResources()
+#define PE_PARSED_CERTIFICATES 0x20 // PeFileCertificates()
+#define PE_PARSED_AUTHENTICODE 0x40 // The Authenticode digest, by PeFileHashes() or PeFileAuthenticode()
+#define PE_PARSED_CHECKSUM 0x80     // The PE checksum, by PeFileHashes() or PeFileChecksum()
+#define PE_PARSED_RELOCATIONS 0x100 // PeFileRelocations()
+#define PE_PARSED_RELOC_ENTRIES 0x200   // PeFileRelocationEntries()
+#define PE_PARSED_FUNCTIONS 0x400   // PeFileFunctions()
+#define PE_PARSED_TLS 0x800         // PeFileTls()
+#define PE_PARSED_DEBUG 0x1000      // PeFileDebug()
+#define PE_PARSED_LOAD_CONFIG 0x2000    // PeFileLoadConfig()
+#define PE_PARSED_SIGNATURES 0x4000 // PeFileSignatures()
+
+// Match of a signature rule, see ExecutableSignatures.c
+typedef struct PeSigMatch
+{
+    const char *rule;           // Name of the rule, owned by the rules
+    uint64_t offset;            // File offset of the first byte of the match
+    uint32_t rva;               // RVA of the first byte of the match, if it's loaded into memory
+    int section;                // Index of the section whose raw data holds the match, -1 in the headers or outside the sections
+    int mapped;                 // 1 if the match is within a section or the headers, i.e. has an RVA
+} PeSigMatch;
+
+typedef struct SigRules SigRules;
+
+// String found by PeStringScan(), see ExecutableStrings.c
+typedef struct PeString
+{
+    uint64_t offset;            // File offset of the first byte of the string
+    uint64_t length;            // Number of characters of the string
+    int wide;                   // 1 for a UTF-16LE string, whose characters are 2 bytes apart, 0 for an ASCII string
+    const unsigned char *data;  // Bytes of the string within the mapped file, which aren't NUL-terminated
+    uint32_t rva;               // RVA of the first byte of the string, if it's loaded into memory
+    int section;                // Index of the section whose raw data holds the string, -1 in the headers or outside the sections
+    int mapped;                 // 1 if the string is within a section or the headers, i.e. has an RVA
+} PeString;
+
+typedef void (*PeStringFn)(void*, const PeString*);
+
+/* Parse-once model of an image file
+ * It's filled in by a single pass over the mapped file by PeFileOpen(),
+ * after which every output function reads the decoded fields from it
+ * instead of opening and decoding the file again
+ */
+typedef struct PeFile
+{
+    const char *path;           // Name of the file, as given by the user
+    PeImage image;              // Mapped contents of the file
+    int status;                 // One of the PE_STATUS_ values
+    PeDos dos;
+    PeCoff coff;
+    PeOptional opt;
+    PeDataDir dir[PE_NUM_DATA_DIRECTORIES];     // Entries beyond NumberOfRvaAndSizes are 0
+    PeSection *sections;
+    uint16_t sectionCount;      // Number of entries in sections
+    PeRvaRange *rvaIndex;       // Sections sorted by virtual address, for resolving RVAs
+    uint16_t rvaCount;          // Number of entries in rvaIndex
+    PeRvaRange *rawIndex;       // Disjoint ranges of the raw data of the sections sorted by file offset, for resolving file offsets
+    uint32_t rawCount;          // Number of entries in rawIndex
+    unsigned parsed;            // Combination of the PE_PARSED_ values
+    PeImportDll *importDlls;
+    uint32_t importDllCount;
+    PeImportFunc *importFuncs;  // Functions of all the imported DLLs, grouped by DLL
+    uint32_t importFuncCount;
+    int importsError;           // One of the PE_ERROR_ values, for the first problem found in the import tables
+    const char *exportDllName;  // Interned name of the image file from the Export Directory Table, NULL if it has none
+    uint32_t exportOrdinalBase;
+    PeExport *exports;          // Export Address Table, indexed by ordinal minus the ordinal base
+    uint32_t exportCount;
+    uint32_t exportNameCount;   // Number of names in the Export Name Pointer Table, several of which may refer to one export
+    PeExportSlot *exportSlots;  // Hash table of the export names, whose size is a power of 2
+    uint32_t exportSlotCount;
+    int exportsError;           // One of the PE_ERROR_ values, for the first problem found in the export tables
+    PeHashes hashes;
+    unsigned char (*sectionSha256)[32];     // SHA-256 of the raw data of each section, within the file
+    PeEntropy entropy;
+    double *sectionEntropy;     // Entropy of the raw data of each section, within the file
+    PeResource *resources;      // Leaves of the resource tree, in the order in which they're found
+    uint32_t resourceCount;
+    int resourcesError;         // One of the PE_ERROR_ values, for the first problem found in the resource tree
+    int hasVersion;             // 1 if a VS_VERSIONINFO resource with a VS_FIXEDFILEINFO was found
+    uint64_t fileVersion;       // FileVersionMS and FileVersionLS of the VS_FIXEDFILEINFO, i.e. four 16-bit parts
+    uint64_t productVersion;    // ProductVersionMS and ProductVersionLS of the VS_FIXEDFILEINFO
+    PeVersionString *versionStrings;    // Strings of every StringTable of the StringFileInfo
+    uint32_t versionStringCount;
+    char *manifest;             // NUL-terminated copy of the first RT_MANIFEST resource, NULL if there's none
+    PeCertificate *certificates;        // Entries of the Attribute Certificate Table
+    uint32_t certificateCount;
+    int certificatesError;      // One of the PE_ERROR_ values, for the first problem found in the certificate table
+    int authenticodeAlg;        // One of the PE_DIGEST_ values, that of the first signature or SHA-256 if there's none
+    unsigned char authenticode[32];     // Authenticode digest of the image, which leaves out the checksum and the certificates
+    uint32_t checksum;          // PE checksum of the file, to compare with the CheckSum field
+    PeRelocPage *relocPages;    // Blocks of the Base Relocation Table, in file order
+    uint32_t relocPageCount;
+    uint16_t *relocEntries;     // Every entry of every block, packed as in the file (type << 12 | offset), NULL unless kept
+    uint32_t relocEntryCount;
+    uint32_t relocCount;        // Number of relocations of every block
+    uint32_t relocTypes[PE_RELOC_TYPES];    // Number of entries of each type, including the ABSOLUTE padding
+    int relocsError;            // One of the PE_ERROR_ values, for the first problem found in the relocation blocks
+    PeFunction *functions;      // Entries of the Exception Table, sorted by address for PeFindFunction()
+    uint32_t functionCount;
+    uint32_t functionsUnsorted; // Number of entries that don't start after the previous one in the file, which the loader requires
+    uint32_t functionOverlaps;  // Number of entries that overlap the one before them, once sorted
+    uint32_t functionsInvalid;  // Number of entries that are empty or lie outside the executable sections
+    uint64_t functionBytes;     // Number of bytes of code covered by the entries
+    int functionsError;         // One of the PE_ERROR_ values, for the first problem found in the Exception Table
+    int hasTls;                 // 1 if the TLS Directory was found
+    PeTls tls;
+    uint64_t *tlsCallbacks;     // Virtual addresses of the TLS callbacks
+    uint32_t tlsCallbackCount;
+    int tlsError;               // One of the PE_ERROR_ values, for the first problem found in the TLS Directory or its callbacks
+    PeDebugEntry *debugEntries; // Entries of the Debug Directory
+    uint32_t debugCount;
+    int debugError;             // One of the PE_ERROR_ values, for the first problem found in the Debug Directory or its data
+    PeCodeView codeView;        // First CodeView record of the Debug Directory
+    int hasPogo;                // 1 if there's a POGO entry, i.e. the image was built with LTCG or profile-guided optimization
+    uint32_t pogoSignature;     // 'LTCG', 'PGU' or 'PGI' as a multi-character constant, stored in the file with its bytes reversed, or 0
+    PePogoEntry *pogoEntries;   // Section contributions of the first POGO entry
+    uint32_t pogoCount;
+    int hasRepro;               // 1 if there's a REPRO entry, i.e. the image was linked with /Brepro and its time stamps are hashes
+    unsigned char reproHash[PE_REPRO_HASH_MAX];     // Hash of the REPRO entry, empty if the entry has no data
+    uint32_t reproHashSize;
+    int hasLoadConfig;          // 1 if the Load Configuration Structure was found
+    PeLoadConfig loadConfig;
+    uint32_t loadConfigSize;    // Number of bytes of the structure that were decoded, i.e. its Size up to the latest known size
+    int loadConfigError;        // One of the PE_ERROR_ values, PE_ERROR_TRUNCATED if the structure runs past the end of its section or of the file
+    PeSigMatch *sigMatches;     // Matches of the signature rules that were kept, in file order
+    uint32_t sigMatchCount;
+    uint64_t sigMatchTotal;     // Number of matches found, including those that weren't kept
+    const char **sigRules;      // Names of the rules that matched, in the order they were found
+    uint32_t sigRuleCount;
+    int sigError;               // One of the PE_ERROR_ values, PE_ERROR_LIMIT if there were more matches than the ones kept
+} PeFile;
+
+/* Growable buffer that the output functions append their text to
+ * It's written out in one go, so that reports built on different threads never interleave
+ */
+typedef struct OutBuf
+{
+    char *data;
+    size_t len;                 // Number of bytes of text in the buffer
+    size_t cap;                 // Number of bytes allocated for the buffer
+} OutBuf;
+
+// Incremental MD5, SHA-1 and SHA-256 contexts, used through the Init/Update/Final functions
+typedef struct Md5Ctx
+{
+    uint32_t state[4];
+    uint64_t length;            // Number of bytes hashed so far
+    unsigned char block[64];    // Bytes of the incomplete block
+    size_t used;                // Number of bytes in block
+} Md5Ctx;
+
+typedef struct Sha1Ctx
+{
+    uint32_t state[5];
+    uint64_t length;
+    unsigned char block[64];
+    size_t used;
+} Sha1Ctx;
+
+typedef struct Sha256Ctx
+{
+    uint32_t state[8];
+    uint64_t length;
+    unsigned char block[64];
+    size_t used;
+} Sha256Ctx;
+
+// Output formats selected by the -f option
+#define RPE_FORMAT_TEXT 0           // Descriptive text (default)
+#define RPE_FORMAT_JSON 1           // One line of JSON per file (JSON Lines)
+#define RPE_FORMAT_CSV 2            // One row of comma-separated values per file, after a header row
+#define RPE_FORMAT_COLUMNAR 3       // Binary columnar file, in row groups, for 'rpe64 query' (see ColumnStore.c)
+
+// Types of the columns of the columnar format
+#define COLUMN_NUMBER 0             // Unsigned integer of 1, 2, 4 or 8 bytes per row
+#define COLUMN_STRING 1             // String per row, as an index into the dictionary of the row group
+#define COLUMN_LIST 2               // List of strings per row, as indexes into the dictionary of the row group
+
+#define COLUMN_MAGIC "RPE64COL"     // First 8 bytes of a columnar file
+#define COLUMN_VERSION 1
+#define COLUMN_GROUP_MAGIC 0x50524752u  // 'RGRP', first 4 bytes of a row group
+#define COLUMN_NAME_MAX 48          // Size of the name of a column, with its NUL terminator
+#define COLUMN_GROUP_ROWS 65536     // Number of rows of a full row group
+#define COLUMN_ALIGN 32             // Alignment of the row groups and of the column chunks within the file
+
+/* Header at the start of a columnar file, followed by the ColumnDesc of each column, and padded to COLUMN_ALIGN bytes
+ * Every number within a columnar file is in the native byte order
+ */
+typedef struct ColumnFileHeader
+{
+    char magic[8];              // COLUMN_MAGIC
+    uint32_t version;
+    uint32_t columnCount;
+} ColumnFileHeader;
+
+// Name and type of a column of a columnar file
+typedef struct ColumnDesc
+{
+    char name[COLUMN_NAME_MAX]; // Same as the name of the CSV column, e.g. 'optional.DllCharacteristics'
+    uint8_t type;               // One of the COLUMN_ types
+    uint8_t width;              // Number of bytes of each value of a COLUMN_NUMBER column
+    uint8_t reserved[6];
+} ColumnDesc;
+
+/* Header of a row group, followed by the ColumnChunk of each column and by the chunks themselves
+ * Row groups follow each other up to the end of the file
+ */
+typedef struct ColumnGroupHeader
+{
+    uint32_t magic;             // COLUMN_GROUP_MAGIC
+    uint32_t rows;              // Number of rows, at most COLUMN_GROUP_ROWS
+    uint64_t size;              // Number of bytes of the whole row group, including this header
+} ColumnGroupHeader;
+
+/* Where the values of one column are within a row group, and their statistics
+ * A COLUMN_NUMBER chunk holds rows values of the width of the column.
+ * A COLUMN_STRING chunk holds rows 32-bit dictionary indexes, then the dictionary.
+ * A COLUMN_LIST chunk holds rows + 1 32-bit offsets into its items, items 32-bit dictionary indexes, then the dictionary.
+ * A dictionary is made of dictCount + 1 32-bit offsets into the NUL-terminated strings that follow them.
+ */
+typedef struct ColumnChunk
+{
+    uint64_t offset;            // Offset of the chunk from the start of the row group, a multiple of COLUMN_ALIGN
+    uint64_t size;
+    uint64_t min;               // Smallest and largest value of a COLUMN_NUMBER chunk, or number of items of a row of a COLUMN_LIST chunk
+    uint64_t max;
+    uint32_t dictCount;         // Number of distinct strings, 0 for COLUMN_NUMBER chunks
+    uint32_t items;             // Number of items of all the rows of a COLUMN_LIST chunk
+} ColumnChunk;
+
+typedef struct ColumnWriter ColumnWriter;
+
+// Identity of a file within the result cache, from stat(), see ResultCache.c
+typedef struct CacheKey
+{
+    uint64_t dev, ino, size;
+    uint64_t mtime, ctime;      // Modification and status-change times, in nanoseconds
+    uint64_t content;           // Hash of the contents of the file, with '-V'
+    int hasContent;             // 1 if content was computed
+    int valid;                  // 0 if the file can't be cached, e.g. it can't be stat()'ed or it was modified just now
+} CacheKey;
+
+typedef struct ResultCache ResultCache;
+
+#define SIM_HASHES 128              // Number of MinHash values in the signature of a file, see SimilarityIndex.c
+
+typedef struct SimilarityIndex SimilarityIndex;
+
+// Command-line options that select what is reported for each file
+typedef struct RpeOptions
+{
+    int format;                 // -f: one of the RPE_FORMAT_ values
+    int fieldValues;            // -e: PE File Header information
+    int sectionInfo;            // -s: Section Table information
+    int threads;                // -j: number of worker threads in batch mode, 0 for one per CPU
+    int unordered;              // -u: write batch reports as soon as they're ready instead of in input order
+    const char *listFile;       // -l: file with newline-separated paths to scan, '-' for the standard input
+    int imports;                // -i: Import Table and Delay-load Import Table information
+    int exports;                // -x: Export Table information
+    int hashes;                 // -H: MD5, SHA-1, SHA-256, imphash and per-section SHA-256
+    int entropy;                // -E: entropy of the file, of its overlay and of each section
+    int resources;              // -r: resource tree, version information and manifest
+    int certificates;           // -a: Authenticode digest and signatures
+    int relocations;            // -b: summary of the base relocations, 2 with -B: every relocation as well
+    int functions;              // -p: functions of the Exception Table
+    int tls;                    // -t: TLS Directory and callbacks
+    int debug;                  // -d: Debug Directory, CodeView (PDB) identity, POGO and REPRO entries
+    int loadConfig;             // -c: Load Configuration Structure and the mitigations it enables
+    ResultCache *cache;         // -C: result cache opened by main(), NULL if there's none
+    int verifyCache;            // -V: hits of the result cache need the hash of the contents of the file to match as well
+    SimilarityIndex *similarity;    // -L: similarity index opened by main() that the scanned files are added to, NULL if there's none
+    const SigRules *signatures; // -S: signature rules loaded by main() that the files are scanned for, NULL if there are none
+    uint32_t strings;           // -n: least number of characters of the ASCII and UTF-16LE strings extracted, 0 if they aren't
+} RpeOptions;
+
+// Shape of a synthetic image file of the benchmark corpus, picked by BenchRandomShape()
+typedef struct BenchShape
+{
+    uint32_t seed;              // Seed of the pseudo-random contents of the file
+    int pe32plus;               // 1 for a PE32+ image, 0 for a PE32 image
+    uint32_t dlls;              // Number of imported DLLs
+    uint32_t funcsPerDll;       // Number of functions imported from each DLL
+    uint32_t exports;           // Number of exported functions
+    uint32_t resources;         // Number of RT_RCDATA resources
+    uint32_t extraSections;     // Number of data sections besides .text, .rdata and .rsrc
+    uint32_t codeSize;          // Number of bytes in the .text section
+    uint32_t overlaySize;       // Number of bytes appended after the last section
+} BenchShape;
+
+// Indexes of the data directory entries within PeFile.dir
+#define PE_DIR_EXPORT 0
+#define PE_DIR_IMPORT 1
+#define PE_DIR_RESOURCE 2
+#define PE_DIR_EXCEPTION 3
+#define PE_DIR_CERTIFICATE 4
+#define PE_DIR_BASERELOC 5
+#define PE_DIR_DEBUG 6
+#define PE_DIR_ARCHITECTURE 7
+#define PE_DIR_GLOBALPTR 8
+#define PE_DIR_TLS 9
+#define PE_DIR_LOAD_CONFIG 10
+#define PE_DIR_BOUND_IMPORT 11
+#define PE_DIR_IAT 12
+#define PE_DIR_DELAY_IMPORT 13
+#define PE_DIR_CLR_RUNTIME 14
+
+int FilenameValid (OutBuf*, char[]);
+int FiletypeValid (OutBuf*, const PeFile*);
+void FilenameCheck (OutBuf*, char[]);
+void FiletypeCheck (OutBuf*, const PeFile*);
 int ExecutableFieldValues2 (const char*);
-void ExecutableFieldValues (const char*);
-uint32_t HexToDec (unsigned char[]);
-uint16_t HexToDec16 (unsigned char[]);
-uint64_t HexToDec64 (unsigned char[]);
+void ExecutableFieldValues (OutBuf*, const PeFile*);
 void help();
-void ExecutableSectionInfo (const char*);
+void ExecutableSectionInfo (OutBuf*, const PeFile*);
+
+int PeImageOpen (PeImage*, const char*);
+void PeImageClose (PeImage*);
+const unsigned char* PeImageView (const PeImage*, uint64_t, uint64_t);
+const unsigned char* PeDosHeader (const PeImage*);
+const unsigned char* PeNtHeaders (const PeImage*);
+const unsigned char* PeSectionTable (const PeImage*, uint16_t*);
+void PeImageFromMemory (PeImage*, const void*, size_t);
+int PeCursorAtOffset (PeCursor*, const PeImage*, uint64_t, uint64_t);
+
+extern const PeFieldTable PeDosLayout, PeCoffLayout, PeOptionalLayout, PeSectionLayout, PeLoadConfigLayout;
+void PeDecodeFields (void*, const unsigned char*, const PeFieldTable*, int);
+uint64_t PeFieldValue (const void*, const PeField*);
+const char* PeMachineName (uint16_t);
+void ShowFlags (OutBuf*, uint32_t, const PeFlag*, size_t, int);
+void ShowFields (OutBuf*, const void*, const PeFieldTable*, int);
+
+int PeFileOpen (PeFile*, const char*);
+int PeFileOpenMemory (PeFile*, const char*, const void*, size_t);
+void PeFileClose (PeFile*);
+int ParsePeHeaders (PeFile*);
+int PeRvaToOffset (const PeFile*, uint32_t, uint32_t*, uint32_t*);
+int PeOffsetToRva (const PeFile*, uint64_t, uint32_t*, int*);
+const PeRvaRange* PeFindRawRange (const PeFile*, uint64_t);
+int PeSectionOfRva (const PeFile*, uint32_t);
+const unsigned char* PeFileRvaView (const PeFile*, uint32_t, uint32_t);
+int PeCursorAtRva (PeCursor*, const PeFile*, uint32_t, uint32_t);
+const char* PeStatusName (int);
+const char* PeErrorName (int);
+const char* PeErrorText (int);
+int PeFileError (const PeFile*, const char**);
+const char* PeFileRvaString (const PeFile*, uint32_t, size_t, size_t*);
+unsigned SectionAnomalies (const PeFile*, uint16_t);
+extern const char *const SectionAnomalyNames[];
+int PeFileImports (PeFile*);
+void ExecutableImports (OutBuf*, const PeFile*);
+int PeFileExports (PeFile*);
+const PeExport* PeFindExportByName (const PeFile*, const char*);
+const PeExport* PeFindExportByOrdinal (const PeFile*, uint32_t);
+void ExecutableExports (OutBuf*, const PeFile*);
+int PeFileHashes (PeFile*);
+void ExecutableHashes (OutBuf*, const PeFile*);
+int PeFileResources (PeFile*);
+const char* PeVersionValue (const PeFile*, const char*);
+size_t PeVersionKeys (const char *const **);
+void ExecutableResources (OutBuf*, const PeFile*);
+int PeFileCertificates (PeFile*);
+int PeFileAuthenticode (PeFile*);
+const char* PeDigestName (int);
+size_t PeDigestSize (int);
+void ExecutableCertificates (OutBuf*, const PeFile*);
+uint64_t PeChecksumAdd (const unsigned char*, size_t);
+void PeChecksumFinish (PeFile*, uint64_t);
+int PeFileChecksum (PeFile*);
+int PeFileRelocations (PeFile*);
+int PeFileRelocationEntries (PeFile*);
+const char* PeRelocTypeName (const PeFile*, unsigned);
+void ExecutableRelocations (OutBuf*, const PeFile*);
+int PeFileFunctions (PeFile*);
+const PeFunction* PeFindFunction (const PeFile*, uint32_t);
+uint64_t PeExecutableBytes (const PeFile*);
+void ExecutableFunctions (OutBuf*, const PeFile*);
+int PeFileTls (PeFile*);
+void ExecutableTls (OutBuf*, const PeFile*);
+int PeFileDebug (PeFile*);
+const char* PeDebugTypeName (uint32_t);
+void PeCodeViewGuid (const PeCodeView*, char[39]);
+void PeCodeViewKey (const PeCodeView*, char[41]);
+void ExecutableDebug (OutBuf*, const PeFile*);
+int PeFileLoadConfig (PeFile*);
+PeFieldTable PeLoadConfigFields (const PeFile*);
+unsigned LoadConfigMitigations (const PeFile*);
+extern const char *const LoadConfigMitigationNames[];
+void ExecutableLoadConfig (OutBuf*, const PeFile*);
+int PeFileSignatures (PeFile*, const SigRules*);
+void ExecutableSignatures (OutBuf*, const PeFile*);
+int PeStringScan (const PeFile*, uint32_t, PeStringFn, void*, uint64_t[2]);
+void PeStringText (OutBuf*, const PeString*);
+void ExecutableStrings (OutBuf*, const PeFile*, uint32_t);
+void ByteHistogram (const unsigned char*, size_t, uint64_t[256]);
+double HistogramEntropy (const uint64_t[256]);
+int PeFileEntropy (PeFile*);
+void ExecutableEntropy (OutBuf*, const PeFile*);
+
+void Md5Init (Md5Ctx*);
+void Md5Update (Md5Ctx*, const void*, size_t);
+void Md5Final (Md5Ctx*, unsigned char[16]);
+void Sha1Init (Sha1Ctx*);
+void Sha1Update (Sha1Ctx*, const void*, size_t);
+void Sha1Final (Sha1Ctx*, unsigned char[20]);
+void Sha256Init (Sha256Ctx*);
+void Sha256Update (Sha256Ctx*, const void*, size_t);
+void Sha256Final (Sha256Ctx*, unsigned char[32]);
+
+const char* StrIntern (const char*, size_t);
+uint64_t StrHash (const char*, size_t);
+
+void OutInit (OutBuf*);
+void OutFree (OutBuf*);
+void OutReset (OutBuf*);
+int OutReserve (OutBuf*, size_t);
+void OutWrite (OutBuf*, const void*, size_t);
+void OutPuts (OutBuf*, const char*);
+void OutPrintf (OutBuf*, const char*, ...) __attribute__((format(printf, 2, 3)));
+int OutFlush (OutBuf*, FILE*);
+void OutChar (OutBuf*, char);
+void OutU64 (OutBuf*, uint64_t);
+void OutJsonString (OutBuf*, const char*);
+void OutCsvString (OutBuf*, const char*);
+void OutHex (OutBuf*, const unsigned char*, size_t);
+void OutFixed4 (OutBuf*, double);
+
+void JsonRecord (OutBuf*, const PeFile*, const RpeOptions*);
+void CsvHeader (OutBuf*, const RpeOptions*);
+void CsvRecord (OutBuf*, const PeFile*, const RpeOptions*);
+
+void BenchRandomShape (BenchShape*, uint32_t, uint32_t);
+uint64_t BenchWritePe (const char*, const BenchShape*);
+
+void ReportPe (OutBuf*, PeFile*, const RpeOptions*);
+int ReportFile (OutBuf*, const char*, const RpeOptions*);
+int BatchScan (char*[], int, const RpeOptions*);
+
+void ColumnRecord (OutBuf*, const PeFile*);
+ColumnWriter* ColumnOpen (FILE*);
+void ColumnAdd (ColumnWriter*, const char*, size_t);
+int ColumnClose (ColumnWriter*);
+int QueryMain (int, char*[]);
+
+ResultCache* CacheOpen (const char*, const RpeOptions*);
+int CacheLookup (ResultCache*, const char*, CacheKey*, OutBuf*, int*);
+void CacheStore (ResultCache*, const CacheKey*, const char*, const char*, size_t, int);
+void CacheClose (ResultCache*);
+
+int PeFileMinHash (PeFile*, uint32_t[SIM_HASHES]);
+SimilarityIndex* SimilarOpen (const char*);
+void SimilarAdd (SimilarityIndex*, PeFile*);
+int SimilarClose (SimilarityIndex*);
+int SimilarMain (int, char*[]);
+
+SigRules* SigRulesCompile (const char*, size_t, const char*);
+SigRules* SigRulesLoad (const char*);
+uint64_t SigRulesHash (const SigRules*);
+void SigRulesFree (SigRules*);
 
-#define MAX_ARG 3
\ No newline at end of file
+#define MAX_ARG 3
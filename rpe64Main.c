@@ -8,70 +8,276 @@
    Reference material used: https://docs.microsoft.com/en-us/windows/win32/debug/pe-format#machine-types
  */
 
+#define _POSIX_C_SOURCE 200809L    // for getopt() and the other POSIX functions under -std=c17
+
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>     //POSIX header file for getopt() function that helps in command-line arguments
+#include <sys/stat.h>
 #include "rpe64Header.h"
 
+/* Checks whether the given input needs the batch mode, i.e. whether it's a directory
+ * or '-', which stands for a list of paths on the standard input
+ */
+static int NeedsBatch(const char *input)
+{
+    struct stat sb;
+
+    return !strcmp(input, "-") || (stat(input, &sb) == 0 && S_ISDIR(sb.st_mode));
+}
+
 int main (int argc, char *argv[])
 {   
+    RpeOptions opts;
+    const char *cacheFile = NULL, *similarFile = NULL, *rulesFile = NULL;
+    SigRules *rules = NULL;
+    int ch, rc, batch = 0;
+
+    memset(&opts, 0, sizeof(opts));
+
     if (argc == 1)
     {
         help();
         return 1;
     }
-    else if (argc > 2)
-    {
-        char ch;
 
-        while ((ch = getopt(argc, argv, "es")) != EOF)      //POSIX function for command-line arguments
-            switch (ch)
-            {
-                case 'e':
-                    ExecutableFieldValues (argv[2]);
-                    break;
-                case 's':
-                    ExecutableSectionInfo (argv[2]);
-                    break;
-                default: 
+    // 'rpe64 query' runs queries on a columnar file rather than scanning files
+    if (!strcmp(argv[1], "query"))
+        return QueryMain(argc - 1, argv + 1);
+    // and 'rpe64 similar' looks files up in a similarity index
+    if (!strcmp(argv[1], "similar"))
+        return SimilarMain(argc - 1, argv + 1);
+
+    while ((ch = getopt(argc, argv, "esixHErabBptdcuVj:l:f:C:L:S:n:")) != -1)    //POSIX function for command-line arguments
+        switch (ch)
+        {
+            case 'f':
+                if (!strcmp(optarg, "json"))
+                    opts.format = RPE_FORMAT_JSON;
+                else if (!strcmp(optarg, "csv"))
+                    opts.format = RPE_FORMAT_CSV;
+                else if (!strcmp(optarg, "text"))
+                    opts.format = RPE_FORMAT_TEXT;
+                else if (!strcmp(optarg, "columnar"))
+                    opts.format = RPE_FORMAT_COLUMNAR;
+                else
+                {
                     help();
                     return 1;
+                }
+                break;
+            case 'e':
+                opts.fieldValues = 1;
+                break;
+            case 's':
+                opts.sectionInfo = 1;
+                break;
+            case 'i':
+                opts.imports = 1;
+                break;
+            case 'x':
+                opts.exports = 1;
+                break;
+            case 'H':
+                opts.hashes = 1;
+                break;
+            case 'E':
+                opts.entropy = 1;
+                break;
+            case 'r':
+                opts.resources = 1;
+                break;
+            case 'a':
+                opts.certificates = 1;
+                break;
+            case 'b':
+                if (!opts.relocations)
+                    opts.relocations = 1;
+                break;
+            case 'B':
+                opts.relocations = 2;
+                break;
+            case 'p':
+                opts.functions = 1;
+                break;
+            case 't':
+                opts.tls = 1;
+                break;
+            case 'd':
+                opts.debug = 1;
+                break;
+            case 'c':
+                opts.loadConfig = 1;
+                break;
+            case 'j':
+                opts.threads = atoi(optarg);
+                batch = 1;
+                break;
+            case 'u':
+                opts.unordered = 1;
+                batch = 1;
+                break;
+            case 'l':
+                opts.listFile = optarg;
+                batch = 1;
+                break;
+            case 'C':
+                cacheFile = optarg;
+                break;
+            case 'V':
+                opts.verifyCache = 1;
+                break;
+            case 'L':
+                similarFile = optarg;
+                break;
+            case 'S':
+                rulesFile = optarg;
+                break;
+            case 'n':
+                if (atoi(optarg) < 1)
+                {
+                    help();
+                    return 1;
+                }
+                opts.strings = (uint32_t)atoi(optarg);
+                break;
+            default: 
+                help();
+                return 1;
+        }
+    argc -= optind;
+    argv += optind;
+
+    if (argc == 0 && opts.listFile == NULL)
+    {
+        help();
+        return 1;
+    }
+
+    // Several inputs, directories and file lists are handled by the batch mode
+    if (argc > 1 || (argc == 1 && NeedsBatch(argv[0])))
+        batch = 1;
+
+    if (opts.format == RPE_FORMAT_COLUMNAR && isatty(STDOUT_FILENO))
+    {
+        fprintf(stderr, "rpe64: the columnar format is binary, redirect it to a file, e.g. '-f columnar <directory> > scan.col'\n");
+        return 1;
+    }
+
+    // The files reported on from the cache aren't parsed, so they couldn't be added to the similarity index
+    if (cacheFile != NULL && similarFile != NULL)
+    {
+        fprintf(stderr, "rpe64: the 'C' and 'L' options can't be used together\n");
+        return 1;
+    }
+
+    // The 'V' option checks the reports taken from the cache, so it means nothing without one
+    if (opts.verifyCache && cacheFile == NULL)
+    {
+        fprintf(stderr, "rpe64: the 'V' option needs a cache file, e.g. '-C scan.cache -V'\n");
+        return 1;
+    }
+
+    // The rules are compiled once, before the cache is opened, since their hash is part of the key of each cached report
+    if (rulesFile != NULL)
+    {
+        rules = SigRulesLoad(rulesFile);
+        if (rules == NULL)
+            return 1;
+        opts.signatures = rules;
+    }
+
+    // The cache is opened once the options are known, since they're part of the key of each cached report
+    if (cacheFile != NULL)
+        opts.cache = CacheOpen(cacheFile, &opts);
+    if (similarFile != NULL)
+        opts.similarity = SimilarOpen(similarFile);
+
+    if (batch)
+    {
+        rc = BatchScan(argv, argc, &opts);
+        CacheClose(opts.cache);
+        SigRulesFree(rules);
+        if (SimilarClose(opts.similarity))
+            rc = 1;
+        return rc;
+    }
+    else if (opts.fieldValues || opts.sectionInfo || opts.imports || opts.exports || opts.hashes || opts.entropy || opts.resources || opts.certificates || opts.relocations || opts.functions || opts.tls || opts.debug || opts.loadConfig || rules != NULL || opts.strings || opts.format != RPE_FORMAT_TEXT || similarFile != NULL || cacheFile != NULL)
+    {
+        OutBuf out;
+
+        OutInit(&out);
+        if (opts.format == RPE_FORMAT_CSV)
+            CsvHeader(&out, &opts);
+        rc = ReportFile(&out, argv[0], &opts);      // The file is opened and its headers are decoded only once, for every option
+        if (opts.format == RPE_FORMAT_COLUMNAR)
+        {
+            ColumnWriter *columns = ColumnOpen(stdout);
+
+            if (columns != NULL)
+                ColumnAdd(columns, out.data, out.len);
+            if (ColumnClose(columns))
+            {
+                fprintf(stderr, "rpe64: can't write the columnar file\n");
+                rc = 1;
             }
-            argc -= optind;
-            argv += optind;
+        }
+        else
+            OutFlush(&out, stdout);
+        OutFree(&out);
+        CacheClose(opts.cache);
+        SigRulesFree(rules);
+        if (SimilarClose(opts.similarity))
+            rc = 1;
+        return rc;      // 1 if the file couldn't be opened or isn't a PE image file, like in batch mode
     }
-    else if (argc == 2)
+    else
     {
         char choice;
+        PeFile pe;
+        OutBuf out;
+
+        OutInit(&out);
+        PeFileOpen(&pe, argv[0]);       // The file is opened and its headers are decoded only once, for every choice
 
-        FilenameCheck(argv[1]);
-        FiletypeCheck(argv[1]);
+        FilenameCheck(&out, argv[0]);
+        FiletypeCheck(&out, &pe);
 
-        printf ("\nDo you need additonal information?\n"
-                "\nDo you want\n"
-                "(A) PE File Header information? (Press 'A')\n"
-                "(B) Section Table information? (Press 'B')\n"
-                "(C) both (Press 'C')\n"
-                "(D) to exit? (Press anything else)\n");
+        OutPrintf (&out, "\nDo you need additonal information?\n"
+                         "\nDo you want\n"
+                         "(A) PE File Header information? (Press 'A')\n"
+                         "(B) Section Table information? (Press 'B')\n"
+                         "(C) both (Press 'C')\n"
+                         "(D) to exit? (Press anything else)\n");
+        OutFlush(&out, stdout);
+        fflush(stdout);
         scanf ("%c", &choice);
 
         switch (choice)
         {
             case 'c':
             case 'C':            
-                ExecutableFieldValues(argv[1]);
+                ExecutableFieldValues(&out, &pe);
             case 'b':
             case 'B': 
-                ExecutableSectionInfo(argv[1]);
+                ExecutableSectionInfo(&out, &pe);
                 break;
             case 'a':
             case 'A':
-                ExecutableFieldValues(argv[1]);
+                ExecutableFieldValues(&out, &pe);
                 break;
             default:
                 printf ("You entered an invalid value, exiting...\n");
+                PeFileClose(&pe);
+                OutFree(&out);
+                CacheClose(opts.cache);
                 help();
                 return 1;
         }
+        OutFlush(&out, stdout);
+        OutFree(&out);
+        PeFileClose(&pe);
+        CacheClose(opts.cache);
     }
 
     return 0;
@@ -79,14 +285,57 @@ int main (int argc, char *argv[])
 
 void help()
 {
-    printf ("\n1. The rpe64 program takes one input argument and has two options\n"
-            "2. If multiple input files are provided, the program will show nothing\n"
-            "3. Always provide the input file as the last command-line argument\n"
-            "4. Use the 'e' option for directly accessing PE File Header information\n"
-            "5. Use the 's' option for directly accessing Section Header Table information\n"
-            "6. If no option is provided, it'll run the default interface of the program\n"
-            "7. Only one option can be used at a time, and multiple options can't be combined\n"
-            "8. If a valid file isn't provided in the input and some random string is given as input, it'll be shown as Segmentation Fault\n"
-            "9. If you use multiple options at the same time or get the order of the command-line arguments wrong, it'll either show Segmentation Fault or do nothing\n"
-	        "10. If you forget to provide the '-' prefix before the option you intended to use, the program will do nothing\n\n");
+    printf ("\n1. The rpe64 program takes one or more input arguments and has the following options\n"
+            "2. Use the 'e' option for directly accessing PE File Header information, with the PE checksum of the file\n"
+            "   computed and compared with the Checksum field, which the 'H' option also adds to the 'json' and 'csv' formats\n"
+            "3. Use the 's' option for directly accessing Section Header Table information\n"
+            "4. Use the 'i' option for directly accessing the DLLs and functions imported through the Import Table\n"
+            "   and the Delay-load Import Table, which are also added to the records of the 'json' format\n"
+            "5. Use the 'x' option for directly accessing the functions exported through the Export Table,\n"
+            "   which are also added to the records of the 'json' format\n"
+            "6. Use the 'H' option for the MD5, SHA-1 and SHA-256 of the file, its imphash, and the SHA-256 of each section,\n"
+            "   which are also added to the records of the 'json' and 'csv' formats\n"
+            "7. Use the 'E' option for the entropy of the file, of its overlay and of each section, which is also\n"
+            "   added to the records of the 'json' and 'csv' formats and to the Section Table information\n"
+            "8. Use the 'r' option for the resource tree, the version information and the manifest, whose file and product\n"
+            "   versions and main version strings are also added to the records of the 'json' and 'csv' formats\n"
+            "9. Use the 'a' option for the Authenticode digest of the image and its signatures, with the signer of each and whether\n"
+            "   its signed digest matches the image (offline, without chain or revocation checks), also added to the 'json' and 'csv' formats\n"
+            "10. Use the 'b' option for the number of base relocations of each type and of each page, or the 'B' option for\n"
+            "   every relocation as well, whose summary is also added to the records of the 'json' and 'csv' formats\n"
+            "11. Use the 'p' option for the functions of the Exception Table of x64 executables, with the share of the code\n"
+            "   they cover and the checks of their entries, whose summary is also added to the 'json' and 'csv' formats\n"
+            "12. Use the 't' option for the TLS Directory and its callbacks, which run before the entry point,\n"
+            "   also added to the records of the 'json' and 'csv' formats\n"
+            "13. Use the 'd' option for the Debug Directory, with the GUID, age and path of the PDB and its symbol server key,\n"
+            "   and the REPRO and POGO entries, whose PDB identity is also added to the records of the 'json' and 'csv' formats\n"
+            "14. Use the 'c' option for the Load Configuration Structure and the mitigations it enables: the /GS cookie, SafeSEH,\n"
+            "   Control Flow Guard, XFG, EH continuation and CHPE metadata, which are also added to the 'json' and 'csv' formats\n"
+            "15. Use the 'S' option to scan the files for the byte patterns of a rule file, one '<name> [section=<name>|entry[:<bytes>]|any] <hex bytes>'\n"
+            "   per line with '?\?' for any byte and 'any' (the default) for matches anywhere in the file, e.g. '-S rules.txt',\n"
+            "   with the offset, section and RVA of each match, and the names of the rules that matched added to the 'json', 'csv'\n"
+            "   and 'columnar' formats\n"
+            "16. Use the 'n' option to extract the ASCII and UTF-16LE strings of at least the given number of characters, e.g. '-n 6',\n"
+            "   like the 'strings' tool, with the offset, RVA and section of each, which are also added to the 'json' format,\n"
+            "   and their number to the 'csv' format\n"
+            "17. The 'e', 's', 'i', 'x', 'H', 'E', 'r', 'a', 'b', 'p', 't', 'd', 'c', 'S' and 'n' options can be combined, e.g. './rpe64 -e -s <input image file name>.exe'\n"
+            "18. If no option is provided and a single file is given, it'll run the default interface of the program\n"
+            "19. If multiple input files, a directory, or '-' are given, the batch mode is used:\n"
+            "   directories are walked recursively, '-' reads newline-separated paths from the standard input,\n"
+            "   and every file found is reported on, under a '==> <file name> <==' line\n"
+            "20. Use the 'l' option to give a file with newline-separated paths to scan in batch mode, e.g. '-l list.txt'\n"
+            "21. Use the 'j' option to set the number of worker threads of the batch mode, e.g. '-j 8' (default: one per CPU)\n"
+            "22. Use the 'u' option to write each report of the batch mode as soon as it's ready, instead of in input order\n"
+            "23. Use the 'f' option to choose the output format: 'text' (default), 'json' for one line of JSON per file,\n"
+            "    'csv' for one row of comma-separated values per file after a header row, e.g. '-f json', or 'columnar'\n"
+            "    for a binary file of the header fields, section names, DLL names and matched rule names laid out by column, for 'rpe64 query'\n"
+            "24. Use the 'C' option to keep the reports in a cache file, from which unchanged files are reported on by later scans\n"
+            "    without being parsed, e.g. '-C scan.cache', and the 'V' option to also compare a hash of their contents\n"
+            "25. Run 'rpe64 query [-g <columns>] [-s <columns>] <columnar file> [<filter>...]' to count, group or list the files\n"
+            "    of a columnar file that pass filters such as 'optional.Magic=0x20b' or 'optional.DllCharacteristics&0x40=0'\n"
+            "26. Use the 'L' option to add the signatures of the imports, sections and Rich header of the files to a similarity index,\n"
+            "    e.g. '-L scan.lsh', then run 'rpe64 similar [-n <matches>] [-t <similarity>] scan.lsh <file>...' to find the files\n"
+            "    of the index most similar to the given ones, or 'rpe64 similar -a scan.lsh' for every pair of similar files\n"
+            "27. If a file isn't a valid PE image file, or can't be opened, it'll be reported as such\n"
+	        "28. If you forget to provide the '-' prefix before the option you intended to use, it'll be treated as a file name\n\n");
 }